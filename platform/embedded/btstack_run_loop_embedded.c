@@ -56,6 +56,7 @@
 
 
 #include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
 #include "btstack_run_loop_embedded.h"
 #include "btstack_linked_list.h"
 #include "btstack_util.h"
@@ -81,10 +82,6 @@
 // the run loop
 static btstack_linked_list_t data_sources;
 
-#ifdef TIMER_SUPPORT
-static btstack_linked_list_t timers;
-#endif
-
 #ifdef HAVE_EMBEDDED_TICK
 static volatile uint32_t system_ticks;
 #endif
@@ -119,25 +116,13 @@ static void btstack_run_loop_embedded_set_timer(btstack_timer_source_t *ts, uint
 }
 
 /**
- * Add timer to run_loop (keep list sorted)
+ * Add timer to run_loop
  */
 static void btstack_run_loop_embedded_add_timer(btstack_timer_source_t *ts){
 #ifdef TIMER_SUPPORT
-    btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) &timers; it->next ; it = it->next){
-        // don't add timer that's already in there
-        btstack_timer_source_t * next = (btstack_timer_source_t *) it->next;
-        if (next == ts){
-            log_error( "btstack_run_loop_timer_add error: timer to add already in list!");
-            return;
-        }
-        // exit if new timeout before list timeout
-        int32_t delta = btstack_time_delta(ts->timeout, next->timeout);
-        if (delta < 0) break;
-    }
-
-    ts->item.next = it->next;
-    it->next = (btstack_linked_item_t *) ts;
+    btstack_run_loop_base_add_timer(ts);
+#else
+    UNUSED(ts);
 #endif
 }
 
@@ -146,25 +131,13 @@ static void btstack_run_loop_embedded_add_timer(btstack_timer_source_t *ts){
  */
 static bool btstack_run_loop_embedded_remove_timer(btstack_timer_source_t *ts){
 #ifdef TIMER_SUPPORT
-    return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+    return btstack_run_loop_base_remove_timer(ts);
 #else
+    UNUSED(ts);
     return 0;
 #endif
 }
 
-static void btstack_run_loop_embedded_dump_timer(void){
-#ifdef TIMER_SUPPORT
-#ifdef ENABLE_LOG_INFO 
-    btstack_linked_item_t *it;
-    int i = 0;
-    for (it = (btstack_linked_item_t *) timers; it ; it = it->next){
-        btstack_timer_source_t *ts = (btstack_timer_source_t*) it;
-        log_info("timer %u, timeout %u\n", i, (unsigned int) ts->timeout);
-    }
-#endif
-#endif
-}
-
 static void btstack_run_loop_embedded_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
     ds->flags |= callback_types;
 }
@@ -179,12 +152,20 @@ static void btstack_run_loop_embedded_disable_data_source_callbacks(btstack_data
 void btstack_run_loop_embedded_execute_once(void) {
     btstack_data_source_t *ds;
 
+#ifdef ENABLE_RUN_LOOP_TRACE
+    btstack_run_loop_base_trace_iteration();
+#endif
+
     // process data sources
     btstack_data_source_t *next;
     for (ds = (btstack_data_source_t *) data_sources; ds != NULL ; ds = next){
         next = (btstack_data_source_t *) ds->item.next; // cache pointer to next data_source to allow data source to remove itself
         if (ds->flags & DATA_SOURCE_CALLBACK_POLL){
+#ifdef ENABLE_RUN_LOOP_TRACE
+            btstack_run_loop_base_trace_process_data_source(ds, DATA_SOURCE_CALLBACK_POLL);
+#else
             ds->process(ds, DATA_SOURCE_CALLBACK_POLL);
+#endif
         }
     }
     
@@ -198,14 +179,18 @@ void btstack_run_loop_embedded_execute_once(void) {
 #endif
 
     // process timers
-    while (timers) {
-        btstack_timer_source_t * ts = (btstack_timer_source_t *) timers;
+#if defined(ENABLE_RUN_LOOP_TRACE) && defined(HAVE_EMBEDDED_TICK)
+    // report lateness in ms instead of ticks
+    while (btstack_run_loop_base_timers) {
+        btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_run_loop_base_timers;
         int32_t delta = btstack_time_delta(ts->timeout, now);
         if (delta > 0) break;
-
-        btstack_run_loop_embedded_remove_timer(ts);
-        ts->process(ts);
+        btstack_run_loop_base_remove_timer(ts);
+        btstack_run_loop_base_trace_process_timer(ts, -delta * (int32_t) hal_tick_get_tick_period_in_ms());
     }
+#else
+    btstack_run_loop_base_process_timers(now);
+#endif
 #endif
     
     // disable IRQs and check if run loop iteration has been requested. if not, go to sleep
@@ -214,7 +199,13 @@ void btstack_run_loop_embedded_execute_once(void) {
         trigger_event_received = 0;
         hal_cpu_enable_irqs();
     } else {
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_wait_start();
         hal_cpu_enable_irqs_and_sleep();
+        btstack_run_loop_base_trace_wait_end();
+#else
+        hal_cpu_enable_irqs_and_sleep();
+#endif
     }
 }
 
@@ -253,6 +244,13 @@ static uint32_t btstack_run_loop_embedded_get_time_ms(void){
 }
 
 
+#ifdef ENABLE_RUN_LOOP_TRACE
+// time resolution limited by hal_time_ms / hal_tick
+static uint32_t btstack_run_loop_embedded_get_time_us(void){
+    return btstack_run_loop_embedded_get_time_ms() * 1000u;
+}
+#endif
+
 /**
  * trigger run loop iteration
  */
@@ -262,16 +260,17 @@ void btstack_run_loop_embedded_trigger(void){
 
 static void btstack_run_loop_embedded_init(void){
     data_sources = NULL;
-
-#ifdef TIMER_SUPPORT
-    timers = NULL;
-#endif
+    btstack_run_loop_base_init();
 
 #ifdef HAVE_EMBEDDED_TICK
     system_ticks = 0;
     hal_tick_init();
     hal_tick_set_handler(&btstack_run_loop_embedded_tick_handler);
 #endif
+
+#ifdef ENABLE_RUN_LOOP_TRACE
+    btstack_run_loop_base_trace_init(&btstack_run_loop_embedded_get_time_us);
+#endif
 }
 
 /**
@@ -288,7 +287,7 @@ static const btstack_run_loop_t btstack_run_loop_embedded = {
     &btstack_run_loop_embedded_add_timer,
     &btstack_run_loop_embedded_remove_timer,
     &btstack_run_loop_embedded_execute,
-    &btstack_run_loop_embedded_dump_timer,
+    &btstack_run_loop_base_dump_timer,
     &btstack_run_loop_embedded_get_time_ms,
 };
 
@@ -58,12 +58,16 @@
 #include <string.h>
 #include <unistd.h>   /* UNIX standard function definitions */
 #include <sys/types.h>
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 #include <libusb.h>
 
 #include "btstack_config.h"
 
 #include "btstack_debug.h"
+#include "btstack_linked_list.h"
 #include "hci.h"
 #include "hci_transport.h"
 
@@ -79,12 +83,30 @@
 #define HAVE_USB_VENDOR_ID_AND_PRODUCT_ID
 #endif
 
-#define ACL_IN_BUFFER_COUNT    3
+// number of submitted IN transfers for HCI Events and ACL Data
+#ifndef ACL_IN_BUFFER_COUNT
+#define ACL_IN_BUFFER_COUNT    4
+#endif
+#ifndef EVENT_IN_BUFFER_COUNT
 #define EVENT_IN_BUFFER_COUNT  3
+#endif
 #define SCO_IN_BUFFER_COUNT   10
 
+// number of outgoing ACL transfers that can be in flight at the same time
+#ifndef ACL_OUT_BUFFER_COUNT
+#define ACL_OUT_BUFFER_COUNT   4
+#endif
+#if ACL_OUT_BUFFER_COUNT < 1
+#error "ACL_OUT_BUFFER_COUNT must be at least 1"
+#endif
+
 #define ASYNC_POLLING_INTERVAL_MS 1
 
+// libusb provides its file descriptors via pollfds on POSIX systems. On Windows, we fall back to polling
+#ifndef _WIN32
+#define USE_LIBUSB_POLLFDS
+#endif
+
 //
 // Bluetooth USB Transport Alternate Settings:
 //
@@ -161,7 +183,7 @@ static struct libusb_device_descriptor desc;
 static libusb_device_handle * handle;
 
 static struct libusb_transfer *command_out_transfer;
-static struct libusb_transfer *acl_out_transfer;
+static struct libusb_transfer *acl_out_transfers[ACL_OUT_BUFFER_COUNT];
 static struct libusb_transfer *event_in_transfer[EVENT_IN_BUFFER_COUNT];
 static struct libusb_transfer *acl_in_transfer[ACL_IN_BUFFER_COUNT];
 
@@ -204,16 +226,29 @@ static uint8_t hci_cmd_buffer[3 + 256 + LIBUSB_CONTROL_SETUP_SIZE];
 static uint8_t hci_event_in_buffer[EVENT_IN_BUFFER_COUNT][HCI_ACL_BUFFER_SIZE]; // bigger than largest packet
 static uint8_t hci_acl_in_buffer[ACL_IN_BUFFER_COUNT][HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_BUFFER_SIZE]; 
 
+// outgoing buffers for ACL packets, packets are copied to allow for multiple transfers in flight
+static uint8_t hci_acl_out_buffer[ACL_OUT_BUFFER_COUNT][HCI_ACL_BUFFER_SIZE];
+
 // For (ab)use as a linked list of received packets
 static struct libusb_transfer *handle_packet;
 
-static int doing_pollfds;
-static int num_pollfds;
-static btstack_data_source_t * pollfd_data_sources;
+#ifdef USE_LIBUSB_POLLFDS
+typedef struct {
+    btstack_linked_item_t item;
+    btstack_data_source_t data_source;
+} usb_pollfd_data_source_t;
+
+static btstack_linked_list_t usb_pollfd_data_sources;
+#endif
+
+static int usb_pollfds_active;
 static btstack_timer_source_t usb_timer;
 static int usb_timer_active;
 
-static int usb_acl_out_active = 0;
+static int usb_acl_out_transfers_in_flight[ACL_OUT_BUFFER_COUNT];
+static int usb_acl_out_transfers_active;
+static int usb_acl_out_packet_sent_pending;
+static btstack_timer_source_t usb_acl_out_packet_sent_timer;
 static int usb_command_active = 0;
 
 // endpoint addresses
@@ -303,6 +338,14 @@ LIBUSB_CALL static void async_callback(struct libusb_transfer *transfer){
 #endif
 
     if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) {
+        for (c=0;c<ACL_OUT_BUFFER_COUNT;c++){
+            if (transfer == acl_out_transfers[c]){
+                usb_acl_out_transfers_in_flight[c] = 0;
+                libusb_free_transfer(transfer);
+                acl_out_transfers[c] = 0;
+                return;
+            }
+        }
         for (c=0;c<EVENT_IN_BUFFER_COUNT;c++){
             if (transfer == event_in_transfer[c]){
                 libusb_free_transfer(transfer);
@@ -442,6 +485,36 @@ static void handle_isochronous_data(uint8_t * buffer, uint16_t size){
 }
 #endif
 
+static void usb_emit_packet_sent(void){
+    // notify upper stack that provided buffer can be used again
+    uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+}
+
+static void usb_acl_out_packet_sent_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+    if (usb_acl_out_packet_sent_pending == 0) return;
+    usb_acl_out_packet_sent_pending = 0;
+    usb_emit_packet_sent();
+}
+
+static void usb_acl_out_transfer_done(struct libusb_transfer *transfer){
+    int c;
+    for (c = 0 ; c < ACL_OUT_BUFFER_COUNT ; c++){
+        if (transfer == acl_out_transfers[c]){
+            usb_acl_out_transfers_in_flight[c] = 0;
+            usb_acl_out_transfers_active--;
+            break;
+        }
+    }
+    // packet sent has been deferred as all transfers were in flight
+    if (usb_acl_out_packet_sent_pending == 0) return;
+    btstack_run_loop_remove_timer(&usb_acl_out_packet_sent_timer);
+    usb_acl_out_packet_sent_pending = 0;
+    usb_emit_packet_sent();
+}
+
 static void handle_completed_transfer(struct libusb_transfer *transfer){
 
     int resubmit = 0;
@@ -460,8 +533,7 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
         signal_done = 1;
     } else if (transfer->endpoint == acl_out_addr){
         // log_info("acl out done, size %u", transfer->actual_length);
-        usb_acl_out_active = 0;
-        signal_done = 1;
+        usb_acl_out_transfer_done(transfer);
 #ifdef ENABLE_SCO_OVER_HCI
     } else if (transfer->endpoint == sco_in_addr) {
         // log_info("handle_completed_transfer for SCO IN! num packets %u", transfer->NUM_ISO_PACKETS);
@@ -506,9 +578,7 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
     }
 
     if (signal_done){
-        // notify upper stack that provided buffer can be used again
-        uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
-        packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+        usb_emit_packet_sent();
     }
 
     if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
@@ -523,6 +593,25 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
     }   
 }
 
+#ifdef USE_LIBUSB_POLLFDS
+static void usb_set_timer_for_next_timeout(void){
+    if (usb_timer_active){
+        btstack_run_loop_remove_timer(&usb_timer);
+        usb_timer_active = 0;
+    }
+
+    // returns 0 if there are no pending timeouts or libusb handles them itself, e.g. with a timerfd
+    struct timeval tv;
+    int r = libusb_get_next_timeout(NULL, &tv);
+    if (r <= 0) return;
+
+    uint32_t timeout_ms = (uint32_t) ((tv.tv_sec * 1000) + ((tv.tv_usec + 999) / 1000));
+    btstack_run_loop_set_timer(&usb_timer, timeout_ms);
+    btstack_run_loop_add_timer(&usb_timer);
+    usb_timer_active = 1;
+}
+#endif
+
 static void usb_process_ds(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type) {
 
     UNUSED(ds);
@@ -550,6 +639,13 @@ static void usb_process_ds(btstack_data_source_t *ds, btstack_data_source_callba
         // handle case where libusb_close might be called by hci packet handler        
         if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
     }
+
+#ifdef USE_LIBUSB_POLLFDS
+    // libusb timeouts might have changed
+    if (usb_pollfds_active){
+        usb_set_timer_for_next_timeout();
+    }
+#endif
     // log_info("end usb_process_ds");
 }
 
@@ -567,6 +663,12 @@ static void usb_process_ts(btstack_timer_source_t *timer) {
     // actually handled the packet in the pollfds function
     usb_process_ds((struct btstack_data_source *) NULL, DATA_SOURCE_CALLBACK_READ);
 
+    // with pollfds, usb_process_ds already started the timer for the next libusb timeout
+    if (usb_pollfds_active) return;
+
+    // handle case where libusb_close might be called by hci packet handler
+    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+
     // Get the amount of time until next event is due
     long msec = ASYNC_POLLING_INTERVAL_MS;
 
@@ -578,6 +680,78 @@ static void usb_process_ts(btstack_timer_source_t *timer) {
     return;
 }
 
+#ifdef USE_LIBUSB_POLLFDS
+static void usb_pollfd_data_source_add(int fd, short events){
+    usb_pollfd_data_source_t * pollfd_data_source = (usb_pollfd_data_source_t *) malloc(sizeof(usb_pollfd_data_source_t));
+    if (pollfd_data_source == NULL){
+        log_error("Cannot allocate data source for pollfd %d", fd);
+        return;
+    }
+    memset(pollfd_data_source, 0, sizeof(usb_pollfd_data_source_t));
+
+    btstack_data_source_t * ds = &pollfd_data_source->data_source;
+    btstack_run_loop_set_data_source_fd(ds, fd);
+    btstack_run_loop_set_data_source_handler(ds, &usb_process_ds);
+    // on Linux, libusb signals completed transfers on the device fd with POLLOUT
+    if ((events & POLLIN) != 0){
+        btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
+    }
+    if ((events & POLLOUT) != 0){
+        btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_WRITE);
+    }
+    btstack_run_loop_add_data_source(ds);
+    btstack_linked_list_add(&usb_pollfd_data_sources, (btstack_linked_item_t *) pollfd_data_source);
+    log_info("pollfd added: fd %d, events %x", fd, events);
+}
+
+static void usb_pollfd_data_source_remove(usb_pollfd_data_source_t * pollfd_data_source){
+    btstack_run_loop_remove_data_source(&pollfd_data_source->data_source);
+    btstack_linked_list_remove(&usb_pollfd_data_sources, (btstack_linked_item_t *) pollfd_data_source);
+    free(pollfd_data_source);
+}
+
+LIBUSB_CALL static void usb_pollfd_added(int fd, short events, void * user_data){
+    UNUSED(user_data);
+    usb_pollfd_data_source_add(fd, events);
+}
+
+LIBUSB_CALL static void usb_pollfd_removed(int fd, void * user_data){
+    UNUSED(user_data);
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &usb_pollfd_data_sources);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        usb_pollfd_data_source_t * pollfd_data_source = (usb_pollfd_data_source_t *) btstack_linked_list_iterator_next(&it);
+        if (btstack_run_loop_get_data_source_fd(&pollfd_data_source->data_source) != fd) continue;
+        log_info("pollfd removed: fd %d", fd);
+        usb_pollfd_data_source_remove(pollfd_data_source);
+        return;
+    }
+}
+
+static int usb_pollfds_start(void){
+    // register for changes first, then add current file descriptors
+    libusb_set_pollfd_notifiers(NULL, &usb_pollfd_added, &usb_pollfd_removed, NULL);
+    const struct libusb_pollfd ** pollfd = libusb_get_pollfds(NULL);
+    if (pollfd == NULL){
+        libusb_set_pollfd_notifiers(NULL, NULL, NULL, NULL);
+        return 0;
+    }
+    int i;
+    for (i = 0 ; pollfd[i] != NULL ; i++){
+        usb_pollfd_data_source_add(pollfd[i]->fd, pollfd[i]->events);
+    }
+    free(pollfd);
+    return 1;
+}
+
+static void usb_pollfds_stop(void){
+    libusb_set_pollfd_notifiers(NULL, NULL, NULL, NULL);
+    while (usb_pollfd_data_sources != NULL){
+        usb_pollfd_data_source_remove((usb_pollfd_data_source_t *) usb_pollfd_data_sources);
+    }
+}
+#endif
+
 #ifndef HAVE_USB_VENDOR_ID_AND_PRODUCT_ID
 
 // list of known devices, using VendorID/ProductID tuples
@@ -1080,9 +1254,21 @@ static int usb_open(void){
     }
 
     command_out_transfer = libusb_alloc_transfer(0);
-    acl_out_transfer     = libusb_alloc_transfer(0);
-
-    // TODO check for error
+    if (!command_out_transfer) {
+        usb_close();
+        return LIBUSB_ERROR_NO_MEM;
+    }
+    for (c = 0 ; c < ACL_OUT_BUFFER_COUNT ; c++) {
+        acl_out_transfers[c] = libusb_alloc_transfer(0);
+        usb_acl_out_transfers_in_flight[c] = 0;
+        if (!acl_out_transfers[c]) {
+            usb_close();
+            return LIBUSB_ERROR_NO_MEM;
+        }
+    }
+    usb_acl_out_transfers_active = 0;
+    usb_acl_out_packet_sent_pending = 0;
+    usb_acl_out_packet_sent_timer.process = &usb_acl_out_packet_sent_timer_handler;
 
     libusb_state = LIB_USB_TRANSFERS_ALLOCATED;
 
@@ -1111,39 +1297,21 @@ static int usb_open(void){
  
      }
 
- #if 0
-    // Check for pollfds functionality
-    doing_pollfds = libusb_pollfds_handle_timeouts(NULL);
-#else
-    // NOTE: using pollfds doesn't work on Linux, so it is disable until further investigation
-    doing_pollfds = 0;
-#endif
+    usb_timer.process = usb_process_ts;
 
-    if (doing_pollfds) {
-        log_info("Async using pollfds:");
+#ifdef USE_LIBUSB_POLLFDS
+    // handle libusb events when its file descriptors become ready
+    usb_pollfds_active = usb_pollfds_start();
+#endif
 
-        const struct libusb_pollfd ** pollfd = libusb_get_pollfds(NULL);
-        for (num_pollfds = 0 ; pollfd[num_pollfds] ; num_pollfds++);
-        pollfd_data_sources = (btstack_data_source_t *)malloc(sizeof(btstack_data_source_t) * num_pollfds);
-        if (!pollfd_data_sources){
-            log_error("Cannot allocate data sources for pollfds");
-            usb_close();
-            return 1;            
-        }
-        memset(pollfd_data_sources, 0, sizeof(btstack_data_source_t) * num_pollfds);
-        for (r = 0 ; r < num_pollfds ; r++) {
-            btstack_data_source_t *ds = &pollfd_data_sources[r];
-            btstack_run_loop_set_data_source_fd(ds, pollfd[r]->fd);
-            btstack_run_loop_set_data_source_handler(ds, &usb_process_ds);
-            btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
-            btstack_run_loop_add_data_source(ds);
-            log_info("%u: %p fd: %u, events %x", r, pollfd[r], pollfd[r]->fd, pollfd[r]->events);
-        }
-        free(pollfd);
+    if (usb_pollfds_active) {
+        log_info("Async using pollfds, libusb handles timeouts: %u", libusb_pollfds_handle_timeouts(NULL));
+#ifdef USE_LIBUSB_POLLFDS
+        usb_set_timer_for_next_timeout();
+#endif
     } else {
         log_info("Async using timers:");
 
-        usb_timer.process = usb_process_ts;
         btstack_run_loop_set_timer(&usb_timer, ASYNC_POLLING_INTERVAL_MS);
         btstack_run_loop_add_timer(&usb_timer);
         usb_timer_active = 1;
@@ -1174,17 +1342,15 @@ static int usb_close(void){
                 usb_timer_active = 0;
             }
 
-            if (doing_pollfds){
-                int r;
-                for (r = 0 ; r < num_pollfds ; r++) {
-                    btstack_data_source_t *ds = &pollfd_data_sources[r];
-                    btstack_run_loop_remove_data_source(ds);
-                }
-                free(pollfd_data_sources);
-                pollfd_data_sources = NULL;
-                num_pollfds = 0;
-                doing_pollfds = 0;
+            btstack_run_loop_remove_timer(&usb_acl_out_packet_sent_timer);
+            usb_acl_out_packet_sent_pending = 0;
+
+#ifdef USE_LIBUSB_POLLFDS
+            if (usb_pollfds_active){
+                usb_pollfds_stop();
             }
+#endif
+            usb_pollfds_active = 0;
 
             /* fall through */
 
@@ -1203,6 +1369,15 @@ static int usb_close(void){
                     libusb_cancel_transfer(acl_in_transfer[c]);
                 }
             }
+            for (c = 0 ; c < ACL_OUT_BUFFER_COUNT ; c++) {
+                if (usb_acl_out_transfers_in_flight[c]){
+                    log_info("cancel acl_out_transfers[%u] = %p", c, acl_out_transfers[c]);
+                    libusb_cancel_transfer(acl_out_transfers[c]);
+                } else if (acl_out_transfers[c]) {
+                    libusb_free_transfer(acl_out_transfers[c]);
+                    acl_out_transfers[c] = 0;
+                }
+            }
 #ifdef ENABLE_SCO_OVER_HCI
             for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
                 if (sco_in_transfer[c]){
@@ -1254,6 +1429,16 @@ static int usb_close(void){
                     }
                 }
 
+                if (!completed) continue;
+
+                for (c=0;c<ACL_OUT_BUFFER_COUNT;c++){
+                    if (acl_out_transfers[c]) {
+                        log_info("acl_out_transfers[%u] still active (%p)", c, acl_out_transfers[c]);
+                        completed = 0;
+                        break;
+                    }
+                }
+
 #ifdef ENABLE_SCO_OVER_HCI
                 if (!completed) continue;
 
@@ -1345,22 +1530,42 @@ static int usb_send_acl_packet(uint8_t *packet, int size){
 
     // log_info("usb_send_acl_packet enter, size %u", size);
 
-    // prepare transfer
-    int completed = 0;
-    libusb_fill_bulk_transfer(acl_out_transfer, handle, acl_out_addr, packet, size,
-        async_callback, &completed, 0);
-    acl_out_transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
+    // find free transfer
+    int c;
+    for (c = 0 ; c < ACL_OUT_BUFFER_COUNT ; c++){
+        if (usb_acl_out_transfers_in_flight[c] == 0) break;
+    }
+    if (c == ACL_OUT_BUFFER_COUNT) return -1;
+    if (size > HCI_ACL_BUFFER_SIZE) return -1;
+
+    // copy packet, transfers to the same endpoint complete in the order they have been submitted
+    struct libusb_transfer * transfer = acl_out_transfers[c];
+    memcpy(hci_acl_out_buffer[c], packet, size);
+    libusb_fill_bulk_transfer(transfer, handle, acl_out_addr, hci_acl_out_buffer[c], size,
+        async_callback, NULL, 0);
+    transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
 
     // update stata before submitting transfer
-    usb_acl_out_active = 1;
+    usb_acl_out_transfers_in_flight[c] = 1;
+    usb_acl_out_transfers_active++;
 
-    r = libusb_submit_transfer(acl_out_transfer);
+    r = libusb_submit_transfer(transfer);
     if (r < 0) {
-        usb_acl_out_active = 0;
+        usb_acl_out_transfers_in_flight[c] = 0;
+        usb_acl_out_transfers_active--;
         log_error("Error submitting acl transfer, %d", r);
         return -1;
     }
 
+    // packet buffer can be used again. if there's a free transfer, report packet sent from run loop,
+    // otherwise, wait for first transfer to complete
+    usb_acl_out_packet_sent_pending = 1;
+    if (usb_acl_out_transfers_active < ACL_OUT_BUFFER_COUNT){
+        btstack_run_loop_remove_timer(&usb_acl_out_packet_sent_timer);
+        btstack_run_loop_set_timer(&usb_acl_out_packet_sent_timer, 0);
+        btstack_run_loop_add_timer(&usb_acl_out_packet_sent_timer);
+    }
+
     return 0;
 }
 
@@ -1369,7 +1574,8 @@ static int usb_can_send_packet_now(uint8_t packet_type){
         case HCI_COMMAND_DATA_PACKET:
             return !usb_command_active;
         case HCI_ACL_DATA_PACKET:
-            return !usb_acl_out_active;
+            if (usb_acl_out_packet_sent_pending) return 0;
+            return usb_acl_out_transfers_active < ACL_OUT_BUFFER_COUNT;
 #ifdef ENABLE_SCO_OVER_HCI
         case HCI_SCO_DATA_PACKET:
             if (!sco_enabled) return 0;
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2020 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define BTSTACK_FILE__ "btstack_run_loop_epoll.c"
+
+/*
+ *  btstack_run_loop_epoll.c
+ *
+ *  Run loop for Linux based on epoll
+ *
+ *  File descriptors are registered with the epoll instance when a data source is added or
+ *  its callbacks are enabled. Each iteration only processes data sources that are ready, so the
+ *  cost of an iteration doesn't depend on the number of registered data sources and there's
+ *  no FD_SETSIZE limit.
+ *
+ *  Disabling callbacks is lazy: the epoll registration is only reduced when an event arrives for a
+ *  callback type that is not enabled anymore. This avoids epoll_ctl calls for the common pattern of
+ *  disabling and re-enabling read/write callbacks for each block, e.g. in btstack_uart_block_posix.
+ */
+
+// enable POSIX functions (needed for -std=c99)
+#define _POSIX_C_SOURCE 200809
+
+#include "btstack_run_loop_epoll.h"
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_util.h"
+#include "btstack_linked_list.h"
+#include "btstack_debug.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+// max number of ready file descriptors processed per iteration
+#ifndef BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS
+#define BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS 32
+#endif
+
+// private flags stored in upper bits of btstack_data_source_t.flags
+#define DATA_SOURCE_FLAG_EPOLL_ADDED      0x8000u
+#define DATA_SOURCE_FLAG_EPOLL_READ       0x4000u
+#define DATA_SOURCE_FLAG_EPOLL_WRITE      0x2000u
+#define DATA_SOURCE_FLAG_EPOLL_REGISTERED (DATA_SOURCE_FLAG_EPOLL_READ | DATA_SOURCE_FLAG_EPOLL_WRITE)
+
+static int epoll_fd = -1;
+
+// events returned by epoll_wait, entries of removed data sources are cleared during processing
+static struct epoll_event ready_events[BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS];
+static int ready_events_num;
+
+// start time. tv_nsec = 0
+static struct timespec init_ts;
+
+static uint16_t btstack_run_loop_epoll_registered_for_callbacks(uint16_t callback_types){
+    uint16_t registered = 0;
+    if (callback_types & DATA_SOURCE_CALLBACK_READ){
+        registered |= DATA_SOURCE_FLAG_EPOLL_READ;
+    }
+    if (callback_types & DATA_SOURCE_CALLBACK_WRITE){
+        registered |= DATA_SOURCE_FLAG_EPOLL_WRITE;
+    }
+    return registered;
+}
+
+/**
+ * Update epoll registration of data source to given set of DATA_SOURCE_FLAG_EPOLL_READ/WRITE flags
+ */
+static void btstack_run_loop_epoll_register(btstack_data_source_t * ds, uint16_t registered){
+    uint16_t registered_before = ds->flags & DATA_SOURCE_FLAG_EPOLL_REGISTERED;
+    if (registered == registered_before) return;
+
+    struct epoll_event event;
+    event.events = 0;
+    event.data.ptr = ds;
+    if (registered & DATA_SOURCE_FLAG_EPOLL_READ){
+        event.events |= EPOLLIN;
+    }
+    if (registered & DATA_SOURCE_FLAG_EPOLL_WRITE){
+        event.events |= EPOLLOUT;
+    }
+
+    int op;
+    if (registered_before == 0){
+        op = EPOLL_CTL_ADD;
+    } else if (registered == 0){
+        op = EPOLL_CTL_DEL;
+    } else {
+        op = EPOLL_CTL_MOD;
+    }
+    int res = epoll_ctl(epoll_fd, op, ds->source.fd, &event);
+    if ((res < 0) && (op != EPOLL_CTL_DEL)){
+        log_error("epoll_ctl op %u for fd %u failed, errno %u", op, ds->source.fd, errno);
+        return;
+    }
+
+    ds->flags = (ds->flags & ~DATA_SOURCE_FLAG_EPOLL_REGISTERED) | registered;
+}
+
+/**
+ * Add data_source to run_loop
+ */
+static void btstack_run_loop_epoll_add_data_source(btstack_data_source_t *ds){
+    log_debug("btstack_run_loop_epoll_add_data_source %p with fd %u", ds, ds->source.fd);
+    btstack_run_loop_base_add_data_source(ds);
+    ds->flags = (ds->flags & ~DATA_SOURCE_FLAG_EPOLL_REGISTERED) | DATA_SOURCE_FLAG_EPOLL_ADDED;
+    if (ds->source.fd < 0) return;
+    btstack_run_loop_epoll_register(ds, btstack_run_loop_epoll_registered_for_callbacks(ds->flags));
+}
+
+/**
+ * Remove data_source from run loop
+ */
+static bool btstack_run_loop_epoll_remove_data_source(btstack_data_source_t *ds){
+    log_debug("btstack_run_loop_epoll_remove_data_source %p", ds);
+    bool removed = btstack_run_loop_base_remove_data_source(ds);
+    if (!removed) return false;
+
+    // unregister, fails silently if fd was already closed
+    if ((ds->source.fd >= 0) && ((ds->flags & DATA_SOURCE_FLAG_EPOLL_REGISTERED) != 0)){
+        btstack_run_loop_epoll_register(ds, 0);
+    }
+    ds->flags &= ~(DATA_SOURCE_FLAG_EPOLL_ADDED | DATA_SOURCE_FLAG_EPOLL_REGISTERED);
+
+    // data source might get removed from a callback: drop its pending events
+    int i;
+    for (i = 0; i < ready_events_num; i++){
+        if (ready_events[i].data.ptr == ds){
+            ready_events[i].data.ptr = NULL;
+        }
+    }
+    return true;
+}
+
+static void btstack_run_loop_epoll_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
+    ds->flags |= callback_types;
+    if ((ds->flags & DATA_SOURCE_FLAG_EPOLL_ADDED) == 0) return;
+    if (ds->source.fd < 0) return;
+    // only register additional events, events of disabled callbacks get dropped lazily
+    uint16_t registered = ds->flags & DATA_SOURCE_FLAG_EPOLL_REGISTERED;
+    btstack_run_loop_epoll_register(ds, registered | btstack_run_loop_epoll_registered_for_callbacks(ds->flags));
+}
+
+static void btstack_run_loop_epoll_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
+    // epoll registration is updated when an event for a disabled callback arrives
+    ds->flags &= ~(callback_types & ~(DATA_SOURCE_FLAG_EPOLL_ADDED | DATA_SOURCE_FLAG_EPOLL_REGISTERED));
+}
+
+/**
+ * @brief Queries the current time in ms since start
+ */
+static uint32_t btstack_run_loop_epoll_get_time_ms(void){
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    int64_t delta_sec  = (int64_t) now_ts.tv_sec  - (int64_t) init_ts.tv_sec;
+    int64_t delta_nsec = (int64_t) now_ts.tv_nsec - (int64_t) init_ts.tv_nsec;
+    return (uint32_t) ((delta_sec * 1000) + (delta_nsec / 1000000));
+}
+
+static void btstack_run_loop_epoll_process_event(int index){
+    btstack_data_source_t * ds = (btstack_data_source_t *) ready_events[index].data.ptr;
+    uint32_t events = ready_events[index].events;
+
+    // report errors and hang-ups to read and write callbacks like select() does, callbacks are
+    // expected to remove the data source. otherwise epoll_wait would report them again right away
+    if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && (ds->flags & DATA_SOURCE_CALLBACK_READ)){
+        log_debug("btstack_run_loop_epoll_execute: process read ds %p with fd %u", ds, ds->source.fd);
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_process_data_source(ds, DATA_SOURCE_CALLBACK_READ);
+#else
+        ds->process(ds, DATA_SOURCE_CALLBACK_READ);
+#endif
+        // removed by callback?
+        if (ready_events[index].data.ptr == NULL) return;
+    }
+    if ((events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && (ds->flags & DATA_SOURCE_CALLBACK_WRITE)){
+        log_debug("btstack_run_loop_epoll_execute: process write ds %p with fd %u", ds, ds->source.fd);
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_process_data_source(ds, DATA_SOURCE_CALLBACK_WRITE);
+#else
+        ds->process(ds, DATA_SOURCE_CALLBACK_WRITE);
+#endif
+        if (ready_events[index].data.ptr == NULL) return;
+    }
+
+    // drop registration for callbacks that have been disabled in the meantime
+    if (ds->source.fd < 0) return;
+    btstack_run_loop_epoll_register(ds, btstack_run_loop_epoll_registered_for_callbacks(ds->flags));
+}
+
+#ifdef ENABLE_RUN_LOOP_TRACE
+/**
+ * @brief Queries the current time in us, wraps around
+ */
+static uint32_t btstack_run_loop_epoll_get_time_us(void){
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    return (uint32_t) ((uint64_t) now_ts.tv_sec * 1000000u + (uint64_t) now_ts.tv_nsec / 1000u);
+}
+#endif
+
+/**
+ * Execute run_loop
+ */
+static void btstack_run_loop_epoll_execute(void) {
+    log_info("epoll run loop with monotonic clock");
+
+    while (true) {
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_iteration();
+#endif
+
+        // get next timeout, -1 = no timer
+        uint32_t now_ms = btstack_run_loop_epoll_get_time_ms();
+        int timeout_ms = (int) btstack_run_loop_base_get_time_until_timeout(now_ms);
+        log_debug("btstack_run_loop_epoll_execute next timeout in %d ms", timeout_ms);
+
+        // wait for ready FDs
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_wait_start();
+#endif
+        int num_events = epoll_wait(epoll_fd, ready_events, BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS, timeout_ms);
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_wait_end();
+#endif
+        if (num_events < 0){
+            if (errno != EINTR){
+                log_error("epoll_wait failed, errno %u", errno);
+            }
+            num_events = 0;
+        }
+
+        // process ready data sources
+        ready_events_num = num_events;
+        int i;
+        for (i = 0; i < num_events; i++){
+            if (ready_events[i].data.ptr == NULL) continue;
+            btstack_run_loop_epoll_process_event(i);
+        }
+        ready_events_num = 0;
+
+        // process timers
+        now_ms = btstack_run_loop_epoll_get_time_ms();
+        btstack_run_loop_base_process_timers(now_ms);
+    }
+}
+
+// set timer
+static void btstack_run_loop_epoll_set_timer(btstack_timer_source_t *a, uint32_t timeout_in_ms){
+    uint32_t time_ms = btstack_run_loop_epoll_get_time_ms();
+    a->timeout = time_ms + timeout_in_ms;
+    log_debug("btstack_run_loop_epoll_set_timer to %u ms (now %u, timeout %u)", a->timeout, time_ms, timeout_in_ms);
+}
+
+static void btstack_run_loop_epoll_init(void){
+    btstack_run_loop_base_init();
+    ready_events_num = 0;
+    if (epoll_fd >= 0){
+        close(epoll_fd);
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0){
+        log_error("epoll_create1 failed, errno %u", errno);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &init_ts);
+    init_ts.tv_nsec = 0;
+#ifdef ENABLE_RUN_LOOP_TRACE
+    btstack_run_loop_base_trace_init(&btstack_run_loop_epoll_get_time_us);
+#endif
+}
+
+static const btstack_run_loop_t btstack_run_loop_epoll = {
+    &btstack_run_loop_epoll_init,
+    &btstack_run_loop_epoll_add_data_source,
+    &btstack_run_loop_epoll_remove_data_source,
+    &btstack_run_loop_epoll_enable_data_source_callbacks,
+    &btstack_run_loop_epoll_disable_data_source_callbacks,
+    &btstack_run_loop_epoll_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    &btstack_run_loop_epoll_execute,
+    &btstack_run_loop_base_dump_timer,
+    &btstack_run_loop_epoll_get_time_ms,
+};
+
+/**
+ * Provide btstack_run_loop_epoll instance
+ */
+const btstack_run_loop_t * btstack_run_loop_epoll_get_instance(void){
+    return &btstack_run_loop_epoll;
+}
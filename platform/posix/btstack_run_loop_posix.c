@@ -49,10 +49,13 @@
 #include "btstack_run_loop_posix.h"
 
 #include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
 #include "btstack_util.h"
 #include "btstack_linked_list.h"
 #include "btstack_debug.h"
 
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/select.h>
@@ -60,12 +63,38 @@
 #include <time.h>
 #include <unistd.h>
 
-static void btstack_run_loop_posix_dump_timer(void);
+// size of queue for btstack_run_loop_posix_execute_code_on_main_thread, must be power of two
+#ifndef BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE
+#define BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE 64
+#endif
+
+#if (BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE & (BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE - 1)) != 0
+#error "BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE must be a power of two"
+#endif
+
+// bounded MPSC queue based on per-cell sequence numbers (D. Vyukov), uses GCC/Clang atomic builtins
+typedef struct {
+    uint32_t sequence;
+    void (*fn)(void * arg);
+    void * arg;
+} function_call_t;
 
 // the run loop
 static btstack_linked_list_t data_sources;
 static int data_sources_modified;
-static btstack_linked_list_t timers;
+
+// cross-thread function calls
+static function_call_t function_calls[BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE];
+static uint32_t function_calls_enqueue_pos;
+static uint32_t function_calls_dequeue_pos;
+static uint32_t function_calls_wakeup_pending;
+static btstack_data_source_t function_calls_data_source;
+// pipe is created on first cross-thread call or when run loop starts
+static int function_calls_pipe_fds[2] = { -1, -1 };
+static bool function_calls_pipe_valid;
+static pthread_mutex_t function_calls_pipe_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t run_loop_thread;
+static bool run_loop_thread_valid;
 
 // start time. tv_usec/tv_nsec = 0
 #ifdef _POSIX_MONOTONIC_CLOCK
@@ -94,44 +123,6 @@ static bool btstack_run_loop_posix_remove_data_source(btstack_data_source_t *ds)
     return btstack_linked_list_remove(&data_sources, (btstack_linked_item_t *) ds);
 }
 
-/**
- * Add timer to run_loop (keep list sorted)
- */
-static void btstack_run_loop_posix_add_timer(btstack_timer_source_t *ts){
-    btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) &timers; it->next ; it = it->next){
-        btstack_timer_source_t * next = (btstack_timer_source_t *) it->next;
-        btstack_assert(next != ts);
-        // exit if new timeout before list timeout
-        int32_t delta = btstack_time_delta(ts->timeout, next->timeout);
-        if (delta < 0) break;
-    }
-    ts->item.next = it->next;
-    it->next = (btstack_linked_item_t *) ts;
-    log_debug("Added timer %p at %u\n", ts, ts->timeout);
-    // btstack_run_loop_posix_dump_timer();
-}
-
-/**
- * Remove timer from run loop
- */
-static bool btstack_run_loop_posix_remove_timer(btstack_timer_source_t *ts){
-    // log_info("Removed timer %x at %u\n", (int) ts, (unsigned int) ts->timeout.tv_sec);
-    // btstack_run_loop_posix_dump_timer();
-    return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
-}
-
-static void btstack_run_loop_posix_dump_timer(void){
-#ifdef ENABLE_LOG_INFO    
-    btstack_linked_item_t *it;
-    int i = 1;
-    for (it = (btstack_linked_item_t *) timers; it ; it = it->next){
-        btstack_timer_source_t *ts = (btstack_timer_source_t*) it;
-        log_info("timer %u (%p): timeout %u\n", i++, ts, ts->timeout);
-    }
-#endif
-}
-
 static void btstack_run_loop_posix_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
     ds->flags |= callback_types;
 }
@@ -193,6 +184,140 @@ static uint32_t btstack_run_loop_posix_get_time_ms(void){
     return time_ms;
 }
 
+#ifdef ENABLE_RUN_LOOP_TRACE
+/**
+ * @brief Queries the current time in us, wraps around
+ */
+static uint32_t btstack_run_loop_posix_get_time_us(void){
+#ifdef _POSIX_MONOTONIC_CLOCK
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+    return (uint32_t) ((uint64_t) now_ts.tv_sec * 1000000u + (uint64_t) now_ts.tv_nsec / 1000u);
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t) ((uint64_t) tv.tv_sec * 1000000u + (uint64_t) tv.tv_usec);
+#endif
+}
+#endif
+
+static bool btstack_run_loop_posix_enqueue_function_call(void (*fn)(void *arg), void * arg){
+    uint32_t pos = __atomic_load_n(&function_calls_enqueue_pos, __ATOMIC_RELAXED);
+    function_call_t * call;
+    while (true){
+        call = &function_calls[pos & (BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE - 1)];
+        uint32_t sequence = __atomic_load_n(&call->sequence, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t) (sequence - pos);
+        if (diff == 0){
+            // cell free, try to claim it
+            if (__atomic_compare_exchange_n(&function_calls_enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0){
+            // queue full
+            return false;
+        } else {
+            pos = __atomic_load_n(&function_calls_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    call->fn  = fn;
+    call->arg = arg;
+    __atomic_store_n(&call->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool btstack_run_loop_posix_dequeue_function_call(function_call_t * result){
+    uint32_t pos = function_calls_dequeue_pos;
+    function_call_t * call = &function_calls[pos & (BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE - 1)];
+    uint32_t sequence = __atomic_load_n(&call->sequence, __ATOMIC_ACQUIRE);
+    if ((int32_t) (sequence - (pos + 1)) < 0) return false;
+    result->fn  = call->fn;
+    result->arg = call->arg;
+    __atomic_store_n(&call->sequence, pos + BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE, __ATOMIC_RELEASE);
+    function_calls_dequeue_pos = pos + 1;
+    return true;
+}
+
+static void btstack_run_loop_posix_process_function_calls(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(callback_type);
+
+    // drain pipe
+    uint8_t buffer[16];
+    while (read(ds->source.fd, buffer, sizeof(buffer)) > 0);
+
+    // allow next wakeup before processing queue, so calls posted from now on trigger a new wakeup
+    __atomic_store_n(&function_calls_wakeup_pending, 0, __ATOMIC_SEQ_CST);
+
+    // process calls queued so far, calls posted from callbacks are processed in the next iteration
+    uint32_t num_calls = __atomic_load_n(&function_calls_enqueue_pos, __ATOMIC_ACQUIRE) - function_calls_dequeue_pos;
+    while (num_calls > 0){
+        function_call_t call;
+        if (!btstack_run_loop_posix_dequeue_function_call(&call)) break;
+        num_calls--;
+        (*call.fn)(call.arg);
+    }
+}
+
+static bool btstack_run_loop_posix_function_calls_create_pipe(void){
+    if (__atomic_load_n(&function_calls_pipe_valid, __ATOMIC_ACQUIRE)) return true;
+    pthread_mutex_lock(&function_calls_pipe_mutex);
+    if (!function_calls_pipe_valid){
+        if (pipe(function_calls_pipe_fds) == 0){
+            fcntl(function_calls_pipe_fds[0], F_SETFL, fcntl(function_calls_pipe_fds[0], F_GETFL) | O_NONBLOCK);
+            fcntl(function_calls_pipe_fds[1], F_SETFL, fcntl(function_calls_pipe_fds[1], F_GETFL) | O_NONBLOCK);
+            __atomic_store_n(&function_calls_pipe_valid, true, __ATOMIC_RELEASE);
+        } else {
+            log_error("pipe for execute on main thread failed");
+        }
+    }
+    pthread_mutex_unlock(&function_calls_pipe_mutex);
+    return function_calls_pipe_valid;
+}
+
+bool btstack_run_loop_posix_execute_code_on_main_thread(void (*fn)(void *arg), void * arg){
+
+    // directly call function if already on btstack thread
+    if (__atomic_load_n(&run_loop_thread_valid, __ATOMIC_ACQUIRE) && pthread_equal(pthread_self(), run_loop_thread)){
+        (*fn)(arg);
+        return true;
+    }
+
+    if (!btstack_run_loop_posix_function_calls_create_pipe()){
+        return false;
+    }
+
+    if (!btstack_run_loop_posix_enqueue_function_call(fn, arg)){
+        log_error("Failed to post fn %p", fn);
+        return false;
+    }
+
+    // wake up run loop if no wakeup is pending
+    if (__atomic_exchange_n(&function_calls_wakeup_pending, 1, __ATOMIC_SEQ_CST) == 0){
+        const uint8_t wakeup = 0;
+        ssize_t res = write(function_calls_pipe_fds[1], &wakeup, 1);
+        UNUSED(res);
+    }
+    return true;
+}
+
+static void btstack_run_loop_posix_function_calls_init(void){
+    uint32_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE; i++){
+        function_calls[i].sequence = i;
+    }
+    function_calls_enqueue_pos = 0;
+    function_calls_dequeue_pos = 0;
+    function_calls_wakeup_pending = 0;
+    run_loop_thread_valid = false;
+}
+
+static void btstack_run_loop_posix_function_calls_start(void){
+    // a select() that is already waiting would not see a pipe created later, create it now if no call was posted yet
+    if (!btstack_run_loop_posix_function_calls_create_pipe()) return;
+    btstack_run_loop_set_data_source_fd(&function_calls_data_source, function_calls_pipe_fds[0]);
+    btstack_run_loop_set_data_source_handler(&function_calls_data_source, &btstack_run_loop_posix_process_function_calls);
+    btstack_run_loop_posix_enable_data_source_callbacks(&function_calls_data_source, DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_posix_add_data_source(&function_calls_data_source);
+}
+
 /**
  * Execute run_loop
  */
@@ -200,7 +325,6 @@ static void btstack_run_loop_posix_execute(void) {
     fd_set descriptors_read;
     fd_set descriptors_write;
     
-    btstack_timer_source_t       *ts;
     btstack_linked_list_iterator_t it;
     struct timeval * timeout;
     struct timeval tv;
@@ -212,7 +336,15 @@ static void btstack_run_loop_posix_execute(void) {
     log_info("POSIX run loop using ettimeofday fallback.");
 #endif
 
+    // calls from run loop thread are executed directly
+    run_loop_thread = pthread_self();
+    __atomic_store_n(&run_loop_thread_valid, true, __ATOMIC_RELEASE);
+    btstack_run_loop_posix_function_calls_start();
+
     while (true) {
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_iteration();
+#endif
         // collect FDs
         FD_ZERO(&descriptors_read);
         FD_ZERO(&descriptors_write);
@@ -239,22 +371,23 @@ static void btstack_run_loop_posix_execute(void) {
         
         // get next timeout
         timeout = NULL;
-        if (timers) {
-            ts = (btstack_timer_source_t *) timers;
+        now_ms = btstack_run_loop_posix_get_time_ms();
+        int32_t delta = btstack_run_loop_base_get_time_until_timeout(now_ms);
+        if (delta >= 0) {
             timeout = &tv;
-            uint32_t list_timeout  = ts->timeout;
-            now_ms = btstack_run_loop_posix_get_time_ms();
-            int32_t delta = btstack_time_delta(list_timeout, now_ms);
-            if (delta < 0){
-                delta = 0;
-            }
             tv.tv_sec  = delta / 1000;
             tv.tv_usec = (int) (delta - (tv.tv_sec * 1000)) * 1000;
             log_debug("btstack_run_loop_execute next timeout in %u ms", delta);
         }
                 
         // wait for ready FDs
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_wait_start();
+#endif
         select( highest_fd+1 , &descriptors_read, &descriptors_write, NULL, timeout);
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_wait_end();
+#endif
                 
 
         data_sources_modified = 0;
@@ -264,28 +397,27 @@ static void btstack_run_loop_posix_execute(void) {
             log_debug("btstack_run_loop_posix_execute: check ds %p with fd %u\n", ds, ds->source.fd);
             if (FD_ISSET(ds->source.fd, &descriptors_read)) {
                 log_debug("btstack_run_loop_posix_execute: process read ds %p with fd %u\n", ds, ds->source.fd);
+#ifdef ENABLE_RUN_LOOP_TRACE
+                btstack_run_loop_base_trace_process_data_source(ds, DATA_SOURCE_CALLBACK_READ);
+#else
                 ds->process(ds, DATA_SOURCE_CALLBACK_READ);
+#endif
             }
             if (data_sources_modified) break;
             if (FD_ISSET(ds->source.fd, &descriptors_write)) {
                 log_debug("btstack_run_loop_posix_execute: process write ds %p with fd %u\n", ds, ds->source.fd);
+#ifdef ENABLE_RUN_LOOP_TRACE
+                btstack_run_loop_base_trace_process_data_source(ds, DATA_SOURCE_CALLBACK_WRITE);
+#else
                 ds->process(ds, DATA_SOURCE_CALLBACK_WRITE);
+#endif
             }
         }
         log_debug("btstack_run_loop_posix_execute: after ds check\n");
         
         // process timers
         now_ms = btstack_run_loop_posix_get_time_ms();
-        while (timers) {
-            ts = (btstack_timer_source_t *) timers;
-            int32_t delta = btstack_time_delta(ts->timeout, now_ms);
-            if (delta > 0) break;
-            log_debug("btstack_run_loop_posix_execute: process timer %p\n", ts);
-            
-            // remove timer before processing it to allow handler to re-register with run loop
-            btstack_run_loop_posix_remove_timer(ts);
-            ts->process(ts);
-        }
+        btstack_run_loop_base_process_timers(now_ms);
     }
 }
 
@@ -298,7 +430,8 @@ static void btstack_run_loop_posix_set_timer(btstack_timer_source_t *a, uint32_t
 
 static void btstack_run_loop_posix_init(void){
     data_sources = NULL;
-    timers = NULL;
+    btstack_run_loop_base_init();
+    btstack_run_loop_posix_function_calls_init();
 #ifdef _POSIX_MONOTONIC_CLOCK
     clock_gettime(CLOCK_MONOTONIC, &init_ts);
     init_ts.tv_nsec = 0;
@@ -307,6 +440,9 @@ static void btstack_run_loop_posix_init(void){
     gettimeofday(&init_tv, NULL);
     init_tv.tv_usec = 0;
 #endif
+#ifdef ENABLE_RUN_LOOP_TRACE
+    btstack_run_loop_base_trace_init(&btstack_run_loop_posix_get_time_us);
+#endif
 }
 
 
@@ -317,10 +453,10 @@ static const btstack_run_loop_t btstack_run_loop_posix = {
     &btstack_run_loop_posix_enable_data_source_callbacks,
     &btstack_run_loop_posix_disable_data_source_callbacks,
     &btstack_run_loop_posix_set_timer,
-    &btstack_run_loop_posix_add_timer,
-    &btstack_run_loop_posix_remove_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
     &btstack_run_loop_posix_execute,
-    &btstack_run_loop_posix_dump_timer,
+    &btstack_run_loop_base_dump_timer,
     &btstack_run_loop_posix_get_time_ms,
 };
 
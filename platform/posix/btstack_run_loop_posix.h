@@ -54,6 +54,18 @@ extern "C" {
  */
 const btstack_run_loop_t * btstack_run_loop_posix_get_instance(void);
 
+/**
+ * @brief Execute code on BTstack run loop. Can be used to control BTstack from a different thread
+ * @note Uses a bounded lock-free queue of size BTSTACK_RUN_LOOP_POSIX_EXECUTE_QUEUE_SIZE. The run loop is woken up
+ *       via a pipe only if no wakeup is pending, queued calls are processed in batches. The pipe is created
+ *       on the first call from another thread or when the run loop starts.
+ *       If called on the run loop thread, fn is called directly.
+ * @param fn
+ * @param arg
+ * @returns false if queue is full
+ */
+bool btstack_run_loop_posix_execute_code_on_main_thread(void (*fn)(void *arg), void * arg);
+
 /* API_END */
 
 #if defined __cplusplus
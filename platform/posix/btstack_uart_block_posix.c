@@ -71,10 +71,12 @@ static const uint8_t * write_bytes_data;
 // block read
 static uint16_t  read_bytes_len;
 static uint8_t * read_bytes_data;
+static bool      read_bytes_partial;
 
 // callbacks
 static void (*block_sent)(void);
 static void (*block_received)(void);
+static void (*data_received)(uint16_t size);
 
 
 static int btstack_uart_posix_init(const btstack_uart_config_t * config){
@@ -145,6 +147,16 @@ static void btstack_uart_posix_process_read(btstack_data_source_t *ds) {
         return;
     }
 
+    if (read_bytes_partial){
+        // deliver whatever was read
+        read_bytes_len = 0;
+        btstack_run_loop_disable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
+        if (data_received){
+            data_received((uint16_t) bytes_read);
+        }
+        return;
+    }
+
     read_bytes_len   -= bytes_read;
     read_bytes_data  += bytes_read;
     if (read_bytes_len > 0) return;
@@ -403,15 +415,27 @@ static void btstack_uart_posix_send_block(const uint8_t *data, uint16_t size){
     btstack_run_loop_enable_data_source_callbacks(&transport_data_source, DATA_SOURCE_CALLBACK_WRITE);
 }
 
+static void btstack_uart_posix_set_data_received( void (*data_handler)(uint16_t size)){
+    data_received = data_handler;
+}
+
 static void btstack_uart_posix_receive_block(uint8_t *buffer, uint16_t len){
     read_bytes_data = buffer;
     read_bytes_len = len;
+    read_bytes_partial = false;
     btstack_run_loop_enable_data_source_callbacks(&transport_data_source, DATA_SOURCE_CALLBACK_READ);
 
     // go
     // btstack_uart_posix_process_read(&transport_data_source);
 }
 
+static void btstack_uart_posix_receive_available(uint8_t *buffer, uint16_t len){
+    read_bytes_data = buffer;
+    read_bytes_len = len;
+    read_bytes_partial = true;
+    btstack_run_loop_enable_data_source_callbacks(&transport_data_source, DATA_SOURCE_CALLBACK_READ);
+}
+
 // static void btstack_uart_posix_set_sleep(uint8_t sleep){
 // }
 // static void btstack_uart_posix_set_csr_irq_handler( void (*csr_irq_handler)(void)){
@@ -431,6 +455,8 @@ static const btstack_uart_block_t btstack_uart_posix = {
     /* int (*get_supported_sleep_modes); */                           NULL,
     /* void (*set_sleep)(btstack_uart_sleep_mode_t sleep_mode); */    NULL,
     /* void (*set_wakeup_handler)(void (*handler)(void)); */          NULL,
+    /* void (*set_data_received)(void (*handler)(uint16_t size)); */  &btstack_uart_posix_set_data_received,
+    /* void (*receive_available)(uint8_t *buffer, uint16_t len); */   &btstack_uart_posix_receive_available,
 };
 
 const btstack_uart_block_t * btstack_uart_block_posix_instance(void){
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "hci_transport_virtual_posix.c"
+
+/*
+ *  hci_transport_virtual_posix.c
+ *
+ *  PDUs are sent with 16-bit little endian length prefix
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hci_transport_virtual_posix.h"
+
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "hci_transport.h"
+
+// larger than ACL PDU
+#define VIRTUAL_POSIX_BUFFER_SIZE 4096
+
+static btstack_data_source_t virtual_posix_data_source;
+static uint8_t  virtual_posix_buffer[VIRTUAL_POSIX_BUFFER_SIZE];
+static uint16_t virtual_posix_buffer_len;
+
+static void hci_transport_virtual_posix_send_pdu(const uint8_t * pdu, uint16_t size){
+    uint8_t header[2];
+    little_endian_store_16(header, 0, size);
+    int fd = btstack_run_loop_get_data_source_fd(&virtual_posix_data_source);
+    const uint8_t * data[2] = { header, pdu };
+    const uint16_t  len[2]  = { 2, size };
+    int i;
+    for (i=0;i<2;i++){
+        uint16_t pos = 0;
+        while (pos < len[i]){
+            ssize_t bytes_written = write(fd, &data[i][pos], len[i] - pos);
+            if (bytes_written < 0){
+                if (errno == EINTR) continue;
+                log_error("write failed, errno %d", errno);
+                return;
+            }
+            pos += (uint16_t) bytes_written;
+        }
+    }
+}
+
+static void hci_transport_virtual_posix_process(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(callback_type);
+    int fd = btstack_run_loop_get_data_source_fd(ds);
+    ssize_t bytes_read = read(fd, &virtual_posix_buffer[virtual_posix_buffer_len], VIRTUAL_POSIX_BUFFER_SIZE - virtual_posix_buffer_len);
+    if (bytes_read <= 0){
+        if ((bytes_read < 0) && (errno == EINTR)) return;
+        log_info("peer closed connection");
+        hci_transport_virtual_posix_deinit();
+        return;
+    }
+    virtual_posix_buffer_len += (uint16_t) bytes_read;
+
+    // process complete PDUs
+    uint16_t pos = 0;
+    while (true){
+        uint16_t bytes_available = virtual_posix_buffer_len - pos;
+        if (bytes_available < 2u) break;
+        uint16_t size = little_endian_read_16(virtual_posix_buffer, pos);
+        if ((2u + size) > VIRTUAL_POSIX_BUFFER_SIZE){
+            log_error("PDU too large, size %u", size);
+            hci_transport_virtual_posix_deinit();
+            return;
+        }
+        if (bytes_available < (2u + size)) break;
+        hci_transport_virtual_receive_pdu(&virtual_posix_buffer[pos + 2u], size);
+        pos += 2u + size;
+    }
+    virtual_posix_buffer_len -= pos;
+    memmove(virtual_posix_buffer, &virtual_posix_buffer[pos], virtual_posix_buffer_len);
+}
+
+void hci_transport_virtual_posix_init(int fd){
+    virtual_posix_buffer_len = 0;
+    btstack_run_loop_set_data_source_fd(&virtual_posix_data_source, fd);
+    btstack_run_loop_set_data_source_handler(&virtual_posix_data_source, &hci_transport_virtual_posix_process);
+    btstack_run_loop_enable_data_source_callbacks(&virtual_posix_data_source, DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_add_data_source(&virtual_posix_data_source);
+    hci_transport_virtual_set_air_interface(&hci_transport_virtual_posix_send_pdu);
+}
+
+void hci_transport_virtual_posix_deinit(void){
+    hci_transport_virtual_set_air_interface(NULL);
+    btstack_run_loop_remove_data_source(&virtual_posix_data_source);
+}
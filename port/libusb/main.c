@@ -72,6 +72,11 @@
 static char tlv_db_path[100];
 static const btstack_tlv_t * tlv_impl;
 static btstack_tlv_posix_t   tlv_context;
+#ifdef ENABLE_HCI_INIT_CACHE
+#define TLV_DB_INIT_CACHE_PATH TLV_DB_PATH_PREFIX "init_cache" TLV_DB_PATH_POSTFIX
+static const btstack_tlv_t * init_cache_tlv_impl;
+static btstack_tlv_posix_t   init_cache_tlv_context;
+#endif
 static bd_addr_t             local_addr;
 
 int btstack_main(int argc, const char * argv[]);
@@ -132,6 +137,9 @@ static void packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *pack
                     break;
                 case HCI_STATE_OFF:
                     btstack_tlv_posix_deinit(&tlv_context);
+#ifdef ENABLE_HCI_INIT_CACHE
+                    btstack_tlv_set_instance(init_cache_tlv_impl, &init_cache_tlv_context);
+#endif
                     break;
                 default:
                     break;
@@ -235,6 +243,12 @@ int main(int argc, const char * argv[]){
     // handle CTRL-c
     signal(SIGINT, sigint_handler);
 
+#ifdef ENABLE_HCI_INIT_CACHE
+    // HCI init cache is used during power on, before BD_ADDR specific TLV can be opened
+    init_cache_tlv_impl = btstack_tlv_posix_init_instance(&init_cache_tlv_context, TLV_DB_INIT_CACHE_PATH);
+    btstack_tlv_set_instance(init_cache_tlv_impl, &init_cache_tlv_context);
+#endif
+
     // setup app
     btstack_main(argc, argv);
 
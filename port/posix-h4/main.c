@@ -78,6 +78,11 @@ int is_bcm;
 static char tlv_db_path[100];
 static const btstack_tlv_t * tlv_impl;
 static btstack_tlv_posix_t   tlv_context;
+#ifdef ENABLE_HCI_INIT_CACHE
+#define TLV_DB_INIT_CACHE_PATH TLV_DB_PATH_PREFIX "init_cache" TLV_DB_PATH_POSTFIX
+static const btstack_tlv_t * init_cache_tlv_impl;
+static btstack_tlv_posix_t   init_cache_tlv_context;
+#endif
 
 int btstack_main(int argc, const char * argv[]);
 static void local_version_information_handler(uint8_t * packet);
@@ -272,6 +277,12 @@ int main(int argc, const char * argv[]){
     // handle CTRL-c
     signal(SIGINT, sigint_handler);
 
+#ifdef ENABLE_HCI_INIT_CACHE
+    // HCI init cache is used during power on, before BD_ADDR specific TLV can be opened
+    init_cache_tlv_impl = btstack_tlv_posix_init_instance(&init_cache_tlv_context, TLV_DB_INIT_CACHE_PATH);
+    btstack_tlv_set_instance(init_cache_tlv_impl, &init_cache_tlv_context);
+#endif
+
     // setup app
     btstack_main(argc, argv);
 
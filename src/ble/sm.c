@@ -53,6 +53,7 @@
 #include "btstack_tlv.h"
 #include "gap.h"
 #include "hci.h"
+#include "hci_cmd_encoder.h"
 #include "hci_dump.h"
 #include "l2cap.h"
 
@@ -2464,7 +2465,7 @@ static void sm_run(void){
                 log_info("sm: hci_le_start_encryption ediv 0x%04x", setup->sm_peer_ediv);
                 uint32_t rand_high = big_endian_read_32(setup->sm_peer_rand, 0);
                 uint32_t rand_low  = big_endian_read_32(setup->sm_peer_rand, 4);
-                hci_send_cmd(&hci_le_start_encryption, connection->sm_handle,rand_low, rand_high, setup->sm_peer_ediv, peer_ltk_flipped);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_start_encryption(hci_reserve_cmd_packet_buffer(), connection->sm_handle, rand_low, rand_high, setup->sm_peer_ediv, peer_ltk_flipped));
                 return;
             }
 
@@ -2824,14 +2825,14 @@ static void sm_run(void){
                 sm_key_t stk_flipped;
                 reverse_128(setup->sm_ltk, stk_flipped);
                 connection->sm_engine_state = SM_PH2_W4_CONNECTION_ENCRYPTED;
-                hci_send_cmd(&hci_le_long_term_key_request_reply, connection->sm_handle, stk_flipped);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_long_term_key_request_reply(hci_reserve_cmd_packet_buffer(), connection->sm_handle, stk_flipped));
                 return;
             }
             case SM_RESPONDER_PH4_SEND_LTK_REPLY: {
                 sm_key_t ltk_flipped;
                 reverse_128(setup->sm_ltk, ltk_flipped);
                 connection->sm_engine_state = SM_PH4_W4_CONNECTION_ENCRYPTED;
-                hci_send_cmd(&hci_le_long_term_key_request_reply, connection->sm_handle, ltk_flipped);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_long_term_key_request_reply(hci_reserve_cmd_packet_buffer(), connection->sm_handle, ltk_flipped));
                 return;
             }
 
@@ -2862,7 +2863,7 @@ static void sm_run(void){
                 sm_key_t stk_flipped;
                 reverse_128(setup->sm_ltk, stk_flipped);
                 connection->sm_engine_state = SM_PH2_W4_CONNECTION_ENCRYPTED;
-                hci_send_cmd(&hci_le_start_encryption, connection->sm_handle, 0, 0, 0, stk_flipped);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_start_encryption(hci_reserve_cmd_packet_buffer(), connection->sm_handle, 0, 0, 0, stk_flipped));
                 return;
             }
 #endif
@@ -46,6 +46,7 @@
 #include "btstack_util.h"
 #include "btstack_bool.h"
 #include "hci.h"
+#include "hci_cmd_encoder.h"
 
 //
 // AES128 Configuration
@@ -130,6 +131,10 @@ static const uint8_t zero[16] = { 0 };
 
 static bool btstack_crypto_initialized;
 static bool btstack_crypto_wait_for_hci_result;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+// HCI LE Rand commands in flight for the current operation
+static uint8_t btstack_crypto_random_requests_pending;
+#endif
 static btstack_linked_list_t btstack_crypto_operations;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
@@ -277,7 +282,12 @@ static void btstack_crypto_aes128_start(const sm_key_t key, const sm_key_t plain
     reverse_128(key, key_flipped);
     reverse_128(plaintext, plaintext_flipped);
     btstack_crypto_wait_for_hci_result = 1;
-    hci_send_cmd(&hci_le_encrypt, key_flipped, plaintext_flipped);
+    // also called from HCI event handler for multi-block operations
+    if (!hci_can_send_command_packet_now()){
+        log_error("btstack_crypto_aes128_start called but cannot send packet now");
+        return;
+    }
+    hci_send_cmd_packet_buffer(hci_cmd_create_le_encrypt(hci_reserve_cmd_packet_buffer(), key_flipped, plaintext_flipped));
 }
 
 static inline void btstack_crypto_cmac_next_state(void){
@@ -825,6 +835,34 @@ static void btstack_crypto_ccm_calc_aad_xn(btstack_crypto_ccm_t * btstack_crypto
 #endif
 }
 
+static void btstack_crypto_random_request(void){
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    btstack_crypto_random_requests_pending++;
+#endif
+    btstack_crypto_wait_for_hci_result = true;
+    hci_send_cmd_packet_buffer(hci_cmd_create_le_rand(hci_reserve_cmd_packet_buffer()));
+}
+
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+// random data is not ordered, request more while earlier HCI LE Rand commands are in flight
+static bool btstack_crypto_random_requests_more(void){
+    if (btstack_crypto_random_requests_pending == 0u) return false;
+    btstack_crypto_t * btstack_crypto = (btstack_crypto_t*) btstack_linked_list_get_first_item(&btstack_crypto_operations);
+    uint16_t bytes_requested = btstack_crypto_random_requests_pending * 8u;
+    switch (btstack_crypto->operation){
+        case BTSTACK_CRYPTO_RANDOM:
+            return ((btstack_crypto_random_t *) btstack_crypto)->size > bytes_requested;
+#if defined(ENABLE_ECC_P256) && defined(USE_SOFTWARE_ECC_P256_IMPLEMENTATION)
+        case BTSTACK_CRYPTO_ECC_P256_GENERATE_KEY:
+            if (btstack_crypto_ecc_p256_key_generation_state != ECC_P256_KEY_GENERATION_GENERATING_RANDOM) return false;
+            return (btstack_crypto_ecc_p256_random_len + bytes_requested) < 64u;
+#endif
+        default:
+            return false;
+    }
+}
+#endif
+
 static void btstack_crypto_run(void){
 
     btstack_crypto_aes128_t        * btstack_crypto_aes128;
@@ -844,7 +882,13 @@ static void btstack_crypto_run(void){
         if (btstack_linked_list_empty(&btstack_crypto_operations)) return;
 
         // already active?
-        if (btstack_crypto_wait_for_hci_result) return;
+        if (btstack_crypto_wait_for_hci_result) {
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+            if (!btstack_crypto_random_requests_more()) return;
+#else
+            return;
+#endif
+        }
 
         // can send a command?
         if (!hci_can_send_command_packet_now()) return;
@@ -853,8 +897,7 @@ static void btstack_crypto_run(void){
     	btstack_crypto_t * btstack_crypto = (btstack_crypto_t*) btstack_linked_list_get_first_item(&btstack_crypto_operations);
     	switch (btstack_crypto->operation){
     		case BTSTACK_CRYPTO_RANDOM:
-    			btstack_crypto_wait_for_hci_result = true;
-    		    hci_send_cmd(&hci_le_rand);
+    		    btstack_crypto_random_request();
     		    break;
     		case BTSTACK_CRYPTO_AES128:
                 btstack_crypto_aes128 = (btstack_crypto_aes128_t *) btstack_crypto;
@@ -939,8 +982,7 @@ static void btstack_crypto_run(void){
                         log_info("start ecc random");
                         btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_GENERATING_RANDOM;
                         btstack_crypto_ecc_p256_random_offset = 0;
-                        btstack_crypto_wait_for_hci_result = true;
-                        hci_send_cmd(&hci_le_rand);
+                        btstack_crypto_random_request();
 #else
                         btstack_crypto_ecc_p256_key_generation_state = ECC_P256_KEY_GENERATION_W4_KEY;
                         btstack_crypto_wait_for_hci_result = 1;
@@ -950,8 +992,7 @@ static void btstack_crypto_run(void){
 #ifdef USE_SOFTWARE_ECC_P256_IMPLEMENTATION
                     case ECC_P256_KEY_GENERATION_GENERATING_RANDOM:
                         log_info("more ecc random");
-                        btstack_crypto_wait_for_hci_result = true;
-                        hci_send_cmd(&hci_le_rand);
+                        btstack_crypto_random_request();
                         break;
 #endif
                     default:
@@ -1101,7 +1142,12 @@ static void btstack_crypto_event_handler(uint8_t packet_type, uint16_t cid, uint
 #endif
     	    if (HCI_EVENT_IS_COMMAND_COMPLETE(packet, hci_le_rand)){
                 if (!btstack_crypto_wait_for_hci_result) return;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+                btstack_crypto_random_requests_pending--;
+                btstack_crypto_wait_for_hci_result = btstack_crypto_random_requests_pending > 0u;
+#else
                 btstack_crypto_wait_for_hci_result = false;
+#endif
                 btstack_crypto_handle_random_data(&packet[6], 8);
     	    }
             if (HCI_EVENT_IS_COMMAND_COMPLETE(packet, hci_read_local_supported_commands)){
@@ -1350,6 +1396,9 @@ void btstack_crypto_ccm_decrypt_block(btstack_crypto_ccm_t * request, uint16_t b
 void btstack_crypto_deinit(void) {
     btstack_crypto_initialized = false;
     btstack_crypto_wait_for_hci_result = false;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    btstack_crypto_random_requests_pending = 0;
+#endif
     btstack_crypto_operations = NULL;
 }
 
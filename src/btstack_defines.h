@@ -750,6 +750,12 @@ typedef uint8_t sm_key_t[16];
  */
 #define HCI_EVENT_TRANSPORT_SLEEP_MODE                     0x69
 
+/**
+ * @format H
+ * @param handle
+ */
+#define HCI_EVENT_ACL_CAN_SEND_NOW                         0x6A
+
 /**
  * @brief Transport ready 
  */
@@ -1386,6 +1392,15 @@ typedef uint8_t sm_key_t[16];
  */
 #define GAP_EVENT_RSSI_MEASUREMENT                            0xE5
 
+/**
+ * @format 1JV
+ * @param num_reports
+ * @param reports_length
+ * @param reports
+ * @note reports are complete GAP_EVENT_ADVERTISING_REPORT events
+ */
+#define GAP_EVENT_ADVERTISING_REPORT_BATCH                    0xE6
+
 // Meta Events, see below for sub events
 #define HCI_EVENT_HSP_META                                 0xE8
 #define HCI_EVENT_HFP_META                                 0xE9
@@ -1127,6 +1127,16 @@ static inline uint8_t hci_event_transport_sleep_mode_get_active(const uint8_t *
     return event[2];
 }
 
+/**
+ * @brief Get field handle from event HCI_EVENT_ACL_CAN_SEND_NOW
+ * @param event packet
+ * @return handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_event_acl_can_send_now_get_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+
 /**
  * @brief Get field handle from event HCI_EVENT_SCO_CAN_SEND_NOW
  * @param event packet
@@ -3325,6 +3335,34 @@ static inline uint8_t gap_event_rssi_measurement_get_rssi(const uint8_t * event)
     return event[4];
 }
 
+/**
+ * @brief Get field num_reports from event GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param event packet
+ * @return num_reports
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_advertising_report_batch_get_num_reports(const uint8_t * event){
+    return event[2];
+}
+/**
+ * @brief Get field reports_length from event GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param event packet
+ * @return reports_length
+ * @note: btstack_type J
+ */
+static inline uint8_t gap_event_advertising_report_batch_get_reports_length(const uint8_t * event){
+    return event[3];
+}
+/**
+ * @brief Get field reports from event GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param event packet
+ * @return reports
+ * @note: btstack_type V
+ */
+static inline const uint8_t * gap_event_advertising_report_batch_get_reports(const uint8_t * event){
+    return &event[4];
+}
+
 /**
  * @brief Get field status from event HCI_SUBEVENT_LE_CONNECTION_COMPLETE
  * @param event packet
@@ -65,6 +65,10 @@ static btstack_memory_buffer_t * btstack_memory_malloc_buffers;
 
 static void btstack_memory_tracking_add(btstack_memory_buffer_t * buffer){
     btstack_assert(buffer != NULL);
+    if (btstack_memory_malloc_buffers != NULL) {
+        // let current first item prev point to new first item
+        btstack_memory_malloc_buffers->prev = buffer;
+    }
     buffer->prev = NULL;
     buffer->next = btstack_memory_malloc_buffers;
     btstack_memory_malloc_buffers = buffer;
@@ -151,6 +155,58 @@ void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
 #endif
 
 
+// MARK: hci_acl_recombination_buffer_t
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS)
+    #if defined(MAX_NO_HCI_ACL_RECOMBINATION_BUFFERS)
+        #error "Deprecated MAX_NO_HCI_ACL_RECOMBINATION_BUFFERS defined instead of MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS. Please update your btstack_config.h to use MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS."
+    #else
+        #define MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS 0
+    #endif
+#endif
+
+#ifdef MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS
+#if MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS > 0
+static hci_acl_recombination_buffer_t hci_acl_recombination_buffer_storage[MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS];
+static btstack_memory_pool_t hci_acl_recombination_buffer_pool;
+hci_acl_recombination_buffer_t * btstack_memory_hci_acl_recombination_buffer_get(void){
+    void * buffer = btstack_memory_pool_get(&hci_acl_recombination_buffer_pool);
+    return (hci_acl_recombination_buffer_t *) buffer;
+}
+void btstack_memory_hci_acl_recombination_buffer_free(hci_acl_recombination_buffer_t *hci_acl_recombination_buffer){
+    btstack_memory_pool_free(&hci_acl_recombination_buffer_pool, hci_acl_recombination_buffer);
+}
+#else
+hci_acl_recombination_buffer_t * btstack_memory_hci_acl_recombination_buffer_get(void){
+    return NULL;
+}
+void btstack_memory_hci_acl_recombination_buffer_free(hci_acl_recombination_buffer_t *hci_acl_recombination_buffer){
+    UNUSED(hci_acl_recombination_buffer);
+};
+#endif
+#elif defined(HAVE_MALLOC)
+
+typedef struct {
+    hci_acl_recombination_buffer_t data;
+    btstack_memory_buffer_t tracking;
+} btstack_memory_hci_acl_recombination_buffer_t;
+
+hci_acl_recombination_buffer_t * btstack_memory_hci_acl_recombination_buffer_get(void){
+    btstack_memory_hci_acl_recombination_buffer_t * buffer = (btstack_memory_hci_acl_recombination_buffer_t *) malloc(sizeof(btstack_memory_hci_acl_recombination_buffer_t));
+    if (buffer){
+        btstack_memory_tracking_add(&buffer->tracking);
+        return &buffer->data;
+    } else {
+        return NULL;
+    }
+}
+void btstack_memory_hci_acl_recombination_buffer_free(hci_acl_recombination_buffer_t *hci_acl_recombination_buffer){
+    btstack_memory_hci_acl_recombination_buffer_t * buffer =  (btstack_memory_hci_acl_recombination_buffer_t *) hci_acl_recombination_buffer;
+    btstack_memory_tracking_remove(&buffer->tracking);
+    free(buffer);
+}
+#endif
+
+
 
 // MARK: l2cap_service_t
 #if !defined(HAVE_MALLOC) && !defined(MAX_NR_L2CAP_SERVICES)
@@ -1518,6 +1574,9 @@ void btstack_memory_init(void){
 #if MAX_NR_HCI_CONNECTIONS > 0
     btstack_memory_pool_create(&hci_connection_pool, hci_connection_storage, MAX_NR_HCI_CONNECTIONS, sizeof(hci_connection_t));
 #endif
+#if MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS > 0
+    btstack_memory_pool_create(&hci_acl_recombination_buffer_pool, hci_acl_recombination_buffer_storage, MAX_NR_HCI_ACL_RECOMBINATION_BUFFERS, sizeof(hci_acl_recombination_buffer_t));
+#endif
 #if MAX_NR_L2CAP_SERVICES > 0
     btstack_memory_pool_create(&l2cap_service_pool, l2cap_service_storage, MAX_NR_L2CAP_SERVICES, sizeof(l2cap_service_t));
 #endif
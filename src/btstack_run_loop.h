@@ -90,8 +90,18 @@ typedef struct btstack_timer_source {
     // timeout in system ticks (HAVE_EMBEDDED_TICK) or milliseconds (HAVE_EMBEDDED_TIME_MS)
     uint32_t timeout;
     // will be called when timer fired
-    void  (*process)(struct btstack_timer_source *ts); 
+    void  (*process)(struct btstack_timer_source *ts);
     void * context;
+#ifdef ENABLE_RUN_LOOP_TIMER_HEAP
+    // pairing heap used by btstack_run_loop_base: item.next is next sibling
+    struct btstack_timer_source * heap_child;
+    // previous sibling or parent for first child, NULL if not in heap or root
+    struct btstack_timer_source * heap_prev;
+    // insertion order for timers with same timeout
+    uint32_t heap_sequence_nr;
+    // set while timer is in heap
+    uint8_t  heap_queued;
+#endif
 } btstack_timer_source_t;
 
 typedef struct btstack_run_loop {
@@ -126,6 +136,7 @@ void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in
 
 /**
  * @brief Set callback that will be executed when timer expires.
+ * @note With ENABLE_RUN_LOOP_TIMER_HEAP, the timer must be zero-initialized before it is added for the first time
  */
 void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *_ts));
 
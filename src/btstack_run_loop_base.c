@@ -49,13 +49,25 @@
 
 #include "btstack_run_loop_base.h"
 
+#ifdef ENABLE_RUN_LOOP_TRACE
+#include "hci_dump.h"
+#include <string.h>
+#endif
+
 // private data (access only by run loop implementations)
 btstack_linked_list_t btstack_run_loop_base_timers;
 btstack_linked_list_t btstack_run_loop_base_data_sources;
 
+#ifdef ENABLE_RUN_LOOP_TIMER_HEAP
+static uint32_t btstack_run_loop_base_timer_sequence_nr;
+#endif
+
 void btstack_run_loop_base_init(void){
     btstack_run_loop_base_timers = NULL;
     btstack_run_loop_base_data_sources = NULL;    
+#ifdef ENABLE_RUN_LOOP_TIMER_HEAP
+    btstack_run_loop_base_timer_sequence_nr = 0;
+#endif
 }
 
 void btstack_run_loop_base_add_data_source(btstack_data_source_t *ds){
@@ -74,6 +86,125 @@ void btstack_run_loop_base_disable_data_source_callbacks(btstack_data_source_t *
     ds->flags &= ~callback_types;
 }
 
+#ifdef ENABLE_RUN_LOOP_TIMER_HEAP
+
+// Timers are stored in a pairing heap with btstack_run_loop_base_timers pointing to the root, i.e. the first timer
+// to fire. Add is O(1), removing the first or any other timer is O(log n) amortized. Timers with the same timeout
+// are ordered by insertion (sequence number) to match the sorted list.
+
+static bool btstack_run_loop_base_timer_before(btstack_timer_source_t * a, btstack_timer_source_t * b){
+    int32_t delta = btstack_time_delta(a->timeout, b->timeout);
+    if (delta != 0) return delta < 0;
+    return (int32_t) (a->heap_sequence_nr - b->heap_sequence_nr) < 0;
+}
+
+// meld two heaps, roots must not have siblings
+static btstack_timer_source_t * btstack_run_loop_base_timer_meld(btstack_timer_source_t * a, btstack_timer_source_t * b){
+    if (btstack_run_loop_base_timer_before(b, a)){
+        btstack_timer_source_t * tmp = a;
+        a = b;
+        b = tmp;
+    }
+    // add b as first child of a
+    b->heap_prev = a;
+    b->item.next = (btstack_linked_item_t *) a->heap_child;
+    if (a->heap_child != NULL){
+        a->heap_child->heap_prev = b;
+    }
+    a->heap_child = b;
+    return a;
+}
+
+// two-pass merge of sibling list
+static btstack_timer_source_t * btstack_run_loop_base_timer_merge_pairs(btstack_timer_source_t * first){
+    // first pass: meld pairs left to right, collect results in reverse order
+    btstack_timer_source_t * pairs = NULL;
+    while (first != NULL){
+        btstack_timer_source_t * a = first;
+        btstack_timer_source_t * b = (btstack_timer_source_t *) a->item.next;
+        a->heap_prev = NULL;
+        a->item.next = NULL;
+        if (b == NULL){
+            first = NULL;
+        } else {
+            first = (btstack_timer_source_t *) b->item.next;
+            b->heap_prev = NULL;
+            b->item.next = NULL;
+            a = btstack_run_loop_base_timer_meld(a, b);
+        }
+        a->item.next = (btstack_linked_item_t *) pairs;
+        pairs = a;
+    }
+    // second pass: meld right to left
+    btstack_timer_source_t * root = NULL;
+    while (pairs != NULL){
+        btstack_timer_source_t * next = (btstack_timer_source_t *) pairs->item.next;
+        pairs->item.next = NULL;
+        root = (root == NULL) ? pairs : btstack_run_loop_base_timer_meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+bool btstack_run_loop_base_remove_timer(btstack_timer_source_t *ts){
+    if (ts->heap_queued == 0u) return false;
+    btstack_timer_source_t * root = (btstack_timer_source_t *) btstack_run_loop_base_timers;
+    btstack_timer_source_t * children = btstack_run_loop_base_timer_merge_pairs(ts->heap_child);
+    if (ts == root){
+        root = children;
+    } else {
+        // unlink from parent or previous sibling
+        btstack_timer_source_t * prev = ts->heap_prev;
+        btstack_timer_source_t * next = (btstack_timer_source_t *) ts->item.next;
+        if (prev->heap_child == ts){
+            prev->heap_child = next;
+        } else {
+            prev->item.next = (btstack_linked_item_t *) next;
+        }
+        if (next != NULL){
+            next->heap_prev = prev;
+        }
+        if (children != NULL){
+            root = btstack_run_loop_base_timer_meld(root, children);
+        }
+    }
+    ts->heap_child  = NULL;
+    ts->heap_prev   = NULL;
+    ts->item.next   = NULL;
+    ts->heap_queued = 0;
+    btstack_run_loop_base_timers = (btstack_linked_item_t *) root;
+    return true;
+}
+
+void btstack_run_loop_base_add_timer(btstack_timer_source_t *ts){
+    // timer that's already in there might have a new timeout, remove it first
+    btstack_run_loop_base_remove_timer(ts);
+    ts->heap_queued = 1;
+    ts->heap_sequence_nr = btstack_run_loop_base_timer_sequence_nr++;
+    btstack_timer_source_t * root = (btstack_timer_source_t *) btstack_run_loop_base_timers;
+    if (root != NULL){
+        ts = btstack_run_loop_base_timer_meld(root, ts);
+    }
+    btstack_run_loop_base_timers = (btstack_linked_item_t *) ts;
+}
+
+#ifdef ENABLE_LOG_INFO
+static void btstack_run_loop_base_dump_timer_heap(btstack_timer_source_t * ts, uint16_t level){
+    for (; ts != NULL; ts = (btstack_timer_source_t *) ts->item.next){
+        log_info("timer %u (%p): timeout %u\n", level, ts, ts->timeout);
+        btstack_run_loop_base_dump_timer_heap(ts->heap_child, level + 1);
+    }
+}
+#endif
+
+void btstack_run_loop_base_dump_timer(void){
+#ifdef ENABLE_LOG_INFO
+    btstack_run_loop_base_dump_timer_heap((btstack_timer_source_t *) btstack_run_loop_base_timers, 0);
+#endif
+}
+
+#else
+
 bool btstack_run_loop_base_remove_timer(btstack_timer_source_t *ts){
     return btstack_linked_list_remove(&btstack_run_loop_base_timers, (btstack_linked_item_t *) ts);
 }
@@ -95,17 +226,6 @@ void btstack_run_loop_base_add_timer(btstack_timer_source_t *ts){
     it->next = (btstack_linked_item_t *) ts;
 }
 
-void btstack_run_loop_base_process_timers(uint32_t now){
-    // process timers, exit when timeout is in the future
-    while (btstack_run_loop_base_timers) {
-        btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_run_loop_base_timers;
-        int32_t delta = btstack_time_delta(ts->timeout, now);
-        if (delta > 0) break;
-        btstack_run_loop_base_remove_timer(ts);
-        ts->process(ts);
-    }
-}
-
 void btstack_run_loop_base_dump_timer(void){
 #ifdef ENABLE_LOG_INFO
     btstack_linked_item_t *it;
@@ -115,8 +235,25 @@ void btstack_run_loop_base_dump_timer(void){
         log_info("timer %u (%p): timeout %u\n", i, ts, ts->timeout);
     }
 #endif
+}
+
+#endif
 
+void btstack_run_loop_base_process_timers(uint32_t now){
+    // process timers, exit when timeout is in the future
+    while (btstack_run_loop_base_timers) {
+        btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_run_loop_base_timers;
+        int32_t delta = btstack_time_delta(ts->timeout, now);
+        if (delta > 0) break;
+        btstack_run_loop_base_remove_timer(ts);
+#ifdef ENABLE_RUN_LOOP_TRACE
+        btstack_run_loop_base_trace_process_timer(ts, -delta);
+#else
+        ts->process(ts);
+#endif
+    }
 }
+
 /**
  * @brief Get time until first timer fires
  * @returns -1 if no timers, time until next timeout otherwise
@@ -131,3 +268,230 @@ int32_t btstack_run_loop_base_get_time_until_timeout(uint32_t now){
     }
     return delta;
 }
+
+#ifdef ENABLE_RUN_LOOP_TRACE
+
+static uint32_t (*btstack_run_loop_base_trace_get_time_us)(void);
+static btstack_run_loop_trace_histogram_t btstack_run_loop_base_trace_histograms[BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_NUM];
+static btstack_run_loop_trace_data_source_stats_t btstack_run_loop_base_trace_data_sources[BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES];
+static btstack_run_loop_trace_timer_stats_t btstack_run_loop_base_trace_timers[BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS];
+static uint32_t btstack_run_loop_base_trace_iterations;
+static uint32_t btstack_run_loop_base_trace_wait_start_us;
+static uint32_t btstack_run_loop_base_trace_dump_interval_us;
+static uint32_t btstack_run_loop_base_trace_dump_last_us;
+
+static const char * btstack_run_loop_base_trace_histogram_names[BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_NUM] = {
+    "data source us",
+    "timer us",
+    "timer lateness ms",
+    "wait us",
+};
+
+static uint32_t btstack_run_loop_base_trace_time_us(void){
+    if (btstack_run_loop_base_trace_get_time_us == NULL) return 0;
+    return (*btstack_run_loop_base_trace_get_time_us)();
+}
+
+static uint16_t btstack_run_loop_base_trace_bucket_for_value(uint32_t value){
+    const uint32_t sub_buckets = 1u << BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+    if (value < (2u * sub_buckets)) return (uint16_t) value;
+    uint16_t msb = 0;
+    uint32_t tmp = value;
+    while (tmp > 1u){
+        tmp >>= 1;
+        msb++;
+    }
+    uint16_t shift = msb - BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+    return (uint16_t) ((sub_buckets * shift) + (value >> shift));
+}
+
+static uint32_t btstack_run_loop_base_trace_upper_bound_for_bucket(uint16_t bucket){
+    const uint32_t sub_buckets = 1u << BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_SUB_BUCKET_BITS;
+    if (bucket < (2u * sub_buckets)) return bucket;
+    uint16_t shift = (bucket - sub_buckets) / sub_buckets;
+    uint32_t mantissa = bucket - (sub_buckets * shift);
+    return ((mantissa + 1u) << shift) - 1u;
+}
+
+static void btstack_run_loop_base_trace_record(btstack_run_loop_trace_histogram_id_t histogram_id, uint32_t value){
+    btstack_run_loop_trace_histogram_t * histogram = &btstack_run_loop_base_trace_histograms[histogram_id];
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max){
+        histogram->max = value;
+    }
+    histogram->buckets[btstack_run_loop_base_trace_bucket_for_value(value)]++;
+}
+
+void btstack_run_loop_base_trace_init(uint32_t (*get_time_us)(void)){
+    btstack_run_loop_base_trace_get_time_us = get_time_us;
+    btstack_run_loop_base_trace_reset();
+}
+
+void btstack_run_loop_base_trace_process_data_source(btstack_data_source_t * data_source, btstack_data_source_callback_type_t callback_type){
+    uint32_t start_us = btstack_run_loop_base_trace_time_us();
+    data_source->process(data_source, callback_type);
+    uint32_t duration_us = btstack_run_loop_base_trace_time_us() - start_us;
+    btstack_run_loop_base_trace_record(BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_DATA_SOURCE_DURATION, duration_us);
+
+    // per data source stats, data source might have been removed by callback, so we only compare the pointer
+    btstack_run_loop_trace_data_source_stats_t * stats = NULL;
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES; i++){
+        btstack_run_loop_trace_data_source_stats_t * entry = &btstack_run_loop_base_trace_data_sources[i];
+        if (entry->data_source == data_source){
+            stats = entry;
+            break;
+        }
+        if ((entry->data_source == NULL) && (stats == NULL)){
+            stats = entry;
+        }
+    }
+    if (stats == NULL) return;
+    stats->data_source = data_source;
+    stats->count++;
+    stats->sum_us += duration_us;
+    if (duration_us > stats->max_us){
+        stats->max_us = duration_us;
+    }
+}
+
+void btstack_run_loop_base_trace_process_timer(btstack_timer_source_t * timer, int32_t lateness_ms){
+    if (lateness_ms < 0){
+        lateness_ms = 0;
+    }
+    btstack_run_loop_base_trace_record(BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_TIMER_LATENESS, (uint32_t) lateness_ms);
+
+    // per timer handler stats, recorded before the call as handler might re-use the timer
+    btstack_run_loop_trace_timer_stats_t * stats = NULL;
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS; i++){
+        btstack_run_loop_trace_timer_stats_t * entry = &btstack_run_loop_base_trace_timers[i];
+        if (entry->process == timer->process){
+            stats = entry;
+            break;
+        }
+        if ((entry->process == NULL) && (stats == NULL)){
+            stats = entry;
+        }
+    }
+    if (stats != NULL){
+        stats->process = timer->process;
+        stats->count++;
+        stats->sum_lateness_ms += (uint32_t) lateness_ms;
+        if ((uint32_t) lateness_ms > stats->max_lateness_ms){
+            stats->max_lateness_ms = (uint32_t) lateness_ms;
+        }
+    }
+
+    uint32_t start_us = btstack_run_loop_base_trace_time_us();
+    timer->process(timer);
+    btstack_run_loop_base_trace_record(BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_TIMER_DURATION, btstack_run_loop_base_trace_time_us() - start_us);
+}
+
+void btstack_run_loop_base_trace_wait_start(void){
+    btstack_run_loop_base_trace_wait_start_us = btstack_run_loop_base_trace_time_us();
+}
+
+void btstack_run_loop_base_trace_wait_end(void){
+    btstack_run_loop_base_trace_record(BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_WAIT, btstack_run_loop_base_trace_time_us() - btstack_run_loop_base_trace_wait_start_us);
+}
+
+void btstack_run_loop_base_trace_iteration(void){
+    btstack_run_loop_base_trace_iterations++;
+    if (btstack_run_loop_base_trace_dump_interval_us == 0) return;
+    uint32_t now_us = btstack_run_loop_base_trace_time_us();
+    if ((now_us - btstack_run_loop_base_trace_dump_last_us) < btstack_run_loop_base_trace_dump_interval_us) return;
+    btstack_run_loop_base_trace_dump_last_us = now_us;
+    btstack_run_loop_base_trace_dump();
+}
+
+const btstack_run_loop_trace_histogram_t * btstack_run_loop_base_trace_get_histogram(btstack_run_loop_trace_histogram_id_t histogram_id){
+    btstack_assert(histogram_id < BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_NUM);
+    return &btstack_run_loop_base_trace_histograms[histogram_id];
+}
+
+uint32_t btstack_run_loop_base_trace_histogram_get_percentile(const btstack_run_loop_trace_histogram_t * histogram, uint16_t permille){
+    if (histogram->count == 0) return 0;
+    uint64_t threshold = (((uint64_t) histogram->count * permille) + 999u) / 1000u;
+    if (threshold == 0){
+        threshold = 1;
+    }
+    uint64_t count = 0;
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_BUCKETS; i++){
+        count += histogram->buckets[i];
+        if (count >= threshold){
+            return btstack_min(btstack_run_loop_base_trace_upper_bound_for_bucket(i), histogram->max);
+        }
+    }
+    return histogram->max;
+}
+
+const btstack_run_loop_trace_data_source_stats_t * btstack_run_loop_base_trace_get_data_source_stats(const btstack_data_source_t * data_source){
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES; i++){
+        if (btstack_run_loop_base_trace_data_sources[i].data_source == data_source){
+            return &btstack_run_loop_base_trace_data_sources[i];
+        }
+    }
+    return NULL;
+}
+
+const btstack_run_loop_trace_timer_stats_t * btstack_run_loop_base_trace_get_timer_stats(void (*process)(btstack_timer_source_t * timer)){
+    if (process == NULL) return NULL;
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS; i++){
+        if (btstack_run_loop_base_trace_timers[i].process == process){
+            return &btstack_run_loop_base_trace_timers[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t btstack_run_loop_base_trace_get_iterations(void){
+    return btstack_run_loop_base_trace_iterations;
+}
+
+void btstack_run_loop_base_trace_reset(void){
+    memset(btstack_run_loop_base_trace_histograms, 0, sizeof(btstack_run_loop_base_trace_histograms));
+    memset(btstack_run_loop_base_trace_data_sources, 0, sizeof(btstack_run_loop_base_trace_data_sources));
+    memset(btstack_run_loop_base_trace_timers, 0, sizeof(btstack_run_loop_base_trace_timers));
+    btstack_run_loop_base_trace_iterations = 0;
+    btstack_run_loop_base_trace_dump_last_us = btstack_run_loop_base_trace_time_us();
+}
+
+void btstack_run_loop_base_trace_set_dump_interval(uint32_t interval_ms){
+    btstack_run_loop_base_trace_dump_interval_us = interval_ms * 1000u;
+    btstack_run_loop_base_trace_dump_last_us = btstack_run_loop_base_trace_time_us();
+}
+
+void btstack_run_loop_base_trace_dump(void){
+    HCI_DUMP_LOG(HCI_DUMP_LOG_LEVEL_INFO, "Run loop trace: %u iterations", (unsigned int) btstack_run_loop_base_trace_iterations);
+    uint16_t i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_NUM; i++){
+        const btstack_run_loop_trace_histogram_t * histogram = &btstack_run_loop_base_trace_histograms[i];
+        HCI_DUMP_LOG(HCI_DUMP_LOG_LEVEL_INFO, "- %s: count %u, avg %u, p50 %u, p90 %u, p99 %u, max %u",
+                     btstack_run_loop_base_trace_histogram_names[i],
+                     (unsigned int) histogram->count,
+                     (unsigned int) ((histogram->count == 0) ? 0 : (histogram->sum / histogram->count)),
+                     (unsigned int) btstack_run_loop_base_trace_histogram_get_percentile(histogram, 500),
+                     (unsigned int) btstack_run_loop_base_trace_histogram_get_percentile(histogram, 900),
+                     (unsigned int) btstack_run_loop_base_trace_histogram_get_percentile(histogram, 990),
+                     (unsigned int) histogram->max);
+    }
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES; i++){
+        const btstack_run_loop_trace_data_source_stats_t * stats = &btstack_run_loop_base_trace_data_sources[i];
+        if (stats->data_source == NULL) continue;
+        HCI_DUMP_LOG(HCI_DUMP_LOG_LEVEL_INFO, "- data source %p: count %u, avg %u us, max %u us", stats->data_source,
+                     (unsigned int) stats->count, (unsigned int) (stats->sum_us / stats->count), (unsigned int) stats->max_us);
+    }
+    for (i = 0; i < BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS; i++){
+        const btstack_run_loop_trace_timer_stats_t * stats = &btstack_run_loop_base_trace_timers[i];
+        if (stats->process == NULL) continue;
+        HCI_DUMP_LOG(HCI_DUMP_LOG_LEVEL_INFO, "- timer handler 0x%lx: count %u, avg lateness %u ms, max lateness %u ms", (unsigned long) (uintptr_t) stats->process,
+                     (unsigned int) stats->count, (unsigned int) (stats->sum_lateness_ms / stats->count), (unsigned int) stats->max_lateness_ms);
+    }
+}
+
+#endif
@@ -55,6 +55,7 @@ extern "C" {
 #endif
 
 // private data (access only by run loop implementations)
+// with ENABLE_RUN_LOOP_TIMER_HEAP, btstack_run_loop_base_timers points to the root of the timer heap, i.e. the next timer
 extern btstack_linked_list_t btstack_run_loop_base_timers;
 extern btstack_linked_list_t btstack_run_loop_base_data_sources;
 	
@@ -120,6 +121,139 @@ void btstack_run_loop_base_enable_data_source_callbacks(btstack_data_source_t *
  */
 void btstack_run_loop_base_disable_data_source_callbacks(btstack_data_source_t * data_source, uint16_t callbacks);
 
+#ifdef ENABLE_RUN_LOOP_TRACE
+
+// HDR-style log-linear histogram: values below 8 are counted exactly, larger values use 4 sub-buckets per power of two
+#define BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_SUB_BUCKET_BITS 2
+#define BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_BUCKETS        124
+
+// max number of data sources with individual callback statistics
+#ifndef BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES
+#define BTSTACK_RUN_LOOP_TRACE_MAX_DATA_SOURCES 8
+#endif
+
+// max number of timer handlers with individual lateness statistics
+#ifndef BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS
+#define BTSTACK_RUN_LOOP_TRACE_MAX_TIMERS 16
+#endif
+
+typedef enum {
+    BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_DATA_SOURCE_DURATION = 0,  // data source callback duration in us
+    BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_TIMER_DURATION,            // timer callback duration in us
+    BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_TIMER_LATENESS,            // actual fire time - timeout in ms
+    BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_WAIT,                      // time blocked waiting for events in us
+    BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_NUM
+} btstack_run_loop_trace_histogram_id_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[BTSTACK_RUN_LOOP_TRACE_HISTOGRAM_BUCKETS];
+} btstack_run_loop_trace_histogram_t;
+
+typedef struct {
+    const btstack_data_source_t * data_source;
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} btstack_run_loop_trace_data_source_stats_t;
+
+// timers are identified by their handler as timer structs are often re-used or on the stack
+typedef struct {
+    void (*process)(btstack_timer_source_t * timer);
+    uint32_t count;
+    uint32_t max_lateness_ms;
+    uint64_t sum_lateness_ms;
+} btstack_run_loop_trace_timer_stats_t;
+
+/**
+ * @brief Init tracing, called by run loop implementations on init
+ * @param get_time_us returns current time in microseconds, might wrap around
+ */
+void btstack_run_loop_base_trace_init(uint32_t (*get_time_us)(void));
+
+/**
+ * @brief Call data source process function and record its duration
+ * @param data_source
+ * @param callback_type
+ */
+void btstack_run_loop_base_trace_process_data_source(btstack_data_source_t * data_source, btstack_data_source_callback_type_t callback_type);
+
+/**
+ * @brief Call timer process function and record its duration and lateness
+ * @param timer
+ * @param lateness_ms time since timeout
+ */
+void btstack_run_loop_base_trace_process_timer(btstack_timer_source_t * timer, int32_t lateness_ms);
+
+/**
+ * @brief Mark start of blocking wait for events, e.g. select() or xTaskNotifyWait
+ */
+void btstack_run_loop_base_trace_wait_start(void);
+
+/**
+ * @brief Mark end of blocking wait for events
+ */
+void btstack_run_loop_base_trace_wait_end(void);
+
+/**
+ * @brief Count run loop iteration and dump statistics if dump interval is set and has passed
+ */
+void btstack_run_loop_base_trace_iteration(void);
+
+/**
+ * @brief Get histogram
+ * @param histogram_id
+ * @returns histogram
+ */
+const btstack_run_loop_trace_histogram_t * btstack_run_loop_base_trace_get_histogram(btstack_run_loop_trace_histogram_id_t histogram_id);
+
+/**
+ * @brief Get value at given percentile
+ * @param histogram
+ * @param permille, e.g. 990 for 99th percentile
+ * @returns upper bound of histogram bucket that contains the requested percentile
+ */
+uint32_t btstack_run_loop_base_trace_histogram_get_percentile(const btstack_run_loop_trace_histogram_t * histogram, uint16_t permille);
+
+/**
+ * @brief Get callback statistics for data source
+ * @param data_source
+ * @returns stats or NULL if not tracked
+ */
+const btstack_run_loop_trace_data_source_stats_t * btstack_run_loop_base_trace_get_data_source_stats(const btstack_data_source_t * data_source);
+
+/**
+ * @brief Get lateness statistics for timer handler
+ * @param process timer handler
+ * @returns stats or NULL if not tracked
+ */
+const btstack_run_loop_trace_timer_stats_t * btstack_run_loop_base_trace_get_timer_stats(void (*process)(btstack_timer_source_t * timer));
+
+/**
+ * @brief Get number of run loop iterations
+ */
+uint32_t btstack_run_loop_base_trace_get_iterations(void);
+
+/**
+ * @brief Reset all histograms and counters
+ */
+void btstack_run_loop_base_trace_reset(void);
+
+/**
+ * @brief Dump statistics to hci_dump periodically
+ * @param interval_ms or 0 to disable
+ */
+void btstack_run_loop_base_trace_set_dump_interval(uint32_t interval_ms);
+
+/**
+ * @brief Dump statistics to hci_dump
+ */
+void btstack_run_loop_base_trace_dump(void);
+
+#endif
+
 #if defined __cplusplus
 }
 #endif
@@ -44,6 +44,9 @@
 
 #include "btstack_slip.h"
 #include "btstack_debug.h"
+#include "btstack_util.h"
+
+#include <string.h>
 
 typedef enum {
 	SLIP_ENCODER_DEFAULT,
@@ -128,6 +131,35 @@ uint8_t btstack_slip_encoder_get_byte(void){
 	}
 }
 
+/**
+ * @brief Get encoded data, runs without SOF or 0xdb are copied at once
+ * @param buffer
+ * @param max_len
+ * @return number of bytes stored in buffer
+ */
+uint16_t btstack_slip_encoder_get_bytes(uint8_t * buffer, uint16_t max_len){
+    uint16_t pos = 0;
+    while ((pos < max_len) && btstack_slip_encoder_has_data()){
+        if (encoder_state == SLIP_ENCODER_DEFAULT){
+            // find run of bytes that don't need escaping
+            uint16_t run = 0;
+            uint16_t max_run = btstack_min(encoder_len, max_len - pos);
+            while ((run < max_run) && (encoder_data[run] != BTSTACK_SLIP_SOF) && (encoder_data[run] != 0xdbu)){
+                run++;
+            }
+            if (run > 0u){
+                (void) memcpy(&buffer[pos], encoder_data, run);
+                encoder_data += run;
+                encoder_len  -= run;
+                pos          += run;
+                continue;
+            }
+        }
+        buffer[pos++] = btstack_slip_encoder_get_byte();
+    }
+    return pos;
+}
+
 // Decoder
 
 static void btstack_slip_decoder_reset(void){
@@ -221,6 +253,34 @@ void btstack_slip_decoder_process(uint8_t input){
     }
 }
 
+/**
+ * @brief Process received data until frame is complete
+ * @param data
+ * @param len
+ * @return number of bytes processed
+ */
+uint16_t btstack_slip_decoder_process_data(const uint8_t * data, uint16_t len){
+    uint16_t pos = 0;
+    while ((pos < len) && (decoder_state != SLIP_DECODER_COMPLETE)){
+        if (decoder_state == SLIP_DECODER_ACTIVE){
+            // copy run of bytes that don't need unescaping
+            uint16_t run = 0;
+            uint16_t max_run = btstack_min(len - pos, decoder_max_size - decoder_pos);
+            while ((run < max_run) && (data[pos + run] != BTSTACK_SLIP_SOF) && (data[pos + run] != 0xdbu)){
+                run++;
+            }
+            if (run > 0u){
+                (void) memcpy(&decoder_buffer[decoder_pos], &data[pos], run);
+                decoder_pos += run;
+                pos         += run;
+                continue;
+            }
+        }
+        btstack_slip_decoder_process(data[pos++]);
+    }
+    return pos;
+}
+
 /**
  * @brief Get size of decoded frame
  * @return size of frame. Size = 0 => frame not complete
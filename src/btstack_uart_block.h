@@ -143,6 +143,19 @@ typedef struct {
      */
     void (*set_wakeup_handler)(void (*wakeup_handler)(void));
 
+    // optional support for partial reads, used by H4 with ENABLE_H4_BULK_READ
+
+    /**
+     * set callback for data received by receive_available. NULL disables callback
+     */
+    void (*set_data_received)(void (*data_handler)(uint16_t size));
+
+    /**
+     * receive up to len bytes, data received callback is called as soon as some data was received
+     * NULL if UART driver only supports exact block reads
+     */
+    void (*receive_available)(uint8_t *buffer, uint16_t len);
+
 } btstack_uart_block_t;
 
 // common implementations
@@ -56,6 +56,7 @@
 #include "classic/sdp_client.h"
 #include "hci.h"
 #include "hci_cmd.h"
+#include "hci_cmd_encoder.h"
 #include "hci_dump.h"
 #include "l2cap.h"
 
@@ -1628,8 +1629,12 @@ void hfp_setup_synchronous_connection(hfp_connection_t * hfp_connection){
     }
     // get packet types - bits 6-9 are 'don't allow'
     uint16_t packet_types = hfp_link_settings[setting].packet_types ^ 0x03c0;
-    hci_send_cmd(&hci_setup_synchronous_connection, hfp_connection->acl_handle, 8000, 8000, hfp_link_settings[setting].max_latency,
-        sco_voice_setting, hfp_link_settings[setting].retransmission_effort, packet_types);
+    if (!hci_can_send_command_packet_now()){
+        log_error("hfp_setup_synchronous_connection called but cannot send packet now");
+        return;
+    }
+    hci_send_cmd_packet_buffer(hci_cmd_create_setup_synchronous_connection(hci_reserve_cmd_packet_buffer(), hfp_connection->acl_handle,
+        8000, 8000, hfp_link_settings[setting].max_latency, sco_voice_setting, hfp_link_settings[setting].retransmission_effort, packet_types));
 }
 
 #ifdef ENABLE_CC256X_ASSISTED_HFP
@@ -60,6 +60,7 @@
 #include "classic/sdp_client.h"
 #include "hci.h"
 #include "hci_cmd.h"
+#include "hci_cmd_encoder.h"
 #include "hci_dump.h"
 #include "hsp_ag.h"
 #include "l2cap.h"
@@ -465,7 +466,7 @@ static void hsp_run(void){
             hsp_state = HSP_W4_SCO_CONNECTED;
             // bits 6-9 are 'don't use'
             packet_types = hsp_ag_sco_packet_types ^ 0x3c0;
-            hci_send_cmd(&hci_setup_synchronous_connection, rfcomm_handle, 8000, 8000, 0xFFFF, hci_get_sco_voice_setting(), 0xFF, packet_types);
+            hci_send_cmd_packet_buffer(hci_cmd_create_setup_synchronous_connection(hci_reserve_cmd_packet_buffer(), rfcomm_handle, 8000, 8000, 0xFFFF, hci_get_sco_voice_setting(), 0xFF, packet_types));
             break;
         
         case HSP_W2_DISCONNECT_SCO:
@@ -81,6 +81,28 @@
 
 #define RFCOMM_CREDITS 10
 
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+// rfcomm cids are allocated from 1 .. RFCOMM_CHANNEL_CID_TABLE_SIZE
+#ifndef RFCOMM_CHANNEL_CID_TABLE_SIZE
+#define RFCOMM_CHANNEL_CID_TABLE_SIZE 32
+#endif
+// number of buckets for multiplexers chained per l2cap cid
+#ifndef RFCOMM_MULTIPLEXER_HASH_SIZE
+#define RFCOMM_MULTIPLEXER_HASH_SIZE 8
+#endif
+#endif
+
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+// upper limit for credits provided to remote
+#ifndef RFCOMM_CREDITS_AUTO_TUNING_MAX
+#define RFCOMM_CREDITS_AUTO_TUNING_MAX 100
+#endif
+// interval for consumption rate measurement
+#define RFCOMM_CREDITS_AUTO_TUNING_INTERVAL_MS 100
+// longer round trip times are caused by idle remote
+#define RFCOMM_CREDITS_AUTO_TUNING_MAX_RTT_MS 1000
+#endif
+
 // FCS calc 
 #define BT_RFCOMM_CODE_WORD         0xE0 // pol = x8+x2+x1+1
 #define BT_RFCOMM_CRC_CHECK_LEN     3
@@ -168,6 +190,11 @@ static btstack_linked_list_t rfcomm_multiplexers;
 static btstack_linked_list_t rfcomm_channels;
 static btstack_linked_list_t rfcomm_services;
 
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+static rfcomm_channel_t     * rfcomm_channel_for_rfcomm_cid_table[RFCOMM_CHANNEL_CID_TABLE_SIZE];
+static rfcomm_multiplexer_t * rfcomm_multiplexers_for_l2cap_cid[RFCOMM_MULTIPLEXER_HASH_SIZE];
+#endif
+
 static gap_security_level_t rfcomm_security_level;
 
 #ifdef RFCOMM_USE_ERTM
@@ -192,6 +219,10 @@ static void rfcomm_multiplexer_state_machine(rfcomm_multiplexer_t * multiplexer,
 // MARK: RFCOMM CLIENT EVENTS
 
 static rfcomm_channel_t * rfcomm_channel_for_rfcomm_cid(uint16_t rfcomm_cid){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    if ((rfcomm_cid == 0u) || (rfcomm_cid > RFCOMM_CHANNEL_CID_TABLE_SIZE)) return NULL;
+    return rfcomm_channel_for_rfcomm_cid_table[rfcomm_cid - 1u];
+#else
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) rfcomm_channels; it ; it = it->next){
         rfcomm_channel_t * channel = ((rfcomm_channel_t *) it);
@@ -200,9 +231,25 @@ static rfcomm_channel_t * rfcomm_channel_for_rfcomm_cid(uint16_t rfcomm_cid){
         };
     }
     return NULL;
+#endif
 }
 
 static uint16_t rfcomm_next_client_cid(void){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    // stay within table, returns 0 if all rfcomm cids are in use
+    uint16_t i;
+    for (i = 0; i < RFCOMM_CHANNEL_CID_TABLE_SIZE; i++){
+        if (rfcomm_client_cid_generator >= RFCOMM_CHANNEL_CID_TABLE_SIZE) {
+            rfcomm_client_cid_generator = 1;
+        } else {
+            rfcomm_client_cid_generator++;
+        }
+        if (rfcomm_channel_for_rfcomm_cid_table[rfcomm_client_cid_generator - 1u] == NULL){
+            return rfcomm_client_cid_generator;
+        }
+    }
+    return 0;
+#else
     do {
         if (rfcomm_client_cid_generator == 0xffff) {
             // don't use 0 as channel id
@@ -212,6 +259,7 @@ static uint16_t rfcomm_next_client_cid(void){
         }
     } while (rfcomm_channel_for_rfcomm_cid(rfcomm_client_cid_generator) != NULL);
     return rfcomm_client_cid_generator;
+#endif
 }
 
 #ifdef RFCOMM_USE_ERTM
@@ -418,6 +466,16 @@ static rfcomm_multiplexer_t * rfcomm_multiplexer_for_addr(bd_addr_t addr){
 }
 
 static rfcomm_multiplexer_t * rfcomm_multiplexer_for_l2cap_cid(uint16_t l2cap_cid) {
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    rfcomm_multiplexer_t * multiplexer = rfcomm_multiplexers_for_l2cap_cid[l2cap_cid % RFCOMM_MULTIPLEXER_HASH_SIZE];
+    while (multiplexer != NULL){
+        if (multiplexer->l2cap_cid == l2cap_cid) {
+            return multiplexer;
+        }
+        multiplexer = multiplexer->l2cap_cid_next;
+    }
+    return NULL;
+#else
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) rfcomm_multiplexers; it ; it = it->next){
         rfcomm_multiplexer_t * multiplexer = ((rfcomm_multiplexer_t *) it);
@@ -426,9 +484,38 @@ static rfcomm_multiplexer_t * rfcomm_multiplexer_for_l2cap_cid(uint16_t l2cap_ci
         };
     }
     return NULL;
+#endif
+}
+
+static void rfcomm_multiplexer_set_l2cap_cid(rfcomm_multiplexer_t * multiplexer, uint16_t l2cap_cid){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    if (multiplexer->l2cap_cid == l2cap_cid) return;
+    // unlink from current bucket
+    if (multiplexer->l2cap_cid != 0u){
+        rfcomm_multiplexer_t ** it = &rfcomm_multiplexers_for_l2cap_cid[multiplexer->l2cap_cid % RFCOMM_MULTIPLEXER_HASH_SIZE];
+        while (*it != NULL){
+            if (*it == multiplexer){
+                *it = multiplexer->l2cap_cid_next;
+                break;
+            }
+            it = &(*it)->l2cap_cid_next;
+        }
+        multiplexer->l2cap_cid_next = NULL;
+    }
+    // add to new bucket
+    if (l2cap_cid != 0u){
+        rfcomm_multiplexer_t ** head = &rfcomm_multiplexers_for_l2cap_cid[l2cap_cid % RFCOMM_MULTIPLEXER_HASH_SIZE];
+        multiplexer->l2cap_cid_next = *head;
+        *head = multiplexer;
+    }
+#endif
+    multiplexer->l2cap_cid = l2cap_cid;
 }
 
 static int rfcomm_multiplexer_has_channels(rfcomm_multiplexer_t * multiplexer){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    return multiplexer->channels != NULL;
+#else
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) rfcomm_channels; it ; it = it->next){
         rfcomm_channel_t * channel = ((rfcomm_channel_t *) it);
@@ -437,6 +524,7 @@ static int rfcomm_multiplexer_has_channels(rfcomm_multiplexer_t * multiplexer){
         }
     }
     return 0;
+#endif
 }
 
 // MARK: RFCOMM CHANNEL HELPER
@@ -489,6 +577,13 @@ static void rfcomm_channel_initialize(rfcomm_channel_t *channel, rfcomm_multiple
 		// outgoing connection
 		channel->dlci = (server_channel << 1) | (multiplexer->outgoing ^ 1);
 	}
+
+    // C/R of UIH frames is set by initiator of multiplexer, which doesn't change for the lifetime of the channel
+    uint8_t uih_header[2];
+    uih_header[0] = (1 << 0) | (multiplexer->outgoing << 1) | (channel->dlci << 2);
+    uih_header[1] = BT_RFCOMM_UIH;
+    channel->uih_address = uih_header[0];
+    channel->uih_fcs     = btstack_crc8_calc(uih_header, 2);
 }
 
 // service == NULL -> outgoing channel
@@ -504,6 +599,17 @@ static rfcomm_channel_t * rfcomm_channel_create(rfcomm_multiplexer_t * multiplex
     
     // fill in 
     rfcomm_channel_initialize(channel, multiplexer, service, server_channel);
+
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    if (channel->rfcomm_cid == 0u){
+        log_info("rfcomm_channel_create: no free rfcomm cid");
+        btstack_memory_rfcomm_channel_free(channel);
+        return NULL;
+    }
+    rfcomm_channel_for_rfcomm_cid_table[channel->rfcomm_cid - 1u] = channel;
+    channel->multiplexer_next = multiplexer->channels;
+    multiplexer->channels = channel;
+#endif
     
     // add to services list
     btstack_linked_list_add(&rfcomm_channels, (btstack_linked_item_t *) channel);
@@ -511,6 +617,22 @@ static rfcomm_channel_t * rfcomm_channel_create(rfcomm_multiplexer_t * multiplex
     return channel;
 }
 
+static void rfcomm_channel_free(rfcomm_channel_t * channel){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    rfcomm_channel_for_rfcomm_cid_table[channel->rfcomm_cid - 1u] = NULL;
+    rfcomm_channel_t ** it = &channel->multiplexer->channels;
+    while (*it != NULL){
+        if (*it == channel){
+            *it = channel->multiplexer_next;
+            break;
+        }
+        it = &(*it)->multiplexer_next;
+    }
+#endif
+    btstack_linked_list_remove(&rfcomm_channels, (btstack_linked_item_t *) channel);
+    btstack_memory_rfcomm_channel_free(channel);
+}
+
 static void rfcomm_notify_channel_can_send(void){
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &rfcomm_channels);
@@ -525,6 +647,15 @@ static void rfcomm_notify_channel_can_send(void){
 }
 
 static rfcomm_channel_t * rfcomm_channel_for_multiplexer_and_dlci(rfcomm_multiplexer_t * multiplexer, uint8_t dlci){
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    rfcomm_channel_t * channel;
+    for (channel = multiplexer->channels; channel != NULL ; channel = channel->multiplexer_next){
+        if (channel->dlci == dlci) {
+            return channel;
+        }
+    }
+    return NULL;
+#else
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) rfcomm_channels; it ; it = it->next){
         rfcomm_channel_t * channel = ((rfcomm_channel_t *) it);
@@ -533,6 +664,7 @@ static rfcomm_channel_t * rfcomm_channel_for_multiplexer_and_dlci(rfcomm_multipl
         };
     }
     return NULL;
+#endif
 }
 
 static rfcomm_service_t * rfcomm_service_for_channel(uint8_t server_channel){
@@ -604,10 +736,8 @@ static int rfcomm_send_packet_for_multiplexer(rfcomm_multiplexer_t *multiplexer,
 }
 
 // simplified version of rfcomm_send_packet_for_multiplexer for prepared rfcomm packet (UIH, 2 byte len, no credits)
-static int rfcomm_send_uih_prepared(rfcomm_multiplexer_t *multiplexer, uint8_t dlci, uint16_t len){
-
-    uint8_t address = (1 << 0) | (multiplexer->outgoing << 1) | (dlci << 2); 
-    uint8_t control = BT_RFCOMM_UIH;
+// uses address and FCS cached in channel
+static int rfcomm_channel_send_uih_prepared(rfcomm_channel_t *channel, uint16_t len){
 
 #ifdef RFCOMM_USE_OUTGOING_BUFFER
     uint8_t * rfcomm_out_buffer = outgoing_buffer;
@@ -616,8 +746,8 @@ static int rfcomm_send_uih_prepared(rfcomm_multiplexer_t *multiplexer, uint8_t d
 #endif
 
     uint16_t pos = 0;
-    rfcomm_out_buffer[pos++] = address;
-    rfcomm_out_buffer[pos++] = control;
+    rfcomm_out_buffer[pos++] = channel->uih_address;
+    rfcomm_out_buffer[pos++] = BT_RFCOMM_UIH;
     rfcomm_out_buffer[pos++] = (len & 0x7f) << 1; // bits 0-6
     rfcomm_out_buffer[pos++] = len >> 7;          // bits 7-14
 
@@ -625,12 +755,12 @@ static int rfcomm_send_uih_prepared(rfcomm_multiplexer_t *multiplexer, uint8_t d
     pos += len;
     
     // UIH frames only calc FCS over address + control (5.1.1)
-    rfcomm_out_buffer[pos++] =  btstack_crc8_calc(rfcomm_out_buffer, 2); // calc fcs
+    rfcomm_out_buffer[pos++] = channel->uih_fcs;
     
 #ifdef RFCOMM_USE_OUTGOING_BUFFER
-    int err = l2cap_send(multiplexer->l2cap_cid, rfcomm_out_buffer, pos);
+    int err = l2cap_send(channel->multiplexer->l2cap_cid, rfcomm_out_buffer, pos);
 #else
-    int err = l2cap_send_prepared(multiplexer->l2cap_cid, pos);
+    int err = l2cap_send_prepared(channel->multiplexer->l2cap_cid, pos);
 #endif
 
     return err;
@@ -873,6 +1003,7 @@ static void rfcomm_multiplexer_stop_timer(rfcomm_multiplexer_t * multiplexer){
     }
 }
 static void rfcomm_multiplexer_free(rfcomm_multiplexer_t * multiplexer){
+    rfcomm_multiplexer_set_l2cap_cid(multiplexer, 0);
     btstack_linked_list_remove( &rfcomm_multiplexers, (btstack_linked_item_t *) multiplexer);
     btstack_memory_rfcomm_multiplexer_free(multiplexer);
 }
@@ -888,10 +1019,8 @@ static void rfcomm_multiplexer_finalize(rfcomm_multiplexer_t * multiplexer){
         if (channel->multiplexer == multiplexer) {
             // emit open with status or closed
             rfcomm_channel_emit_final_event(channel, RFCOMM_MULTIPLEXER_STOPPED);
-            // remove from list
-            it->next = it->next->next;
-            // free channel struct
-            btstack_memory_rfcomm_channel_free(channel);
+            // remove from list and free channel struct
+            rfcomm_channel_free(channel);
         } else {
             it = it->next;
         }
@@ -1060,7 +1189,7 @@ static int rfcomm_hci_event_handler(uint8_t *packet, uint16_t size){
             }
             
             multiplexer->con_handle = con_handle;
-            multiplexer->l2cap_cid = l2cap_cid;
+            rfcomm_multiplexer_set_l2cap_cid(multiplexer, l2cap_cid);
             // 
             multiplexer->state = RFCOMM_MULTIPLEXER_W4_SABM_0;
             log_info("L2CAP_EVENT_INCOMING_CONNECTION (l2cap_cid 0x%02x) for BLUETOOTH_PROTOCOL_RFCOMM => accept", l2cap_cid);
@@ -1122,8 +1251,7 @@ static int rfcomm_hci_event_handler(uint8_t *packet, uint16_t size){
                         if (channel->multiplexer == multiplexer){
                             done = 0;
                             rfcomm_emit_channel_opened(channel, status);
-                            btstack_linked_list_remove(&rfcomm_channels, (btstack_linked_item_t *) channel);
-                            btstack_memory_rfcomm_channel_free(channel);
+                            rfcomm_channel_free(channel);
                             break;
                         } else {
                             it = it->next;
@@ -1145,7 +1273,7 @@ static int rfcomm_hci_event_handler(uint8_t *packet, uint16_t size){
                 log_info("L2CAP_EVENT_CHANNEL_OPENED: outgoing connection");
                 // wrong remote addr
                 if (bd_addr_cmp(event_addr, multiplexer->remote_addr)) break;
-                multiplexer->l2cap_cid = l2cap_cid;
+                rfcomm_multiplexer_set_l2cap_cid(multiplexer, l2cap_cid);
                 multiplexer->con_handle = con_handle;
                 // send SABM #0
                 rfcomm_multiplexer_set_state_and_request_can_send_now_event(multiplexer, RFCOMM_MULTIPLEXER_SEND_SABM_0);
@@ -1382,10 +1510,72 @@ static void rfcomm_multiplexer_state_machine(rfcomm_multiplexer_t * multiplexer,
 // MARK: RFCOMM CHANNEL
 
 static void rfcomm_channel_send_credits(rfcomm_channel_t *channel, uint8_t credits){
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+    // first frame that uses new credits provides round trip time sample, if remote is already sending
+    bool remote_sending = (channel->credits_interval_frames > 0u) || (channel->credits_frames_per_second > 0u);
+    if (remote_sending && (channel->credits_rtt_frames == 0u)){
+        channel->credits_rtt_frames = channel->credits_incoming + 1u;
+        channel->credits_granted_ms = btstack_run_loop_get_time_ms();
+        channel->credits_rtt_drain_ms = 0;
+        if (channel->credits_incoming > 0u){
+            channel->credits_rtt_drain_ms = UINT32_MAX;
+            if (channel->credits_frames_per_second > 0u){
+                channel->credits_rtt_drain_ms = (((uint32_t) channel->credits_incoming) * 1000u) / channel->credits_frames_per_second;
+            }
+        }
+    }
+#endif
     channel->credits_incoming += credits;
     rfcomm_send_uih_credits(channel->multiplexer, channel->dlci, credits);
 }
 
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+static void rfcomm_channel_credits_frame_received(rfcomm_channel_t *channel){
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+    // round trip time, ignore samples where remote was idle. If the first frame with new credits arrives before
+    // outstanding credits could have been used up, remote did not wait for new credits and the sample is only the drain time
+    if (channel->credits_rtt_frames > 0u){
+        channel->credits_rtt_frames--;
+        uint32_t rtt_ms = now - channel->credits_granted_ms;
+        bool remote_waited = rtt_ms > channel->credits_rtt_drain_ms;
+        if ((channel->credits_rtt_frames == 0u) && remote_waited && (rtt_ms <= RFCOMM_CREDITS_AUTO_TUNING_MAX_RTT_MS)){
+            if (channel->credits_rtt_ms == 0u){
+                channel->credits_rtt_ms = (uint16_t) rtt_ms;
+            } else {
+                channel->credits_rtt_ms = (uint16_t) (((3u * channel->credits_rtt_ms) + rtt_ms) / 4u);
+            }
+        }
+    }
+
+    // consumption rate
+    if (channel->credits_interval_frames == 0u){
+        channel->credits_interval_start_ms = now;
+    }
+    channel->credits_interval_frames++;
+    uint32_t interval_ms = now - channel->credits_interval_start_ms;
+    if (interval_ms >= RFCOMM_CREDITS_AUTO_TUNING_INTERVAL_MS){
+        uint32_t frames_per_second = btstack_min((channel->credits_interval_frames * 1000u) / interval_ms, 0xffffu);
+        if (channel->credits_frames_per_second == 0u){
+            channel->credits_frames_per_second = (uint16_t) frames_per_second;
+        } else {
+            channel->credits_frames_per_second = (uint16_t) ((channel->credits_frames_per_second + frames_per_second) / 2u);
+        }
+        channel->credits_interval_frames = 0;
+    }
+}
+
+// new credits are provided when half of the window has been used, so half of the window needs to cover
+// twice the frames consumed per round trip time. If remote is limited by credits, the window doubles
+static uint8_t rfcomm_channel_credits_window(rfcomm_channel_t *channel){
+    uint32_t frames_per_rtt = (((uint32_t) channel->credits_frames_per_second) * channel->credits_rtt_ms) / 1000u;
+    uint32_t window = 4u * frames_per_rtt;
+    if (window < RFCOMM_CREDITS) return RFCOMM_CREDITS;
+    if (window > RFCOMM_CREDITS_AUTO_TUNING_MAX) return RFCOMM_CREDITS_AUTO_TUNING_MAX;
+    return (uint8_t) window;
+}
+#endif
+
 static int rfcomm_channel_can_send(rfcomm_channel_t * channel){
     if (!channel->credits_outgoing) return 0;
     if ((channel->multiplexer->fcon & 1) == 0) return 0;
@@ -1454,6 +1644,10 @@ static void rfcomm_channel_packet_handler_uih(rfcomm_multiplexer_t *multiplexer,
         if (channel->credits_incoming > 0){
             channel->credits_incoming--;
         }
+
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+        rfcomm_channel_credits_frame_received(channel);
+#endif
         
         // deliver payload
         (channel->packet_handler)(RFCOMM_DATA_PACKET, channel->rfcomm_cid,
@@ -1461,10 +1655,21 @@ static void rfcomm_channel_packet_handler_uih(rfcomm_multiplexer_t *multiplexer,
     }
     
     // automatically provide new credits to remote device, if no incoming flow control
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+    // top up to window once half of it has been used
+    if (!channel->incoming_flow_control){
+        uint8_t window = rfcomm_channel_credits_window(channel);
+        if (channel->credits_incoming < (window / 2u)){
+            channel->new_credits_incoming = window - channel->credits_incoming;
+            request_can_send_now = 1;
+        }
+    }
+#else
     if (!channel->incoming_flow_control && (channel->credits_incoming < 5)){
         channel->new_credits_incoming = RFCOMM_CREDITS;
         request_can_send_now = 1;
     }    
+#endif
 
     if (request_can_send_now){
         l2cap_request_can_send_now_event(multiplexer->l2cap_cid);
@@ -1492,11 +1697,8 @@ static void rfcomm_channel_finalize(rfcomm_channel_t *channel){
 
     rfcomm_multiplexer_t *multiplexer = channel->multiplexer;
 
-    // remove from list
-    btstack_linked_list_remove( &rfcomm_channels, (btstack_linked_item_t *) channel);
-
-    // free channel
-    btstack_memory_rfcomm_channel_free(channel);
+    // remove from list and free channel
+    rfcomm_channel_free(channel);
     
     // update multiplexer timeout after channel was removed from list
     rfcomm_multiplexer_prepare_idle_timer(multiplexer);
@@ -1726,18 +1928,20 @@ static void rfcomm_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t
     // we only handle l2cap packets for:
     if (packet_type != L2CAP_DATA_PACKET) return;
 
-    //  - multiplexer itself
-    int handled = rfcomm_multiplexer_l2cap_packet_handler(channel, packet, size);
+    // rfcomm: (0) addr [76543 server channel] [2 direction: initiator uses 1] [1 C/R: CMD by initiator = 1] [0 EA=1]
+    const uint8_t frame_dlci = packet[0] >> 2;
 
-    if (handled) return;
+    //  - multiplexer itself, only handles DLCI 0
+    if (frame_dlci == 0){
+        int handled = rfcomm_multiplexer_l2cap_packet_handler(channel, packet, size);
+        if (handled) return;
+    }
     
     // - channel over open mutliplexer
     rfcomm_multiplexer_t * multiplexer = rfcomm_multiplexer_for_l2cap_cid(channel);
     if ( (multiplexer == NULL) || (multiplexer->state != RFCOMM_MULTIPLEXER_OPEN)) return;
     
     // channel data ?
-    // rfcomm: (0) addr [76543 server channel] [2 direction: initiator uses 1] [1 C/R: CMD by initiator = 1] [0 EA=1]
-    const uint8_t frame_dlci = packet[0] >> 2;
 	
     if (frame_dlci && ((packet[1] == BT_RFCOMM_UIH) || (packet[1] == BT_RFCOMM_UIH_PF))) {
         rfcomm_channel_packet_handler_uih(multiplexer, packet, size);
@@ -2186,6 +2390,10 @@ void rfcomm_init(void){
     rfcomm_multiplexers = NULL;
     rfcomm_services     = NULL;
     rfcomm_channels     = NULL;
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    memset(rfcomm_channel_for_rfcomm_cid_table, 0, sizeof(rfcomm_channel_for_rfcomm_cid_table));
+    memset(rfcomm_multiplexers_for_l2cap_cid, 0, sizeof(rfcomm_multiplexers_for_l2cap_cid));
+#endif
     rfcomm_security_level = gap_get_security_level();
 #ifdef RFCOMM_USE_ERTM
     rfcomm_ertm_id = 0;
@@ -2284,16 +2492,8 @@ uint8_t * rfcomm_get_outgoing_buffer(void){
     return &rfcomm_out_buffer[4];
 }
 
-int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
-    rfcomm_channel_t * channel = rfcomm_channel_for_rfcomm_cid(rfcomm_cid);
-    if (!channel){
-        log_error("rfcomm_send_prepared cid 0x%02x doesn't exist!", rfcomm_cid);
-        return 0;
-    }
-
-    int err = rfcomm_assert_send_valid(channel, len);
-    if (err) return err;
-
+// pre: rfcomm_assert_send_valid(channel, len) == 0
+static int rfcomm_channel_send_prepared(rfcomm_channel_t * channel, uint16_t len){
 #ifdef RFCOMM_USE_OUTGOING_BUFFER
     if (!l2cap_can_send_packet_now(channel->multiplexer->l2cap_cid)){
         log_error("rfcomm_send_prepared: l2cap cannot send now");
@@ -2310,10 +2510,10 @@ int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
     if (len){
         channel->credits_outgoing--;
     } else {
-        log_info("sending empty RFCOMM packet for cid %02x", rfcomm_cid);
+        log_info("sending empty RFCOMM packet for cid %02x", channel->rfcomm_cid);
     }
         
-    int result = rfcomm_send_uih_prepared(channel->multiplexer, channel->dlci, len);
+    int result = rfcomm_channel_send_uih_prepared(channel, len);
     
     if (result != 0) {
         if (len) {
@@ -2326,6 +2526,19 @@ int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
     return result;
 }
 
+int rfcomm_send_prepared(uint16_t rfcomm_cid, uint16_t len){
+    rfcomm_channel_t * channel = rfcomm_channel_for_rfcomm_cid(rfcomm_cid);
+    if (!channel){
+        log_error("rfcomm_send_prepared cid 0x%02x doesn't exist!", rfcomm_cid);
+        return 0;
+    }
+
+    int err = rfcomm_assert_send_valid(channel, len);
+    if (err) return err;
+
+    return rfcomm_channel_send_prepared(channel, len);
+}
+
 int rfcomm_send(uint16_t rfcomm_cid, uint8_t *data, uint16_t len){
     rfcomm_channel_t * channel = rfcomm_channel_for_rfcomm_cid(rfcomm_cid);
     if (!channel){
@@ -2347,7 +2560,7 @@ int rfcomm_send(uint16_t rfcomm_cid, uint8_t *data, uint16_t len){
     uint8_t * rfcomm_payload = rfcomm_get_outgoing_buffer();
 
     (void)memcpy(rfcomm_payload, data, len);
-    err = rfcomm_send_prepared(rfcomm_cid, len);    
+    err = rfcomm_channel_send_prepared(channel, len);
 
 #ifdef RFCOMM_USE_OUTGOING_BUFFER
 #else
@@ -2430,14 +2643,14 @@ static uint8_t rfcomm_channel_create_internal(btstack_packet_handler_t packet_ha
     dlci = (server_channel << 1) | (multiplexer->outgoing ^ 1);
     channel = rfcomm_channel_for_multiplexer_and_dlci(multiplexer, dlci);
     if (channel){
-        if (new_multiplexer) btstack_memory_rfcomm_multiplexer_free(multiplexer);
+        if (new_multiplexer) rfcomm_multiplexer_free(multiplexer);
         return RFCOMM_CHANNEL_ALREADY_REGISTERED;
     }
 
     // prepare channel
     channel = rfcomm_channel_create(multiplexer, NULL, server_channel);
     if (!channel){
-        if (new_multiplexer) btstack_memory_rfcomm_multiplexer_free(multiplexer);
+        if (new_multiplexer) rfcomm_multiplexer_free(multiplexer);
         return BTSTACK_MEMORY_ALLOC_FAILED;
     }
 
@@ -2475,11 +2688,11 @@ static uint8_t rfcomm_channel_create_internal(btstack_packet_handler_t packet_ha
             status = l2cap_create_channel(rfcomm_packet_handler, addr, BLUETOOTH_PROTOCOL_RFCOMM, l2cap_max_mtu(), &l2cap_cid);
         }
         if (status) {
-            if (new_multiplexer) btstack_memory_rfcomm_multiplexer_free(multiplexer);
-            btstack_memory_rfcomm_channel_free(channel);
+            rfcomm_channel_free(channel);
+            if (new_multiplexer) rfcomm_multiplexer_free(multiplexer);
             return status;
         }
-        multiplexer->l2cap_cid = l2cap_cid;
+        rfcomm_multiplexer_set_l2cap_cid(multiplexer, l2cap_cid);
         return ERROR_CODE_SUCCESS;
     }
     
@@ -152,7 +152,7 @@ typedef struct {
 
 // info regarding multiplexer
 // note: spec mandates single multiplexer per device combination
-typedef struct {
+typedef struct rfcomm_multiplexer {
     // linked list - assert: first field
     btstack_linked_item_t    item;
     
@@ -162,6 +162,14 @@ typedef struct {
 	RFCOMM_MULTIPLEXER_STATE state;	
     
     uint16_t  l2cap_cid;
+
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    // next multiplexer in same l2cap_cid bucket
+    struct rfcomm_multiplexer * l2cap_cid_next;
+
+    // channels of this multiplexer, chained via multiplexer_next
+    struct rfcomm_channel * channels;
+#endif
     
     uint8_t   fcon; // only send if fcon & 1, send rsp if fcon & 0x80
 
@@ -191,7 +199,7 @@ typedef struct {
 } rfcomm_multiplexer_t;
 
 // info regarding an actual connection
-typedef struct {
+typedef struct rfcomm_channel {
 
     // linked list - assert: first field
     btstack_linked_item_t    item;
@@ -210,6 +218,15 @@ typedef struct {
         
     // 
     uint8_t  dlci; 
+
+    // address and FCS of UIH frames on this DLCI, the FCS only covers address and control field
+    uint8_t  uih_address;
+    uint8_t  uih_fcs;
+
+#ifdef ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+    // next channel of same multiplexer
+    struct rfcomm_channel * multiplexer_next;
+#endif
     
     // credits for outgoing traffic
     uint8_t credits_outgoing;
@@ -246,6 +263,25 @@ typedef struct {
 
     //
     uint8_t   waiting_for_can_send_now;
+
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+    // frames until first frame that uses credits granted at credits_granted_ms, 0 if no sample pending
+    uint16_t credits_rtt_frames;
+    uint32_t credits_granted_ms;
+
+    // time to drain credits outstanding at credits_granted_ms at current consumption rate
+    uint32_t credits_rtt_drain_ms;
+
+    // smoothed round trip time from credit grant to first frame
+    uint16_t credits_rtt_ms;
+
+    // frames received in current measurement interval
+    uint32_t credits_interval_start_ms;
+    uint16_t credits_interval_frames;
+
+    // smoothed consumption rate
+    uint16_t credits_frames_per_second;
+#endif
         
 } rfcomm_channel_t;
 
@@ -104,6 +104,28 @@ typedef enum {
     GAP_RANDOM_ADDRESS_RESOLVABLE,
 } gap_random_address_type_t;
 
+// Advertising report filter, all enabled criteria need to match
+typedef struct {
+    // min RSSI in dBm, -128 = off
+    int8_t            rssi_min;
+    // accepted addresses of any address type, num_addresses = 0 = off
+    uint16_t          num_addresses;
+    const bd_addr_t * addresses;
+    // UUID16 in Service UUID list, 0 = off
+    uint16_t          uuid16;
+    // Company ID of Manufacturer Specific Data, 0xffff = off
+    uint16_t          company_id;
+} gap_advertising_report_filter_t;
+
+typedef struct {
+    // reports delivered to packet handlers
+    uint32_t forwarded;
+    // reports rejected by filter
+    uint32_t dropped_by_filter;
+    // reports seen before within cache TTL
+    uint32_t dropped_duplicates;
+} gap_advertising_report_counters_t;
+
 // Authorization state
 typedef enum {
     AUTHORIZATION_UNKNOWN,
@@ -309,6 +331,35 @@ void gap_start_scan(void);
  */
 void gap_stop_scan(void);
 
+/**
+ * @brief Set filter for advertising reports. Rejected reports are dropped before GAP_EVENT_ADVERTISING_REPORT is emitted
+ * @note requires ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+ * @param filter or NULL to accept all reports, needs to stay valid
+ */
+void gap_set_advertising_report_filter(const gap_advertising_report_filter_t * filter);
+
+/**
+ * @brief Drop advertising reports with same address, advertising event type and data seen within given time
+ * @note requires ENABLE_LE_ADVERTISING_REPORT_PIPELINE, cache has LE_ADVERTISING_REPORT_CACHE_SIZE entries and is cleared on gap_start_scan
+ * @param ttl_ms or 0 to disable
+ */
+void gap_set_advertising_report_cache_ttl(uint16_t ttl_ms);
+
+/**
+ * @brief Collect advertising reports and emit them in GAP_EVENT_ADVERTISING_REPORT_BATCH instead of GAP_EVENT_ADVERTISING_REPORT
+ * @note requires ENABLE_LE_ADVERTISING_REPORT_PIPELINE. Batch is emitted when full, after timeout, or on gap_stop_scan.
+ *       Each report in batch is a complete GAP_EVENT_ADVERTISING_REPORT event
+ * @param timeout_ms max time a report is held back or 0 to disable batching
+ */
+void gap_set_advertising_report_batch_timeout(uint16_t timeout_ms);
+
+/**
+ * @brief Get advertising report counters
+ * @note requires ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+ * @param counters
+ */
+void gap_get_advertising_report_counters(gap_advertising_report_counters_t * counters);
+
 /**
  * @brief Enable privacy by using random addresses
  * @param random_address_type to use (incl. OFF)
@@ -70,11 +70,13 @@
 #include "btstack_event.h"
 #include "btstack_linked_list.h"
 #include "btstack_memory.h"
+#include "btstack_tlv.h"
 #include "bluetooth_company_id.h"
 #include "bluetooth_data_types.h"
 #include "gap.h"
 #include "hci.h"
 #include "hci_cmd.h"
+#include "hci_cmd_encoder.h"
 #include "hci_dump.h"
 #include "ad_parser.h"
 
@@ -154,9 +156,15 @@ static void hci_emit_hci_open_failed(void);
 static void hci_emit_dedicated_bonding_result(bd_addr_t address, uint8_t status);
 static void hci_emit_event(uint8_t * event, uint16_t size, int dump);
 static void hci_emit_acl_packet(uint8_t * packet, uint16_t size);
+static void hci_notify_if_acl_can_send_now(void);
 static void hci_run(void);
+static void packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size);
+static int  hci_transport_synchronous(void);
 static int  hci_is_le_connection(hci_connection_t * connection);
 static int  hci_number_free_acl_slots_for_connection_type( bd_addr_type_t address_type);
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+static void hci_connection_clear_dirty(hci_connection_t * connection);
+#endif
 
 #ifdef ENABLE_CLASSIC
 static int hci_have_usb_transport(void);
@@ -185,6 +193,90 @@ static const char * default_classic_name = "BTstack 00:00:00:00:00:00";
 static uint8_t disable_l2cap_timeouts = 0;
 #endif
 
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+static uint16_t hci_connection_address_hash(const bd_addr_t addr, bd_addr_type_t addr_type){
+    uint32_t hash = (uint32_t) addr_type;
+    int i;
+    for (i = 0; i < 6; i++){
+        hash = (hash * 31u) + addr[i];
+    }
+    return (uint16_t) (hash % HCI_CONNECTION_ADDRESS_HASH_SIZE);
+}
+
+static void hci_connection_address_hash_add(hci_connection_t * conn){
+    uint16_t index = hci_connection_address_hash(conn->address, conn->address_type);
+    conn->address_hash_next = hci_stack->connection_for_address[index];
+    hci_stack->connection_for_address[index] = conn;
+}
+
+static void hci_connection_address_hash_remove(hci_connection_t * conn){
+    uint16_t index = hci_connection_address_hash(conn->address, conn->address_type);
+    hci_connection_t ** it = &hci_stack->connection_for_address[index];
+    while (*it != NULL){
+        if (*it == conn){
+            *it = conn->address_hash_next;
+            conn->address_hash_next = NULL;
+            return;
+        }
+        it = &(*it)->address_hash_next;
+    }
+}
+#endif
+
+// set connection handle and keep handle table in sync
+static void hci_connection_set_con_handle(hci_connection_t * conn, hci_con_handle_t con_handle){
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    if ((conn->con_handle < HCI_CONNECTION_HANDLE_TABLE_SIZE) && (hci_stack->connection_for_handle[conn->con_handle] == conn)){
+        hci_stack->connection_for_handle[conn->con_handle] = NULL;
+    }
+    if (con_handle < HCI_CONNECTION_HANDLE_TABLE_SIZE){
+        hci_stack->connection_for_handle[con_handle] = conn;
+    }
+#endif
+    conn->con_handle = con_handle;
+}
+
+// get buffer for ACL packet recombination, NULL if pool exhausted
+static uint8_t * hci_acl_recombination_buffer_get(hci_connection_t * conn){
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    if (conn->acl_recombination_buffer == NULL){
+        conn->acl_recombination_buffer = btstack_memory_hci_acl_recombination_buffer_get();
+        if (conn->acl_recombination_buffer == NULL) return NULL;
+        // buffer is not cleared on allocation, payload is written by received fragments
+        memset(&conn->acl_recombination_buffer->data[HCI_INCOMING_PRE_BUFFER_SIZE], 0, 4);
+    }
+    return conn->acl_recombination_buffer->data;
+#else
+    return conn->acl_recombination_buffer;
+#endif
+}
+
+// drop partially received ACL packet and return pooled buffer
+static void hci_acl_recombination_reset(hci_connection_t * conn){
+    conn->acl_recombination_pos = 0;
+    conn->acl_recombination_length = 0;
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    if (conn->acl_recombination_buffer != NULL){
+        btstack_memory_hci_acl_recombination_buffer_free(conn->acl_recombination_buffer);
+        conn->acl_recombination_buffer = NULL;
+    }
+#endif
+}
+
+// remove connection from connection list and lookup tables and free it
+static void hci_connection_free(hci_connection_t * conn){
+    hci_acl_recombination_reset(conn);
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    hci_connection_set_con_handle(conn, HCI_CON_HANDLE_INVALID);
+    hci_connection_address_hash_remove(conn);
+#endif
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+    hci_connection_clear_dirty(conn);
+#endif
+    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+    btstack_memory_hci_connection_free( conn );
+}
+
 /**
  * create connection for given address
  *
@@ -210,6 +302,9 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(const bd_addr_t
     conn->acl_recombination_length = 0;
     conn->acl_recombination_pos = 0;
     conn->num_packets_sent = 0;
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    conn->acl_scheduler_weight = HCI_ACL_SCHEDULER_DEFAULT_WEIGHT;
+#endif
 
     conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
 #ifdef ENABLE_BLE
@@ -219,6 +314,11 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(const bd_addr_t
     conn->le_max_tx_octets = 27;
 #endif
     btstack_linked_list_add(&hci_stack->connections, (btstack_linked_item_t *) conn);
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    hci_connection_address_hash_add(conn);
+#endif
+    // initial state is SEND_CREATE_CONNECTION
+    hci_connection_set_dirty(conn);
     return conn;
 }
 
@@ -289,6 +389,10 @@ void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
  * @return connection OR NULL, if not found
  */
 hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    if (con_handle >= HCI_CONNECTION_HANDLE_TABLE_SIZE) return NULL;
+    return hci_stack->connection_for_handle[con_handle];
+#else
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hci_stack->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -298,6 +402,7 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
         }
     } 
     return NULL;
+#endif
 }
 
 /**
@@ -306,6 +411,16 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
  * @return connection OR NULL, if not found
  */
 hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t  addr, bd_addr_type_t addr_type){
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    hci_connection_t * connection = hci_stack->connection_for_address[hci_connection_address_hash(addr, addr_type)];
+    while (connection != NULL){
+        if ((connection->address_type == addr_type) && (memcmp(addr, connection->address, 6) == 0)){
+            return connection;
+        }
+        connection = connection->address_hash_next;
+    }
+    return NULL;
+#else
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hci_stack->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -315,6 +430,25 @@ hci_connection_t * hci_connection_for_bd_addr_and_type(const bd_addr_t  addr, bd
         return connection;   
     } 
     return NULL;
+#endif
+}
+
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+static void hci_connection_clear_dirty(hci_connection_t * connection){
+    if (!connection->dirty) return;
+    connection->dirty = false;
+    hci_stack->connections_dirty--;
+}
+#endif
+
+void hci_connection_set_dirty(hci_connection_t * connection){
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+    if (connection->dirty) return;
+    connection->dirty = true;
+    hci_stack->connections_dirty++;
+#else
+    UNUSED(connection);
+#endif
 }
 
 inline static void connectionClearAuthenticationFlags(hci_connection_t * conn, hci_authentication_flags_t flags){
@@ -323,6 +457,7 @@ inline static void connectionClearAuthenticationFlags(hci_connection_t * conn, h
 
 inline static void connectionSetAuthenticationFlags(hci_connection_t * conn, hci_authentication_flags_t flags){
     conn->authentication_flags = (hci_authentication_flags_t)(conn->authentication_flags | flags);
+    hci_connection_set_dirty(conn);
 }
 
 #ifdef ENABLE_CLASSIC
@@ -531,6 +666,96 @@ int hci_number_free_acl_slots_for_handle(hci_con_handle_t con_handle){
     return hci_number_free_acl_slots_for_connection_type(connection->address_type);
 }
 
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+// connections share Controller ACL buffers if both are LE or Classic, or if Controller has no LE buffers
+static bool hci_acl_scheduler_share_buffers(hci_connection_t * a, hci_connection_t * b){
+    if (hci_stack->le_acl_packets_total_num == 0u) return true;
+    return hci_is_le_connection(a) == hci_is_le_connection(b);
+}
+
+// deficit round robin among connections waiting for can send now, pre: Controller has free ACL buffers
+static bool hci_acl_scheduler_grant(hci_connection_t * connection){
+    bool peers_with_deficit = false;
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
+        hci_connection_t * peer = (hci_connection_t *) it;
+        if (peer == connection) continue;
+        if (peer->acl_waiting_for_can_send_now == 0u) continue;
+        if (!hci_acl_scheduler_share_buffers(peer, connection)) continue;
+        if (peer->acl_scheduler_priority > connection->acl_scheduler_priority) return false;
+        if (peer->acl_scheduler_priority < connection->acl_scheduler_priority) continue;
+        if (peer->acl_scheduler_deficit > 0) {
+            peers_with_deficit = true;
+        }
+    }
+    if (connection->acl_scheduler_deficit > 0) return true;
+    // otherwise, a new round is started when the packet is sent
+    return !peers_with_deficit;
+}
+
+static bool hci_acl_scheduler_peers_waiting(hci_connection_t * connection){
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
+        hci_connection_t * peer = (hci_connection_t *) it;
+        if (peer == connection) continue;
+        if (peer->acl_waiting_for_can_send_now == 0u) continue;
+        if (peer->acl_scheduler_priority != connection->acl_scheduler_priority) continue;
+        if (!hci_acl_scheduler_share_buffers(peer, connection)) continue;
+        return true;
+    }
+    return false;
+}
+
+// charge Controller ACL buffers used for packet
+static void hci_acl_scheduler_packet_sent(hci_connection_t * connection, uint16_t num_fragments){
+    connection->acl_scheduler_counters.packets_sent++;
+    connection->acl_scheduler_counters.fragments_sent += num_fragments;
+
+    // start new round for connections with same priority, idle connections don't collect credit
+    if (connection->acl_scheduler_deficit <= 0){
+        // nobody else wants to send
+        if (!hci_acl_scheduler_peers_waiting(connection)){
+            connection->acl_scheduler_deficit = 0;
+            return;
+        }
+        btstack_linked_item_t * it;
+        for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
+            hci_connection_t * peer = (hci_connection_t *) it;
+            if (peer->acl_scheduler_priority != connection->acl_scheduler_priority) continue;
+            if (!hci_acl_scheduler_share_buffers(peer, connection)) continue;
+            if ((peer == connection) || (peer->acl_waiting_for_can_send_now != 0u)){
+                peer->acl_scheduler_deficit += peer->acl_scheduler_weight;
+            } else if (peer->acl_scheduler_deficit > 0){
+                peer->acl_scheduler_deficit = 0;
+            }
+        }
+    }
+    connection->acl_scheduler_deficit -= (int16_t) num_fragments;
+}
+
+uint8_t hci_acl_scheduler_set_weight(hci_con_handle_t con_handle, uint8_t weight){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (weight == 0u) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    connection->acl_scheduler_weight = weight;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t hci_acl_scheduler_set_priority(hci_con_handle_t con_handle, uint8_t priority){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    connection->acl_scheduler_priority = priority;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t hci_acl_scheduler_get_counters(hci_con_handle_t con_handle, hci_acl_scheduler_counters_t * counters){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (connection == NULL) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    *counters = connection->acl_scheduler_counters;
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+
 #ifdef ENABLE_CLASSIC
 static int hci_number_free_sco_slots(void){
     unsigned int num_sco_packets_sent  = 0;
@@ -561,9 +786,98 @@ static int hci_number_free_sco_slots(void){
 }
 #endif
 
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+static void hci_outgoing_packet_buffer_set_current(hci_outgoing_packet_buffer_t * buffer){
+    hci_stack->outgoing_packet_buffer_current = buffer;
+    hci_stack->hci_packet_buffer = &buffer->data[HCI_OUTGOING_PRE_BUFFER_SIZE];
+}
+
+static void hci_outgoing_packet_buffers_reset(void){
+    hci_stack->outgoing_packet_buffers_free = NULL;
+    hci_stack->outgoing_packet_buffers_parked = NULL;
+    hci_stack->outgoing_packet_buffer_tx_active = NULL;
+    int i;
+    for (i = 1; i < HCI_OUTGOING_PACKET_POOL_SIZE; i++){
+        btstack_linked_list_add(&hci_stack->outgoing_packet_buffers_free, (btstack_linked_item_t *) &hci_stack->outgoing_packet_buffers[i]);
+    }
+    hci_outgoing_packet_buffer_set_current(&hci_stack->outgoing_packet_buffers[0]);
+}
+
+static hci_con_handle_t hci_outgoing_packet_buffer_get_con_handle(hci_outgoing_packet_buffer_t * buffer){
+    return READ_ACL_CONNECTION_HANDLE(&buffer->data[HCI_OUTGOING_PRE_BUFFER_SIZE]);
+}
+
+static bool hci_outgoing_packet_buffer_parked_for_handle(hci_con_handle_t con_handle){
+    btstack_linked_item_t * it;
+    for (it = hci_stack->outgoing_packet_buffers_parked; it != NULL; it = it->next){
+        hci_outgoing_packet_buffer_t * buffer = (hci_outgoing_packet_buffer_t *) it;
+        if (buffer->acl_fragmentation_total_size == 0u) continue;
+        if (hci_outgoing_packet_buffer_get_con_handle(buffer) == con_handle) return true;
+    }
+    return false;
+}
+
+// park fragmented ACL packet in current buffer and continue with free buffer
+static void hci_outgoing_packet_buffer_park(void){
+    hci_outgoing_packet_buffer_t * next = (hci_outgoing_packet_buffer_t *) btstack_linked_list_pop(&hci_stack->outgoing_packet_buffers_free);
+    if (next == NULL) return;
+    hci_outgoing_packet_buffer_t * buffer = hci_stack->outgoing_packet_buffer_current;
+    buffer->acl_fragmentation_pos        = hci_stack->acl_fragmentation_pos;
+    buffer->acl_fragmentation_total_size = hci_stack->acl_fragmentation_total_size;
+    btstack_linked_list_add_tail(&hci_stack->outgoing_packet_buffers_parked, (btstack_linked_item_t *) buffer);
+    if ((hci_stack->acl_fragmentation_tx_active != 0u) && !hci_transport_synchronous()){
+        hci_stack->outgoing_packet_buffer_tx_active = buffer;
+    }
+    hci_stack->acl_fragmentation_pos = 0;
+    hci_stack->acl_fragmentation_total_size = 0;
+    hci_stack->acl_fragmentation_tx_active = 0;
+    hci_stack->hci_packet_buffer_reserved = 0;
+    hci_outgoing_packet_buffer_set_current(next);
+}
+
+// make parked buffer the current buffer, pre: current buffer not reserved
+static void hci_outgoing_packet_buffer_resume(hci_outgoing_packet_buffer_t * buffer){
+    btstack_linked_list_remove(&hci_stack->outgoing_packet_buffers_parked, (btstack_linked_item_t *) buffer);
+    btstack_linked_list_add(&hci_stack->outgoing_packet_buffers_free, (btstack_linked_item_t *) hci_stack->outgoing_packet_buffer_current);
+    hci_outgoing_packet_buffer_set_current(buffer);
+    hci_stack->acl_fragmentation_pos        = buffer->acl_fragmentation_pos;
+    hci_stack->acl_fragmentation_total_size = buffer->acl_fragmentation_total_size;
+    hci_stack->hci_packet_buffer_reserved = 1;
+}
+
+static void hci_outgoing_packet_buffer_drop(hci_outgoing_packet_buffer_t * buffer){
+    btstack_linked_list_remove(&hci_stack->outgoing_packet_buffers_parked, (btstack_linked_item_t *) buffer);
+    btstack_linked_list_add(&hci_stack->outgoing_packet_buffers_free, (btstack_linked_item_t *) buffer);
+}
+
+// drop parked fragments for closed connection, buffer still used by transport is dropped when sent
+static void hci_outgoing_packet_buffers_drop_for_handle(hci_con_handle_t con_handle){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->outgoing_packet_buffers_parked);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        hci_outgoing_packet_buffer_t * buffer = (hci_outgoing_packet_buffer_t *) btstack_linked_list_iterator_next(&it);
+        if (hci_outgoing_packet_buffer_get_con_handle(buffer) != con_handle) continue;
+        log_info("drop parked ACL fragments for closed connection");
+        buffer->acl_fragmentation_total_size = 0;
+        buffer->acl_fragmentation_pos = 0;
+        if (buffer == hci_stack->outgoing_packet_buffer_tx_active) continue;
+        btstack_linked_list_iterator_remove(&it);
+        btstack_linked_list_add(&hci_stack->outgoing_packet_buffers_free, (btstack_linked_item_t *) buffer);
+    }
+}
+#endif
+
+// packet buffer reserved or, with outgoing packet pool, parked buffer still in transport
+static int hci_packet_buffer_busy(void){
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    if (hci_stack->outgoing_packet_buffer_tx_active != NULL) return 1;
+#endif
+    return hci_stack->hci_packet_buffer_reserved;
+}
+
 // only used to send HCI Host Number Completed Packets
 static int hci_can_send_comand_packet_transport(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_packet_buffer_busy()) return 0;
 
     // check for async hci transport implementations
     if (hci_stack->hci_transport->can_send_packet_now){
@@ -574,13 +888,98 @@ static int hci_can_send_comand_packet_transport(void){
     return 1;
 }
 
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+// commands that don't update host state on completion, other commands can be sent while they are in flight
+static bool hci_command_is_independent(uint16_t opcode){
+    switch (opcode){
+        case HCI_OPCODE_HCI_READ_RSSI:
+        case HCI_OPCODE_HCI_LE_ENCRYPT:
+        case HCI_OPCODE_HCI_LE_RAND:
+        case HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST:
+        case HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_WHITE_LIST:
+        case HCI_OPCODE_HCI_LE_CONNECTION_UPDATE:
+        case HCI_OPCODE_HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_REPLY:
+        case HCI_OPCODE_HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_NEGATIVE_REPLY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool hci_command_pipeline_ready(void){
+    uint8_t i;
+    if (hci_stack->cmd_opcodes_pending_count == 0u) return true;
+    // init sequence and shutdown wait for each command
+    if (hci_stack->state != HCI_STATE_WORKING) return false;
+    if (hci_stack->cmd_opcodes_pending_count >= HCI_COMMAND_PIPELINE_MAX) return false;
+    for (i = 0; i < hci_stack->cmd_opcodes_pending_count; i++){
+        if (!hci_command_is_independent(hci_stack->cmd_opcodes_pending[i])) return false;
+    }
+    return true;
+}
+
+static void hci_command_pipeline_add(uint16_t opcode){
+    if (hci_stack->cmd_opcodes_pending_count >= HCI_COMMAND_PIPELINE_MAX) {
+        // only possible if controller doesn't report completion, e.g. vendor commands
+        log_info("Command pipeline full, drop opcode %04x", hci_stack->cmd_opcodes_pending[0]);
+        hci_stack->cmd_opcodes_pending_count--;
+        (void)memmove(&hci_stack->cmd_opcodes_pending[0], &hci_stack->cmd_opcodes_pending[1],
+                      hci_stack->cmd_opcodes_pending_count * sizeof(uint16_t));
+    }
+    hci_stack->cmd_opcodes_pending[hci_stack->cmd_opcodes_pending_count++] = opcode;
+}
+
+// match Command Complete/Status to oldest command with same opcode
+static void hci_command_pipeline_complete(uint16_t opcode){
+    uint8_t i;
+    for (i = 0; i < hci_stack->cmd_opcodes_pending_count; i++){
+        if (hci_stack->cmd_opcodes_pending[i] != opcode) continue;
+        hci_stack->cmd_opcodes_pending_count--;
+        (void)memmove(&hci_stack->cmd_opcodes_pending[i], &hci_stack->cmd_opcodes_pending[i+1u],
+                      (hci_stack->cmd_opcodes_pending_count - i) * sizeof(uint16_t));
+        return;
+    }
+}
+#endif
+
+static void hci_command_pipeline_reset(void){
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    hci_stack->cmd_opcodes_pending_count = 0;
+#endif
+}
+
+// Num_HCI_Command_Packets from Command Complete/Status
+static void hci_command_credits_update(uint8_t num_hci_command_packets, uint16_t opcode){
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    // event might have been generated before later commands were received, count them as outstanding
+    hci_command_pipeline_complete(opcode);
+    uint8_t limit = btstack_min(num_hci_command_packets, HCI_COMMAND_PIPELINE_MAX);
+    if (limit > hci_stack->cmd_opcodes_pending_count){
+        hci_stack->num_cmd_packets = limit - hci_stack->cmd_opcodes_pending_count;
+    } else {
+        hci_stack->num_cmd_packets = 0;
+    }
+#else
+    UNUSED(opcode);
+    // limit to 1 to reduce complexity
+    hci_stack->num_cmd_packets = num_hci_command_packets ? 1 : 0;
+#endif
+}
+
 // new functions replacing hci_can_send_packet_now[_using_packet_buffer]
 int hci_can_send_command_packet_now(void){
     if (hci_can_send_comand_packet_transport() == 0) return 0;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    if (!hci_command_pipeline_ready()) return 0;
+#endif
     return hci_stack->num_cmd_packets > 0u;
 }
 
 static int hci_transport_can_send_prepared_packet_now(uint8_t packet_type){
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // parked buffer still used by transport
+    if (hci_stack->outgoing_packet_buffer_tx_active != NULL) return 0;
+#endif
     // check for async hci transport implementations
     if (!hci_stack->hci_transport->can_send_packet_now) return 1;
     return hci_stack->hci_transport->can_send_packet_now(packet_type);
@@ -592,23 +991,46 @@ static int hci_can_send_prepared_acl_packet_for_address_type(bd_addr_type_t addr
 }
 
 int hci_can_send_acl_le_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_packet_buffer_busy()) return 0;
     return hci_can_send_prepared_acl_packet_for_address_type(BD_ADDR_TYPE_LE_PUBLIC);
 }
 
-int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle) {
+// transport and controller ready for next ACL fragment
+static int hci_can_send_acl_fragment_now(hci_con_handle_t con_handle){
     if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
     return hci_number_free_acl_slots_for_handle(con_handle) > 0;
 }
 
+int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle) {
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // prepared packet is parked while transport is busy
+    return hci_number_free_acl_slots_for_handle(con_handle) > 0;
+#else
+    return hci_can_send_acl_fragment_now(con_handle);
+#endif
+}
+
 int hci_can_send_acl_packet_now(hci_con_handle_t con_handle){
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // one prepared packet per connection, it can be prepared while other packets wait for transport or controller
     if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_outgoing_packet_buffer_parked_for_handle(con_handle)) return 0;
+#else
+    if (hci_packet_buffer_busy()) return 0;
+#endif
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (connection == NULL) return 0;
+    if (!hci_can_send_prepared_acl_packet_now(con_handle)) return 0;
+    return hci_acl_scheduler_grant(connection) ? 1 : 0;
+#else
     return hci_can_send_prepared_acl_packet_now(con_handle);
+#endif
 }
 
 #ifdef ENABLE_CLASSIC
 int hci_can_send_acl_classic_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_packet_buffer_busy()) return 0;
     return hci_can_send_prepared_acl_packet_for_address_type(BD_ADDR_TYPE_ACL);
 }
 
@@ -622,7 +1044,7 @@ int hci_can_send_prepared_sco_packet_now(void){
 }
 
 int hci_can_send_sco_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_packet_buffer_busy()) return 0;
     return hci_can_send_prepared_sco_packet_now();
 }
 
@@ -632,13 +1054,27 @@ void hci_request_sco_can_send_now_event(void){
 }
 #endif
 
+void hci_request_can_send_now_event(hci_con_handle_t con_handle){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (connection == NULL) return;
+    connection->acl_waiting_for_can_send_now = 1;
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    // Controller buffers are given to other connections first
+    if ((hci_number_free_acl_slots_for_handle(con_handle) > 0) && !hci_acl_scheduler_grant(connection)){
+        connection->acl_scheduler_counters.requests_denied++;
+    }
+#endif
+    hci_notify_if_acl_can_send_now();
+}
+
 // used for internal checks in l2cap.c
 int hci_is_packet_buffer_reserved(void){
-    return hci_stack->hci_packet_buffer_reserved;
+    return hci_packet_buffer_busy();
 }
 
 // reserves outgoing packet buffer. @returns 1 if successful
 int hci_reserve_packet_buffer(void){
+    // with outgoing packet pool, current buffer can be reserved while parked buffer is used by transport
     if (hci_stack->hci_packet_buffer_reserved) {
         log_error("hci_reserve_packet_buffer called but buffer already reserved");
         return 0;
@@ -656,11 +1092,8 @@ static int hci_transport_synchronous(void){
     return hci_stack->hci_transport->can_send_packet_now == NULL;
 }
 
-static int hci_send_acl_packet_fragments(hci_connection_t *connection){
-
-    // log_info("hci_send_acl_packet_fragments  %u/%u (con 0x%04x)", hci_stack->acl_fragmentation_pos, hci_stack->acl_fragmentation_total_size, connection->con_handle);
-
-    // max ACL data packet length depends on connection type (LE vs. Classic) and available buffers
+// max ACL data packet length depends on connection type (LE vs. Classic) and available buffers
+static uint16_t hci_max_acl_data_packet_length_for_connection(hci_connection_t * connection){
     uint16_t max_acl_data_packet_length = hci_stack->acl_data_packet_length;
     if (hci_is_le_connection(connection) && (hci_stack->le_data_packets_length > 0u)){
         max_acl_data_packet_length = hci_stack->le_data_packets_length;
@@ -671,6 +1104,14 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         max_acl_data_packet_length = connection->le_max_tx_octets;
     }
 #endif
+    return max_acl_data_packet_length;
+}
+
+static int hci_send_acl_packet_fragments(hci_connection_t *connection){
+
+    // log_info("hci_send_acl_packet_fragments  %u/%u (con 0x%04x)", hci_stack->acl_fragmentation_pos, hci_stack->acl_fragmentation_total_size, connection->con_handle);
+
+    uint16_t max_acl_data_packet_length = hci_max_acl_data_packet_length_for_connection(connection);
 
     log_debug("hci_send_acl_packet_fragments entered");
 
@@ -728,7 +1169,13 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         if (!more_fragments) break;
 
         // can send more?
-        if (!hci_can_send_prepared_acl_packet_now(connection->con_handle)) return err;
+        if (!hci_can_send_acl_fragment_now(connection->con_handle)) {
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+            // wait for transport or controller buffers in parked buffer to allow other connections to prepare packets
+            hci_outgoing_packet_buffer_park();
+#endif
+            return err;
+        }
     }
 
     log_debug("hci_send_acl_packet_fragments loop over");
@@ -738,7 +1185,15 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         hci_stack->acl_fragmentation_tx_active = 0;
         hci_release_packet_buffer();
         hci_emit_transport_packet_sent();
+        hci_notify_if_acl_can_send_now();
+    }
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // allow other connections to prepare packets while transport sends last fragment
+    else if (hci_stack->acl_fragmentation_tx_active != 0u){
+        hci_outgoing_packet_buffer_park();
+        hci_notify_if_acl_can_send_now();
     }
+#endif
 
     return err;
 }
@@ -757,12 +1212,15 @@ int hci_send_acl_packet_buffer(int size){
     hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(packet);
 
     // check for free places on Bluetooth module
-    if (!hci_can_send_prepared_acl_packet_now(con_handle)) {
+    int can_send_now = hci_can_send_acl_fragment_now(con_handle);
+#ifndef ENABLE_HCI_OUTGOING_PACKET_POOL
+    if (!can_send_now) {
         log_error("hci_send_acl_packet_buffer called but no free ACL buffers on controller");
         hci_release_packet_buffer();
         hci_emit_transport_packet_sent();
         return BTSTACK_ACL_BUFFERS_FULL;
     }
+#endif
 
     hci_connection_t *connection = hci_connection_for_handle( con_handle);
     if (!connection) {
@@ -776,12 +1234,33 @@ int hci_send_acl_packet_buffer(int size){
     hci_connection_timestamp(connection);
 #endif
 
+    // sender has to request can send now event again for next packet
+    connection->acl_waiting_for_can_send_now = 0;
+
     // hci_dump_packet( HCI_ACL_DATA_PACKET, 0, packet, size);
 
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    // charge Controller ACL buffers used for this packet
+    uint16_t max_acl_data_packet_length = hci_max_acl_data_packet_length_for_connection(connection);
+    uint16_t num_fragments = 1;
+    if ((max_acl_data_packet_length > 0u) && (size > (4 + max_acl_data_packet_length))){
+        num_fragments = (uint16_t) ((size - 4 + max_acl_data_packet_length - 1) / max_acl_data_packet_length);
+    }
+    hci_acl_scheduler_packet_sent(connection, num_fragments);
+#endif
+
     // setup data
     hci_stack->acl_fragmentation_total_size = size;
     hci_stack->acl_fragmentation_pos = 4;   // start of L2CAP packet
 
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // packet prepared while transport or controller buffers are used by other packets, sent from hci_run
+    if (!can_send_now){
+        hci_outgoing_packet_buffer_park();
+        return ERROR_CODE_SUCCESS;
+    }
+#endif
+
     return hci_send_acl_packet_fragments(connection);
 }
 
@@ -850,6 +1329,7 @@ static void acl_handler(uint8_t *packet, uint16_t size){
     hci_connection_t *conn      = hci_connection_for_handle(con_handle);
     uint8_t  acl_flags          = READ_ACL_FLAGS(packet);
     uint16_t acl_length         = READ_ACL_LENGTH(packet);
+    uint8_t * recombination_buffer;
 
     // ignore non-registered handle
     if (!conn){
@@ -886,21 +1366,21 @@ static void acl_handler(uint8_t *packet, uint16_t size){
             if ((conn->acl_recombination_pos + acl_length) > (4u + HCI_ACL_BUFFER_SIZE)){
                 log_error( "ACL Cont Fragment to large: combined packet %u > buffer size %u for handle 0x%02x",
                     conn->acl_recombination_pos + acl_length, 4 + HCI_ACL_BUFFER_SIZE, con_handle);
-                conn->acl_recombination_pos = 0;
+                hci_acl_recombination_reset(conn);
                 return;
             }
 
             // append fragment payload (header already stored)
-            (void)memcpy(&conn->acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + conn->acl_recombination_pos],
+            recombination_buffer = hci_acl_recombination_buffer_get(conn);
+            (void)memcpy(&recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + conn->acl_recombination_pos],
                          &packet[4], acl_length);
             conn->acl_recombination_pos += acl_length;
 
             // forward complete L2CAP packet if complete. 
             if (conn->acl_recombination_pos >= (conn->acl_recombination_length + 4u + 4u)){ // pos already incl. ACL header
-                hci_emit_acl_packet(&conn->acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE], conn->acl_recombination_pos);
+                hci_emit_acl_packet(&recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE], conn->acl_recombination_pos);
                 // reset recombination buffer
-                conn->acl_recombination_length = 0;
-                conn->acl_recombination_pos = 0;
+                hci_acl_recombination_reset(conn);
             }
             break;
             
@@ -909,7 +1389,7 @@ static void acl_handler(uint8_t *packet, uint16_t size){
             // sanity check
             if (conn->acl_recombination_pos) {
                 log_error( "ACL First Fragment but data in buffer for handle 0x%02x, dropping stale fragments", con_handle);
-                conn->acl_recombination_pos = 0;
+                hci_acl_recombination_reset(conn);
             }
 
             // peek into L2CAP packet!
@@ -927,12 +1407,18 @@ static void acl_handler(uint8_t *packet, uint16_t size){
                     return;
                 }
 
+                recombination_buffer = hci_acl_recombination_buffer_get(conn);
+                if (recombination_buffer == NULL){
+                    log_error( "ACL First Fragment but no recombination buffer available for handle 0x%02x", con_handle);
+                    return;
+                }
+
                 // store first fragment and tweak acl length for complete package
-                (void)memcpy(&conn->acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE],
+                (void)memcpy(&recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE],
                              packet, acl_length + 4u);
                 conn->acl_recombination_pos    = acl_length + 4u;
                 conn->acl_recombination_length = l2cap_length;
-                little_endian_store_16(conn->acl_recombination_buffer, HCI_INCOMING_PRE_BUFFER_SIZE + 2u, l2cap_length +4u);
+                little_endian_store_16(recombination_buffer, HCI_INCOMING_PRE_BUFFER_SIZE + 2u, l2cap_length +4u);
             }
             break;
             
@@ -957,8 +1443,7 @@ static void hci_shutdown_connection(hci_connection_t *conn){
 
     btstack_run_loop_remove_timer(&conn->timeout);
     
-    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-    btstack_memory_hci_connection_free( conn );
+    hci_connection_free(conn);
     
     // now it's gone
     hci_emit_nr_connections_changed();
@@ -1085,6 +1570,151 @@ void gap_le_get_own_address(uint8_t * addr_type, bd_addr_t addr){
 }
 
 #ifdef ENABLE_LE_CENTRAL
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+
+// number of cache entries checked for a report
+#define LE_ADVERTISING_REPORT_CACHE_PROBES 4
+
+// event layout: type, length, advertising event type, address type, address, rssi, data length, data
+static bool hci_le_advertising_report_filter_accepts(const uint8_t * event){
+    const gap_advertising_report_filter_t * filter = hci_stack->le_advertising_report_filter;
+    if (filter == NULL) return true;
+
+    if ((int8_t) event[10] < filter->rssi_min) return false;
+
+    if (filter->num_addresses > 0u){
+        bd_addr_t address;
+        reverse_bd_addr(&event[4], address);
+        uint16_t i;
+        for (i=0;i<filter->num_addresses;i++){
+            if (bd_addr_cmp(address, filter->addresses[i]) == 0) break;
+        }
+        if (i == filter->num_addresses) return false;
+    }
+
+    uint8_t data_length = event[11];
+    const uint8_t * data = &event[12];
+    if (filter->uuid16 != 0u){
+        if (!ad_data_contains_uuid16(data_length, data, filter->uuid16)) return false;
+    }
+
+    if (filter->company_id != 0xffffu){
+        bool found = false;
+        ad_context_t context;
+        for (ad_iterator_init(&context, data_length, data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+            if (ad_iterator_get_data_type(&context) != BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA) continue;
+            if (ad_iterator_get_data_len(&context) < 2u) continue;
+            if (little_endian_read_16(ad_iterator_get_data(&context), 0) == filter->company_id){
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+// FNV-1a
+static uint32_t hci_le_advertising_report_hash(uint32_t hash, const uint8_t * data, uint16_t size){
+    uint16_t i;
+    for (i=0;i<size;i++){
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// returns true if report was seen within TTL, otherwise it's stored in the cache
+static bool hci_le_advertising_report_cache_seen(const uint8_t * event){
+    uint8_t address_type = event[3];
+    const uint8_t * address = &event[4];
+    uint32_t ad_hash = hci_le_advertising_report_hash(2166136261u, &event[2], 1);
+    ad_hash = hci_le_advertising_report_hash(ad_hash, &event[12], event[11]);
+    uint32_t index = hci_le_advertising_report_hash(ad_hash, &event[3], 7);
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+    // check probed entries for report, use empty, expired or oldest entry otherwise
+    le_advertising_report_cache_entry_t * victim = NULL;
+    uint32_t victim_age = 0;
+    int i;
+    for (i=0;i<LE_ADVERTISING_REPORT_CACHE_PROBES;i++){
+        le_advertising_report_cache_entry_t * entry = &hci_stack->le_advertising_report_cache[(index + i) % LE_ADVERTISING_REPORT_CACHE_SIZE];
+        uint32_t age = now - entry->timestamp_ms;
+        bool expired = (entry->valid == false) || (age >= hci_stack->le_advertising_report_cache_ttl_ms);
+        if (entry->valid && (entry->ad_hash == ad_hash) && (entry->address_type == address_type)
+            && (memcmp(entry->address, address, 6) == 0)){
+            if (!expired) return true;
+            entry->timestamp_ms = now;
+            return false;
+        }
+        if (expired){
+            age = 0xffffffffu;
+        }
+        if ((victim == NULL) || (age > victim_age)){
+            victim = entry;
+            victim_age = age;
+        }
+    }
+    victim->valid = true;
+    victim->ad_hash = ad_hash;
+    victim->timestamp_ms = now;
+    victim->address_type = address_type;
+    (void)memcpy(victim->address, address, 6);
+    return false;
+}
+
+static void hci_le_advertising_report_batch_emit(void){
+    uint8_t * batch = hci_stack->le_advertising_report_batch;
+    if (batch[2] == 0u) return;
+    btstack_run_loop_remove_timer(&hci_stack->le_advertising_report_batch_timer);
+    // emit copy as packet handlers might stop scan
+    uint8_t event[sizeof(hci_stack->le_advertising_report_batch)];
+    uint16_t size = 4u + batch[3];
+    event[0] = GAP_EVENT_ADVERTISING_REPORT_BATCH;
+    event[1] = size - 2u;
+    (void)memcpy(&event[2], &batch[2], size - 2u);
+    batch[2] = 0;
+    batch[3] = 0;
+    hci_emit_event(event, size, 1);
+}
+
+static void hci_le_advertising_report_batch_timeout_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    hci_le_advertising_report_batch_emit();
+}
+
+static void hci_le_advertising_report_batch_add(const uint8_t * report, uint16_t size){
+    uint8_t * batch = hci_stack->le_advertising_report_batch;
+    if ((4u + batch[3] + size) > sizeof(hci_stack->le_advertising_report_batch)){
+        hci_le_advertising_report_batch_emit();
+    }
+    (void)memcpy(&batch[4u + batch[3]], report, size);
+    batch[2]++;
+    batch[3] += (uint8_t) size;
+    if (batch[2] == 1u){
+        btstack_run_loop_set_timer(&hci_stack->le_advertising_report_batch_timer, hci_stack->le_advertising_report_batch_timeout_ms);
+        btstack_run_loop_add_timer(&hci_stack->le_advertising_report_batch_timer);
+    }
+}
+
+static void hci_le_advertising_report_pipeline(uint8_t * event, uint16_t size){
+    if (!hci_le_advertising_report_filter_accepts(event)){
+        hci_stack->le_advertising_report_counters.dropped_by_filter++;
+        return;
+    }
+    if ((hci_stack->le_advertising_report_cache_ttl_ms > 0u) && hci_le_advertising_report_cache_seen(event)){
+        hci_stack->le_advertising_report_counters.dropped_duplicates++;
+        return;
+    }
+    hci_stack->le_advertising_report_counters.forwarded++;
+    if (hci_stack->le_advertising_report_batch_timeout_ms > 0u){
+        hci_le_advertising_report_batch_add(event, size);
+    } else {
+        hci_emit_event(event, size, 1);
+    }
+}
+#endif
+
 void le_handle_advertisement_report(uint8_t *packet, uint16_t size){
 
     int offset = 3;
@@ -1113,7 +1743,11 @@ void le_handle_advertisement_report(uint8_t *packet, uint16_t size){
         (void)memcpy(&event[pos], &packet[offset], data_length);
         pos +=    data_length;
         offset += data_length + 1u; // rssi
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+        hci_le_advertising_report_pipeline(event, pos);
+#else
         hci_emit_event(event, pos, 1);
+#endif
     }
 }
 #endif
@@ -1164,6 +1798,7 @@ static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
             log_info("Resend HCI Reset");
             hci_stack->substate = HCI_INIT_SEND_RESET;
             hci_stack->num_cmd_packets = 1;
+            hci_command_pipeline_reset();
             hci_run();
             break;
         case HCI_INIT_W4_CUSTOM_INIT_CSR_WARM_BOOT_LINK_RESET:
@@ -1178,6 +1813,7 @@ static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
             log_info("Resend HCI Reset - CSR Warm Boot");
             hci_stack->substate = HCI_INIT_SEND_RESET_CSR_WARM_BOOT;
             hci_stack->num_cmd_packets = 1;
+            hci_command_pipeline_reset();
             hci_run();
             break;
         case HCI_INIT_W4_SEND_BAUD_CHANGE:
@@ -1212,6 +1848,176 @@ static void hci_initializing_next_state(void){
 }
 
 // assumption: hci_can_send_command_packet_now() == true
+#ifdef ENABLE_HCI_INIT_CACHE
+
+#define HCI_INIT_CACHE_FORMAT     2
+#define HCI_INIT_CACHE_HEADER_LEN 13
+
+// FNV-1a over commands sent by chipset driver identifies uploaded firmware/patches
+#define HCI_INIT_CACHE_FIRMWARE_ID_INIT  0x811C9DC5u
+#define HCI_INIT_CACHE_FIRMWARE_ID_PRIME 0x01000193u
+
+static const uint32_t hci_init_cache_tag = ((uint32_t) 'B' << 24) | ((uint32_t) 'T' << 16) | ((uint32_t) 'I' << 8) | ((uint32_t) 'C');
+
+// event buffer for replayed Command Complete events, Read Local Name handler writes up to offset 254
+static uint8_t hci_init_cache_event[HCI_EVENT_BUFFER_SIZE];
+
+static bool hci_init_cache_opcode_cacheable(uint16_t opcode){
+    switch (opcode){
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS:
+        case HCI_OPCODE_HCI_READ_BUFFER_SIZE:
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES:
+        case HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE:
+        case HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH:
+        case HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE:
+            return true;
+        case HCI_OPCODE_HCI_READ_BD_ADDR:
+            // public address may be changed via chipset driver
+            return hci_stack->custom_bd_addr_set == 0u;
+        default:
+            return false;
+    }
+}
+
+// @returns offset of record for opcode or 0 if not found
+static uint16_t hci_init_cache_find(uint16_t opcode){
+    uint16_t pos = HCI_INIT_CACHE_HEADER_LEN;
+    while ((pos + 4u) <= hci_stack->init_cache_len){
+        uint16_t record_len = 4u + hci_stack->init_cache[pos + 3u];
+        if ((pos + record_len) > hci_stack->init_cache_len) break;
+        if (little_endian_read_16(hci_stack->init_cache, pos) == opcode) return pos;
+        pos += record_len;
+    }
+    return 0;
+}
+
+static void hci_init_cache_load(const uint8_t * local_version_information){
+    const btstack_tlv_t * tlv_impl;
+    void * tlv_context;
+    int len = 0;
+    hci_stack->init_cache_firmware_id = HCI_INIT_CACHE_FIRMWARE_ID_INIT;
+    hci_stack->init_cache_firmware_checked = false;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl != NULL){
+        len = tlv_impl->get_tag(tlv_context, hci_init_cache_tag, hci_stack->init_cache, HCI_INIT_CACHE_SIZE);
+    }
+    if ((len >= HCI_INIT_CACHE_HEADER_LEN) && (len <= HCI_INIT_CACHE_SIZE)
+        && (hci_stack->init_cache[0] == HCI_INIT_CACHE_FORMAT)
+        && (memcmp(&hci_stack->init_cache[1], local_version_information, 8) == 0)){
+        log_info("Init cache: use %u bytes", len);
+        hci_stack->init_cache_len = (uint16_t) len;
+        hci_stack->init_cache_dirty = false;
+        return;
+    }
+    // no cache or different Controller, collect responses again
+    log_info("Init cache: not found or outdated");
+    hci_stack->init_cache[0] = HCI_INIT_CACHE_FORMAT;
+    (void)memcpy(&hci_stack->init_cache[1], local_version_information, 8);
+    hci_stack->init_cache_len = HCI_INIT_CACHE_HEADER_LEN;
+    hci_stack->init_cache_dirty = true;
+}
+
+static void hci_init_cache_firmware_update(const uint8_t * packet, uint16_t size){
+    uint16_t i;
+    for (i = 0; i < size; i++){
+        hci_stack->init_cache_firmware_id = (hci_stack->init_cache_firmware_id ^ packet[i]) * HCI_INIT_CACHE_FIRMWARE_ID_PRIME;
+    }
+}
+
+// called when chipset driver is done, responses are only valid for same firmware/patches
+static void hci_init_cache_firmware_check(void){
+    if (hci_stack->init_cache_len == 0u) return;
+    if (hci_stack->init_cache_firmware_checked) return;
+    hci_stack->init_cache_firmware_checked = true;
+    if (little_endian_read_32(hci_stack->init_cache, 9) == hci_stack->init_cache_firmware_id) return;
+    if (hci_stack->init_cache_len > HCI_INIT_CACHE_HEADER_LEN){
+        log_info("Init cache: firmware changed");
+    }
+    little_endian_store_32(hci_stack->init_cache, 9, hci_stack->init_cache_firmware_id);
+    hci_stack->init_cache_len = HCI_INIT_CACHE_HEADER_LEN;
+    hci_stack->init_cache_dirty = true;
+}
+
+static void hci_init_cache_handle_command_complete(const uint8_t * packet, uint16_t size){
+    if (size < 6u) return;
+    if (packet[5] != ERROR_CODE_SUCCESS) return;
+    uint16_t opcode = hci_event_command_complete_get_command_opcode(packet);
+    if (opcode == HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION){
+        if (size < 14u) return;
+        hci_init_cache_load(&packet[6]);
+        return;
+    }
+    if (!hci_stack->init_cache_firmware_checked) return;
+    if (!hci_init_cache_opcode_cacheable(opcode)) return;
+    if (hci_init_cache_find(opcode) != 0u) return;
+    // store return parameters without trailing zeros, they are restored on replay
+    uint8_t params_len = packet[1] - 3u;
+    uint8_t stored_len = params_len;
+    while ((stored_len > 0u) && (packet[5u + stored_len - 1u] == 0u)){
+        stored_len--;
+    }
+    uint16_t pos = hci_stack->init_cache_len;
+    if ((pos + 4u + stored_len) > HCI_INIT_CACHE_SIZE){
+        log_info("Init cache: no space for opcode %04x", opcode);
+        return;
+    }
+    little_endian_store_16(hci_stack->init_cache, pos, opcode);
+    hci_stack->init_cache[pos + 2u] = params_len;
+    hci_stack->init_cache[pos + 3u] = stored_len;
+    (void)memcpy(&hci_stack->init_cache[pos + 4u], &packet[5], stored_len);
+    hci_stack->init_cache_len += 4u + stored_len;
+    hci_stack->init_cache_dirty = true;
+}
+
+static void hci_init_cache_save(void){
+    if (!hci_stack->init_cache_dirty) return;
+    const btstack_tlv_t * tlv_impl;
+    void * tlv_context;
+    btstack_tlv_get_instance(&tlv_impl, &tlv_context);
+    if (tlv_impl == NULL) return;
+    log_info("Init cache: store %u bytes", hci_stack->init_cache_len);
+    tlv_impl->store_tag(tlv_context, hci_init_cache_tag, hci_stack->init_cache, hci_stack->init_cache_len);
+    hci_stack->init_cache_dirty = false;
+}
+
+// deliver cached responses in a loop, nested hci_run calls only queue the next one
+static void hci_init_cache_replay_responses(void){
+    if (hci_stack->init_cache_replay_active) return;
+    hci_stack->init_cache_replay_active = true;
+    while ((hci_stack->init_cache_replay_opcode != 0u) && (hci_stack->state == HCI_STATE_INITIALIZING)){
+        uint16_t opcode = hci_stack->init_cache_replay_opcode;
+        hci_stack->init_cache_replay_opcode = 0;
+        uint16_t pos = hci_init_cache_find(opcode);
+        uint8_t params_len = hci_stack->init_cache[pos + 2u];
+        uint8_t stored_len = hci_stack->init_cache[pos + 3u];
+        log_info("Init cache: replay opcode %04x", opcode);
+        memset(hci_init_cache_event, 0, sizeof(hci_init_cache_event));
+        hci_init_cache_event[0] = HCI_EVENT_COMMAND_COMPLETE;
+        hci_init_cache_event[1] = 3u + params_len;
+        hci_init_cache_event[2] = 1;
+        little_endian_store_16(hci_init_cache_event, 3, opcode);
+        (void)memcpy(&hci_init_cache_event[5], &hci_stack->init_cache[pos + 4u], stored_len);
+        packet_handler(HCI_EVENT_PACKET, hci_init_cache_event, 5u + params_len);
+    }
+    hci_stack->init_cache_replay_opcode = 0;
+    hci_stack->init_cache_replay_active = false;
+}
+#endif
+
+// @returns true if response to read-only init command will be replayed from init cache
+static bool hci_init_cache_replay(uint16_t opcode){
+#ifdef ENABLE_HCI_INIT_CACHE
+    if (!hci_stack->init_cache_firmware_checked) return false;
+    if (hci_init_cache_find(opcode) == 0u) return false;
+    hci_stack->last_cmd_opcode = opcode;
+    hci_stack->init_cache_replay_opcode = opcode;
+    return true;
+#else
+    UNUSED(opcode);
+    return false;
+#endif
+}
+
 static void hci_initializing_run(void){
     log_debug("hci_initializing_run: substate %u, can send %u", hci_stack->substate, hci_can_send_command_packet_now());
     switch (hci_stack->substate){
@@ -1233,8 +2039,8 @@ static void hci_initializing_run(void){
             hci_stack->substate = HCI_INIT_W4_SEND_READ_LOCAL_VERSION_INFORMATION;
             break;
         case HCI_INIT_SEND_READ_LOCAL_NAME:
-            hci_send_cmd(&hci_read_local_name);
             hci_stack->substate = HCI_INIT_W4_SEND_READ_LOCAL_NAME;
+            hci_send_cmd(&hci_read_local_name);
             break;
 
 #if !defined(HAVE_PLATFORM_IPHONE_OS) && !defined (HAVE_HOST_CONTROLLER_API)
@@ -1309,12 +2115,18 @@ static void hci_initializing_run(void){
 
                 if (send_cmd){
                     int size = 3u + hci_stack->hci_packet_buffer[2u];
+#ifdef ENABLE_HCI_INIT_CACHE
+                    hci_init_cache_firmware_update(hci_stack->hci_packet_buffer, size);
+#endif
                     hci_stack->last_cmd_opcode = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
                     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, hci_stack->hci_packet_buffer, size);
                     hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, hci_stack->hci_packet_buffer, size);
                     break;
                 }
                 log_info("Init script done");
+#ifdef ENABLE_HCI_INIT_CACHE
+                hci_init_cache_firmware_check();
+#endif
 
                 // Init script download on Broadcom chipsets causes:
                 if ( (hci_stack->chipset_result != BTSTACK_CHIPSET_NO_INIT_SCRIPT) &&
@@ -1344,8 +2156,12 @@ static void hci_initializing_run(void){
                     break;
                 }
             }
+#ifdef ENABLE_HCI_INIT_CACHE
+            hci_init_cache_firmware_check();
+#endif
             // otherwise continue
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_COMMANDS;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS)) break;
             hci_send_cmd(&hci_read_local_supported_commands);
             break;            
         case HCI_INIT_SET_BD_ADDR:
@@ -1360,18 +2176,22 @@ static void hci_initializing_run(void){
         case HCI_INIT_READ_LOCAL_SUPPORTED_COMMANDS:
             log_info("Resend hci_read_local_supported_commands after CSR Warm Boot double reset");
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_COMMANDS;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS)) break;
             hci_send_cmd(&hci_read_local_supported_commands);
             break;       
         case HCI_INIT_READ_BD_ADDR:
             hci_stack->substate = HCI_INIT_W4_READ_BD_ADDR;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_READ_BD_ADDR)) break;
             hci_send_cmd(&hci_read_bd_addr);
             break;
         case HCI_INIT_READ_BUFFER_SIZE:
             hci_stack->substate = HCI_INIT_W4_READ_BUFFER_SIZE;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_READ_BUFFER_SIZE)) break;
             hci_send_cmd(&hci_read_buffer_size);
             break;
         case HCI_INIT_READ_LOCAL_SUPPORTED_FEATURES:
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_FEATURES;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES)) break;
             hci_send_cmd(&hci_read_local_supported_features);
             break;                
 
@@ -1516,6 +2336,7 @@ static void hci_initializing_run(void){
         // LE INIT
         case HCI_INIT_LE_READ_BUFFER_SIZE:
             hci_stack->substate = HCI_INIT_W4_LE_READ_BUFFER_SIZE;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE)) break;
             hci_send_cmd(&hci_le_read_buffer_size);
             break;
         case HCI_INIT_LE_SET_EVENT_MASK:
@@ -1532,6 +2353,7 @@ static void hci_initializing_run(void){
 #ifdef ENABLE_LE_DATA_LENGTH_EXTENSION
         case HCI_INIT_LE_READ_MAX_DATA_LENGTH:
             hci_stack->substate = HCI_INIT_W4_LE_READ_MAX_DATA_LENGTH;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH)) break;
             hci_send_cmd(&hci_le_read_maximum_data_length);
             break;
         case HCI_INIT_LE_WRITE_SUGGESTED_DATA_LENGTH:
@@ -1543,6 +2365,7 @@ static void hci_initializing_run(void){
 #ifdef ENABLE_LE_CENTRAL
         case HCI_INIT_READ_WHITE_LIST_SIZE:
             hci_stack->substate = HCI_INIT_W4_READ_WHITE_LIST_SIZE;
+            if (hci_init_cache_replay(HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE)) break;
             hci_send_cmd(&hci_le_read_white_list_size);
             break;
         case HCI_INIT_LE_SET_SCAN_PARAMETERS:
@@ -1559,6 +2382,10 @@ static void hci_init_done(void){
     // done. tell the app
     log_info("hci_init_done -> HCI_STATE_WORKING");
     hci_stack->state = HCI_STATE_WORKING;
+#ifdef ENABLE_HCI_INIT_CACHE
+    // store with TLV used for loading, ports may switch to BD_ADDR specific TLV in HCI_STATE_WORKING
+    hci_init_cache_save();
+#endif
     hci_emit_state();
     hci_run();
 }
@@ -1602,6 +2429,7 @@ static bool hci_initializing_event_handler_command_completed(const uint8_t * pac
         command_completed = true;
         // Fix: no HCI Command Complete received, so num_cmd_packets not reset
         hci_stack->num_cmd_packets = 1;
+        hci_command_pipeline_reset();
     }
 #endif
 
@@ -1611,6 +2439,12 @@ static bool hci_initializing_event_handler_command_completed(const uint8_t * pac
 static void hci_initializing_event_handler(const uint8_t * packet, uint16_t size){
 
     UNUSED(size);   // ok: less than 6 bytes are read from our buffer
+
+#ifdef ENABLE_HCI_INIT_CACHE
+    if (hci_event_packet_get_type(packet) == HCI_EVENT_COMMAND_COMPLETE){
+        hci_init_cache_handle_command_complete(packet, size);
+    }
+#endif
     
     bool command_completed =  hci_initializing_event_handler_command_completed(packet);
 
@@ -1910,8 +2744,7 @@ static void hci_handle_connection_failed(hci_connection_t * conn, uint8_t status
 #endif
     
     // connection failed, remove entry
-    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-    btstack_memory_hci_connection_free( conn );
+    hci_connection_free(conn);
 
 #ifdef ENABLE_CLASSIC
     // notify client if dedicated bonding
@@ -1968,6 +2801,7 @@ static void hci_handle_remote_features_received(hci_connection_t * conn){
     log_info("Remote features %02x, bonding flags %x", conn->remote_supported_features[0], conn->bonding_flags);
     if (conn->bonding_flags & BONDING_DEDICATED){
         conn->bonding_flags |= BONDING_SEND_AUTHENTICATE_REQUEST;
+        hci_connection_set_dirty(conn);
     }
 }
 #endif
@@ -1999,6 +2833,7 @@ static void hci_handle_read_encryption_key_size_complete(hci_connection_t * conn
     // Request Authentication if not already done
     if ((conn->bonding_flags & BONDING_SENT_AUTHENTICATE_REQUEST) != 0) return;
     conn->bonding_flags |= BONDING_SEND_AUTHENTICATE_REQUEST;
+    hci_connection_set_dirty(conn);
 }
 #endif
 
@@ -2011,10 +2846,9 @@ static void handle_command_complete_event(uint8_t * packet, uint16_t size){
     hci_connection_t * conn;
     uint8_t status;
 #endif
-    // get num cmd packets - limit to 1 to reduce complexity
-    hci_stack->num_cmd_packets = packet[2] ? 1 : 0;
-
     uint16_t opcode = hci_event_command_complete_get_command_opcode(packet);
+    hci_command_credits_update(packet[2], opcode);
+
     switch (opcode){
         case HCI_OPCODE_HCI_READ_LOCAL_NAME:
             if (packet[5]) break;
@@ -2190,8 +3024,7 @@ static void event_handle_le_connection_complete(const uint8_t * packet){
 		// outgoing le connection establishment is done
 		if (conn){
 			// remove entry
-			btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-			btstack_memory_hci_connection_free( conn );
+			hci_connection_free(conn);
 		}
 		return;
 	}
@@ -2226,7 +3059,7 @@ static void event_handle_le_connection_complete(const uint8_t * packet){
 
 	conn->state = OPEN;
 	conn->role  = packet[6];
-	conn->con_handle             = hci_subevent_le_connection_complete_get_connection_handle(packet);
+	hci_connection_set_con_handle(conn, hci_subevent_le_connection_complete_get_connection_handle(packet));
 	conn->le_connection_interval = hci_subevent_le_connection_complete_get_conn_interval(packet);
 
 #ifdef ENABLE_LE_PERIPHERAL
@@ -2281,8 +3114,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
             break;
             
         case HCI_EVENT_COMMAND_STATUS:
-            // get num cmd packets - limit to 1 to reduce complexity
-            hci_stack->num_cmd_packets = packet[3] ? 1 : 0;
+            hci_command_credits_update(packet[3], hci_event_command_status_get_command_opcode(packet));
 
             // check command status to detected failed outgoing connections
             create_connection_cmd = 0;
@@ -2351,6 +3183,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                 hci_notify_if_sco_can_send_now();
 #endif
             }
+            hci_notify_if_acl_can_send_now();
             break;
         }
 
@@ -2393,6 +3226,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
             }
             conn->role  = HCI_ROLE_SLAVE;
             conn->state = RECEIVED_CONNECTION_REQUEST;
+            hci_connection_set_dirty(conn);
             // store info about eSCO
             if (link_type == HCI_LINK_TYPE_ESCO){
                 conn->remote_supported_features[0] |= 1;
@@ -2409,10 +3243,11 @@ static void event_handler(uint8_t *packet, uint16_t size){
             if (conn) {
                 if (!packet[2]){
                     conn->state = OPEN;
-                    conn->con_handle = little_endian_read_16(packet, 3);
+                    hci_connection_set_con_handle(conn, little_endian_read_16(packet, 3));
 
                     // queue get remote feature
                     conn->bonding_flags |= BONDING_REQUEST_REMOTE_FEATURES_PAGE_0;
+                    hci_connection_set_dirty(conn);
 
                     // queue set supervision timeout if we're master
                     if ((hci_stack->link_supervision_timeout != 0) && (conn->role == HCI_ROLE_MASTER)){
@@ -2448,7 +3283,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                 break;
             }
             conn->state = OPEN;
-            conn->con_handle = little_endian_read_16(packet, 3);            
+            hci_connection_set_con_handle(conn, little_endian_read_16(packet, 3));
 
 #ifdef ENABLE_SCO_OVER_HCI
             // update SCO
@@ -2473,6 +3308,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                 // read extended features if possible
                 if (((hci_stack->local_supported_commands[1] & 1) != 0) && ((conn->remote_supported_features[0] & 2) != 0)) {
                     conn->bonding_flags |= BONDING_REQUEST_REMOTE_FEATURES_PAGE_1;
+                    hci_connection_set_dirty(conn);
                     break;
                 }
             }
@@ -2495,6 +3331,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                         if (maximum_page_number >= 2){
                             // get Secure Connections (Controller) from Page 2 if available
                             conn->bonding_flags |= BONDING_REQUEST_REMOTE_FEATURES_PAGE_2;
+                            hci_connection_set_dirty(conn);
                         } else {
                             // otherwise, assume SC (Controller) == SC (Host)
                             if ((conn->bonding_flags & BONDING_REMOTE_SUPPORTS_SC_HOST) != 0){
@@ -2595,6 +3432,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                         if (hci_stack->secure_connections_active && sc_used_during_pairing && !connected_uses_aes_ccm){
                             log_info("SC during pairing, but only E0 now -> abort");
                             conn->bonding_flags |= BONDING_DISCONNECT_SECURITY_BLOCK;
+                            hci_connection_set_dirty(conn);
                             break;
                         }
 
@@ -2606,6 +3444,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                         if ((hci_stack->local_supported_commands[0] & 0x80) != 0){
                             // For Classic, we need to validate encryption key size first, if possible (== supported by Controller)
                             conn->bonding_flags |= BONDING_SEND_READ_ENCRYPTION_KEY_SIZE;
+                            hci_connection_set_dirty(conn);
                         } else {
                             // if not, pretend everything is perfect
                             hci_handle_read_encryption_key_size_complete(conn, 16);
@@ -2632,6 +3471,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
             if (conn->bonding_flags & BONDING_DEDICATED){
                 conn->bonding_flags &= ~BONDING_DEDICATED;
                 conn->bonding_flags |= BONDING_DISCONNECT_DEDICATED_DONE;
+                hci_connection_set_dirty(conn);
                 conn->bonding_status = packet[2];
                 break;
             }
@@ -2645,6 +3485,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
                 if (((gap_security_level_for_link_key_type(conn->link_key_type) >= conn->requested_security_level)) &&
                     ((conn->authentication_flags & CONNECTION_ENCRYPTED) == 0)){
                     conn->bonding_flags |= BONDING_SEND_ENCRYPTION_REQUEST;
+                    hci_connection_set_dirty(conn);
                     break;
                 }
             }
@@ -2672,12 +3513,19 @@ static void event_handler(uint8_t *packet, uint16_t size){
                     }
                 }
             }
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+            hci_outgoing_packet_buffers_drop_for_handle(handle);
+#endif
 
             conn = hci_connection_for_handle(handle);
             if (!conn) break;
             // mark connection for shutdown
             conn->state = RECEIVED_DISCONNECTION_COMPLETE;
 
+            // Controller buffers might have been reserved for it
+            conn->acl_waiting_for_can_send_now = 0;
+            hci_notify_if_acl_can_send_now();
+
             // emit dedicatd bonding event
             if (conn->bonding_flags & BONDING_EMIT_COMPLETE_ON_DISCONNECT){
                 hci_emit_dedicated_bonding_result(conn->address, conn->bonding_status);
@@ -2721,11 +3569,24 @@ static void event_handler(uint8_t *packet, uint16_t size){
                 log_error("Synchronous HCI Transport shouldn't send HCI_EVENT_TRANSPORT_PACKET_SENT");
                 return; // instead of break: to avoid re-entering hci_run()
             }
-            hci_stack->acl_fragmentation_tx_active = 0;
-            if (hci_stack->acl_fragmentation_total_size) break;
-            hci_release_packet_buffer();
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+            // sent packet from parked buffer, remaining fragments are sent from hci_run
+            if (hci_stack->outgoing_packet_buffer_tx_active != NULL){
+                hci_outgoing_packet_buffer_t * buffer = hci_stack->outgoing_packet_buffer_tx_active;
+                hci_stack->outgoing_packet_buffer_tx_active = NULL;
+                if (buffer->acl_fragmentation_total_size == 0u){
+                    hci_outgoing_packet_buffer_drop(buffer);
+                }
+            } else
+#endif
+            {
+                hci_stack->acl_fragmentation_tx_active = 0;
+                if (hci_stack->acl_fragmentation_total_size) break;
+                hci_release_packet_buffer();
+            }
             
             // L2CAP receives this event via the hci_emit_event below
+            hci_notify_if_acl_can_send_now();
 
 #ifdef ENABLE_CLASSIC
             // For SCO, we do the can_send_now_check here
@@ -2787,12 +3648,14 @@ static void event_handler(uint8_t *packet, uint16_t size){
                         int update_parameter = gap_connection_parameter_range_included(&existing_range, le_conn_interval_min, le_conn_interval_max, le_conn_latency, le_supervision_timeout);
                         if (update_parameter){
                             conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_REPLY;
+                            hci_connection_set_dirty(conn);
                             conn->le_conn_interval_min = le_conn_interval_min;
                             conn->le_conn_interval_max = le_conn_interval_max;
                             conn->le_conn_latency = le_conn_latency;
                             conn->le_supervision_timeout = le_supervision_timeout;
                         } else {
                             conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NEGATIVE_REPLY;
+                            hci_connection_set_dirty(conn);
                         }
                     }
                     break;
@@ -2816,6 +3679,7 @@ static void event_handler(uint8_t *packet, uint16_t size){
             switch (hci_stack->manufacturer){
                 case BLUETOOTH_COMPANY_ID_CAMBRIDGE_SILICON_RADIO:
                     hci_stack->num_cmd_packets = 1;
+                    hci_command_pipeline_reset();
                     break;
                 default:
                     break;
@@ -2994,6 +3858,9 @@ static void hci_state_reset(void){
 
     // buffer is free
     hci_stack->hci_packet_buffer_reserved = 0;
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    hci_outgoing_packet_buffers_reset();
+#endif
 
     // no pending cmds
     hci_stack->decline_reason = 0;
@@ -3011,6 +3878,12 @@ static void hci_state_reset(void){
     hci_stack->le_connecting_state = LE_CONNECTING_IDLE;
     hci_stack->le_connecting_request = LE_CONNECTING_IDLE;
     hci_stack->le_whitelist_capacity = 0;
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+    // drop pending batch
+    btstack_run_loop_remove_timer(&hci_stack->le_advertising_report_batch_timer);
+    hci_stack->le_advertising_report_batch[2] = 0;
+    hci_stack->le_advertising_report_batch[3] = 0;
+#endif
 #endif
 }
 
@@ -3044,8 +3917,16 @@ void hci_init(const hci_transport_t *transport, const void *config){
     // reference to used config
     hci_stack->config = config;
     
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+    btstack_run_loop_set_timer_handler(&hci_stack->le_advertising_report_batch_timer, &hci_le_advertising_report_batch_timeout_handler);
+#endif
+
     // setup pointer for outgoing packet buffer
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    hci_outgoing_packet_buffers_reset();
+#else
     hci_stack->hci_packet_buffer = &hci_stack->hci_packet_buffer_data[HCI_OUTGOING_PRE_BUFFER_SIZE];
+#endif
 
     // max acl payload size defined in config.h
     hci_stack->acl_data_packet_length = HCI_ACL_PAYLOAD_SIZE;
@@ -3342,6 +4223,11 @@ static int hci_power_control_wake(void){
 static void hci_power_transition_to_initializing(void){
     // set up state machine
     hci_stack->num_cmd_packets = 1; // assume that one cmd can be sent
+    hci_command_pipeline_reset();
+#ifdef ENABLE_HCI_INIT_CACHE
+    hci_stack->init_cache_len = 0;
+    hci_stack->init_cache_replay_opcode = 0;
+#endif
     hci_stack->hci_packet_buffer_reserved = 0;
     hci_stack->state = HCI_STATE_INITIALIZING;
     hci_stack->substate = HCI_INIT_SEND_RESET;
@@ -3601,7 +4487,7 @@ static bool hci_run_acl_fragments(void){
         hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(hci_stack->hci_packet_buffer);
         hci_connection_t *connection = hci_connection_for_handle(con_handle);
         if (connection) {
-            if (hci_can_send_prepared_acl_packet_now(con_handle)){
+            if (hci_can_send_acl_fragment_now(con_handle)){
                 hci_send_acl_packet_fragments(connection);
                 return true;
             }
@@ -3612,6 +4498,27 @@ static bool hci_run_acl_fragments(void){
             hci_stack->acl_fragmentation_pos = 0;
         }
     }
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // continue with parked fragments if packet buffer is free
+    if (hci_packet_buffer_busy()) return false;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_stack->outgoing_packet_buffers_parked);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        hci_outgoing_packet_buffer_t * buffer = (hci_outgoing_packet_buffer_t *) btstack_linked_list_iterator_next(&it);
+        hci_con_handle_t con_handle = hci_outgoing_packet_buffer_get_con_handle(buffer);
+        hci_connection_t * connection = hci_connection_for_handle(con_handle);
+        if (connection == NULL){
+            log_info("hci_run: parked ACL packet no connection -> discard fragment");
+            btstack_linked_list_iterator_remove(&it);
+            btstack_linked_list_add(&hci_stack->outgoing_packet_buffers_free, (btstack_linked_item_t *) buffer);
+            continue;
+        }
+        if (!hci_can_send_acl_fragment_now(con_handle)) continue;
+        hci_outgoing_packet_buffer_resume(buffer);
+        hci_send_acl_packet_fragments(connection);
+        return true;
+    }
+#endif
     return false;
 }
 
@@ -3622,12 +4529,12 @@ static bool hci_run_general_gap_classic(void){
     if (hci_stack->decline_reason){
         uint8_t reason = hci_stack->decline_reason;
         hci_stack->decline_reason = 0;
-        hci_send_cmd(&hci_reject_connection_request, hci_stack->decline_addr, reason);
+        hci_send_cmd_packet_buffer(hci_cmd_create_reject_connection_request(hci_reserve_cmd_packet_buffer(), hci_stack->decline_addr, reason));
         return true;
     }
     // send scan enable
     if ((hci_stack->state == HCI_STATE_WORKING) && (hci_stack->new_scan_enable_value != 0xff) && hci_classic_supported()){
-        hci_send_cmd(&hci_write_scan_enable, hci_stack->new_scan_enable_value);
+        hci_send_cmd_packet_buffer(hci_cmd_create_write_scan_enable(hci_reserve_cmd_packet_buffer(), hci_stack->new_scan_enable_value));
         hci_stack->new_scan_enable_value = 0xff;
         return true;
     }
@@ -3635,19 +4542,19 @@ static bool hci_run_general_gap_classic(void){
     if ((hci_stack->inquiry_state >= GAP_INQUIRY_DURATION_MIN) && (hci_stack->inquiry_state <= GAP_INQUIRY_DURATION_MAX)){
         uint8_t duration = hci_stack->inquiry_state;
         hci_stack->inquiry_state = GAP_INQUIRY_STATE_ACTIVE;
-        hci_send_cmd(&hci_inquiry, GAP_IAC_GENERAL_INQUIRY, duration, 0);
+        hci_send_cmd_packet_buffer(hci_cmd_create_inquiry(hci_reserve_cmd_packet_buffer(), GAP_IAC_GENERAL_INQUIRY, duration, 0));
         return true;
     }
     if (hci_stack->inquiry_state == GAP_INQUIRY_STATE_W2_CANCEL){
         hci_stack->inquiry_state = GAP_INQUIRY_STATE_W4_CANCELLED;
-        hci_send_cmd(&hci_inquiry_cancel);
+        hci_send_cmd_packet_buffer(hci_cmd_create_inquiry_cancel(hci_reserve_cmd_packet_buffer()));
         return true;
     }
     // remote name request
     if (hci_stack->remote_name_state == GAP_REMOTE_NAME_STATE_W2_SEND){
         hci_stack->remote_name_state = GAP_REMOTE_NAME_STATE_W4_COMPLETE;
-        hci_send_cmd(&hci_remote_name_request, hci_stack->remote_name_addr,
-                     hci_stack->remote_name_page_scan_repetition_mode, 0, hci_stack->remote_name_clock_offset);
+        hci_send_cmd_packet_buffer(hci_cmd_create_remote_name_request(hci_reserve_cmd_packet_buffer(), hci_stack->remote_name_addr,
+                                                                      hci_stack->remote_name_page_scan_repetition_mode, 0, hci_stack->remote_name_clock_offset));
         return true;
     }
     // pairing
@@ -3656,22 +4563,22 @@ static bool hci_run_general_gap_classic(void){
         hci_stack->gap_pairing_state = GAP_PAIRING_STATE_IDLE;
         switch (state){
             case GAP_PAIRING_STATE_SEND_PIN:
-                hci_send_cmd(&hci_pin_code_request_reply, hci_stack->gap_pairing_addr, hci_stack->gap_pairing_pin_len, hci_stack->gap_pairing_input.gap_pairing_pin);
+                hci_send_cmd_packet_buffer(hci_cmd_create_pin_code_request_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr, hci_stack->gap_pairing_pin_len, hci_stack->gap_pairing_input.gap_pairing_pin));
                 break;
             case GAP_PAIRING_STATE_SEND_PIN_NEGATIVE:
-                hci_send_cmd(&hci_pin_code_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_cmd_packet_buffer(hci_cmd_create_pin_code_request_negative_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr));
                 break;
             case GAP_PAIRING_STATE_SEND_PASSKEY:
-                hci_send_cmd(&hci_user_passkey_request_reply, hci_stack->gap_pairing_addr, hci_stack->gap_pairing_input.gap_pairing_passkey);
+                hci_send_cmd_packet_buffer(hci_cmd_create_user_passkey_request_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr, hci_stack->gap_pairing_input.gap_pairing_passkey));
                 break;
             case GAP_PAIRING_STATE_SEND_PASSKEY_NEGATIVE:
-                hci_send_cmd(&hci_user_passkey_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_cmd_packet_buffer(hci_cmd_create_user_passkey_request_negative_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr));
                 break;
             case GAP_PAIRING_STATE_SEND_CONFIRMATION:
-                hci_send_cmd(&hci_user_confirmation_request_reply, hci_stack->gap_pairing_addr);
+                hci_send_cmd_packet_buffer(hci_cmd_create_user_confirmation_request_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr));
                 break;
             case GAP_PAIRING_STATE_SEND_CONFIRMATION_NEGATIVE:
-                hci_send_cmd(&hci_user_confirmation_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_cmd_packet_buffer(hci_cmd_create_user_confirmation_request_negative_reply(hci_reserve_cmd_packet_buffer(), hci_stack->gap_pairing_addr));
                 break;
             default:
                 break;
@@ -3792,14 +4699,14 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_CENTRAL
     if (scanning_stop){
         hci_stack->le_scanning_active = false;
-        hci_send_cmd(&hci_le_set_scan_enable, 0, 0);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_scan_enable(hci_reserve_cmd_packet_buffer(), 0, 0));
         return true;
     }
 #endif
 
 #ifdef ENABLE_LE_CENTRAL
     if (connecting_stop){
-        hci_send_cmd(&hci_le_create_connection_cancel);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_create_connection_cancel(hci_reserve_cmd_packet_buffer()));
         return true;
     }
 #endif
@@ -3807,7 +4714,7 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_PERIPHERAL
     if (advertising_stop){
         hci_stack->le_advertisements_active = false;
-        hci_send_cmd(&hci_le_set_advertise_enable, 0);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_advertise_enable(hci_reserve_cmd_packet_buffer(), 0));
         return true;
     }
 #endif
@@ -3817,8 +4724,8 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_CENTRAL
     if (hci_stack->le_scanning_param_update){
         hci_stack->le_scanning_param_update = false;
-        hci_send_cmd(&hci_le_set_scan_parameters, hci_stack->le_scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window,
-                     hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_scan_parameters(hci_reserve_cmd_packet_buffer(), hci_stack->le_scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window,
+                                                                         hci_stack->le_own_addr_type, hci_stack->le_scan_filter_policy));
         return true;
     }
 #endif
@@ -3826,15 +4733,15 @@ static bool hci_run_general_gap_le(void){
 #ifdef ENABLE_LE_PERIPHERAL
     if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_PARAMS){
         hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_PARAMS;
-        hci_send_cmd(&hci_le_set_advertising_parameters,
-                     hci_stack->le_advertisements_interval_min,
-                     hci_stack->le_advertisements_interval_max,
-                     hci_stack->le_advertisements_type,
-                     hci_stack->le_own_addr_type,
-                     hci_stack->le_advertisements_direct_address_type,
-                     hci_stack->le_advertisements_direct_address,
-                     hci_stack->le_advertisements_channel_map,
-                     hci_stack->le_advertisements_filter_policy);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_advertising_parameters(hci_reserve_cmd_packet_buffer(),
+                                                                                hci_stack->le_advertisements_interval_min,
+                                                                                hci_stack->le_advertisements_interval_max,
+                                                                                hci_stack->le_advertisements_type,
+                                                                                hci_stack->le_own_addr_type,
+                                                                                hci_stack->le_advertisements_direct_address_type,
+                                                                                hci_stack->le_advertisements_direct_address,
+                                                                                hci_stack->le_advertisements_channel_map,
+                                                                                hci_stack->le_advertisements_filter_policy));
         return true;
     }
     if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_ADV_DATA){
@@ -3844,7 +4751,7 @@ static bool hci_run_general_gap_le(void){
         (void)memcpy(adv_data_clean, hci_stack->le_advertisements_data,
                      hci_stack->le_advertisements_data_len);
         btstack_replace_bd_addr_placeholder(adv_data_clean, hci_stack->le_advertisements_data_len, hci_stack->local_bd_addr);
-        hci_send_cmd(&hci_le_set_advertising_data, hci_stack->le_advertisements_data_len, adv_data_clean);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_advertising_data(hci_reserve_cmd_packet_buffer(), hci_stack->le_advertisements_data_len, adv_data_clean));
         return true;
     }
     if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA){
@@ -3854,7 +4761,7 @@ static bool hci_run_general_gap_le(void){
         (void)memcpy(scan_data_clean, hci_stack->le_scan_response_data,
                      hci_stack->le_scan_response_data_len);
         btstack_replace_bd_addr_placeholder(scan_data_clean, hci_stack->le_scan_response_data_len, hci_stack->local_bd_addr);
-        hci_send_cmd(&hci_le_set_scan_response_data, hci_stack->le_scan_response_data_len, scan_data_clean);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_scan_response_data(hci_reserve_cmd_packet_buffer(), hci_stack->le_scan_response_data_len, scan_data_clean));
         return true;
     }
 #endif
@@ -3873,13 +4780,13 @@ static bool hci_run_general_gap_le(void){
             whitelist_entry_t * entry = (whitelist_entry_t*) btstack_linked_list_iterator_next(&lit);
 			if (entry->state & LE_WHITELIST_REMOVE_FROM_CONTROLLER){
 				entry->state &= ~LE_WHITELIST_REMOVE_FROM_CONTROLLER;
-				hci_send_cmd(&hci_le_remove_device_from_white_list, entry->address_type, entry->address);
+				hci_send_cmd_packet_buffer(hci_cmd_create_le_remove_device_from_white_list(hci_reserve_cmd_packet_buffer(), entry->address_type, entry->address));
 				return true;
 			}
             if (entry->state & LE_WHITELIST_ADD_TO_CONTROLLER){
 				entry->state &= ~LE_WHITELIST_ADD_TO_CONTROLLER;
                 entry->state |= LE_WHITELIST_ON_CONTROLLER;
-                hci_send_cmd(&hci_le_add_device_to_white_list, entry->address_type, entry->address);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_add_device_to_white_list(hci_reserve_cmd_packet_buffer(), entry->address_type, entry->address));
                 return true;
             }
             if ((entry->state & LE_WHITELIST_ON_CONTROLLER) == 0){
@@ -3896,11 +4803,11 @@ static bool hci_run_general_gap_le(void){
 		switch (hci_stack->le_resolving_list_state) {
 			case LE_RESOLVING_LIST_SEND_ENABLE_ADDRESS_RESOLUTION:
 				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_READ_SIZE;
-				hci_send_cmd(&hci_le_set_address_resolution_enabled, 1);
+				hci_send_cmd_packet_buffer(hci_cmd_create_le_set_address_resolution_enabled(hci_reserve_cmd_packet_buffer(), 1));
 				return true;
 			case LE_RESOLVING_LIST_READ_SIZE:
 				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_SEND_CLEAR;
-				hci_send_cmd(&hci_le_read_resolving_list_size);
+				hci_send_cmd_packet_buffer(hci_cmd_create_le_read_resolving_list_size(hci_reserve_cmd_packet_buffer()));
 				return true;
 			case LE_RESOLVING_LIST_SEND_CLEAR:
 				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_REMOVE_ENTRIES;
@@ -3908,7 +4815,7 @@ static bool hci_run_general_gap_le(void){
 							  sizeof(hci_stack->le_resolving_list_add_entries));
 				(void) memset(hci_stack->le_resolving_list_remove_entries, 0,
 							  sizeof(hci_stack->le_resolving_list_remove_entries));
-				hci_send_cmd(&hci_le_clear_resolving_list);
+				hci_send_cmd_packet_buffer(hci_cmd_create_le_clear_resolving_list(hci_reserve_cmd_packet_buffer()));
 				return true;
 			case LE_RESOLVING_LIST_REMOVE_ENTRIES:
 				for (i = 0; i < MAX_NUM_RESOLVING_LIST_ENTRIES && i < le_device_db_max_count(); i++) {
@@ -3934,8 +4841,8 @@ static bool hci_run_general_gap_le(void){
 					}
 #endif
 
-					hci_send_cmd(&hci_le_remove_device_from_resolving_list, peer_identity_addr_type,
-								 peer_identity_addreses);
+					hci_send_cmd_packet_buffer(hci_cmd_create_le_remove_device_from_resolving_list(hci_reserve_cmd_packet_buffer(), peer_identity_addr_type,
+								 peer_identity_addreses));
 					return true;
 				}
 
@@ -3960,8 +4867,8 @@ static bool hci_run_general_gap_le(void){
 					uint8_t peer_irk_flipped[16];
 					reverse_128(local_irk, local_irk_flipped);
 					reverse_128(peer_irk, peer_irk_flipped);
-					hci_send_cmd(&hci_le_add_device_to_resolving_list, peer_identity_addr_type, peer_identity_addreses,
-								 peer_irk_flipped, local_irk_flipped);
+					hci_send_cmd_packet_buffer(hci_cmd_create_le_add_device_to_resolving_list(hci_reserve_cmd_packet_buffer(), peer_identity_addr_type, peer_identity_addreses,
+								 peer_irk_flipped, local_irk_flipped));
 					return true;
 				}
 				hci_stack->le_resolving_list_state = LE_RESOLVING_LIST_DONE;
@@ -3980,7 +4887,7 @@ static bool hci_run_general_gap_le(void){
     // re-start scanning
     if ((hci_stack->le_scanning_enabled && !hci_stack->le_scanning_active)){
         hci_stack->le_scanning_active = true;
-        hci_send_cmd(&hci_le_set_scan_enable, 1, 0);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_scan_enable(hci_reserve_cmd_packet_buffer(), 1, 0));
         return true;
     }
 #endif
@@ -3990,20 +4897,20 @@ static bool hci_run_general_gap_le(void){
     if ( (hci_stack->le_connecting_state == LE_CONNECTING_IDLE) && (hci_stack->le_connecting_request == LE_CONNECTING_WHITELIST)){
         bd_addr_t null_addr;
         memset(null_addr, 0, 6);
-        hci_send_cmd(&hci_le_create_connection,
-                     hci_stack->le_connection_scan_interval,    // scan interval: 60 ms
-                     hci_stack->le_connection_scan_window,    // scan interval: 30 ms
-                     1,         // use whitelist
-                     0,         // peer address type
-                     null_addr, // peer bd addr
-                     hci_stack->le_own_addr_type, // our addr type:
-                     hci_stack->le_connection_interval_min,    // conn interval min
-                     hci_stack->le_connection_interval_max,    // conn interval max
-                     hci_stack->le_connection_latency,         // conn latency
-                     hci_stack->le_supervision_timeout,        // conn latency
-                     hci_stack->le_minimum_ce_length,          // min ce length
-                     hci_stack->le_maximum_ce_length           // max ce length
-        );
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_create_connection(hci_reserve_cmd_packet_buffer(),
+                                                                       hci_stack->le_connection_scan_interval,    // scan interval: 60 ms
+                                                                       hci_stack->le_connection_scan_window,    // scan interval: 30 ms
+                                                                       1,         // use whitelist
+                                                                       0,         // peer address type
+                                                                       null_addr, // peer bd addr
+                                                                       hci_stack->le_own_addr_type, // our addr type:
+                                                                       hci_stack->le_connection_interval_min,    // conn interval min
+                                                                       hci_stack->le_connection_interval_max,    // conn interval max
+                                                                       hci_stack->le_connection_latency,         // conn latency
+                                                                       hci_stack->le_supervision_timeout,        // conn latency
+                                                                       hci_stack->le_minimum_ce_length,          // min ce length
+                                                                       hci_stack->le_maximum_ce_length           // max ce length
+        ));
         return true;
     }
 #endif
@@ -4013,7 +4920,7 @@ static bool hci_run_general_gap_le(void){
     if (hci_stack->le_advertisements_enabled_for_current_roles && !hci_stack->le_advertisements_active){
         // check if advertisements should be enabled given
         hci_stack->le_advertisements_active = true;
-        hci_send_cmd(&hci_le_set_advertise_enable, 1);
+        hci_send_cmd_packet_buffer(hci_cmd_create_le_set_advertise_enable(hci_reserve_cmd_packet_buffer(), 1));
         return true;
     }
 #endif
@@ -4023,9 +4930,16 @@ static bool hci_run_general_gap_le(void){
 #endif
 
 static bool hci_run_general_pending_commands(void){
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+    // only visit connections marked dirty, in list order
+    if (hci_stack->connections_dirty == 0u) return false;
+#endif
     btstack_linked_item_t * it;
     for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+        if (!connection->dirty) continue;
+#endif
 
         switch(connection->state){
             case SEND_CREATE_CONNECTION:
@@ -4033,27 +4947,27 @@ static bool hci_run_general_pending_commands(void){
 #ifdef ENABLE_CLASSIC
                     case BD_ADDR_TYPE_ACL:
                         log_info("sending hci_create_connection");
-                        hci_send_cmd(&hci_create_connection, connection->address, hci_usable_acl_packet_types(), 0, 0, 0, hci_stack->allow_role_switch);
+                        hci_send_cmd_packet_buffer(hci_cmd_create_create_connection(hci_reserve_cmd_packet_buffer(), connection->address, hci_usable_acl_packet_types(), 0, 0, 0, hci_stack->allow_role_switch));
                         break;
 #endif
                     default:
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
                         log_info("sending hci_le_create_connection");
-                        hci_send_cmd(&hci_le_create_connection,
-                                     hci_stack->le_connection_scan_interval,    // conn scan interval
-                                     hci_stack->le_connection_scan_window,      // conn scan windows
-                                     0,         // don't use whitelist
-                                     connection->address_type, // peer address type
-                                     connection->address,      // peer bd addr
-                                     hci_stack->le_own_addr_type, // our addr type:
-                                     hci_stack->le_connection_interval_min,    // conn interval min
-                                     hci_stack->le_connection_interval_max,    // conn interval max
-                                     hci_stack->le_connection_latency,         // conn latency
-                                     hci_stack->le_supervision_timeout,        // conn latency
-                                     hci_stack->le_minimum_ce_length,          // min ce length
-                                     hci_stack->le_maximum_ce_length          // max ce length
-                        );
+                        hci_send_cmd_packet_buffer(hci_cmd_create_le_create_connection(hci_reserve_cmd_packet_buffer(),
+                                                                                       hci_stack->le_connection_scan_interval,    // conn scan interval
+                                                                                       hci_stack->le_connection_scan_window,      // conn scan windows
+                                                                                       0,         // don't use whitelist
+                                                                                       connection->address_type, // peer address type
+                                                                                       connection->address,      // peer bd addr
+                                                                                       hci_stack->le_own_addr_type, // our addr type:
+                                                                                       hci_stack->le_connection_interval_min,    // conn interval min
+                                                                                       hci_stack->le_connection_interval_max,    // conn interval max
+                                                                                       hci_stack->le_connection_latency,         // conn latency
+                                                                                       hci_stack->le_supervision_timeout,        // conn latency
+                                                                                       hci_stack->le_minimum_ce_length,          // min ce length
+                                                                                       hci_stack->le_maximum_ce_length          // max ce length
+                        ));
                         connection->state = SENT_CREATE_CONNECTION;
 #endif
 #endif
@@ -4067,7 +4981,7 @@ static bool hci_run_general_pending_commands(void){
                 if (connection->address_type == BD_ADDR_TYPE_ACL){
                     log_info("sending hci_accept_connection_request");
                     connection->state = ACCEPTED_CONNECTION_REQUEST;
-                    hci_send_cmd(&hci_accept_connection_request, connection->address, hci_stack->master_slave_policy);
+                    hci_send_cmd_packet_buffer(hci_cmd_create_accept_connection_request(hci_reserve_cmd_packet_buffer(), connection->address, hci_stack->master_slave_policy));
                 }
                 return true;
 #endif
@@ -4076,13 +4990,13 @@ static bool hci_run_general_pending_commands(void){
 #ifdef ENABLE_LE_CENTRAL
             case SEND_CANCEL_CONNECTION:
                 connection->state = SENT_CANCEL_CONNECTION;
-                hci_send_cmd(&hci_le_create_connection_cancel);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_create_connection_cancel(hci_reserve_cmd_packet_buffer()));
                 return true;
 #endif
 #endif
             case SEND_DISCONNECT:
                 connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+                hci_send_cmd_packet_buffer(hci_cmd_create_disconnect(hci_reserve_cmd_packet_buffer(), connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION));
                 return true;
 
             default:
@@ -4094,7 +5008,7 @@ static bool hci_run_general_pending_commands(void){
 
         if (connection->authentication_flags & READ_RSSI){
             connectionClearAuthenticationFlags(connection, READ_RSSI);
-            hci_send_cmd(&hci_read_rssi, connection->con_handle);
+            hci_send_cmd_packet_buffer(hci_cmd_create_read_rssi(hci_reserve_cmd_packet_buffer(), connection->con_handle));
             return true;
         }
 
@@ -4102,7 +5016,7 @@ static bool hci_run_general_pending_commands(void){
 
         if (connection->authentication_flags & WRITE_SUPERVISION_TIMEOUT){
             connectionClearAuthenticationFlags(connection, WRITE_SUPERVISION_TIMEOUT);
-            hci_send_cmd(&hci_write_link_supervision_timeout, connection->con_handle, hci_stack->link_supervision_timeout);
+            hci_send_cmd_packet_buffer(hci_cmd_create_write_link_supervision_timeout(hci_reserve_cmd_packet_buffer(), connection->con_handle, hci_stack->link_supervision_timeout));
             return true;
         }
 
@@ -4120,16 +5034,16 @@ static bool hci_run_general_pending_commands(void){
             if (sc_downgrade){
                 log_info("Link key based on SC, but remote does not support SC -> disconnect");
                 connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE);
+                hci_send_cmd_packet_buffer(hci_cmd_create_disconnect(hci_reserve_cmd_packet_buffer(), connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE));
                 return true;
             }
 
             bool security_level_sufficient = have_link_key && (gap_security_level_for_link_key_type(link_key_type) >= connection->requested_security_level);
             if (have_link_key && security_level_sufficient){
                 connection->link_key_type = link_key_type;
-                hci_send_cmd(&hci_link_key_request_reply, connection->address, &link_key);
+                hci_send_cmd_packet_buffer(hci_cmd_create_link_key_request_reply(hci_reserve_cmd_packet_buffer(), connection->address, link_key));
             } else {
-                hci_send_cmd(&hci_link_key_request_negative_reply, connection->address);
+                hci_send_cmd_packet_buffer(hci_cmd_create_link_key_request_negative_reply(hci_reserve_cmd_packet_buffer(), connection->address));
             }
             return true;
         }
@@ -4137,7 +5051,7 @@ static bool hci_run_general_pending_commands(void){
         if (connection->authentication_flags & DENY_PIN_CODE_REQUEST){
             log_info("denying to pin request");
             connectionClearAuthenticationFlags(connection, DENY_PIN_CODE_REQUEST);
-            hci_send_cmd(&hci_pin_code_request_negative_reply, connection->address);
+            hci_send_cmd_packet_buffer(hci_cmd_create_pin_code_request_negative_reply(hci_reserve_cmd_packet_buffer(), connection->address));
             return true;
         }
 
@@ -4153,40 +5067,40 @@ static bool hci_run_general_pending_commands(void){
                 if (gap_mitm_protection_required_for_security_level(connection->requested_security_level)){
                     authreq |= 1;
                 }
-                hci_send_cmd(&hci_io_capability_request_reply, &connection->address, hci_stack->ssp_io_capability, NULL, authreq);
+                hci_send_cmd_packet_buffer(hci_cmd_create_io_capability_request_reply(hci_reserve_cmd_packet_buffer(), connection->address, hci_stack->ssp_io_capability, 0, authreq));
             } else {
-                hci_send_cmd(&hci_io_capability_request_negative_reply, &connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED);
+                hci_send_cmd_packet_buffer(hci_cmd_create_io_capability_request_negative_reply(hci_reserve_cmd_packet_buffer(), connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED));
             }
             return true;
         }
 
         if (connection->authentication_flags & SEND_USER_CONFIRM_REPLY){
             connectionClearAuthenticationFlags(connection, SEND_USER_CONFIRM_REPLY);
-            hci_send_cmd(&hci_user_confirmation_request_reply, &connection->address);
+            hci_send_cmd_packet_buffer(hci_cmd_create_user_confirmation_request_reply(hci_reserve_cmd_packet_buffer(), connection->address));
             return true;
         }
 
         if (connection->authentication_flags & SEND_USER_PASSKEY_REPLY){
             connectionClearAuthenticationFlags(connection, SEND_USER_PASSKEY_REPLY);
-            hci_send_cmd(&hci_user_passkey_request_reply, &connection->address, 000000);
+            hci_send_cmd_packet_buffer(hci_cmd_create_user_passkey_request_reply(hci_reserve_cmd_packet_buffer(), connection->address, 000000));
             return true;
         }
 
         if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_0){
             connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_0;
-            hci_send_cmd(&hci_read_remote_supported_features_command, connection->con_handle);
+            hci_send_cmd_packet_buffer(hci_cmd_create_read_remote_supported_features_command(hci_reserve_cmd_packet_buffer(), connection->con_handle));
             return true;
         }
 
         if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_1){
             connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_1;
-            hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 1);
+            hci_send_cmd_packet_buffer(hci_cmd_create_read_remote_extended_features_command(hci_reserve_cmd_packet_buffer(), connection->con_handle, 1));
             return true;
         }
 
         if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES_PAGE_2){
             connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES_PAGE_2;
-            hci_send_cmd(&hci_read_remote_extended_features_command, connection->con_handle, 2);
+            hci_send_cmd_packet_buffer(hci_cmd_create_read_remote_extended_features_command(hci_reserve_cmd_packet_buffer(), connection->con_handle, 2));
             return true;
         }
 
@@ -4194,25 +5108,25 @@ static bool hci_run_general_pending_commands(void){
             connection->bonding_flags &= ~BONDING_DISCONNECT_DEDICATED_DONE;
             connection->bonding_flags |= BONDING_EMIT_COMPLETE_ON_DISCONNECT;
             connection->state = SENT_DISCONNECT;
-            hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+            hci_send_cmd_packet_buffer(hci_cmd_create_disconnect(hci_reserve_cmd_packet_buffer(), connection->con_handle, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION));
             return true;
         }
 
         if (connection->bonding_flags & BONDING_SEND_AUTHENTICATE_REQUEST){
             connection->bonding_flags &= ~BONDING_SEND_AUTHENTICATE_REQUEST;
             connection->bonding_flags |= BONDING_SENT_AUTHENTICATE_REQUEST;
-            hci_send_cmd(&hci_authentication_requested, connection->con_handle);
+            hci_send_cmd_packet_buffer(hci_cmd_create_authentication_requested(hci_reserve_cmd_packet_buffer(), connection->con_handle));
             return true;
         }
 
         if (connection->bonding_flags & BONDING_SEND_ENCRYPTION_REQUEST){
             connection->bonding_flags &= ~BONDING_SEND_ENCRYPTION_REQUEST;
-            hci_send_cmd(&hci_set_connection_encryption, connection->con_handle, 1);
+            hci_send_cmd_packet_buffer(hci_cmd_create_set_connection_encryption(hci_reserve_cmd_packet_buffer(), connection->con_handle, 1));
             return true;
         }
         if (connection->bonding_flags & BONDING_SEND_READ_ENCRYPTION_KEY_SIZE){
             connection->bonding_flags &= ~BONDING_SEND_READ_ENCRYPTION_KEY_SIZE;
-            hci_send_cmd(&hci_read_encryption_key_size, connection->con_handle, 1);
+            hci_send_cmd_packet_buffer(hci_cmd_create_read_encryption_key_size(hci_reserve_cmd_packet_buffer(), connection->con_handle));
             return true;
         }
 #endif
@@ -4221,7 +5135,7 @@ static bool hci_run_general_pending_commands(void){
             connection->bonding_flags &= ~BONDING_DISCONNECT_SECURITY_BLOCK;
             if (connection->state != SENT_DISCONNECT){
                 connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE);
+                hci_send_cmd_packet_buffer(hci_cmd_create_disconnect(hci_reserve_cmd_packet_buffer(), connection->con_handle, ERROR_CODE_AUTHENTICATION_FAILURE));
                 return true;
             }
         }
@@ -4233,19 +5147,19 @@ static bool hci_run_general_pending_commands(void){
                 break;
             case 0xffff:
                 connection->sniff_min_interval = 0;
-                hci_send_cmd(&hci_exit_sniff_mode, connection->con_handle);
+                hci_send_cmd_packet_buffer(hci_cmd_create_exit_sniff_mode(hci_reserve_cmd_packet_buffer(), connection->con_handle));
                 return true;
             default:
                 sniff_min_interval = connection->sniff_min_interval;
                 connection->sniff_min_interval = 0;
-                hci_send_cmd(&hci_sniff_mode, connection->con_handle, connection->sniff_max_interval, sniff_min_interval, connection->sniff_attempt, connection->sniff_timeout);
+                hci_send_cmd_packet_buffer(hci_cmd_create_sniff_mode(hci_reserve_cmd_packet_buffer(), connection->con_handle, connection->sniff_max_interval, sniff_min_interval, connection->sniff_attempt, connection->sniff_timeout));
                 return true;
         }
 
         if (connection->request_role != HCI_ROLE_INVALID){
             hci_role_t  role = connection->request_role;
             connection->request_role = HCI_ROLE_INVALID;
-            hci_send_cmd(&hci_switch_role_command, connection->address, role);
+            hci_send_cmd_packet_buffer(hci_cmd_create_switch_role_command(hci_reserve_cmd_packet_buffer(), connection->address, role));
             return true;
         }
 #endif
@@ -4255,19 +5169,19 @@ static bool hci_run_general_pending_commands(void){
             // response to L2CAP CON PARAMETER UPDATE REQUEST
             case CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS:
                 connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_connection_update, connection->con_handle, connection->le_conn_interval_min,
-                             connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
-                             0x0000, 0xffff);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_connection_update(hci_reserve_cmd_packet_buffer(), connection->con_handle, connection->le_conn_interval_min,
+                                                                               connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
+                                                                               0x0000, 0xffff));
                 return true;
             case CON_PARAMETER_UPDATE_REPLY:
                 connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_remote_connection_parameter_request_reply, connection->con_handle, connection->le_conn_interval_min,
-                             connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
-                             0x0000, 0xffff);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_remote_connection_parameter_request_reply(hci_reserve_cmd_packet_buffer(), connection->con_handle, connection->le_conn_interval_min,
+                                                                                                       connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
+                                                                                                       0x0000, 0xffff));
                 return true;
             case CON_PARAMETER_UPDATE_NEGATIVE_REPLY:
                 connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-                hci_send_cmd(&hci_le_remote_connection_parameter_request_negative_reply, ERROR_CODE_UNSUPPORTED_LMP_PARAMETER_VALUE_UNSUPPORTED_LL_PARAMETER_VALUE);
+                hci_send_cmd_packet_buffer(hci_cmd_create_le_remote_connection_parameter_request_negative_reply(hci_reserve_cmd_packet_buffer(), connection->con_handle, ERROR_CODE_UNSUPPORTED_LMP_PARAMETER_VALUE_UNSUPPORTED_LL_PARAMETER_VALUE));
                 return true;
             default:
                 break;
@@ -4275,10 +5189,15 @@ static bool hci_run_general_pending_commands(void){
         if (connection->le_phy_update_all_phys != 0xffu){
             uint8_t all_phys = connection->le_phy_update_all_phys;
             connection->le_phy_update_all_phys = 0xff;
-            hci_send_cmd(&hci_le_set_phy, connection->con_handle, all_phys, connection->le_phy_update_tx_phys, connection->le_phy_update_rx_phys, connection->le_phy_update_phy_options);
+            hci_send_cmd_packet_buffer(hci_cmd_create_le_set_phy(hci_reserve_cmd_packet_buffer(), connection->con_handle, all_phys, connection->le_phy_update_tx_phys, connection->le_phy_update_rx_phys, connection->le_phy_update_phy_options));
             return true;
         }
 #endif
+
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+        // nothing left to do. connections in SENT_DISCONNECT stay dirty
+        hci_connection_clear_dirty(connection);
+#endif
     }
     return false;
 }
@@ -4326,6 +5245,9 @@ static void hci_run(void){
     switch (hci_stack->state){
         case HCI_STATE_INITIALIZING:
             hci_initializing_run();
+#ifdef ENABLE_HCI_INIT_CACHE
+            hci_init_cache_replay_responses();
+#endif
             break;
             
         case HCI_STATE_HALTING:
@@ -4502,6 +5424,7 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
                     return -1; // packet not sent to controller
                 }
                 conn->state = SEND_CREATE_CONNECTION;
+                hci_connection_set_dirty(conn);
                 conn->role  = HCI_ROLE_MASTER;
             }
             log_info("conn state %u", conn->state);
@@ -4612,6 +5535,9 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
     }
 
     hci_stack->num_cmd_packets--;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    hci_command_pipeline_add(opcode);
+#endif
 
     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet, size);
     return hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, packet, size);
@@ -4622,6 +5548,7 @@ void hci_disconnect_security_block(hci_con_handle_t con_handle){
     hci_connection_t * connection = hci_connection_for_handle(con_handle);
     if (!connection) return;
     connection->bonding_flags |= BONDING_DISCONNECT_SECURITY_BLOCK;
+    hci_connection_set_dirty(connection);
 }
 
 
@@ -4664,13 +5591,14 @@ int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argptr){
         return 0;
     }
 
-    // for HCI INITIALIZATION
-    // log_info("hci_send_cmd: opcode %04x", cmd->opcode);
-    hci_stack->last_cmd_opcode = cmd->opcode;
-
     hci_reserve_packet_buffer();
+    uint16_t size = hci_cmd_create_from_template(hci_stack->hci_packet_buffer, cmd, argptr);
+    return hci_send_cmd_packet_buffer(size);
+}
+
+int hci_send_cmd_packet_buffer(uint16_t size){
     uint8_t * packet = hci_stack->hci_packet_buffer;
-    uint16_t size = hci_cmd_create_from_template(packet, cmd, argptr);
+    hci_stack->last_cmd_opcode = little_endian_read_16(packet, 0);
     int err = hci_send_cmd_packet(packet, size);
 
     // release packet buffer on error or for synchronous transport implementations
@@ -4682,6 +5610,12 @@ int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argptr){
     return err;
 }
 
+// reserve packet buffer for hci_cmd_create_* encoder, caller checked hci_can_send_command_packet_now
+uint8_t * hci_reserve_cmd_packet_buffer(void){
+    hci_reserve_packet_buffer();
+    return hci_stack->hci_packet_buffer;
+}
+
 /**
  * pre: numcmds >= 0 - it's allowed to send a command to the controller
  */
@@ -4716,6 +5650,32 @@ static void hci_emit_acl_packet(uint8_t * packet, uint16_t size){
     hci_stack->acl_packet_handler(HCI_ACL_DATA_PACKET, 0, packet, size);
 }
 
+static void hci_notify_if_acl_can_send_now(void){
+    // requests and sends from event handler are handled by outer loop
+    if (hci_stack->acl_can_send_now_notify_active != 0u) return;
+    hci_stack->acl_can_send_now_notify_active = 1;
+    // emit event for one waiting connection at a time as sending a packet changes the state
+    while (true){
+        hci_connection_t * connection = NULL;
+        btstack_linked_item_t * it;
+        for (it = (btstack_linked_item_t *) hci_stack->connections; it != NULL; it = it->next){
+            hci_connection_t * candidate = (hci_connection_t *) it;
+            if (candidate->acl_waiting_for_can_send_now == 0u) continue;
+            if (!hci_can_send_acl_packet_now(candidate->con_handle)) continue;
+            connection = candidate;
+            break;
+        }
+        if (connection == NULL) break;
+        connection->acl_waiting_for_can_send_now = 0;
+        uint8_t event[4];
+        event[0] = HCI_EVENT_ACL_CAN_SEND_NOW;
+        event[1] = sizeof(event) - 2u;
+        little_endian_store_16(event, 2, connection->con_handle);
+        hci_emit_event(event, sizeof(event), 1);
+    }
+    hci_stack->acl_can_send_now_notify_active = 0;
+}
+
 #ifdef ENABLE_CLASSIC
 static void hci_notify_if_sco_can_send_now(void){
     // notify SCO sender if waiting
@@ -5092,6 +6052,7 @@ void gap_request_security_level(hci_con_handle_t con_handle, gap_security_level_
     // start to authenticate connection if authentication not already active
     if ((connection->bonding_flags & BONDING_SENT_AUTHENTICATE_REQUEST) != 0) return;
     connection->bonding_flags |= BONDING_SEND_AUTHENTICATE_REQUEST;
+    hci_connection_set_dirty(connection);
     hci_run();
 }
 
@@ -5115,6 +6076,7 @@ int gap_dedicated_bonding(bd_addr_t device, int mitm_protection_required){
 
     // configure LEVEL_2/3, dedicated bonding
     connection->state = SEND_CREATE_CONNECTION;    
+    hci_connection_set_dirty(connection);
     connection->requested_security_level = mitm_protection_required ? LEVEL_3 : LEVEL_2;
     log_info("gap_dedicated_bonding, mitm %d -> level %u", mitm_protection_required, connection->requested_security_level);
     connection->bonding_flags = BONDING_DEDICATED;
@@ -5141,14 +6103,42 @@ void gap_set_local_name(const char * local_name){
 #ifdef ENABLE_LE_CENTRAL
 void gap_start_scan(void){
     hci_stack->le_scanning_enabled = true;
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+    memset(hci_stack->le_advertising_report_cache, 0, sizeof(hci_stack->le_advertising_report_cache));
+#endif
     hci_run();
 }
 
 void gap_stop_scan(void){
     hci_stack->le_scanning_enabled = false;
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+    hci_le_advertising_report_batch_emit();
+#endif
     hci_run();
 }
 
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+void gap_set_advertising_report_filter(const gap_advertising_report_filter_t * filter){
+    hci_stack->le_advertising_report_filter = filter;
+}
+
+void gap_set_advertising_report_cache_ttl(uint16_t ttl_ms){
+    hci_stack->le_advertising_report_cache_ttl_ms = ttl_ms;
+    memset(hci_stack->le_advertising_report_cache, 0, sizeof(hci_stack->le_advertising_report_cache));
+}
+
+void gap_set_advertising_report_batch_timeout(uint16_t timeout_ms){
+    hci_stack->le_advertising_report_batch_timeout_ms = timeout_ms;
+    if (timeout_ms == 0u){
+        hci_le_advertising_report_batch_emit();
+    }
+}
+
+void gap_get_advertising_report_counters(gap_advertising_report_counters_t * counters){
+    *counters = hci_stack->le_advertising_report_counters;
+}
+#endif
+
 void gap_set_scan_params(uint8_t scan_type, uint16_t scan_interval, uint16_t scan_window, uint8_t scanning_filter_policy){
     hci_stack->le_scan_type          = scan_type;
     hci_stack->le_scan_filter_policy = scanning_filter_policy;
@@ -5186,6 +6176,7 @@ uint8_t gap_connect(const bd_addr_t addr, bd_addr_type_t addr_type){
         }
 
         conn->state = SEND_CREATE_CONNECTION;
+        hci_connection_set_dirty(conn);
         log_info("gap_connect: send create connection next");
         hci_run();
         return ERROR_CODE_SUCCESS;
@@ -5203,6 +6194,7 @@ uint8_t gap_connect(const bd_addr_t addr, bd_addr_type_t addr_type){
     if (conn->state == RECEIVED_DISCONNECTION_COMPLETE){
         log_info("gap_connect: send create connection (again)");
         conn->state = SEND_CREATE_CONNECTION;
+        hci_connection_set_dirty(conn);
         hci_run();
         return ERROR_CODE_SUCCESS;
     }
@@ -5238,12 +6230,12 @@ uint8_t gap_connect_cancel(void){
         case SEND_CREATE_CONNECTION:
             // skip sending create connection and emit event instead
             hci_emit_le_connection_complete(conn->address_type, conn->address, 0, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
-            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-            btstack_memory_hci_connection_free( conn );
+            hci_connection_free(conn);
             break;            
         case SENT_CREATE_CONNECTION:
             // request to send cancel connection
             conn->state = SEND_CANCEL_CONNECTION;
+            hci_connection_set_dirty(conn);
             hci_run();
             break;
         default:
@@ -5298,6 +6290,7 @@ int gap_update_connection_parameters(hci_con_handle_t con_handle, uint16_t conn_
     connection->le_conn_latency = conn_latency;
     connection->le_supervision_timeout = supervision_timeout;
     connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS;
+    hci_connection_set_dirty(connection);
     hci_run();
     return 0;
 }
@@ -5422,6 +6415,7 @@ uint8_t gap_disconnect(hci_con_handle_t handle){
         return 0;
     }
     conn->state = SEND_DISCONNECT;
+    hci_connection_set_dirty(conn);
     hci_run();
     return 0;
 }
@@ -5467,6 +6461,7 @@ uint8_t gap_request_role(const bd_addr_t addr, hci_role_t role){
     hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_ACL);
     if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     conn->request_role = role;
+    hci_connection_set_dirty(conn);
     hci_run();
     return ERROR_CODE_SUCCESS;
 }
@@ -5479,6 +6474,7 @@ uint8_t gap_le_set_phy(hci_con_handle_t connection_handle, uint8_t all_phys, uin
     if (!conn) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
 
     conn->le_phy_update_all_phys    = all_phys;
+    hci_connection_set_dirty(conn);
     conn->le_phy_update_tx_phys     = tx_phys;
     conn->le_phy_update_rx_phys     = rx_phys;
     conn->le_phy_update_phy_options = phy_options;
@@ -5918,6 +6914,7 @@ void hci_disconnect_all(void){
         hci_connection_t * con = (hci_connection_t*) btstack_linked_list_iterator_next(&it);
         if (con->state == SENT_DISCONNECT) continue;
         con->state = SEND_DISCONNECT;
+        hci_connection_set_dirty(con);
     }
     hci_run();
 }
@@ -6031,6 +7028,7 @@ uint8_t gap_sniff_mode_enter(hci_con_handle_t con_handle, uint16_t sniff_min_int
     hci_connection_t * conn = hci_connection_for_handle(con_handle);
     if (!conn) return GAP_CONNECTION_INVALID;
     conn->sniff_min_interval = sniff_min_interval;
+    hci_connection_set_dirty(conn);
     conn->sniff_max_interval = sniff_max_interval;
     conn->sniff_attempt = sniff_attempt;
     conn->sniff_timeout = sniff_timeout;
@@ -6047,6 +7045,7 @@ uint8_t gap_sniff_mode_exit(hci_con_handle_t con_handle){
     hci_connection_t * conn = hci_connection_for_handle(con_handle);
     if (!conn) return GAP_CONNECTION_INVALID;
     conn->sniff_min_interval = 0xffff;
+    hci_connection_set_dirty(conn);
     hci_run();
     return 0;
 }
@@ -6114,23 +7113,25 @@ void hci_setup_test_connections_fuzz(void){
     // setup incoming Classic ACL connection with con handle 0x0001, 66:55:44:33:22:01
     addr[5] = 0x01;
     conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_ACL);
-    conn->con_handle = addr[5];
+    hci_connection_set_con_handle(conn, addr[5]);
     conn->role  = HCI_ROLE_SLAVE;
     conn->state = RECEIVED_CONNECTION_REQUEST;
+    hci_connection_set_dirty(conn);
     conn->sm_connection.sm_role = HCI_ROLE_SLAVE;
 
     // setup incoming Classic SCO connection with con handle 0x0002
     addr[5] = 0x02;
     conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_SCO);
-    conn->con_handle = addr[5];
+    hci_connection_set_con_handle(conn, addr[5]);
     conn->role  = HCI_ROLE_SLAVE;
     conn->state = RECEIVED_CONNECTION_REQUEST;
+    hci_connection_set_dirty(conn);
     conn->sm_connection.sm_role = HCI_ROLE_SLAVE;
 
     // setup ready Classic ACL connection with con handle 0x0003
     addr[5] = 0x03;
     conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_ACL);
-    conn->con_handle = addr[5];
+    hci_connection_set_con_handle(conn, addr[5]);
     conn->role  = HCI_ROLE_SLAVE;
     conn->state = OPEN;
     conn->sm_connection.sm_role = HCI_ROLE_SLAVE;
@@ -6138,7 +7139,7 @@ void hci_setup_test_connections_fuzz(void){
     // setup ready Classic SCO connection with con handle 0x0004
     addr[5] = 0x04;
     conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_SCO);
-    conn->con_handle = addr[5];
+    hci_connection_set_con_handle(conn, addr[5]);
     conn->role  = HCI_ROLE_SLAVE;
     conn->state = OPEN;
     conn->sm_connection.sm_role = HCI_ROLE_SLAVE;
@@ -6146,19 +7147,15 @@ void hci_setup_test_connections_fuzz(void){
     // setup ready LE ACL connection with con handle 0x005 and public address
     addr[5] = 0x05;
     conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_LE_PUBLIC);
-    conn->con_handle = addr[5];
+    hci_connection_set_con_handle(conn, addr[5]);
     conn->role  = HCI_ROLE_SLAVE;
     conn->state = OPEN;
     conn->sm_connection.sm_role = HCI_ROLE_SLAVE;
 }
 
 void hci_free_connections_fuzz(void){
-    btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->connections);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        hci_connection_t * con = (hci_connection_t*) btstack_linked_list_iterator_next(&it);
-        btstack_linked_list_iterator_remove(&it);
-        btstack_memory_hci_connection_free(con);
+    while (hci_stack->connections != NULL){
+        hci_connection_free((hci_connection_t *) hci_stack->connections);
     }
 }
 void hci_simulate_working_fuzz(void){
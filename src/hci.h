@@ -131,6 +131,14 @@ extern "C" {
     #endif
 #endif
 
+// connection lookup tables: connection handles are 12 bit, address hash size is configurable
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+#define HCI_CONNECTION_HANDLE_TABLE_SIZE 0x1000
+#ifndef HCI_CONNECTION_ADDRESS_HASH_SIZE
+#define HCI_CONNECTION_ADDRESS_HASH_SIZE 16
+#endif
+#endif
+
 // additional pre-buffer space for packets to Bluetooth module, for now, used for HCI Transport H4 DMA
 #ifndef HCI_OUTGOING_PRE_BUFFER_SIZE
 #ifdef HAVE_HOST_CONTROLLER_API
@@ -140,6 +148,52 @@ extern "C" {
 #endif
 #endif
 
+// outgoing packet buffer pool: ACL packets that wait for transport or controller buffers are parked in their own buffer,
+// each connection can prepare one packet while others are sent
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+#ifndef HCI_OUTGOING_PACKET_POOL_SIZE
+#define HCI_OUTGOING_PACKET_POOL_SIZE 2
+#endif
+#if HCI_OUTGOING_PACKET_POOL_SIZE < 2
+#error HCI_OUTGOING_PACKET_POOL_SIZE must be at least 2
+#endif
+typedef struct {
+    btstack_linked_item_t item;
+    // fragmentation state while parked
+    uint16_t acl_fragmentation_pos;
+    uint16_t acl_fragmentation_total_size;
+    uint8_t  data[HCI_OUTGOING_PRE_BUFFER_SIZE + HCI_OUTGOING_PACKET_BUFFER_SIZE];
+} hci_outgoing_packet_buffer_t;
+#endif
+
+// ACL scheduler: weight in Controller ACL buffers per round
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+#ifndef HCI_ACL_SCHEDULER_DEFAULT_WEIGHT
+#define HCI_ACL_SCHEDULER_DEFAULT_WEIGHT 1
+#endif
+#endif
+
+// Command pipelining: max number of HCI Commands waiting for Command Complete/Status
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+#ifndef HCI_COMMAND_PIPELINE_MAX
+#define HCI_COMMAND_PIPELINE_MAX 4
+#endif
+#endif
+
+// Init cache: max size of stored responses to read-only init commands
+#ifdef ENABLE_HCI_INIT_CACHE
+#ifndef HCI_INIT_CACHE_SIZE
+#define HCI_INIT_CACHE_SIZE 256
+#endif
+#endif
+
+// Advertising report pipeline: number of entries in recently-seen cache
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+#ifndef LE_ADVERTISING_REPORT_CACHE_SIZE
+#define LE_ADVERTISING_REPORT_CACHE_SIZE 32
+#endif
+#endif
+
 // BNEP may uncompress the IP Header by 16 bytes, GATT Client requires two additional bytes for long characteristic reads
 #ifndef HCI_INCOMING_PRE_BUFFER_SIZE
 #ifdef ENABLE_CLASSIC
@@ -477,7 +531,35 @@ typedef struct {
 #endif
 
 //
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+typedef struct {
+    // L2CAP packets sent
+    uint32_t packets_sent;
+    // ACL fragments sent, i.e. Controller ACL buffers used
+    uint32_t fragments_sent;
+    // can send now requests denied in favor of other connections
+    uint32_t requests_denied;
+} hci_acl_scheduler_counters_t;
+#endif
+
+// recently-seen advertising report, keyed by address and hash over advertising event type and data
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+typedef struct {
+    uint32_t  ad_hash;
+    uint32_t  timestamp_ms;
+    bd_addr_t address;
+    uint8_t   address_type;
+    bool      valid;
+} le_advertising_report_cache_entry_t;
+#endif
+
+// ACL packet recombination buffer - PRE_BUFFER + ACL Header + ACL payload
+// with ENABLE_HCI_ACL_RECOMBINATION_POOL, allocated via btstack_memory only while a fragmented packet is received
 typedef struct {
+    uint8_t data[HCI_INCOMING_PRE_BUFFER_SIZE + 4 + HCI_ACL_BUFFER_SIZE];
+} hci_acl_recombination_buffer_t;
+
+typedef struct hci_connection {
     // linked list - assert: first field
     btstack_linked_item_t    item;
     
@@ -547,7 +629,11 @@ typedef struct {
     uint32_t timestamp;
 
     // ACL packet recombination - PRE_BUFFER + ACL Header + ACL payload
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    hci_acl_recombination_buffer_t * acl_recombination_buffer;
+#else
     uint8_t  acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + 4 + HCI_ACL_BUFFER_SIZE];
+#endif
     uint16_t acl_recombination_pos;
     uint16_t acl_recombination_length;
     
@@ -595,6 +681,27 @@ typedef struct {
     l2cap_state_t l2cap_state;
 #endif
 
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+    // connection might have HCI Commands to send, checked by hci_run
+    bool dirty;
+#endif
+
+    // HCI_EVENT_ACL_CAN_SEND_NOW requested
+    uint8_t  acl_waiting_for_can_send_now;
+
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    // deficit round robin over Controller ACL buffers
+    int16_t  acl_scheduler_deficit;
+    uint8_t  acl_scheduler_weight;
+    uint8_t  acl_scheduler_priority;
+    hci_acl_scheduler_counters_t acl_scheduler_counters;
+#endif
+
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    // next connection in same address hash bucket
+    struct hci_connection * address_hash_next;
+#endif
+
 } hci_connection_t;
 
 
@@ -765,6 +872,19 @@ typedef struct {
     // list of existing baseband connections
     btstack_linked_list_t     connections;
 
+#ifdef ENABLE_HCI_CONNECTION_LOOKUP_TABLES
+    // connections indexed by connection handle
+    hci_connection_t *        connection_for_handle[HCI_CONNECTION_HANDLE_TABLE_SIZE];
+
+    // connections hashed by address and address type
+    hci_connection_t *        connection_for_address[HCI_CONNECTION_ADDRESS_HASH_SIZE];
+#endif
+
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+    // number of connections marked dirty
+    uint16_t                  connections_dirty;
+#endif
+
     /* callback to L2CAP layer */
     btstack_packet_handler_t acl_packet_handler;
 
@@ -805,7 +925,18 @@ typedef struct {
 
     // single buffer for HCI packet assembly + additional prebuffer for H4 drivers
     uint8_t   * hci_packet_buffer;
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+    // hci_packet_buffer points into current buffer
+    hci_outgoing_packet_buffer_t   outgoing_packet_buffers[HCI_OUTGOING_PACKET_POOL_SIZE];
+    hci_outgoing_packet_buffer_t * outgoing_packet_buffer_current;
+    btstack_linked_list_t          outgoing_packet_buffers_free;
+    // ACL packets waiting for transport or controller buffers, in order
+    btstack_linked_list_t          outgoing_packet_buffers_parked;
+    // parked buffer still used by HCI transport
+    hci_outgoing_packet_buffer_t * outgoing_packet_buffer_tx_active;
+#else
     uint8_t   hci_packet_buffer_data[HCI_OUTGOING_PRE_BUFFER_SIZE + HCI_OUTGOING_PACKET_BUFFER_SIZE];
+#endif
     uint8_t   hci_packet_buffer_reserved;
     uint16_t  acl_fragmentation_pos;
     uint16_t  acl_fragmentation_total_size;
@@ -813,6 +944,11 @@ typedef struct {
      
     /* host to controller flow control */
     uint8_t  num_cmd_packets;
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+    // opcodes of commands waiting for Command Complete/Status, oldest first
+    uint16_t cmd_opcodes_pending[HCI_COMMAND_PIPELINE_MAX];
+    uint8_t  cmd_opcodes_pending_count;
+#endif
     uint8_t  acl_packets_total_num;
     uint16_t acl_data_packet_length;
     uint8_t  sco_packets_total_num;
@@ -822,6 +958,8 @@ typedef struct {
     uint16_t le_data_packets_length;
     uint8_t  sco_waiting_for_can_send_now;
     uint8_t  sco_can_send_now;
+    // emitting HCI_EVENT_ACL_CAN_SEND_NOW
+    uint8_t  acl_can_send_now_notify_active;
 
     /* local supported features */
     uint8_t local_supported_features[8];
@@ -859,6 +997,19 @@ typedef struct {
 
     uint16_t  last_cmd_opcode;
 
+#ifdef ENABLE_HCI_INIT_CACHE
+    // format, Local Version Information, firmware id, then records {opcode, params len, stored len, params}
+    uint8_t   init_cache[HCI_INIT_CACHE_SIZE];
+    uint16_t  init_cache_len;
+    bool      init_cache_dirty;
+    // hash over chipset driver commands, cache is used after check
+    uint32_t  init_cache_firmware_id;
+    bool      init_cache_firmware_checked;
+    // opcode of command completed from cache by hci_run
+    uint16_t  init_cache_replay_opcode;
+    bool      init_cache_replay_active;
+#endif
+
     uint8_t   cmds_ready;
 
     /* buffer for scan enable cmd - 0xff no change */
@@ -919,6 +1070,17 @@ typedef struct {
     uint16_t le_scan_interval;
     uint16_t le_scan_window;
 
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+    const gap_advertising_report_filter_t * le_advertising_report_filter;
+    uint16_t le_advertising_report_cache_ttl_ms;
+    le_advertising_report_cache_entry_t le_advertising_report_cache[LE_ADVERTISING_REPORT_CACHE_SIZE];
+    // batch event: event type, length, num reports, reports length, reports
+    uint16_t le_advertising_report_batch_timeout_ms;
+    btstack_timer_source_t le_advertising_report_batch_timer;
+    uint8_t  le_advertising_report_batch[2 + 255];
+    gap_advertising_report_counters_t le_advertising_report_counters;
+#endif
+
     // Connection parameters
     uint16_t le_connection_interval_min;
     uint16_t le_connection_interval_max;
@@ -1137,6 +1299,35 @@ void hci_release_packet_buffer(void);
 */
 void hci_set_master_slave_policy(uint8_t policy);
 
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+/**
+ * @brief Set number of Controller ACL buffers a connection gets per round if other connections of same priority want to send, too
+ * @note requires ENABLE_HCI_ACL_SCHEDULER, default HCI_ACL_SCHEDULER_DEFAULT_WEIGHT
+ * @param con_handle
+ * @param weight >= 1
+ * @return status
+ */
+uint8_t hci_acl_scheduler_set_weight(hci_con_handle_t con_handle, uint8_t weight);
+
+/**
+ * @brief Set priority class of a connection. Connections with higher priority are served first
+ * @note requires ENABLE_HCI_ACL_SCHEDULER, default 0
+ * @param con_handle
+ * @param priority
+ * @return status
+ */
+uint8_t hci_acl_scheduler_set_priority(hci_con_handle_t con_handle, uint8_t priority);
+
+/**
+ * @brief Get ACL scheduler counters for a connection
+ * @note requires ENABLE_HCI_ACL_SCHEDULER
+ * @param con_handle
+ * @param counters
+ * @return status
+ */
+uint8_t hci_acl_scheduler_get_counters(hci_con_handle_t con_handle, hci_acl_scheduler_counters_t * counters);
+#endif
+
 /* API_END */
 
 
@@ -1145,6 +1336,19 @@ void hci_set_master_slave_policy(uint8_t policy);
  */
 int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argtr);
 
+/**
+ * Reserve hci packet buffer for HCI Command created by hci_cmd_create_* from hci_cmd_encoder.h
+ * @note caller needs to check hci_can_send_command_packet_now before
+ * @return hci packet buffer
+ */
+uint8_t * hci_reserve_cmd_packet_buffer(void);
+
+/**
+ * Send HCI Command prepared in reserved hci packet buffer, e.g. by hci_cmd_create_* from hci_cmd_encoder.h
+ * @note caller needs to check hci_can_send_command_packet_now before reserving the packet buffer
+ */
+int hci_send_cmd_packet_buffer(uint16_t size);
+
 /**
  * Get connection iterator. Only used by l2cap.c and sm.c
  */
@@ -1155,6 +1359,11 @@ void hci_connections_get_iterator(btstack_linked_list_iterator_t *it);
  */
 hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle);
 
+/**
+ * Mark connection to be checked for pending HCI Commands by hci_run. Used by L2CAP
+ */
+void hci_connection_set_dirty(hci_connection_t * connection);
+
 /**
  * Get internal hci_connection_t for given Bluetooth addres. Called by L2CAP
  */
@@ -1180,6 +1389,12 @@ int hci_can_send_acl_le_packet_now(void);
  */
 int hci_can_send_acl_packet_now(hci_con_handle_t con_handle);
 
+/**
+ * Request HCI_EVENT_ACL_CAN_SEND_NOW for the given handle, might be emitted during call. Used by L2CAP
+ * With ENABLE_HCI_ACL_SCHEDULER, connections waiting for the event share the Controller ACL buffers
+ */
+void hci_request_can_send_now_event(hci_con_handle_t con_handle);
+
 /**
  * Check if acl packet for the given handle can be sent to controller
  */
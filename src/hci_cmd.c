@@ -1266,8 +1266,8 @@ const hci_cmd_t hci_le_read_local_p256_public_key = {
 };
 
 /**
- * @param public key
- * @param private key
+ * @param public_key_x of remote device
+ * @param public_key_y of remote device
  */
 const hci_cmd_t hci_le_generate_dhkey = {
     HCI_OPCODE_HCI_LE_GENERATE_DHKEY, "QQ"
@@ -0,0 +1,2589 @@
+/*
+ * Copyright (C) 2016 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  hci_cmd_encoder.h
+ *
+ *  @brief HCI Command encoders, type-safe alternative to hci_cmd_create_from_template
+ *  @note  Don't edit - generated by tool/btstack_hci_cmd_generator.py
+ *
+ */
+
+#ifndef HCI_CMD_ENCODER_H
+#define HCI_CMD_ENCODER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include "btstack_util.h"
+#include "hci_cmd.h"
+#include <stdint.h>
+#include <string.h>
+
+/* API_START */
+
+/**
+ * @brief Create HCI Command HCI_INQUIRY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param lap
+ * @param inquiry_length
+ * @param num_responses
+ * @return size of HCI Command
+ * @note: btstack_type 311
+ */
+static inline uint16_t hci_cmd_create_inquiry(uint8_t * hci_cmd_buffer, uint32_t lap, uint8_t inquiry_length, uint8_t num_responses){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_INQUIRY);
+    hci_cmd_buffer[2] = 5;
+    little_endian_store_24(hci_cmd_buffer, 3, lap);
+    hci_cmd_buffer[6] = inquiry_length;
+    hci_cmd_buffer[7] = num_responses;
+    return 8;
+}
+
+/**
+ * @brief Create HCI Command HCI_INQUIRY_CANCEL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_inquiry_cancel(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_INQUIRY_CANCEL);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_CREATE_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param packet_type
+ * @param page_scan_repetition_mode
+ * @param reserved
+ * @param clock_offset
+ * @param allow_role_switch
+ * @return size of HCI Command
+ * @note: btstack_type B21121
+ */
+static inline uint16_t hci_cmd_create_create_connection(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint16_t packet_type, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset, uint8_t allow_role_switch){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_CREATE_CONNECTION);
+    hci_cmd_buffer[2] = 13;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_16(hci_cmd_buffer, 9, packet_type);
+    hci_cmd_buffer[11] = page_scan_repetition_mode;
+    hci_cmd_buffer[12] = reserved;
+    little_endian_store_16(hci_cmd_buffer, 13, clock_offset);
+    hci_cmd_buffer[15] = allow_role_switch;
+    return 16;
+}
+
+/**
+ * @brief Create HCI Command HCI_DISCONNECT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_cmd_create_disconnect(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t reason){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_DISCONNECT);
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = reason;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_CREATE_CONNECTION_CANCEL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_create_connection_cancel(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_CREATE_CONNECTION_CANCEL);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_ACCEPT_CONNECTION_REQUEST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param role
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_cmd_create_accept_connection_request(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t role){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ACCEPT_CONNECTION_REQUEST);
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = role;
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_REJECT_CONNECTION_REQUEST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_cmd_create_reject_connection_request(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t reason){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_REJECT_CONNECTION_REQUEST);
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = reason;
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_LINK_KEY_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param link_key
+ * @return size of HCI Command
+ * @note: btstack_type BP
+ */
+static inline uint16_t hci_cmd_create_link_key_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, const uint8_t * link_key){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LINK_KEY_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 22;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    (void)memcpy(&hci_cmd_buffer[9], link_key, 16);
+    return 25;
+}
+
+/**
+ * @brief Create HCI Command HCI_LINK_KEY_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_link_key_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LINK_KEY_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_PIN_CODE_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param pin_length
+ * @param pin
+ * @return size of HCI Command
+ * @note: btstack_type B1P
+ */
+static inline uint16_t hci_cmd_create_pin_code_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t pin_length, const uint8_t * pin){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_PIN_CODE_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 23;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = pin_length;
+    (void)memcpy(&hci_cmd_buffer[10], pin, 16);
+    return 26;
+}
+
+/**
+ * @brief Create HCI Command HCI_PIN_CODE_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_pin_code_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_PIN_CODE_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_CHANGE_CONNECTION_PACKET_TYPE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_cmd_create_change_connection_packet_type(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t packet_type){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_CHANGE_CONNECTION_PACKET_TYPE);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, packet_type);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_AUTHENTICATION_REQUESTED in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_authentication_requested(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_AUTHENTICATION_REQUESTED);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_SET_CONNECTION_ENCRYPTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param encryption_enable
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_cmd_create_set_connection_encryption(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t encryption_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SET_CONNECTION_ENCRYPTION);
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = encryption_enable;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_CHANGE_CONNECTION_LINK_KEY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_change_connection_link_key(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_CHANGE_CONNECTION_LINK_KEY);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_REMOTE_NAME_REQUEST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param page_scan_repetition_mode
+ * @param reserved
+ * @param clock_offset
+ * @return size of HCI Command
+ * @note: btstack_type B112
+ */
+static inline uint16_t hci_cmd_create_remote_name_request(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_REMOTE_NAME_REQUEST);
+    hci_cmd_buffer[2] = 10;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = page_scan_repetition_mode;
+    hci_cmd_buffer[10] = reserved;
+    little_endian_store_16(hci_cmd_buffer, 11, clock_offset);
+    return 13;
+}
+
+/**
+ * @brief Create HCI Command HCI_REMOTE_NAME_REQUEST_CANCEL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_remote_name_request_cancel(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_REMOTE_NAME_REQUEST_CANCEL);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_REMOTE_SUPPORTED_FEATURES_COMMAND in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_remote_supported_features_command(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_REMOTE_SUPPORTED_FEATURES_COMMAND);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_REMOTE_EXTENDED_FEATURES_COMMAND in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param arg1
+ * @param arg2
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_cmd_create_read_remote_extended_features_command(uint8_t * hci_cmd_buffer, hci_con_handle_t arg1, uint8_t arg2){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_REMOTE_EXTENDED_FEATURES_COMMAND);
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, arg1);
+    hci_cmd_buffer[5] = arg2;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_REMOTE_VERSION_INFORMATION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_remote_version_information(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_REMOTE_VERSION_INFORMATION);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_SETUP_SYNCHRONOUS_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param max_latency
+ * @param voice_settings
+ * @param retransmission_effort
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type H442212
+ */
+static inline uint16_t hci_cmd_create_setup_synchronous_connection(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SETUP_SYNCHRONOUS_CONNECTION);
+    hci_cmd_buffer[2] = 17;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_32(hci_cmd_buffer, 5, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 9, receive_bandwidth);
+    little_endian_store_16(hci_cmd_buffer, 13, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 15, voice_settings);
+    hci_cmd_buffer[17] = retransmission_effort;
+    little_endian_store_16(hci_cmd_buffer, 18, packet_type);
+    return 20;
+}
+
+/**
+ * @brief Create HCI Command HCI_ACCEPT_SYNCHRONOUS_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param max_latency
+ * @param voice_settings
+ * @param retransmission_effort
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type B442212
+ */
+static inline uint16_t hci_cmd_create_accept_synchronous_connection(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ACCEPT_SYNCHRONOUS_CONNECTION);
+    hci_cmd_buffer[2] = 21;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 13, receive_bandwidth);
+    little_endian_store_16(hci_cmd_buffer, 17, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 19, voice_settings);
+    hci_cmd_buffer[21] = retransmission_effort;
+    little_endian_store_16(hci_cmd_buffer, 22, packet_type);
+    return 24;
+}
+
+/**
+ * @brief Create HCI Command HCI_IO_CAPABILITY_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param io_capability
+ * @param oob_data_present
+ * @param authentication_requirements
+ * @return size of HCI Command
+ * @note: btstack_type B111
+ */
+static inline uint16_t hci_cmd_create_io_capability_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t io_capability, uint8_t oob_data_present, uint8_t authentication_requirements){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_IO_CAPABILITY_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 9;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = io_capability;
+    hci_cmd_buffer[10] = oob_data_present;
+    hci_cmd_buffer[11] = authentication_requirements;
+    return 12;
+}
+
+/**
+ * @brief Create HCI Command HCI_USER_CONFIRMATION_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_user_confirmation_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_USER_CONFIRMATION_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_USER_CONFIRMATION_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_user_confirmation_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_USER_CONFIRMATION_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_USER_PASSKEY_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param numeric_value
+ * @return size of HCI Command
+ * @note: btstack_type B4
+ */
+static inline uint16_t hci_cmd_create_user_passkey_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t numeric_value){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_USER_PASSKEY_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 10;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, numeric_value);
+    return 13;
+}
+
+/**
+ * @brief Create HCI Command HCI_USER_PASSKEY_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_user_passkey_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_USER_PASSKEY_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_REMOTE_OOB_DATA_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param c
+ * @param r
+ * @return size of HCI Command
+ * @note: btstack_type BPP
+ */
+static inline uint16_t hci_cmd_create_remote_oob_data_request_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, const uint8_t * c, const uint8_t * r){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_REMOTE_OOB_DATA_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 38;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    (void)memcpy(&hci_cmd_buffer[9], c, 16);
+    (void)memcpy(&hci_cmd_buffer[25], r, 16);
+    return 41;
+}
+
+/**
+ * @brief Create HCI Command HCI_REMOTE_OOB_DATA_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_remote_oob_data_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_REMOTE_OOB_DATA_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_IO_CAPABILITY_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_cmd_create_io_capability_request_negative_reply(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t reason){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_IO_CAPABILITY_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = reason;
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_ENHANCED_SETUP_SYNCHRONOUS_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param transmit_coding_format_type
+ * @param transmit_coding_format_company
+ * @param transmit_coding_format_codec
+ * @param receive_coding_format_type
+ * @param receive_coding_format_company
+ * @param receive_coding_format_codec
+ * @param transmit_coding_frame_size
+ * @param receive_coding_frame_size
+ * @param input_bandwidth
+ * @param output_bandwidth
+ * @param input_coding_format_type
+ * @param input_coding_format_company
+ * @param input_coding_format_codec
+ * @param output_coding_format_type
+ * @param output_coding_format_company
+ * @param output_coding_format_codec
+ * @param input_coded_data_size
+ * @param outupt_coded_data_size
+ * @param input_pcm_data_format
+ * @param output_pcm_data_format
+ * @param input_pcm_sample_payload_msb_position
+ * @param output_pcm_sample_payload_msb_position
+ * @param input_data_path
+ * @param output_data_path
+ * @param input_transport_unit_size
+ * @param output_transport_unit_size
+ * @param max_latency
+ * @param packet_type
+ * @param retransmission_effort
+ * @return size of HCI Command
+ * @note: btstack_type H4412212222441221222211111111221
+ */
+static inline uint16_t hci_cmd_create_enhanced_setup_synchronous_connection(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ENHANCED_SETUP_SYNCHRONOUS_CONNECTION);
+    hci_cmd_buffer[2] = 59;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_32(hci_cmd_buffer, 5, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 9, receive_bandwidth);
+    hci_cmd_buffer[13] = transmit_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 14, transmit_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 16, transmit_coding_format_codec);
+    hci_cmd_buffer[18] = receive_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 19, receive_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 21, receive_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 23, transmit_coding_frame_size);
+    little_endian_store_16(hci_cmd_buffer, 25, receive_coding_frame_size);
+    little_endian_store_32(hci_cmd_buffer, 27, input_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 31, output_bandwidth);
+    hci_cmd_buffer[35] = input_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 36, input_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 38, input_coding_format_codec);
+    hci_cmd_buffer[40] = output_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 41, output_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 43, output_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 45, input_coded_data_size);
+    little_endian_store_16(hci_cmd_buffer, 47, outupt_coded_data_size);
+    hci_cmd_buffer[49] = input_pcm_data_format;
+    hci_cmd_buffer[50] = output_pcm_data_format;
+    hci_cmd_buffer[51] = input_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[52] = output_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[53] = input_data_path;
+    hci_cmd_buffer[54] = output_data_path;
+    hci_cmd_buffer[55] = input_transport_unit_size;
+    hci_cmd_buffer[56] = output_transport_unit_size;
+    little_endian_store_16(hci_cmd_buffer, 57, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 59, packet_type);
+    hci_cmd_buffer[61] = retransmission_effort;
+    return 62;
+}
+
+/**
+ * @brief Create HCI Command HCI_ENHANCED_ACCEPT_SYNCHRONOUS_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param transmit_coding_format_type
+ * @param transmit_coding_format_company
+ * @param transmit_coding_format_codec
+ * @param receive_coding_format_type
+ * @param receive_coding_format_company
+ * @param receive_coding_format_codec
+ * @param transmit_coding_frame_size
+ * @param receive_coding_frame_size
+ * @param input_bandwidth
+ * @param output_bandwidth
+ * @param input_coding_format_type
+ * @param input_coding_format_company
+ * @param input_coding_format_codec
+ * @param output_coding_format_type
+ * @param output_coding_format_company
+ * @param output_coding_format_codec
+ * @param input_coded_data_size
+ * @param outupt_coded_data_size
+ * @param input_pcm_data_format
+ * @param output_pcm_data_format
+ * @param input_pcm_sample_payload_msb_position
+ * @param output_pcm_sample_payload_msb_position
+ * @param input_data_path
+ * @param output_data_path
+ * @param input_transport_unit_size
+ * @param output_transport_unit_size
+ * @param max_latency
+ * @param packet_type
+ * @param retransmission_effort
+ * @return size of HCI Command
+ * @note: btstack_type B4412212222441221222211111111221
+ */
+static inline uint16_t hci_cmd_create_enhanced_accept_synchronous_connection(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ENHANCED_ACCEPT_SYNCHRONOUS_CONNECTION);
+    hci_cmd_buffer[2] = 63;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 13, receive_bandwidth);
+    hci_cmd_buffer[17] = transmit_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 18, transmit_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 20, transmit_coding_format_codec);
+    hci_cmd_buffer[22] = receive_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 23, receive_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 25, receive_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 27, transmit_coding_frame_size);
+    little_endian_store_16(hci_cmd_buffer, 29, receive_coding_frame_size);
+    little_endian_store_32(hci_cmd_buffer, 31, input_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 35, output_bandwidth);
+    hci_cmd_buffer[39] = input_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 40, input_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 42, input_coding_format_codec);
+    hci_cmd_buffer[44] = output_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 45, output_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 47, output_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 49, input_coded_data_size);
+    little_endian_store_16(hci_cmd_buffer, 51, outupt_coded_data_size);
+    hci_cmd_buffer[53] = input_pcm_data_format;
+    hci_cmd_buffer[54] = output_pcm_data_format;
+    hci_cmd_buffer[55] = input_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[56] = output_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[57] = input_data_path;
+    hci_cmd_buffer[58] = output_data_path;
+    hci_cmd_buffer[59] = input_transport_unit_size;
+    hci_cmd_buffer[60] = output_transport_unit_size;
+    little_endian_store_16(hci_cmd_buffer, 61, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 63, packet_type);
+    hci_cmd_buffer[65] = retransmission_effort;
+    return 66;
+}
+
+/**
+ * @brief Create HCI Command HCI_SNIFF_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param sniff_max_interval
+ * @param sniff_min_interval
+ * @param sniff_attempt
+ * @param sniff_timeout
+ * @return size of HCI Command
+ * @note: btstack_type H2222
+ */
+static inline uint16_t hci_cmd_create_sniff_mode(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t sniff_max_interval, uint16_t sniff_min_interval, uint16_t sniff_attempt, uint16_t sniff_timeout){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SNIFF_MODE);
+    hci_cmd_buffer[2] = 10;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, sniff_max_interval);
+    little_endian_store_16(hci_cmd_buffer, 7, sniff_min_interval);
+    little_endian_store_16(hci_cmd_buffer, 9, sniff_attempt);
+    little_endian_store_16(hci_cmd_buffer, 11, sniff_timeout);
+    return 13;
+}
+
+/**
+ * @brief Create HCI Command HCI_EXIT_SNIFF_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_exit_sniff_mode(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_EXIT_SNIFF_MODE);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_QOS_SETUP in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param flags
+ * @param service_type
+ * @param token_rate
+ * @param peak_bandwith
+ * @param latency
+ * @param delay_variation
+ * @return size of HCI Command
+ * @note: btstack_type H114444
+ */
+static inline uint16_t hci_cmd_create_qos_setup(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t flags, uint8_t service_type, uint32_t token_rate, uint32_t peak_bandwith, uint32_t latency, uint32_t delay_variation){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_QOS_SETUP);
+    hci_cmd_buffer[2] = 20;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = flags;
+    hci_cmd_buffer[6] = service_type;
+    little_endian_store_32(hci_cmd_buffer, 7, token_rate);
+    little_endian_store_32(hci_cmd_buffer, 11, peak_bandwith);
+    little_endian_store_32(hci_cmd_buffer, 15, latency);
+    little_endian_store_32(hci_cmd_buffer, 19, delay_variation);
+    return 23;
+}
+
+/**
+ * @brief Create HCI Command HCI_ROLE_DISCOVERY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_role_discovery(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ROLE_DISCOVERY);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_SWITCH_ROLE_COMMAND in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param role
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_cmd_create_switch_role_command(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t role){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SWITCH_ROLE_COMMAND);
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = role;
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LINK_POLICY_SETTINGS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_link_policy_settings(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LINK_POLICY_SETTINGS);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_LINK_POLICY_SETTINGS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param settings
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_cmd_create_write_link_policy_settings(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t settings){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_LINK_POLICY_SETTINGS);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, settings);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_DEFAULT_LINK_POLICY_SETTING in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param policy
+ * @return size of HCI Command
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_cmd_create_write_default_link_policy_setting(uint8_t * hci_cmd_buffer, uint16_t policy){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_DEFAULT_LINK_POLICY_SETTING);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, policy);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_SET_EVENT_MASK in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param event_mask_lover_octets
+ * @param event_mask_higher_octets
+ * @return size of HCI Command
+ * @note: btstack_type 44
+ */
+static inline uint16_t hci_cmd_create_set_event_mask(uint8_t * hci_cmd_buffer, uint32_t event_mask_lover_octets, uint32_t event_mask_higher_octets){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SET_EVENT_MASK);
+    hci_cmd_buffer[2] = 8;
+    little_endian_store_32(hci_cmd_buffer, 3, event_mask_lover_octets);
+    little_endian_store_32(hci_cmd_buffer, 7, event_mask_higher_octets);
+    return 11;
+}
+
+/**
+ * @brief Create HCI Command HCI_RESET in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_reset(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_RESET);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_FLUSH in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_flush(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_FLUSH);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_PIN_TYPE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_pin_type(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_PIN_TYPE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_PIN_TYPE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_pin_type(uint8_t * hci_cmd_buffer, uint8_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_PIN_TYPE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = handle;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_DELETE_STORED_LINK_KEY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param delete_all_flags
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_cmd_create_delete_stored_link_key(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t delete_all_flags){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_DELETE_STORED_LINK_KEY);
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = delete_all_flags;
+    return 10;
+}
+
+#ifdef ENABLE_CLASSIC
+/**
+ * @brief Create HCI Command HCI_WRITE_LOCAL_NAME in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param local_name
+ * @return size of HCI Command
+ * @note: btstack_type N
+ */
+static inline uint16_t hci_cmd_create_write_local_name(uint8_t * hci_cmd_buffer, const char * local_name){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_LOCAL_NAME);
+    hci_cmd_buffer[2] = 248;
+    uint16_t local_name_len = (uint16_t) strlen(local_name);
+    if (local_name_len > 248u) {
+        local_name_len = 248;
+    }
+    (void)memcpy(&hci_cmd_buffer[3], local_name, local_name_len);
+    memset(&hci_cmd_buffer[3 + local_name_len], 0u, 248u - local_name_len);
+    return 251;
+}
+
+#endif
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_NAME in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_name(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_NAME);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_PAGE_TIMEOUT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_page_timeout(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_PAGE_TIMEOUT);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_PAGE_TIMEOUT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param page_timeout
+ * @return size of HCI Command
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_cmd_create_write_page_timeout(uint8_t * hci_cmd_buffer, uint16_t page_timeout){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_PAGE_TIMEOUT);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, page_timeout);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SCAN_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param scan_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_scan_enable(uint8_t * hci_cmd_buffer, uint8_t scan_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SCAN_ENABLE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = scan_enable;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_PAGE_SCAN_ACTIVITY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_page_scan_activity(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_PAGE_SCAN_ACTIVITY);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_PAGE_SCAN_ACTIVITY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param page_scan_interval
+ * @param page_scan_window
+ * @return size of HCI Command
+ * @note: btstack_type 22
+ */
+static inline uint16_t hci_cmd_create_write_page_scan_activity(uint8_t * hci_cmd_buffer, uint16_t page_scan_interval, uint16_t page_scan_window){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_PAGE_SCAN_ACTIVITY);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, page_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 5, page_scan_window);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_INQUIRY_SCAN_ACTIVITY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_inquiry_scan_activity(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_INQUIRY_SCAN_ACTIVITY);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_INQUIRY_SCAN_ACTIVITY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param inquiry_scan_interval
+ * @param inquiry_scan_window
+ * @return size of HCI Command
+ * @note: btstack_type 22
+ */
+static inline uint16_t hci_cmd_create_write_inquiry_scan_activity(uint8_t * hci_cmd_buffer, uint16_t inquiry_scan_interval, uint16_t inquiry_scan_window){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_INQUIRY_SCAN_ACTIVITY);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, inquiry_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 5, inquiry_scan_window);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_AUTHENTICATION_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param authentication_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_authentication_enable(uint8_t * hci_cmd_buffer, uint8_t authentication_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_AUTHENTICATION_ENABLE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = authentication_enable;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_CLASS_OF_DEVICE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param class_of_device
+ * @return size of HCI Command
+ * @note: btstack_type 3
+ */
+static inline uint16_t hci_cmd_create_write_class_of_device(uint8_t * hci_cmd_buffer, uint32_t class_of_device){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_CLASS_OF_DEVICE);
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_24(hci_cmd_buffer, 3, class_of_device);
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_NUM_BROADCAST_RETRANSMISSIONS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_num_broadcast_retransmissions(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_NUM_BROADCAST_RETRANSMISSIONS);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_NUM_BROADCAST_RETRANSMISSIONS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param num_broadcast_retransmissions
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_num_broadcast_retransmissions(uint8_t * hci_cmd_buffer, uint8_t num_broadcast_retransmissions){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_NUM_BROADCAST_RETRANSMISSIONS);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = num_broadcast_retransmissions;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_TRANSMIT_POWER_LEVEL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param connection_handle
+ * @param type
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_cmd_create_read_transmit_power_level(uint8_t * hci_cmd_buffer, uint8_t connection_handle, uint8_t type){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_TRANSMIT_POWER_LEVEL);
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = connection_handle;
+    hci_cmd_buffer[4] = type;
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SYNCHRONOUS_FLOW_CONTROL_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param synchronous_flow_control_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_synchronous_flow_control_enable(uint8_t * hci_cmd_buffer, uint8_t synchronous_flow_control_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SYNCHRONOUS_FLOW_CONTROL_ENABLE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = synchronous_flow_control_enable;
+    return 4;
+}
+
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+/**
+ * @brief Create HCI Command HCI_SET_CONTROLLER_TO_HOST_FLOW_CONTROL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param flow_control_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_set_controller_to_host_flow_control(uint8_t * hci_cmd_buffer, uint8_t flow_control_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_SET_CONTROLLER_TO_HOST_FLOW_CONTROL);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = flow_control_enable;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_HOST_BUFFER_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param host_acl_data_packet_length
+ * @param host_synchronous_data_packet_length
+ * @param host_total_num_acl_data_packets
+ * @param host_total_num_synchronous_data_packets
+ * @return size of HCI Command
+ * @note: btstack_type 2122
+ */
+static inline uint16_t hci_cmd_create_host_buffer_size(uint8_t * hci_cmd_buffer, uint16_t host_acl_data_packet_length, uint8_t host_synchronous_data_packet_length, uint16_t host_total_num_acl_data_packets, uint16_t host_total_num_synchronous_data_packets){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_HOST_BUFFER_SIZE);
+    hci_cmd_buffer[2] = 7;
+    little_endian_store_16(hci_cmd_buffer, 3, host_acl_data_packet_length);
+    hci_cmd_buffer[5] = host_synchronous_data_packet_length;
+    little_endian_store_16(hci_cmd_buffer, 6, host_total_num_acl_data_packets);
+    little_endian_store_16(hci_cmd_buffer, 8, host_total_num_synchronous_data_packets);
+    return 10;
+}
+
+#endif
+
+/**
+ * @brief Create HCI Command HCI_READ_LINK_SUPERVISION_TIMEOUT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_link_supervision_timeout(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LINK_SUPERVISION_TIMEOUT);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_LINK_SUPERVISION_TIMEOUT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param timeout
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_cmd_create_write_link_supervision_timeout(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t timeout){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_LINK_SUPERVISION_TIMEOUT);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, timeout);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_CURRENT_IAC_LAP_TWO_IACS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param num_current_iac
+ * @param iac_lap1
+ * @param iac_lap2
+ * @return size of HCI Command
+ * @note: btstack_type 133
+ */
+static inline uint16_t hci_cmd_create_write_current_iac_lap_two_iacs(uint8_t * hci_cmd_buffer, uint8_t num_current_iac, uint32_t iac_lap1, uint32_t iac_lap2){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_CURRENT_IAC_LAP_TWO_IACS);
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = num_current_iac;
+    little_endian_store_24(hci_cmd_buffer, 4, iac_lap1);
+    little_endian_store_24(hci_cmd_buffer, 7, iac_lap2);
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_INQUIRY_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param inquiry_mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_inquiry_mode(uint8_t * hci_cmd_buffer, uint8_t inquiry_mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_INQUIRY_MODE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = inquiry_mode;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_EXTENDED_INQUIRY_RESPONSE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param fec_required
+ * @param exstended_inquiry_response
+ * @return size of HCI Command
+ * @note: btstack_type 1E
+ */
+static inline uint16_t hci_cmd_create_write_extended_inquiry_response(uint8_t * hci_cmd_buffer, uint8_t fec_required, const uint8_t * exstended_inquiry_response){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_EXTENDED_INQUIRY_RESPONSE);
+    hci_cmd_buffer[2] = 241;
+    hci_cmd_buffer[3] = fec_required;
+    (void)memcpy(&hci_cmd_buffer[4], exstended_inquiry_response, 240);
+    return 244;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SIMPLE_PAIRING_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_simple_pairing_mode(uint8_t * hci_cmd_buffer, uint8_t mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SIMPLE_PAIRING_MODE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = mode;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_OOB_DATA in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_oob_data(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_OOB_DATA);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_DEFAULT_ERRONEOUS_DATA_REPORTING in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_default_erroneous_data_reporting(uint8_t * hci_cmd_buffer, uint8_t mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_DEFAULT_ERRONEOUS_DATA_REPORTING);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = mode;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LE_HOST_SUPPORTED in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_le_host_supported(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LE_HOST_SUPPORTED);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_LE_HOST_SUPPORTED in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param le_supported_host
+ * @param simultaneous_le_host
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_cmd_create_write_le_host_supported(uint8_t * hci_cmd_buffer, uint8_t le_supported_host, uint8_t simultaneous_le_host){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_LE_HOST_SUPPORTED);
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = le_supported_host;
+    hci_cmd_buffer[4] = simultaneous_le_host;
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SECURE_CONNECTIONS_HOST_SUPPORT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param secure_connections_host_support
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_secure_connections_host_support(uint8_t * hci_cmd_buffer, uint8_t secure_connections_host_support){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SECURE_CONNECTIONS_HOST_SUPPORT);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = secure_connections_host_support;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_EXTENDED_OB_DATA in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_extended_ob_data(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_EXTENDED_OB_DATA);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOOPBACK_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_loopback_mode(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOOPBACK_MODE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_LOOPBACK_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param loopback_mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_loopback_mode(uint8_t * hci_cmd_buffer, uint8_t loopback_mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_LOOPBACK_MODE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = loopback_mode;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_ENABLE_DEVICE_UNDER_TEST_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_enable_device_under_test_mode(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_ENABLE_DEVICE_UNDER_TEST_MODE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SIMPLE_PAIRING_DEBUG_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param simple_pairing_debug_mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_write_simple_pairing_debug_mode(uint8_t * hci_cmd_buffer, uint8_t simple_pairing_debug_mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SIMPLE_PAIRING_DEBUG_MODE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = simple_pairing_debug_mode;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_WRITE_SECURE_CONNECTIONS_TEST_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param dm1_acl_u_mode
+ * @param esco_loopback_mode
+ * @return size of HCI Command
+ * @note: btstack_type H11
+ */
+static inline uint16_t hci_cmd_create_write_secure_connections_test_mode(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t dm1_acl_u_mode, uint8_t esco_loopback_mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_WRITE_SECURE_CONNECTIONS_TEST_MODE);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = dm1_acl_u_mode;
+    hci_cmd_buffer[6] = esco_loopback_mode;
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_VERSION_INFORMATION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_version_information(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_SUPPORTED_COMMANDS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_supported_commands(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_LOCAL_SUPPORTED_FEATURES in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_local_supported_features(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_BUFFER_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_buffer_size(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_BUFFER_SIZE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_BD_ADDR in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_read_bd_addr(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_BD_ADDR);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_RSSI in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_rssi(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_RSSI);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_READ_ENCRYPTION_KEY_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_read_encryption_key_size(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_READ_ENCRYPTION_KEY_SIZE);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+#ifdef ENABLE_BLE
+/**
+ * @brief Create HCI Command HCI_LE_SET_EVENT_MASK in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param event_mask_lower_octets
+ * @param event_mask_higher_octets
+ * @return size of HCI Command
+ * @note: btstack_type 44
+ */
+static inline uint16_t hci_cmd_create_le_set_event_mask(uint8_t * hci_cmd_buffer, uint32_t event_mask_lower_octets, uint32_t event_mask_higher_octets){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_EVENT_MASK);
+    hci_cmd_buffer[2] = 8;
+    little_endian_store_32(hci_cmd_buffer, 3, event_mask_lower_octets);
+    little_endian_store_32(hci_cmd_buffer, 7, event_mask_higher_octets);
+    return 11;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_BUFFER_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_buffer_size(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_SUPPORTED_FEATURES in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_supported_features(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_SUPPORTED_FEATURES);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_RANDOM_ADDRESS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param random_bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_cmd_create_le_set_random_address(uint8_t * hci_cmd_buffer, const bd_addr_t random_bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_RANDOM_ADDRESS);
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(random_bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_ADVERTISING_PARAMETERS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param advertising_interval_min
+ * @param advertising_interval_max
+ * @param advertising_type
+ * @param own_address_type
+ * @param direct_address_type
+ * @param direct_address
+ * @param advertising_channel_map
+ * @param advertising_filter_policy
+ * @return size of HCI Command
+ * @note: btstack_type 22111B11
+ */
+static inline uint16_t hci_cmd_create_le_set_advertising_parameters(uint8_t * hci_cmd_buffer, uint16_t advertising_interval_min, uint16_t advertising_interval_max, uint8_t advertising_type, uint8_t own_address_type, uint8_t direct_address_type, const bd_addr_t direct_address, uint8_t advertising_channel_map, uint8_t advertising_filter_policy){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS);
+    hci_cmd_buffer[2] = 15;
+    little_endian_store_16(hci_cmd_buffer, 3, advertising_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 5, advertising_interval_max);
+    hci_cmd_buffer[7] = advertising_type;
+    hci_cmd_buffer[8] = own_address_type;
+    hci_cmd_buffer[9] = direct_address_type;
+    reverse_bd_addr(direct_address, &hci_cmd_buffer[10]);
+    hci_cmd_buffer[16] = advertising_channel_map;
+    hci_cmd_buffer[17] = advertising_filter_policy;
+    return 18;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_ADVERTISING_CHANNEL_TX_POWER in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_advertising_channel_tx_power(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_ADVERTISING_CHANNEL_TX_POWER);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_ADVERTISING_DATA in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param advertising_data_length
+ * @param advertising_data
+ * @return size of HCI Command
+ * @note: btstack_type 1A
+ */
+static inline uint16_t hci_cmd_create_le_set_advertising_data(uint8_t * hci_cmd_buffer, uint8_t advertising_data_length, const uint8_t * advertising_data){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA);
+    hci_cmd_buffer[2] = 32;
+    hci_cmd_buffer[3] = advertising_data_length;
+    (void)memcpy(&hci_cmd_buffer[4], advertising_data, 31);
+    return 35;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_SCAN_RESPONSE_DATA in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param scan_response_data_length
+ * @param scan_response_data
+ * @return size of HCI Command
+ * @note: btstack_type 1A
+ */
+static inline uint16_t hci_cmd_create_le_set_scan_response_data(uint8_t * hci_cmd_buffer, uint8_t scan_response_data_length, const uint8_t * scan_response_data){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_SCAN_RESPONSE_DATA);
+    hci_cmd_buffer[2] = 32;
+    hci_cmd_buffer[3] = scan_response_data_length;
+    (void)memcpy(&hci_cmd_buffer[4], scan_response_data, 31);
+    return 35;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_ADVERTISE_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param advertise_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_le_set_advertise_enable(uint8_t * hci_cmd_buffer, uint8_t advertise_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = advertise_enable;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_SCAN_PARAMETERS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param le_scan_type
+ * @param le_scan_interval
+ * @param le_scan_window
+ * @param own_address_type
+ * @param scanning_filter_policy
+ * @return size of HCI Command
+ * @note: btstack_type 12211
+ */
+static inline uint16_t hci_cmd_create_le_set_scan_parameters(uint8_t * hci_cmd_buffer, uint8_t le_scan_type, uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t own_address_type, uint8_t scanning_filter_policy){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_SCAN_PARAMETERS);
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = le_scan_type;
+    little_endian_store_16(hci_cmd_buffer, 4, le_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 6, le_scan_window);
+    hci_cmd_buffer[8] = own_address_type;
+    hci_cmd_buffer[9] = scanning_filter_policy;
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_SCAN_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param le_scan_enable
+ * @param filter_duplices
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_cmd_create_le_set_scan_enable(uint8_t * hci_cmd_buffer, uint8_t le_scan_enable, uint8_t filter_duplices){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_SCAN_ENABLE);
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = le_scan_enable;
+    hci_cmd_buffer[4] = filter_duplices;
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_CREATE_CONNECTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param le_scan_interval
+ * @param le_scan_window
+ * @param initiator_filter_policy
+ * @param peer_address_type
+ * @param peer_address
+ * @param own_address_type
+ * @param conn_interval_min
+ * @param conn_interval_max
+ * @param conn_latency
+ * @param supervision_timeout
+ * @param minimum_ce_length
+ * @param maximum_ce_length
+ * @return size of HCI Command
+ * @note: btstack_type 2211B1222222
+ */
+static inline uint16_t hci_cmd_create_le_create_connection(uint8_t * hci_cmd_buffer, uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t initiator_filter_policy, uint8_t peer_address_type, const bd_addr_t peer_address, uint8_t own_address_type, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_ce_length, uint16_t maximum_ce_length){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_CREATE_CONNECTION);
+    hci_cmd_buffer[2] = 25;
+    little_endian_store_16(hci_cmd_buffer, 3, le_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 5, le_scan_window);
+    hci_cmd_buffer[7] = initiator_filter_policy;
+    hci_cmd_buffer[8] = peer_address_type;
+    reverse_bd_addr(peer_address, &hci_cmd_buffer[9]);
+    hci_cmd_buffer[15] = own_address_type;
+    little_endian_store_16(hci_cmd_buffer, 16, conn_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 18, conn_interval_max);
+    little_endian_store_16(hci_cmd_buffer, 20, conn_latency);
+    little_endian_store_16(hci_cmd_buffer, 22, supervision_timeout);
+    little_endian_store_16(hci_cmd_buffer, 24, minimum_ce_length);
+    little_endian_store_16(hci_cmd_buffer, 26, maximum_ce_length);
+    return 28;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_CREATE_CONNECTION_CANCEL in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_create_connection_cancel(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_WHITE_LIST_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_white_list_size(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_CLEAR_WHITE_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_clear_white_list(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_CLEAR_WHITE_LIST);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_ADD_DEVICE_TO_WHITE_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param address_type
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type 1B
+ */
+static inline uint16_t hci_cmd_create_le_add_device_to_white_list(uint8_t * hci_cmd_buffer, uint8_t address_type, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST);
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = address_type;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[4]);
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_REMOVE_DEVICE_FROM_WHITE_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param address_type
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type 1B
+ */
+static inline uint16_t hci_cmd_create_le_remove_device_from_white_list(uint8_t * hci_cmd_buffer, uint8_t address_type, const bd_addr_t bd_addr){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_WHITE_LIST);
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = address_type;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[4]);
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_CONNECTION_UPDATE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @param conn_interval_min
+ * @param conn_interval_max
+ * @param conn_latency
+ * @param supervision_timeout
+ * @param minimum_ce_length
+ * @param maximum_ce_length
+ * @return size of HCI Command
+ * @note: btstack_type H222222
+ */
+static inline uint16_t hci_cmd_create_le_connection_update(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_ce_length, uint16_t maximum_ce_length){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_CONNECTION_UPDATE);
+    hci_cmd_buffer[2] = 14;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    little_endian_store_16(hci_cmd_buffer, 5, conn_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 7, conn_interval_max);
+    little_endian_store_16(hci_cmd_buffer, 9, conn_latency);
+    little_endian_store_16(hci_cmd_buffer, 11, supervision_timeout);
+    little_endian_store_16(hci_cmd_buffer, 13, minimum_ce_length);
+    little_endian_store_16(hci_cmd_buffer, 15, maximum_ce_length);
+    return 17;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_HOST_CHANNEL_CLASSIFICATION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param channel_map_lower_32bits
+ * @param channel_map_higher_5bits
+ * @return size of HCI Command
+ * @note: btstack_type 41
+ */
+static inline uint16_t hci_cmd_create_le_set_host_channel_classification(uint8_t * hci_cmd_buffer, uint32_t channel_map_lower_32bits, uint8_t channel_map_higher_5bits){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_HOST_CHANNEL_CLASSIFICATION);
+    hci_cmd_buffer[2] = 5;
+    little_endian_store_32(hci_cmd_buffer, 3, channel_map_lower_32bits);
+    hci_cmd_buffer[7] = channel_map_higher_5bits;
+    return 8;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_CHANNEL_MAP in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_le_read_channel_map(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_CHANNEL_MAP);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_REMOTE_USED_FEATURES in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_le_read_remote_used_features(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_REMOTE_USED_FEATURES);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_ENCRYPT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param key
+ * @param plain_text
+ * @return size of HCI Command
+ * @note: btstack_type PP
+ */
+static inline uint16_t hci_cmd_create_le_encrypt(uint8_t * hci_cmd_buffer, const uint8_t * key, const uint8_t * plain_text){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_ENCRYPT);
+    hci_cmd_buffer[2] = 32;
+    (void)memcpy(&hci_cmd_buffer[3], key, 16);
+    (void)memcpy(&hci_cmd_buffer[19], plain_text, 16);
+    return 35;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_RAND in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_rand(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_RAND);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_START_ENCRYPTION in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @param random_number_lower_32bits
+ * @param random_number_higher_32bits
+ * @param encryption_diversifier
+ * @param long_term_key
+ * @return size of HCI Command
+ * @note: btstack_type H442P
+ */
+static inline uint16_t hci_cmd_create_le_start_encryption(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle, uint32_t random_number_lower_32bits, uint32_t random_number_higher_32bits, uint16_t encryption_diversifier, const uint8_t * long_term_key){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_START_ENCRYPTION);
+    hci_cmd_buffer[2] = 28;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    little_endian_store_32(hci_cmd_buffer, 5, random_number_lower_32bits);
+    little_endian_store_32(hci_cmd_buffer, 9, random_number_higher_32bits);
+    little_endian_store_16(hci_cmd_buffer, 13, encryption_diversifier);
+    (void)memcpy(&hci_cmd_buffer[15], long_term_key, 16);
+    return 31;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_LONG_TERM_KEY_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param connection_handle
+ * @param long_term_key
+ * @return size of HCI Command
+ * @note: btstack_type HP
+ */
+static inline uint16_t hci_cmd_create_le_long_term_key_request_reply(uint8_t * hci_cmd_buffer, hci_con_handle_t connection_handle, const uint8_t * long_term_key){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_LONG_TERM_KEY_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 18;
+    little_endian_store_16(hci_cmd_buffer, 3, connection_handle);
+    (void)memcpy(&hci_cmd_buffer[5], long_term_key, 16);
+    return 21;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_LONG_TERM_KEY_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_le_long_term_key_negative_reply(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_LONG_TERM_KEY_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_SUPPORTED_STATES in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_le_read_supported_states(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_SUPPORTED_STATES);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_RECEIVER_TEST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param rx_frequency
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_le_receiver_test(uint8_t * hci_cmd_buffer, uint8_t rx_frequency){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_RECEIVER_TEST);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = rx_frequency;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_TRANSMITTER_TEST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param tx_frequency
+ * @param test_payload_lengh
+ * @param packet_payload
+ * @return size of HCI Command
+ * @note: btstack_type 111
+ */
+static inline uint16_t hci_cmd_create_le_transmitter_test(uint8_t * hci_cmd_buffer, uint8_t tx_frequency, uint8_t test_payload_lengh, uint8_t packet_payload){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_TRANSMITTER_TEST);
+    hci_cmd_buffer[2] = 3;
+    hci_cmd_buffer[3] = tx_frequency;
+    hci_cmd_buffer[4] = test_payload_lengh;
+    hci_cmd_buffer[5] = packet_payload;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_TEST_END in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param end_test_cmd
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_le_test_end(uint8_t * hci_cmd_buffer, uint8_t end_test_cmd){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_TEST_END);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = end_test_cmd;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @param conn_interval_min
+ * @param conn_interval_max
+ * @param conn_latency
+ * @param supervision_timeout
+ * @param minimum_ce_length
+ * @param maximum_ce_length
+ * @return size of HCI Command
+ * @note: btstack_type H222222
+ */
+static inline uint16_t hci_cmd_create_le_remote_connection_parameter_request_reply(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_ce_length, uint16_t maximum_ce_length){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_REPLY);
+    hci_cmd_buffer[2] = 14;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    little_endian_store_16(hci_cmd_buffer, 5, conn_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 7, conn_interval_max);
+    little_endian_store_16(hci_cmd_buffer, 9, conn_latency);
+    little_endian_store_16(hci_cmd_buffer, 11, supervision_timeout);
+    little_endian_store_16(hci_cmd_buffer, 13, minimum_ce_length);
+    little_endian_store_16(hci_cmd_buffer, 15, maximum_ce_length);
+    return 17;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_NEGATIVE_REPLY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param con_handle
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_cmd_create_le_remote_connection_parameter_request_negative_reply(uint8_t * hci_cmd_buffer, hci_con_handle_t con_handle, uint8_t reason){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_REMOTE_CONNECTION_PARAMETER_REQUEST_NEGATIVE_REPLY);
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, con_handle);
+    hci_cmd_buffer[5] = reason;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_DATA_LENGTH in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param con_handle
+ * @param tx_octets
+ * @param tx_time
+ * @return size of HCI Command
+ * @note: btstack_type H22
+ */
+static inline uint16_t hci_cmd_create_le_set_data_length(uint8_t * hci_cmd_buffer, hci_con_handle_t con_handle, uint16_t tx_octets, uint16_t tx_time){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_DATA_LENGTH);
+    hci_cmd_buffer[2] = 6;
+    little_endian_store_16(hci_cmd_buffer, 3, con_handle);
+    little_endian_store_16(hci_cmd_buffer, 5, tx_octets);
+    little_endian_store_16(hci_cmd_buffer, 7, tx_time);
+    return 9;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_suggested_default_data_length(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_WRITE_SUGGESTED_DEFAULT_DATA_LENGTH in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param suggested_max_tx_octets
+ * @param suggested_max_tx_time
+ * @return size of HCI Command
+ * @note: btstack_type 22
+ */
+static inline uint16_t hci_cmd_create_le_write_suggested_default_data_length(uint8_t * hci_cmd_buffer, uint16_t suggested_max_tx_octets, uint16_t suggested_max_tx_time){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_WRITE_SUGGESTED_DEFAULT_DATA_LENGTH);
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, suggested_max_tx_octets);
+    little_endian_store_16(hci_cmd_buffer, 5, suggested_max_tx_time);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_LOCAL_P256_PUBLIC_KEY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_local_p256_public_key(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_LOCAL_P256_PUBLIC_KEY);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_GENERATE_DHKEY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param public_key_x
+ * @param public_key_y
+ * @return size of HCI Command
+ * @note: btstack_type QQ
+ */
+static inline uint16_t hci_cmd_create_le_generate_dhkey(uint8_t * hci_cmd_buffer, const uint8_t * public_key_x, const uint8_t * public_key_y){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_GENERATE_DHKEY);
+    hci_cmd_buffer[2] = 64;
+    reverse_bytes(public_key_x, &hci_cmd_buffer[3], 32);
+    reverse_bytes(public_key_y, &hci_cmd_buffer[35], 32);
+    return 67;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_ADD_DEVICE_TO_RESOLVING_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param peer_identity_address_type
+ * @param peer_identity_address
+ * @param peer_irk
+ * @param local_irk
+ * @return size of HCI Command
+ * @note: btstack_type 1BPP
+ */
+static inline uint16_t hci_cmd_create_le_add_device_to_resolving_list(uint8_t * hci_cmd_buffer, uint8_t peer_identity_address_type, const bd_addr_t peer_identity_address, const uint8_t * peer_irk, const uint8_t * local_irk){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_RESOLVING_LIST);
+    hci_cmd_buffer[2] = 39;
+    hci_cmd_buffer[3] = peer_identity_address_type;
+    reverse_bd_addr(peer_identity_address, &hci_cmd_buffer[4]);
+    (void)memcpy(&hci_cmd_buffer[10], peer_irk, 16);
+    (void)memcpy(&hci_cmd_buffer[26], local_irk, 16);
+    return 42;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_REMOVE_DEVICE_FROM_RESOLVING_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param peer_identity_address_type
+ * @param peer_identity_address
+ * @return size of HCI Command
+ * @note: btstack_type 1B
+ */
+static inline uint16_t hci_cmd_create_le_remove_device_from_resolving_list(uint8_t * hci_cmd_buffer, uint8_t peer_identity_address_type, const bd_addr_t peer_identity_address){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_REMOVE_DEVICE_FROM_RESOLVING_LIST);
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = peer_identity_address_type;
+    reverse_bd_addr(peer_identity_address, &hci_cmd_buffer[4]);
+    return 10;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_CLEAR_RESOLVING_LIST in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_clear_resolving_list(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_CLEAR_RESOLVING_LIST);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_RESOLVING_LIST_SIZE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_resolving_list_size(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_RESOLVING_LIST_SIZE);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_PEER_RESOLVABLE_ADDRESS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_peer_resolvable_address(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_PEER_RESOLVABLE_ADDRESS);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_LOCAL_RESOLVABLE_ADDRESS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_local_resolvable_address(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_LOCAL_RESOLVABLE_ADDRESS);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_ADDRESS_RESOLUTION_ENABLED in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param address_resolution_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_cmd_create_le_set_address_resolution_enabled(uint8_t * hci_cmd_buffer, uint8_t address_resolution_enable){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_ADDRESS_RESOLUTION_ENABLED);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = address_resolution_enable;
+    return 4;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_RESOLVABLE_PRIVATE_ADDRESS_TIMEOUT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param rpa_timeout
+ * @return size of HCI Command
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_cmd_create_le_set_resolvable_private_address_timeout(uint8_t * hci_cmd_buffer, uint16_t rpa_timeout){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_RESOLVABLE_PRIVATE_ADDRESS_TIMEOUT);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, rpa_timeout);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_MAXIMUM_DATA_LENGTH in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_le_read_maximum_data_length(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_READ_PHY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param con_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_le_read_phy(uint8_t * hci_cmd_buffer, hci_con_handle_t con_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_READ_PHY);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, con_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_DEFAULT_PHY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param all_phys
+ * @param tx_phys
+ * @param rx_phys
+ * @return size of HCI Command
+ * @note: btstack_type 111
+ */
+static inline uint16_t hci_cmd_create_le_set_default_phy(uint8_t * hci_cmd_buffer, uint8_t all_phys, uint8_t tx_phys, uint8_t rx_phys){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_DEFAULT_PHY);
+    hci_cmd_buffer[2] = 3;
+    hci_cmd_buffer[3] = all_phys;
+    hci_cmd_buffer[4] = tx_phys;
+    hci_cmd_buffer[5] = rx_phys;
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_LE_SET_PHY in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param con_handle
+ * @param all_phys
+ * @param tx_phys
+ * @param rx_phys
+ * @param phy_options
+ * @return size of HCI Command
+ * @note: btstack_type H1111
+ */
+static inline uint16_t hci_cmd_create_le_set_phy(uint8_t * hci_cmd_buffer, hci_con_handle_t con_handle, uint8_t all_phys, uint8_t tx_phys, uint8_t rx_phys, uint8_t phy_options){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_LE_SET_PHY);
+    hci_cmd_buffer[2] = 6;
+    little_endian_store_16(hci_cmd_buffer, 3, con_handle);
+    hci_cmd_buffer[5] = all_phys;
+    hci_cmd_buffer[6] = tx_phys;
+    hci_cmd_buffer[7] = rx_phys;
+    hci_cmd_buffer[8] = phy_options;
+    return 9;
+}
+
+#endif
+
+/**
+ * @brief Create HCI Command HCI_BCM_ENABLE_WBS in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param enable_wbs
+ * @param uuid_wbs
+ * @return size of HCI Command
+ * @note: btstack_type 12
+ */
+static inline uint16_t hci_cmd_create_bcm_enable_wbs(uint8_t * hci_cmd_buffer, uint8_t enable_wbs, uint16_t uuid_wbs){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_ENABLE_WBS);
+    hci_cmd_buffer[2] = 3;
+    hci_cmd_buffer[3] = enable_wbs;
+    little_endian_store_16(hci_cmd_buffer, 4, uuid_wbs);
+    return 6;
+}
+
+/**
+ * @brief Create HCI Command HCI_BCM_WRITE_SCO_PCM_INT in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param sco_routing
+ * @param pcm_interface_rate
+ * @param frame_type
+ * @param sync_mode
+ * @param clock_mode
+ * @return size of HCI Command
+ * @note: btstack_type 11111
+ */
+static inline uint16_t hci_cmd_create_bcm_write_sco_pcm_int(uint8_t * hci_cmd_buffer, uint8_t sco_routing, uint8_t pcm_interface_rate, uint8_t frame_type, uint8_t sync_mode, uint8_t clock_mode){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_WRITE_SCO_PCM_INT);
+    hci_cmd_buffer[2] = 5;
+    hci_cmd_buffer[3] = sco_routing;
+    hci_cmd_buffer[4] = pcm_interface_rate;
+    hci_cmd_buffer[5] = frame_type;
+    hci_cmd_buffer[6] = sync_mode;
+    hci_cmd_buffer[7] = clock_mode;
+    return 8;
+}
+
+/**
+ * @brief Create HCI Command HCI_BCM_WRITE_I2SPCM_INTERFACE_PARAM in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param arg1
+ * @param arg2
+ * @param arg3
+ * @param arg4
+ * @return size of HCI Command
+ * @note: btstack_type 1111
+ */
+static inline uint16_t hci_cmd_create_bcm_write_i2spcm_interface_param(uint8_t * hci_cmd_buffer, uint8_t arg1, uint8_t arg2, uint8_t arg3, uint8_t arg4){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_WRITE_I2SPCM_INTERFACE_PARAM);
+    hci_cmd_buffer[2] = 4;
+    hci_cmd_buffer[3] = arg1;
+    hci_cmd_buffer[4] = arg2;
+    hci_cmd_buffer[5] = arg3;
+    hci_cmd_buffer[6] = arg4;
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_BCM_SET_SLEEP_MODE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param sleep_mode
+ * @param idle_threshold_host
+ * @param idle_threshold_controller
+ * @param bt_wake_active_mode
+ * @param host_wake_active_mode
+ * @param allow_host_sleep_during_sco
+ * @param combine_sleep_mode_and_lpm
+ * @param enable_tristate_control_of_uart_tx_line
+ * @param active_connection_handling_on_suspend
+ * @param resume_timeout
+ * @param enable_break_to_host
+ * @param pulsed_host_wake
+ * @return size of HCI Command
+ * @note: btstack_type 111111111111
+ */
+static inline uint16_t hci_cmd_create_bcm_set_sleep_mode(uint8_t * hci_cmd_buffer, uint8_t sleep_mode, uint8_t idle_threshold_host, uint8_t idle_threshold_controller, uint8_t bt_wake_active_mode, uint8_t host_wake_active_mode, uint8_t allow_host_sleep_during_sco, uint8_t combine_sleep_mode_and_lpm, uint8_t enable_tristate_control_of_uart_tx_line, uint8_t active_connection_handling_on_suspend, uint8_t resume_timeout, uint8_t enable_break_to_host, uint8_t pulsed_host_wake){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_SET_SLEEP_MODE);
+    hci_cmd_buffer[2] = 12;
+    hci_cmd_buffer[3] = sleep_mode;
+    hci_cmd_buffer[4] = idle_threshold_host;
+    hci_cmd_buffer[5] = idle_threshold_controller;
+    hci_cmd_buffer[6] = bt_wake_active_mode;
+    hci_cmd_buffer[7] = host_wake_active_mode;
+    hci_cmd_buffer[8] = allow_host_sleep_during_sco;
+    hci_cmd_buffer[9] = combine_sleep_mode_and_lpm;
+    hci_cmd_buffer[10] = enable_tristate_control_of_uart_tx_line;
+    hci_cmd_buffer[11] = active_connection_handling_on_suspend;
+    hci_cmd_buffer[12] = resume_timeout;
+    hci_cmd_buffer[13] = enable_break_to_host;
+    hci_cmd_buffer[14] = pulsed_host_wake;
+    return 15;
+}
+
+/**
+ * @brief Create HCI Command HCI_BCM_WRITE_TX_POWER_TABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param is_le
+ * @param chip_max_tx_pwr_db
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_cmd_create_bcm_write_tx_power_table(uint8_t * hci_cmd_buffer, uint8_t is_le, uint8_t chip_max_tx_pwr_db){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_WRITE_TX_POWER_TABLE);
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = is_le;
+    hci_cmd_buffer[4] = chip_max_tx_pwr_db;
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_BCM_SET_TX_PWR in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param arg1
+ * @param arg2
+ * @param arg3
+ * @return size of HCI Command
+ * @note: btstack_type 11H
+ */
+static inline uint16_t hci_cmd_create_bcm_set_tx_pwr(uint8_t * hci_cmd_buffer, uint8_t arg1, uint8_t arg2, hci_con_handle_t arg3){
+    little_endian_store_16(hci_cmd_buffer, 0, HCI_OPCODE_HCI_BCM_SET_TX_PWR);
+    hci_cmd_buffer[2] = 4;
+    hci_cmd_buffer[3] = arg1;
+    hci_cmd_buffer[4] = arg2;
+    little_endian_store_16(hci_cmd_buffer, 5, arg3);
+    return 7;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_DRPB_TESTER_CON_TX in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param modulation
+ * @param test_patern
+ * @param frequency
+ * @param power_level
+ * @param reserved1
+ * @param reserved2
+ * @return size of HCI Command
+ * @note: btstack_type 111144
+ */
+static inline uint16_t hci_cmd_create_ti_drpb_tester_con_tx(uint8_t * hci_cmd_buffer, uint8_t modulation, uint8_t test_patern, uint8_t frequency, uint8_t power_level, uint32_t reserved1, uint32_t reserved2){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD84);
+    hci_cmd_buffer[2] = 12;
+    hci_cmd_buffer[3] = modulation;
+    hci_cmd_buffer[4] = test_patern;
+    hci_cmd_buffer[5] = frequency;
+    hci_cmd_buffer[6] = power_level;
+    little_endian_store_32(hci_cmd_buffer, 7, reserved1);
+    little_endian_store_32(hci_cmd_buffer, 11, reserved2);
+    return 15;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_DRPB_TESTER_PACKET_TX_RX in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param arg1
+ * @param arg2
+ * @param arg3
+ * @param arg4
+ * @param arg5
+ * @param arg6
+ * @param arg7
+ * @param arg8
+ * @param arg9
+ * @param arg10
+ * @return size of HCI Command
+ * @note: btstack_type 1111112112
+ */
+static inline uint16_t hci_cmd_create_ti_drpb_tester_packet_tx_rx(uint8_t * hci_cmd_buffer, uint8_t arg1, uint8_t arg2, uint8_t arg3, uint8_t arg4, uint8_t arg5, uint8_t arg6, uint16_t arg7, uint8_t arg8, uint8_t arg9, uint16_t arg10){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD85);
+    hci_cmd_buffer[2] = 12;
+    hci_cmd_buffer[3] = arg1;
+    hci_cmd_buffer[4] = arg2;
+    hci_cmd_buffer[5] = arg3;
+    hci_cmd_buffer[6] = arg4;
+    hci_cmd_buffer[7] = arg5;
+    hci_cmd_buffer[8] = arg6;
+    little_endian_store_16(hci_cmd_buffer, 9, arg7);
+    hci_cmd_buffer[11] = arg8;
+    hci_cmd_buffer[12] = arg9;
+    little_endian_store_16(hci_cmd_buffer, 13, arg10);
+    return 15;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_AVRP_ENABLE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param enable
+ * @param a3dp_role
+ * @param code_upload
+ * @param reserved
+ * @return size of HCI Command
+ * @note: btstack_type 1112
+ */
+static inline uint16_t hci_cmd_create_ti_avrp_enable(uint8_t * hci_cmd_buffer, uint8_t enable, uint8_t a3dp_role, uint8_t code_upload, uint16_t reserved){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD92);
+    hci_cmd_buffer[2] = 5;
+    hci_cmd_buffer[3] = enable;
+    hci_cmd_buffer[4] = a3dp_role;
+    hci_cmd_buffer[5] = code_upload;
+    little_endian_store_16(hci_cmd_buffer, 6, reserved);
+    return 8;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_WBS_ASSOCIATE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param acl_con_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_cmd_create_ti_wbs_associate(uint8_t * hci_cmd_buffer, hci_con_handle_t acl_con_handle){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD78);
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, acl_con_handle);
+    return 5;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_WBS_DISASSOCIATE in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_cmd_create_ti_wbs_disassociate(uint8_t * hci_cmd_buffer){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD79);
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Create HCI Command HCI_TI_WRITE_CODEC_CONFIG in hci_cmd_buffer
+ * @param hci_cmd_buffer
+ * @param clock_rate
+ * @param clock_direction
+ * @param frame_sync_frequency
+ * @param frame_sync_duty_cycle
+ * @param frame_sync_edge
+ * @param frame_sync_polariy
+ * @param reserved1
+ * @param channel_1_data_out_size
+ * @param channel_1_data_out_offset
+ * @param channel_1_data_out_edge
+ * @param channel_1_data_in_size
+ * @param channel_1_data_in_offset
+ * @param channel_1_data_in_edge
+ * @param fsync_multiplier
+ * @param channel_2_data_out_size
+ * @param channel_2_data_out_offset
+ * @param channel_2_data_out_edge
+ * @param channel_2_data_in_size
+ * @param channel_2_data_in_offset
+ * @param channel_2_data_in_edge
+ * @param reserved2
+ * @return size of HCI Command
+ * @note: btstack_type 214211122122112212211
+ */
+static inline uint16_t hci_cmd_create_ti_write_codec_config(uint8_t * hci_cmd_buffer, uint16_t clock_rate, uint8_t clock_direction, uint32_t frame_sync_frequency, uint16_t frame_sync_duty_cycle, uint8_t frame_sync_edge, uint8_t frame_sync_polariy, uint8_t reserved1, uint16_t channel_1_data_out_size, uint16_t channel_1_data_out_offset, uint8_t channel_1_data_out_edge, uint16_t channel_1_data_in_size, uint16_t channel_1_data_in_offset, uint8_t channel_1_data_in_edge, uint8_t fsync_multiplier, uint16_t channel_2_data_out_size, uint16_t channel_2_data_out_offset, uint8_t channel_2_data_out_edge, uint16_t channel_2_data_in_size, uint16_t channel_2_data_in_offset, uint8_t channel_2_data_in_edge, uint8_t reserved2){
+    little_endian_store_16(hci_cmd_buffer, 0, 0xFD06);
+    hci_cmd_buffer[2] = 34;
+    little_endian_store_16(hci_cmd_buffer, 3, clock_rate);
+    hci_cmd_buffer[5] = clock_direction;
+    little_endian_store_32(hci_cmd_buffer, 6, frame_sync_frequency);
+    little_endian_store_16(hci_cmd_buffer, 10, frame_sync_duty_cycle);
+    hci_cmd_buffer[12] = frame_sync_edge;
+    hci_cmd_buffer[13] = frame_sync_polariy;
+    hci_cmd_buffer[14] = reserved1;
+    little_endian_store_16(hci_cmd_buffer, 15, channel_1_data_out_size);
+    little_endian_store_16(hci_cmd_buffer, 17, channel_1_data_out_offset);
+    hci_cmd_buffer[19] = channel_1_data_out_edge;
+    little_endian_store_16(hci_cmd_buffer, 20, channel_1_data_in_size);
+    little_endian_store_16(hci_cmd_buffer, 22, channel_1_data_in_offset);
+    hci_cmd_buffer[24] = channel_1_data_in_edge;
+    hci_cmd_buffer[25] = fsync_multiplier;
+    little_endian_store_16(hci_cmd_buffer, 26, channel_2_data_out_size);
+    little_endian_store_16(hci_cmd_buffer, 28, channel_2_data_out_offset);
+    hci_cmd_buffer[30] = channel_2_data_out_edge;
+    little_endian_store_16(hci_cmd_buffer, 31, channel_2_data_in_size);
+    little_endian_store_16(hci_cmd_buffer, 33, channel_2_data_in_offset);
+    hci_cmd_buffer[35] = channel_2_data_in_edge;
+    hci_cmd_buffer[36] = reserved2;
+    return 37;
+}
+
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // HCI_CMD_ENCODER_H
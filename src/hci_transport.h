@@ -49,6 +49,7 @@
 #include <stdint.h>
 #include "btstack_uart_block.h"
 #include "btstack_em9304_spi.h"
+#include "bluetooth.h"
 #include "btstack_defines.h"
 
 #if defined __cplusplus
@@ -172,6 +173,42 @@ const hci_transport_t * hci_transport_usb_instance(void);
  */
 void hci_transport_usb_set_path(int len, uint8_t * port_numbers);
 
+/*
+ * @brief Setup virtual transport with in-process Controller model
+ */
+const hci_transport_t * hci_transport_virtual_instance(void);
+
+/**
+ * @brief Set BD_ADDR of virtual Controller, use different addresses for Controllers connected via air interface
+ * @param addr
+ */
+void hci_transport_virtual_set_bd_addr(const bd_addr_t addr);
+
+/**
+ * @brief Set rate for outgoing ACL packets of virtual Controller
+ * @param bits_per_second, default 1000000
+ */
+void hci_transport_virtual_set_link_rate(uint32_t bits_per_second);
+
+/**
+ * @brief Set time between transmission of an ACL packet and its reception by the peer
+ * @param latency_ms, default 0
+ */
+void hci_transport_virtual_set_link_latency(uint32_t latency_ms);
+
+/**
+ * @brief Register function to send PDUs to peer Controller
+ * @param send_pdu, PDU needs to be passed to hci_transport_virtual_receive_pdu of peer
+ */
+void hci_transport_virtual_set_air_interface(void (*send_pdu)(const uint8_t * pdu, uint16_t size));
+
+/**
+ * @brief Process PDU received from peer Controller
+ * @param pdu
+ * @param size
+ */
+void hci_transport_virtual_receive_pdu(const uint8_t * pdu, uint16_t size);
+
 /* API_END */
     
 #if defined __cplusplus
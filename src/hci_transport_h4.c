@@ -138,6 +138,35 @@ static uint16_t  ehcill_tx_len;   // 0 == no outgoing packet
 
 static  void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size) = dummy_handler;
 
+#ifdef ENABLE_H4_TX_AGGREGATION
+#ifdef ENABLE_EHCILL
+#error "ENABLE_H4_TX_AGGREGATION cannot be combined with ENABLE_EHCILL"
+#endif
+#ifndef HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE
+#define HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE (4 * (1 + HCI_OUTGOING_PACKET_BUFFER_SIZE))
+#endif
+#if HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE < (1 + HCI_OUTGOING_PACKET_BUFFER_SIZE)
+#error HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE must be at least 1 + HCI_OUTGOING_PACKET_BUFFER_SIZE
+#endif
+// max time an ACL or SCO packet waits for more packets if UART is idle
+#ifndef HCI_TRANSPORT_H4_TX_AGGREGATION_DELAY_MS
+#define HCI_TRANSPORT_H4_TX_AGGREGATION_DELAY_MS 0
+#endif
+// packets are copied into collect buffer while the other buffer is sent
+static uint8_t  tx_aggregation_buffers[2][HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE];
+static uint8_t  tx_aggregation_collect_index;
+static uint16_t tx_aggregation_len;
+// ACL and SCO packets copied but not reported as sent yet
+static uint16_t tx_aggregation_sent_events_pending;
+// HCI commands are reported as sent when the block containing them was sent
+static uint16_t tx_aggregation_commands_collected;
+static uint16_t tx_aggregation_commands_sending;
+// can_send_now was refused as buffer was full, report packet sent when buffer was flushed
+static bool     tx_aggregation_can_send_refused;
+static btstack_timer_source_t tx_aggregation_sent_timer;
+static btstack_timer_source_t tx_aggregation_flush_timer;
+#endif
+
 // packet reader state machine
 static  H4_STATE h4_state;
 static uint16_t bytes_to_read;
@@ -147,6 +176,24 @@ static uint16_t read_pos;
 static uint8_t hci_packet_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + HCI_INCOMING_PACKET_BUFFER_SIZE + 1]; // packet type + max(acl header + acl payload, event header + event data)
 static uint8_t * hci_packet = &hci_packet_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
 
+#ifdef ENABLE_H4_BULK_READ
+// bulk read buffer, holds at least one complete packet
+#ifndef HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE
+#define HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE (2 * (1 + HCI_INCOMING_PACKET_BUFFER_SIZE))
+#endif
+#if HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE < (1 + HCI_INCOMING_PACKET_BUFFER_SIZE)
+#error HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE must be at least 1 + HCI_INCOMING_PACKET_BUFFER_SIZE
+#endif
+#ifdef ENABLE_BAUDRATE_CHANGE_FLOWCONTROL_BUG_WORKAROUND
+#error "ENABLE_H4_BULK_READ cannot be combined with the baudrate change flowcontrol workaround"
+#endif
+// packets are delivered in place, bytes before a packet are free to be used as pre-buffer
+// spare byte after the buffer as packet handlers may zero-terminate the packet, e.g. for the local name
+static uint8_t  hci_bulk_read_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE + 1];
+static uint8_t * hci_bulk_read_buffer = &hci_bulk_read_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
+static uint16_t hci_bulk_read_len;
+#endif
+
 // Baudrate change bugs in TI CC256x and CYW20704
 #ifdef ENABLE_CC256X_BAUDRATE_CHANGE_FLOWCONTROL_BUG_WORKAROUND
 #define ENABLE_BAUDRATE_CHANGE_FLOWCONTROL_BUG_WORKAROUND
@@ -321,9 +368,194 @@ static void hci_transport_h4_block_read(void){
     }
 }
 
-static void hci_transport_h4_block_sent(void){
+#ifdef ENABLE_H4_BULK_READ
+static void hci_transport_h4_bulk_trigger_next_read(void){
+    btstack_uart->receive_available(&hci_bulk_read_buffer[hci_bulk_read_len], HCI_TRANSPORT_H4_BULK_READ_BUFFER_SIZE - hci_bulk_read_len);
+}
+
+// returns size of packet type + header or 0 if packet type is invalid
+static uint16_t hci_transport_h4_bulk_header_size(uint8_t packet_type){
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            return 1 + HCI_EVENT_HEADER_SIZE;
+        case HCI_ACL_DATA_PACKET:
+            return 1 + HCI_ACL_HEADER_SIZE;
+        case HCI_SCO_DATA_PACKET:
+            return 1 + HCI_SCO_HEADER_SIZE;
+        default:
+            return 0;
+    }
+}
+
+static uint16_t hci_transport_h4_bulk_payload_size(const uint8_t * packet){
+    switch (packet[0]){
+        case HCI_EVENT_PACKET:
+            return packet[2];
+        case HCI_ACL_DATA_PACKET:
+            return little_endian_read_16(packet, 3);
+        case HCI_SCO_DATA_PACKET:
+            return packet[3];
+        default:
+            btstack_assert(false);
+            return 0;
+    }
+}
+
+static void hci_transport_h4_bulk_data_received(uint16_t size){
+    hci_bulk_read_len += size;
+
+    // deliver all complete packets back to back
+    uint16_t pos = 0;
+    while (h4_state != H4_OFF){
+        uint16_t available = hci_bulk_read_len - pos;
+        if (available == 0u) break;
+        uint8_t * packet = &hci_bulk_read_buffer[pos];
+        uint16_t header_size = hci_transport_h4_bulk_header_size(packet[0]);
+        if (header_size == 0u){
+#ifdef ENABLE_EHCILL
+            switch (packet[0]){
+                case EHCILL_GO_TO_SLEEP_IND:
+                case EHCILL_GO_TO_SLEEP_ACK:
+                case EHCILL_WAKE_UP_IND:
+                case EHCILL_WAKE_UP_ACK:
+                    pos++;
+                    hci_transport_h4_ehcill_handle_command(packet[0]);
+                    continue;
+                default:
+                    break;
+            }
+#endif
+            log_error("hci_transport_h4: invalid packet type 0x%02x", packet[0]);
+            pos++;
+            continue;
+        }
+        if (available < header_size) break;
+        uint16_t payload_size = hci_transport_h4_bulk_payload_size(packet);
+        if (payload_size > (HCI_INCOMING_PACKET_BUFFER_SIZE - (header_size - 1u))){
+            log_error("hci_transport_h4: invalid payload len %u - only space for %u", payload_size, HCI_INCOMING_PACKET_BUFFER_SIZE - (header_size - 1u));
+            pos += header_size;
+            continue;
+        }
+        uint16_t packet_size = header_size + payload_size;
+        if (available < packet_size) break;
+        pos += packet_size;
+        // byte after packet belongs to next packet, restore it in case the packet handler wrote to it
+        uint8_t next_byte = packet[packet_size];
+        packet_handler(packet[0], &packet[1], packet_size - 1u);
+        packet[packet_size] = next_byte;
+    }
+
+    // transport might have been closed by packet handler
+    if (h4_state == H4_OFF) return;
+
+    // keep partial packet
+    hci_bulk_read_len -= pos;
+    if (hci_bulk_read_len > 0u){
+        memmove(hci_bulk_read_buffer, &hci_bulk_read_buffer[pos], hci_bulk_read_len);
+    }
+    hci_transport_h4_bulk_trigger_next_read();
+}
+#endif
+
+static void hci_transport_h4_start_reading(void){
+    hci_transport_h4_reset_statemachine();
+#ifdef ENABLE_H4_BULK_READ
+    // use bulk read if supported by UART driver
+    if (btstack_uart->receive_available != NULL){
+        hci_bulk_read_len = 0;
+        hci_transport_h4_bulk_trigger_next_read();
+        return;
+    }
+#endif
+    hci_transport_h4_trigger_next_read();
+}
+
+static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+
+#ifdef ENABLE_H4_TX_AGGREGATION
+static void hci_transport_h4_tx_aggregation_flush(void){
+    // collected packets are sent when current block is done
+    if (tx_state != TX_IDLE) return;
+    if (tx_aggregation_len == 0u) return;
+    btstack_run_loop_remove_timer(&tx_aggregation_flush_timer);
+    uint8_t * buffer = tx_aggregation_buffers[tx_aggregation_collect_index];
+    uint16_t  len    = tx_aggregation_len;
+    tx_aggregation_collect_index ^= 1u;
+    tx_aggregation_len = 0;
+    tx_aggregation_commands_sending = tx_aggregation_commands_collected;
+    tx_aggregation_commands_collected = 0;
+    tx_state = TX_W4_PACKET_SENT;
+    btstack_uart->send_block(buffer, len);
+}
+
+static void hci_transport_h4_tx_aggregation_flush_timer_handler(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    hci_transport_h4_tx_aggregation_flush();
+}
+
+static void hci_transport_h4_tx_aggregation_sent_timer_handler(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    // packet handler might send next packet, which gets reported in this loop
+    while ((tx_aggregation_sent_events_pending > 0u) && (tx_state != TX_OFF)){
+        tx_aggregation_sent_events_pending--;
+        packet_handler(HCI_EVENT_PACKET, (uint8_t *) &packet_sent_event[0], sizeof(packet_sent_event));
+    }
+}
+
+// space for another packet of max size
+static bool hci_transport_h4_tx_aggregation_has_space(void){
+    uint16_t space = HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE - tx_aggregation_len;
+    return space >= (1u + HCI_OUTGOING_PACKET_BUFFER_SIZE);
+}
+
+static int hci_transport_h4_tx_aggregation_add(uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    if ((tx_aggregation_len + size) > HCI_TRANSPORT_H4_TX_AGGREGATION_BUFFER_SIZE){
+        log_error("hci_transport_h4: no space for packet of size %u", size);
+        return -1;
+    }
+    bool first_packet = tx_aggregation_len == 0u;
+    (void) memcpy(&tx_aggregation_buffers[tx_aggregation_collect_index][tx_aggregation_len], packet, size);
+    tx_aggregation_len += size;
+
+    if (packet_type == HCI_COMMAND_DATA_PACKET){
+        // command is reported as sent from block_sent, e.g. for baud rate change after command was sent
+        tx_aggregation_commands_collected++;
+    } else {
+        // packet was copied, report as sent from run loop to avoid re-entering the stack
+        tx_aggregation_sent_events_pending++;
+        if (tx_aggregation_sent_events_pending == 1u){
+            btstack_run_loop_remove_timer(&tx_aggregation_sent_timer);
+            btstack_run_loop_set_timer_handler(&tx_aggregation_sent_timer, &hci_transport_h4_tx_aggregation_sent_timer_handler);
+            btstack_run_loop_set_timer(&tx_aggregation_sent_timer, 0);
+            btstack_run_loop_add_timer(&tx_aggregation_sent_timer);
+        }
+    }
+
+    // commands are sent right away, ACL and SCO packets wait up to configured delay or until buffer is full
+    if ((packet_type == HCI_COMMAND_DATA_PACKET) || !hci_transport_h4_tx_aggregation_has_space() || (HCI_TRANSPORT_H4_TX_AGGREGATION_DELAY_MS == 0)){
+        hci_transport_h4_tx_aggregation_flush();
+    } else if (first_packet && (tx_state == TX_IDLE)){
+        btstack_run_loop_remove_timer(&tx_aggregation_flush_timer);
+        btstack_run_loop_set_timer_handler(&tx_aggregation_flush_timer, &hci_transport_h4_tx_aggregation_flush_timer_handler);
+        btstack_run_loop_set_timer(&tx_aggregation_flush_timer, HCI_TRANSPORT_H4_TX_AGGREGATION_DELAY_MS);
+        btstack_run_loop_add_timer(&tx_aggregation_flush_timer);
+    }
+    return 0;
+}
+
+static void hci_transport_h4_tx_aggregation_reset(void){
+    btstack_run_loop_remove_timer(&tx_aggregation_sent_timer);
+    btstack_run_loop_remove_timer(&tx_aggregation_flush_timer);
+    tx_aggregation_collect_index = 0;
+    tx_aggregation_len = 0;
+    tx_aggregation_sent_events_pending = 0;
+    tx_aggregation_commands_collected = 0;
+    tx_aggregation_commands_sending = 0;
+    tx_aggregation_can_send_refused = false;
+}
+#endif
 
-    static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+static void hci_transport_h4_block_sent(void){
 
     switch (tx_state){
         case TX_W4_PACKET_SENT:
@@ -333,6 +565,28 @@ static void hci_transport_h4_block_sent(void){
 #endif
             tx_state = TX_IDLE;
 
+#ifdef ENABLE_H4_TX_AGGREGATION
+            {
+                // ACL and SCO packets have been reported as sent when copied, commands are reported now
+                uint16_t commands_sent = tx_aggregation_commands_sending;
+                tx_aggregation_commands_sending = 0;
+                // send packets collected in the meantime
+                hci_transport_h4_tx_aggregation_flush();
+                if (tx_aggregation_can_send_refused && hci_transport_h4_tx_aggregation_has_space()){
+                    tx_aggregation_can_send_refused = false;
+                    if (commands_sent == 0u){
+                        commands_sent = 1;
+                    }
+                }
+                // packet handler might send next packet or close transport
+                while ((commands_sent > 0u) && (tx_state != TX_OFF)){
+                    commands_sent--;
+                    packet_handler(HCI_EVENT_PACKET, (uint8_t *) &packet_sent_event[0], sizeof(packet_sent_event));
+                }
+            }
+            break;
+#endif
+
 #ifdef ENABLE_EHCILL
             // notify eHCILL engine
             hci_transport_h4_ehcill_handle_packet_sent();
@@ -355,7 +609,17 @@ static void hci_transport_h4_block_sent(void){
 
 static int hci_transport_h4_can_send_now(uint8_t packet_type){
     UNUSED(packet_type);
+#ifdef ENABLE_H4_TX_AGGREGATION
+    if (tx_state == TX_OFF) return 0;
+    if (tx_aggregation_sent_events_pending > 0u) return 0;
+    // wait for packet sent of outstanding commands
+    if ((tx_aggregation_commands_collected + tx_aggregation_commands_sending) > 0u) return 0;
+    if (hci_transport_h4_tx_aggregation_has_space()) return 1;
+    tx_aggregation_can_send_refused = true;
+    return 0;
+#else
     return tx_state == TX_IDLE;
+#endif
 }
 
 static int hci_transport_h4_send_packet(uint8_t packet_type, uint8_t * packet, int size){
@@ -373,6 +637,10 @@ static int hci_transport_h4_send_packet(uint8_t packet_type, uint8_t * packet, i
     }
 #endif
 
+#ifdef ENABLE_H4_TX_AGGREGATION
+    return hci_transport_h4_tx_aggregation_add(packet_type, packet, size);
+#endif
+
 #ifdef ENABLE_EHCILL
     // store request for later
     ehcill_tx_len   = size;
@@ -420,6 +688,11 @@ static void hci_transport_h4_init(const void * transport_config){
     btstack_uart->init(&uart_config);
     btstack_uart->set_block_received(&hci_transport_h4_block_read);
     btstack_uart->set_block_sent(&hci_transport_h4_block_sent);
+#ifdef ENABLE_H4_BULK_READ
+    if (btstack_uart->set_data_received != NULL){
+        btstack_uart->set_data_received(&hci_transport_h4_bulk_data_received);
+    }
+#endif
 }
 
 static int hci_transport_h4_open(void){
@@ -430,9 +703,11 @@ static int hci_transport_h4_open(void){
     }
 
     // init rx + tx state machines
-    hci_transport_h4_reset_statemachine();
-    hci_transport_h4_trigger_next_read();
+    hci_transport_h4_start_reading();
     tx_state = TX_IDLE;
+#ifdef ENABLE_H4_TX_AGGREGATION
+    hci_transport_h4_tx_aggregation_reset();
+#endif
 
 #ifdef ENABLE_EHCILL
     hci_transport_h4_ehcill_open();
@@ -444,6 +719,9 @@ static int hci_transport_h4_close(void){
     // set state to off
     tx_state = TX_OFF;
     h4_state = H4_OFF;
+#ifdef ENABLE_H4_TX_AGGREGATION
+    hci_transport_h4_tx_aggregation_reset();
+#endif
 
     // close uart driver
     return btstack_uart->close();
@@ -74,8 +74,19 @@ typedef enum {
 
 } hci_transport_link_actions_t;
 
+#ifdef ENABLE_H5_SLIDING_WINDOW
+#ifndef HCI_TRANSPORT_H5_WINDOW_SIZE
+#define HCI_TRANSPORT_H5_WINDOW_SIZE 4
+#endif
+#if (HCI_TRANSPORT_H5_WINDOW_SIZE < 1) || (HCI_TRANSPORT_H5_WINDOW_SIZE > 7)
+#error "HCI_TRANSPORT_H5_WINDOW_SIZE must be between 1 and 7"
+#endif
+// Configuration Field. Outgoing packets copied into window, no OOF flow control, support data integrity check
+#define LINK_CONFIG_SLIDING_WINDOW_SIZE HCI_TRANSPORT_H5_WINDOW_SIZE
+#else
 // Configuration Field. No packet buffers -> sliding window = 1, no OOF flow control, support data integrity check
 #define LINK_CONFIG_SLIDING_WINDOW_SIZE 1
+#endif
 #define LINK_CONFIG_OOF_FLOW_CONTROL 0
 #define LINK_CONFIG_DATA_INTEGRITY_CHECK 1
 #define LINK_CONFIG_VERSION_NR 0
@@ -92,7 +103,21 @@ typedef enum {
 #define LINK_CONTROL_PACKET_TYPE 0x0f
 
 // max size of write requests
+#ifdef HCI_TRANSPORT_H5_SLIP_TX_CHUNK_LEN
+#define LINK_SLIP_TX_CHUNK_LEN HCI_TRANSPORT_H5_SLIP_TX_CHUNK_LEN
+#else
 #define LINK_SLIP_TX_CHUNK_LEN 64
+#endif
+#if LINK_SLIP_TX_CHUNK_LEN < 16
+#error "HCI_TRANSPORT_H5_SLIP_TX_CHUNK_LEN must be at least 16"
+#endif
+
+// size of read requests if UART driver supports partial reads
+#ifdef ENABLE_H5_BULK_READ
+#ifndef HCI_TRANSPORT_H5_READ_BUFFER_SIZE
+#define HCI_TRANSPORT_H5_READ_BUFFER_SIZE 64
+#endif
+#endif
 
 // ---
 static const uint8_t link_control_sync[] =   { 0x01, 0x7e};
@@ -128,10 +153,28 @@ static uint8_t  link_peer_supports_data_integrity_check;
 static btstack_timer_source_t inactivity_timer;
 static uint16_t link_inactivity_timeout_ms; // auto-sleep if set
 
+#ifdef ENABLE_H5_SLIDING_WINDOW
+typedef struct {
+    uint8_t  packet_type;
+    uint16_t size;
+    uint8_t  data[HCI_OUTGOING_PACKET_BUFFER_SIZE];
+} hci_transport_link_window_slot_t;
+
+// Outgoing reliable packets, oldest packet uses link_seq_nr
+static hci_transport_link_window_slot_t link_window_slots[HCI_TRANSPORT_H5_WINDOW_SIZE];
+static uint8_t link_window_size;        // negotiated in config handshake
+static uint8_t link_window_first;       // slot of oldest packet
+static uint8_t link_window_count;       // queued packets
+static uint8_t link_window_transmitted; // packets sent at least once
+static uint8_t link_window_next;        // next packet to send, reset for resend
+static bool    link_window_new_packet_in_write;
+static bool    link_window_packet_sent_pending;
+#else
 // Outgoing packet
 static uint8_t   hci_packet_type;
 static uint16_t  hci_packet_size;
 static uint8_t * hci_packet;
+#endif
 
 // hci packet handler
 static  void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
@@ -154,8 +197,50 @@ static void hci_transport_link_run(void);
 static void hci_transport_slip_init(void);
 
 // -----------------------------
-// CRC16-CCITT Calculation - compromise: use 32 byte table - 512 byte table would be faster, but that's too large
+#ifdef ENABLE_H5_CRC16_TABLE_256
+// CRC16-CCITT Calculation - 512 byte table, one lookup per byte
+
+static uint16_t crc16_ccitt_update (uint16_t crc, uint8_t ch){
 
+    static const uint16_t crc16_ccitt_table[] ={
+            0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+            0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+            0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+            0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+            0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+            0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+            0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+            0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+            0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+            0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+            0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+            0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+            0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+            0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+            0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+            0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+            0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+            0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+            0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+            0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+            0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+            0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+            0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+            0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+            0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+            0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+            0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+            0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+            0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+            0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+            0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+            0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+    };
+
+    return (crc >> 8u) ^ crc16_ccitt_table[(crc ^ ch) & 0x00ffu];
+}
+#else
+// CRC16-CCITT Calculation - compromise: use 32 byte table - 512 byte table would be faster, but that's too large
 
 static uint16_t crc16_ccitt_update (uint16_t crc, uint8_t ch){
 
@@ -170,16 +255,14 @@ static uint16_t crc16_ccitt_update (uint16_t crc, uint8_t ch){
     crc = (crc >> 4u) ^ crc16_ccitt_table[(crc ^ (ch >> 4u)) & 0x000fu];
     return crc;
 }
+#endif
 
 static uint16_t btstack_reverse_bits_16(uint16_t value){
-    int reverse = 0;
-    int i;
-    for (i = 0; i < 16; i++) { 
-        reverse = reverse << 1;
-        reverse |= value & 1u;
-        value = value >> 1;
-    }
-    return reverse;
+    // swap adjacent bits, pairs, nibbles and bytes
+    value = ((value >> 1) & 0x5555u) | ((value & 0x5555u) << 1);
+    value = ((value >> 2) & 0x3333u) | ((value & 0x3333u) << 2);
+    value = ((value >> 4) & 0x0f0fu) | ((value & 0x0f0fu) << 4);
+    return (uint16_t) ((value >> 8) | (value << 8));
 }
 
 static uint16_t crc16_calc_for_slip_frame(const uint8_t * header, const uint8_t * payload, uint16_t len){
@@ -220,8 +303,8 @@ static void hci_transport_inactivity_timer_set(void){
 
 // Fill chunk and write
 static void hci_transport_slip_encode_chunk_and_send(int pos){
-    while (btstack_slip_encoder_has_data() & (pos < LINK_SLIP_TX_CHUNK_LEN)) {
-        slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
+    if (pos < LINK_SLIP_TX_CHUNK_LEN){
+        pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], LINK_SLIP_TX_CHUNK_LEN - pos);
     }
 
     if (!btstack_slip_encoder_has_data()){
@@ -231,9 +314,7 @@ static void hci_transport_slip_encode_chunk_and_send(int pos){
             uint8_t dic_buffer[2];
             big_endian_store_16(dic_buffer, 0, slip_outgoing_dic);
             btstack_slip_encoder_start(dic_buffer, 2);
-            while (btstack_slip_encoder_has_data()){
-                slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
-            } 
+            pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], 4);
         }
         // Start of Frame
         slip_outgoing_buffer[pos++] = BTSTACK_SLIP_SOF;
@@ -262,9 +343,7 @@ static void hci_transport_slip_send_frame(const uint8_t * header, const uint8_t
 
     // Header
     btstack_slip_encoder_start(header, 4);
-    while (btstack_slip_encoder_has_data()){
-        slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
-    }
+    pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], 8);
 
     // Packet
     btstack_slip_encoder_start(packet, packet_size);
@@ -348,24 +427,41 @@ static void hci_transport_link_send_sleep(void){
     hci_transport_link_send_control(link_control_sleep, sizeof(link_control_sleep));
 }
 
-static void hci_transport_link_send_queued_packet(void){
+static void hci_transport_link_send_reliable_packet(uint8_t seq_nr, uint8_t packet_type, const uint8_t * packet, uint16_t packet_size){
 
     uint8_t header[4];
-    hci_transport_link_calc_header(header, link_seq_nr, link_ack_nr, link_peer_supports_data_integrity_check, 1, hci_packet_type, hci_packet_size);
+    hci_transport_link_calc_header(header, seq_nr, link_ack_nr, link_peer_supports_data_integrity_check, 1, packet_type, packet_size);
 
     uint16_t data_integrity_check = 0;
     if (link_peer_supports_data_integrity_check){
-        data_integrity_check = crc16_calc_for_slip_frame(header, hci_packet, hci_packet_size);
+        data_integrity_check = crc16_calc_for_slip_frame(header, packet, packet_size);
     }
-    log_debug("hci_transport_link_send_queued_packet: seq %u, ack %u, size %u. Append dic %u, dic = 0x%04x", link_seq_nr, link_ack_nr, hci_packet_size, link_peer_supports_data_integrity_check, data_integrity_check);
-    log_debug_hexdump(hci_packet, hci_packet_size);
+    log_debug("hci_transport_link_send_queued_packet: seq %u, ack %u, size %u. Append dic %u, dic = 0x%04x", seq_nr, link_ack_nr, packet_size, link_peer_supports_data_integrity_check, data_integrity_check);
+    log_debug_hexdump(packet, packet_size);
 
-    hci_transport_slip_send_frame(header, hci_packet, hci_packet_size, data_integrity_check);
+    hci_transport_slip_send_frame(header, packet, packet_size, data_integrity_check);
 
     // reset inactvitiy timer
     hci_transport_inactivity_timer_set();
 }
 
+#ifdef ENABLE_H5_SLIDING_WINDOW
+static void hci_transport_link_send_queued_packet(void){
+    hci_transport_link_window_slot_t * slot = &link_window_slots[(link_window_first + link_window_next) % HCI_TRANSPORT_H5_WINDOW_SIZE];
+    uint8_t seq_nr = (link_seq_nr + link_window_next) & 0x07u;
+    if (link_window_next == link_window_transmitted){
+        link_window_transmitted++;
+        link_window_new_packet_in_write = true;
+    }
+    link_window_next++;
+    hci_transport_link_send_reliable_packet(seq_nr, slot->packet_type, slot->data, slot->size);
+}
+#else
+static void hci_transport_link_send_queued_packet(void){
+    hci_transport_link_send_reliable_packet(link_seq_nr, hci_packet_type, hci_packet, hci_packet_size);
+}
+#endif
+
 static void hci_transport_link_send_ack_packet(void){
     // Pure ACK package is without DIC as there is no payload either
     log_debug("send ack %u", link_ack_nr);
@@ -436,6 +532,7 @@ static void hci_transport_link_run(void){
 }
 
 static void hci_transport_link_set_timer(uint16_t timeout_ms){
+    btstack_run_loop_remove_timer(&link_timer);
     btstack_run_loop_set_timer(&link_timer, timeout_ms);
     btstack_run_loop_add_timer(&link_timer);
 }
@@ -462,6 +559,10 @@ static void hci_transport_link_timeout_handler(btstack_timer_source_t * ts){
                 return;
             }
             // resend packet
+#ifdef ENABLE_H5_SLIDING_WINDOW
+            // go back to oldest packet
+            link_window_next = 0;
+#endif
             hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
             hci_transport_link_set_timer(link_resend_timeout_ms);
             break;
@@ -488,6 +589,64 @@ static int hci_transport_link_inc_seq_nr(int seq_nr){
     return (seq_nr + 1) & 0x07;    
 }
 
+#ifdef ENABLE_H5_SLIDING_WINDOW
+static int hci_transport_link_have_outgoing_packet(void){
+    return link_window_count > 0u;
+}
+
+static void hci_transport_link_clear_queue(void){
+    btstack_run_loop_remove_timer(&link_timer);
+    hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
+    link_window_first = 0;
+    link_window_count = 0;
+    link_window_transmitted = 0;
+    link_window_next = 0;
+    link_window_new_packet_in_write = false;
+    link_window_packet_sent_pending = false;
+}
+
+static void hci_transport_h5_queue_packet(uint8_t packet_type, uint8_t *packet, int size){
+    hci_transport_link_window_slot_t * slot = &link_window_slots[(link_window_first + link_window_count) % HCI_TRANSPORT_H5_WINDOW_SIZE];
+    slot->packet_type = packet_type;
+    slot->size = size;
+    (void) memcpy(slot->data, packet, size);
+    link_window_count++;
+}
+
+// report packet as sent after it was written once, if window has space and no resend is in progress
+static void hci_transport_link_window_emit_packet_sent(void){
+    if (link_window_packet_sent_pending == false) return;
+    if (link_window_count >= link_window_size) return;
+    if (link_window_next < link_window_count) return;
+    link_window_packet_sent_pending = false;
+    uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+}
+
+static void hci_transport_link_process_ack(uint8_t ack_nr){
+    // acknowledgement is cumulative, peer expects ack_nr next
+    uint8_t num_acked = (ack_nr - link_seq_nr) & 0x07u;
+    if (num_acked == 0u) return;
+    if (num_acked > link_window_transmitted){
+        log_info("ack nr %u for packets not sent yet, seq nr %u", ack_nr, link_seq_nr);
+        return;
+    }
+    log_debug("outgoing packets with seq %u..%u ack'ed", link_seq_nr, (ack_nr - 1u) & 0x07u);
+    link_seq_nr = ack_nr;
+    link_window_first = (link_window_first + num_acked) % HCI_TRANSPORT_H5_WINDOW_SIZE;
+    link_window_count -= num_acked;
+    link_window_transmitted -= num_acked;
+    link_window_next = (link_window_next > num_acked) ? (link_window_next - num_acked) : 0u;
+
+    // restart resend timer for remaining packets
+    btstack_run_loop_remove_timer(&link_timer);
+    if (link_window_count > 0u){
+        hci_transport_link_set_timer(link_resend_timeout_ms);
+    }
+
+    hci_transport_link_window_emit_packet_sent();
+}
+#else
 static int hci_transport_link_have_outgoing_packet(void){
     return hci_packet != NULL;
 }
@@ -503,6 +662,21 @@ static void hci_transport_h5_queue_packet(uint8_t packet_type, uint8_t *packet,
     hci_packet_size = size;
 }
 
+static void hci_transport_link_process_ack(uint8_t ack_nr){
+    // our packet is good if the remote expects our seq nr + 1
+    int next_seq_nr = hci_transport_link_inc_seq_nr(link_seq_nr);
+    if (hci_transport_link_have_outgoing_packet() && (next_seq_nr == ack_nr)){
+        log_debug("outoing packet with seq %u ack'ed", link_seq_nr);
+        link_seq_nr = next_seq_nr;
+        hci_transport_link_clear_queue();
+
+        // notify upper stack that it can send again
+        uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+        packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+    }
+}
+#endif
+
 static void hci_transport_h5_emit_sleep_state(int sleep_active){
     static int last_state = 0;
     if (sleep_active == last_state) return;
@@ -612,6 +786,14 @@ static void hci_transport_h5_process_frame(uint16_t frame_size){
                 uint8_t config = slip_payload[2];
                 link_peer_supports_data_integrity_check = (config & 0x10u) != 0u;
                 log_info("link received config response 0x%02x, data integrity check supported %u", config, link_peer_supports_data_integrity_check);
+#ifdef ENABLE_H5_SLIDING_WINDOW
+                link_window_size = btstack_min(config & 0x07u, HCI_TRANSPORT_H5_WINDOW_SIZE);
+                if (link_window_size == 0u){
+                    link_window_size = 1;
+                }
+                log_info("sliding window size %u", link_window_size);
+                hci_transport_link_clear_queue();
+#endif
                 link_state = LINK_ACTIVE;
                 btstack_run_loop_remove_timer(&link_timer);
                 log_info("link activated");
@@ -640,17 +822,7 @@ static void hci_transport_h5_process_frame(uint16_t frame_size){
 
             // Process ACKs in reliable packet and explicit ack packets
             if (reliable_packet || (link_packet_type == LINK_ACKNOWLEDGEMENT_TYPE)){
-                // our packet is good if the remote expects our seq nr + 1
-                int next_seq_nr = hci_transport_link_inc_seq_nr(link_seq_nr);
-                if (hci_transport_link_have_outgoing_packet() && (next_seq_nr == ack_nr)){
-                    log_debug("outoing packet with seq %u ack'ed", link_seq_nr);
-                    link_seq_nr = next_seq_nr;
-                    hci_transport_link_clear_queue();
-
-                    // notify upper stack that it can send again
-                    uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
-                    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
-                }
+                hci_transport_link_process_ack(ack_nr);
             } 
 
             switch (link_packet_type){
@@ -736,14 +908,39 @@ static void hci_transport_link_update_resend_timeout(uint32_t baudrate){
 /// H5 Interface
 
 static uint8_t hci_transport_link_read_byte;
+#ifdef ENABLE_H5_BULK_READ
+static uint8_t hci_transport_link_read_buffer[HCI_TRANSPORT_H5_READ_BUFFER_SIZE];
+#endif
 static int hci_transport_h5_active;
 
 static void hci_transport_h5_read_next_byte(void){
+#ifdef ENABLE_H5_BULK_READ
+    // read all available data if supported by UART driver
+    if (btstack_uart->receive_available != NULL){
+        btstack_uart->receive_available(hci_transport_link_read_buffer, sizeof(hci_transport_link_read_buffer));
+        return;
+    }
+#endif
     btstack_uart->receive_block(&hci_transport_link_read_byte, 1);    
 }
 
 // track time receiving SLIP frame
 static uint32_t hci_transport_h5_receive_start;
+
+static void hci_transport_h5_frame_received(uint16_t frame_size){
+    // track time
+    uint32_t packet_receive_time = btstack_run_loop_get_time_ms() - hci_transport_h5_receive_start;
+    uint32_t nominal_time = (frame_size + 6u) * 10u * 1000u / uart_config.baudrate;
+    UNUSED(nominal_time);
+    UNUSED(packet_receive_time);
+    log_info("slip frame time %u ms for %u decoded bytes. nomimal time %u ms", (int) packet_receive_time, frame_size, (int) nominal_time);
+    // reset state
+    hci_transport_h5_receive_start = 0;
+    // 
+    hci_transport_h5_process_frame(frame_size);
+    hci_transport_slip_init();
+}
+
 static void hci_transport_h5_block_received(void){
     if (hci_transport_h5_active == 0) return;
 
@@ -754,21 +951,32 @@ static void hci_transport_h5_block_received(void){
     btstack_slip_decoder_process(hci_transport_link_read_byte);
     uint16_t frame_size = btstack_slip_decoder_frame_size();
     if (frame_size) {
-        // track time
-        uint32_t packet_receive_time = btstack_run_loop_get_time_ms() - hci_transport_h5_receive_start;
-        uint32_t nominal_time = (frame_size + 6u) * 10u * 1000u / uart_config.baudrate;
-        UNUSED(nominal_time);
-        UNUSED(packet_receive_time);
-        log_info("slip frame time %u ms for %u decoded bytes. nomimal time %u ms", (int) packet_receive_time, frame_size, (int) nominal_time);
-        // reset state
-        hci_transport_h5_receive_start = 0;
-        // 
-        hci_transport_h5_process_frame(frame_size);
-        hci_transport_slip_init();
+        hci_transport_h5_frame_received(frame_size);
     }
     hci_transport_h5_read_next_byte();
 }
 
+#ifdef ENABLE_H5_BULK_READ
+static void hci_transport_h5_data_received(uint16_t size){
+    if (hci_transport_h5_active == 0) return;
+
+    if (hci_transport_h5_receive_start == 0u){
+        hci_transport_h5_receive_start = btstack_run_loop_get_time_ms();
+    }
+    uint16_t pos = 0;
+    while (pos < size){
+        pos += btstack_slip_decoder_process_data(&hci_transport_link_read_buffer[pos], size - pos);
+        uint16_t frame_size = btstack_slip_decoder_frame_size();
+        if (frame_size) {
+            hci_transport_h5_frame_received(frame_size);
+            // transport might have been closed by packet handler
+            if (hci_transport_h5_active == 0) return;
+        }
+    }
+    hci_transport_h5_read_next_byte();
+}
+#endif
+
 static void hci_transport_h5_block_sent(void){
     if (hci_transport_h5_active == 0) return;
 
@@ -781,6 +989,17 @@ static void hci_transport_h5_block_sent(void){
     // done
     slip_write_active = 0;
 
+#ifdef ENABLE_H5_SLIDING_WINDOW
+    // new packet was written, continue with packets to resend
+    if (link_window_new_packet_in_write){
+        link_window_new_packet_in_write = false;
+        link_window_packet_sent_pending = true;
+    }
+    if ((link_window_next < link_window_count) && (link_peer_asleep == 0u)){
+        hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
+    }
+#endif
+
     // enter sleep mode after sending sleep message
     if (hci_transport_link_actions & HCI_TRANSPORT_LINK_ENTER_SLEEP){
         hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_ENTER_SLEEP;
@@ -794,6 +1013,10 @@ static void hci_transport_h5_block_sent(void){
     }
 
     hci_transport_link_run();
+
+#ifdef ENABLE_H5_SLIDING_WINDOW
+    hci_transport_link_window_emit_packet_sent();
+#endif
 }
 
 static void hci_transport_h5_init(const void * transport_config){
@@ -819,6 +1042,11 @@ static void hci_transport_h5_init(const void * transport_config){
     btstack_uart->init(&uart_config);
     btstack_uart->set_block_received(&hci_transport_h5_block_received);
     btstack_uart->set_block_sent(&hci_transport_h5_block_sent);
+#ifdef ENABLE_H5_BULK_READ
+    if (btstack_uart->set_data_received != NULL){
+        btstack_uart->set_data_received(&hci_transport_h5_data_received);
+    }
+#endif
 }
 
 static int hci_transport_h5_open(void){
@@ -872,7 +1100,13 @@ static void hci_transport_h5_register_packet_handler(void (*handler)(uint8_t pac
 }
 
 static int hci_transport_h5_can_send_packet_now(uint8_t packet_type){
+#ifdef ENABLE_H5_SLIDING_WINDOW
+    // window has space, previous packet was written and reported as sent
+    int res = (link_state == LINK_ACTIVE) && (link_window_count < link_window_size)
+        && (link_window_next == link_window_count) && (link_window_packet_sent_pending == false);
+#else
     int res = !hci_transport_link_have_outgoing_packet() && (link_state == LINK_ACTIVE);
+#endif
     // log_info("can_send_packet_now: %u", res);
     return res;
 }
@@ -882,6 +1116,12 @@ static int hci_transport_h5_send_packet(uint8_t packet_type, uint8_t *packet, in
         log_error("hci_transport_h5_send_packet called but in state %d", link_state);
         return -1;
     }
+#ifdef ENABLE_H5_SLIDING_WINDOW
+    if (size > HCI_OUTGOING_PACKET_BUFFER_SIZE){
+        log_error("hci_transport_h5_send_packet: packet of size %u too large", size);
+        return -1;
+    }
+#endif
 
     // store request
     hci_transport_h5_queue_packet(packet_type, packet, size);
@@ -897,7 +1137,14 @@ static int hci_transport_h5_send_packet(uint8_t packet_type, uint8_t *packet, in
         hci_transport_link_set_timer(LINK_WAKEUP_MS);
     } else {
         hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
+#ifdef ENABLE_H5_SLIDING_WINDOW
+        // resend timer already runs for older packets
+        if (link_window_count == 1u){
+            hci_transport_link_set_timer(link_resend_timeout_ms);
+        }
+#else
         hci_transport_link_set_timer(link_resend_timeout_ms);
+#endif
     }
     hci_transport_link_run();
     return 0;
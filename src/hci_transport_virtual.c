@@ -0,0 +1,1087 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define BTSTACK_FILE__ "hci_transport_virtual.c"
+
+/*
+ *  hci_transport_virtual.c
+ *
+ *  HCI Transport API implementation on top of an in-process Controller model
+ *
+ *  The model answers the HCI init sequence, accounts for ACL buffers, sets up LE and Classic connections
+ *  and sends outgoing ACL packets with a configurable link rate and latency. Two Controllers are connected
+ *  by an 'air interface' that exchanges PDUs, e.g. between two processes via hci_transport_virtual_posix.
+ *
+ *  Not modeled: security, SCO, inquiry, and timing of connection setup. Other commands complete with success.
+ */
+
+#include <string.h>
+
+#include "btstack_config.h"
+
+#include "bluetooth_company_id.h"
+#include "btstack_debug.h"
+#include "btstack_ring_buffer.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "hci_transport.h"
+
+// number of ACL buffers reported to the host
+#ifndef HCI_TRANSPORT_VIRTUAL_ACL_PACKETS
+#define HCI_TRANSPORT_VIRTUAL_ACL_PACKETS 8
+#endif
+
+// number of ACL packets that have been transmitted but not received by the peer yet
+#ifndef HCI_TRANSPORT_VIRTUAL_AIR_PACKETS
+#define HCI_TRANSPORT_VIRTUAL_AIR_PACKETS 8
+#endif
+
+#ifndef HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS
+#define HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS 4
+#endif
+
+// buffer for events and ACL packets to the host
+#ifndef HCI_TRANSPORT_VIRTUAL_HOST_BUFFER_SIZE
+#define HCI_TRANSPORT_VIRTUAL_HOST_BUFFER_SIZE ((HCI_TRANSPORT_VIRTUAL_AIR_PACKETS + 8) * (3 + HCI_INCOMING_PACKET_BUFFER_SIZE))
+#endif
+
+#define HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN (HCI_TRANSPORT_VIRTUAL_ACL_PACKETS + HCI_TRANSPORT_VIRTUAL_AIR_PACKETS)
+
+#define HCI_TRANSPORT_VIRTUAL_DEFAULT_LINK_RATE 1000000
+
+// PDUs exchanged between Controllers
+typedef enum {
+    VIRTUAL_AIR_ADV = 1,            // address type, address, data len, data
+    VIRTUAL_AIR_ADV_STOP,           //
+    VIRTUAL_AIR_LE_CONNECT_REQ,     // initiator handle, initiator address type, initiator address, target address
+    VIRTUAL_AIR_LE_CONNECT_CANCEL,  // initiator handle
+    VIRTUAL_AIR_LE_CONNECT_RSP,     // initiator handle, responder handle, responder address type, responder address
+    VIRTUAL_AIR_CONNECT_REQ,        // initiator handle, initiator address, class of device, target address
+    VIRTUAL_AIR_CONNECT_RSP,        // initiator handle, responder handle, status
+    VIRTUAL_AIR_ACL,                // receiver handle | flags, len, data
+    VIRTUAL_AIR_DISCONNECT,         // receiver handle, reason
+} virtual_air_pdu_t;
+
+typedef enum {
+    VIRTUAL_CONNECTION_FREE = 0,
+    VIRTUAL_CONNECTION_W4_CONNECT_RSP,
+    VIRTUAL_CONNECTION_W4_ACCEPT,
+    VIRTUAL_CONNECTION_OPEN,
+} virtual_connection_state_t;
+
+typedef struct {
+    virtual_connection_state_t state;
+    hci_con_handle_t handle;
+    hci_con_handle_t peer_handle;
+    bd_addr_t        address;
+    uint8_t          address_type;
+    uint8_t          le;
+    uint16_t         num_completed_packets;
+} virtual_connection_t;
+
+typedef struct {
+    hci_con_handle_t handle;
+    uint16_t size;
+    uint32_t tx_done_ms;
+    uint32_t delivery_ms;
+    // air pdu type followed by ACL packet
+    uint8_t  pdu[1 + HCI_ACL_HEADER_SIZE + HCI_ACL_PAYLOAD_SIZE];
+} virtual_tx_packet_t;
+
+// prototypes
+static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size);
+static void hci_transport_virtual_air_dummy(const uint8_t * pdu, uint16_t size);
+
+static void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size) = dummy_handler;
+static void (*air_send_pdu)(const uint8_t * pdu, uint16_t size) = hci_transport_virtual_air_dummy;
+
+// configuration
+static bd_addr_t virtual_bd_addr = { 0x00, 0x1B, 0xDC, 0x07, 0x00, 0x01 };
+static uint32_t  virtual_link_rate_kbps = HCI_TRANSPORT_VIRTUAL_DEFAULT_LINK_RATE / 1000;
+static uint32_t  virtual_link_latency_ms;
+
+// controller state
+static int       virtual_open;
+static hci_con_handle_t virtual_next_handle;
+static virtual_connection_t virtual_connections[HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS];
+static uint8_t   virtual_scan_enable;
+static uint32_t  virtual_class_of_device;
+static bd_addr_t virtual_le_random_address;
+static uint8_t   virtual_le_adv_own_address_type;
+static uint8_t   virtual_le_adv_data_len;
+static uint8_t   virtual_le_adv_data[31];
+static uint8_t   virtual_le_adv_enabled;
+static uint8_t   virtual_le_scan_enabled;
+static hci_con_handle_t virtual_le_connect_handle;
+
+// advertisement received from peer
+static uint8_t   virtual_peer_adv_valid;
+static uint8_t   virtual_peer_adv_address_type;
+static bd_addr_t virtual_peer_adv_address;
+static uint8_t   virtual_peer_adv_data_len;
+static uint8_t   virtual_peer_adv_data[31];
+
+// LE Connect Request received while not advertising
+static uint8_t   virtual_peer_le_connect_pending;
+static hci_con_handle_t virtual_peer_le_connect_handle;
+static uint8_t   virtual_peer_le_connect_address_type;
+static bd_addr_t virtual_peer_le_connect_address;
+
+// outgoing ACL packets: waiting for transmission, then 'in the air' for the link latency
+static virtual_tx_packet_t virtual_tx_queue[HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN];
+static uint16_t  virtual_tx_queue_head;
+static uint16_t  virtual_tx_queue_count;
+static uint16_t  virtual_tx_air_count;
+static uint32_t  virtual_tx_busy_until_ms;
+static uint32_t  virtual_tx_busy_until_us_fraction;
+static btstack_timer_source_t virtual_tx_timer;
+
+// packets to the host are delivered from the run loop
+static btstack_ring_buffer_t virtual_host_ring_buffer;
+static uint8_t   virtual_host_storage[HCI_TRANSPORT_VIRTUAL_HOST_BUFFER_SIZE];
+static uint8_t   virtual_host_packet[HCI_INCOMING_PRE_BUFFER_SIZE + HCI_INCOMING_PACKET_BUFFER_SIZE];
+static btstack_timer_source_t virtual_host_timer;
+
+static int32_t hci_transport_virtual_time_delta(uint32_t a, uint32_t b){
+    return (int32_t) (a - b);
+}
+
+// packets to host
+
+static void hci_transport_virtual_host_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    while (virtual_open && (btstack_ring_buffer_bytes_available(&virtual_host_ring_buffer) >= 3u)){
+        uint8_t header[3];
+        uint32_t bytes_read;
+        btstack_ring_buffer_read(&virtual_host_ring_buffer, header, 3, &bytes_read);
+        uint16_t size = little_endian_read_16(header, 1);
+        uint8_t * packet = &virtual_host_packet[HCI_INCOMING_PRE_BUFFER_SIZE];
+        btstack_ring_buffer_read(&virtual_host_ring_buffer, packet, size, &bytes_read);
+        packet_handler(header[0], packet, size);
+    }
+}
+
+static void hci_transport_virtual_host_queue_packet(uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    if (size > HCI_INCOMING_PACKET_BUFFER_SIZE) {
+        log_error("packet for host too large, size %u", size);
+        return;
+    }
+    if (btstack_ring_buffer_bytes_free(&virtual_host_ring_buffer) < (3u + size)){
+        log_error("host buffer full, drop packet type %u, size %u", packet_type, size);
+        return;
+    }
+    uint8_t header[3];
+    header[0] = packet_type;
+    little_endian_store_16(header, 1, size);
+    btstack_ring_buffer_write(&virtual_host_ring_buffer, header, 3);
+    btstack_ring_buffer_write(&virtual_host_ring_buffer, (uint8_t *) packet, size);
+
+    btstack_run_loop_remove_timer(&virtual_host_timer);
+    btstack_run_loop_set_timer(&virtual_host_timer, 0);
+    btstack_run_loop_add_timer(&virtual_host_timer);
+}
+
+static void hci_transport_virtual_emit_event(const uint8_t * event, uint16_t size){
+    hci_transport_virtual_host_queue_packet(HCI_EVENT_PACKET, event, size);
+}
+
+static void hci_transport_virtual_emit_command_complete(uint16_t opcode, const uint8_t * return_params, uint16_t return_params_len){
+    uint8_t event[5 + 255];
+    if (return_params_len > 250u) return;
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 3 + return_params_len;
+    event[2] = 1;
+    little_endian_store_16(event, 3, opcode);
+    (void) memcpy(&event[5], return_params, return_params_len);
+    hci_transport_virtual_emit_event(event, 5 + return_params_len);
+}
+
+static void hci_transport_virtual_emit_command_complete_status(uint16_t opcode, uint8_t status){
+    hci_transport_virtual_emit_command_complete(opcode, &status, 1);
+}
+
+static void hci_transport_virtual_emit_command_status(uint16_t opcode, uint8_t status){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_COMMAND_STATUS;
+    event[1] = 4;
+    event[2] = status;
+    event[3] = 1;
+    little_endian_store_16(event, 4, opcode);
+    hci_transport_virtual_emit_event(event, sizeof(event));
+}
+
+static void hci_transport_virtual_emit_connection_complete(uint8_t status, hci_con_handle_t handle, const bd_addr_t address){
+    uint8_t event[13];
+    event[0] = HCI_EVENT_CONNECTION_COMPLETE;
+    event[1] = 11;
+    event[2] = status;
+    little_endian_store_16(event, 3, handle);
+    reverse_bd_addr(address, &event[5]);
+    event[11] = 1;  // ACL
+    event[12] = 0;  // no encryption
+    hci_transport_virtual_emit_event(event, sizeof(event));
+}
+
+static void hci_transport_virtual_emit_le_connection_complete(uint8_t status, hci_con_handle_t handle, uint8_t role,
+                                                              uint8_t address_type, const bd_addr_t address){
+    uint8_t event[21];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 19;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    event[3] = status;
+    little_endian_store_16(event, 4, handle);
+    event[6] = role;
+    event[7] = address_type;
+    reverse_bd_addr(address, &event[8]);
+    little_endian_store_16(event, 14, 0x0018);  // 30 ms connection interval
+    little_endian_store_16(event, 16, 0);       // latency
+    little_endian_store_16(event, 18, 0x0048);  // 720 ms supervision timeout
+    event[20] = 0;
+    hci_transport_virtual_emit_event(event, sizeof(event));
+}
+
+static void hci_transport_virtual_emit_disconnection_complete(hci_con_handle_t handle, uint8_t reason){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    event[1] = 4;
+    event[2] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 3, handle);
+    event[5] = reason;
+    hci_transport_virtual_emit_event(event, sizeof(event));
+}
+
+static void hci_transport_virtual_emit_advertising_report(void){
+    uint8_t event[14 + 31];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = 12 + virtual_peer_adv_data_len;
+    event[2] = HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+    event[3] = 1;   // num reports
+    event[4] = 0;   // ADV_IND
+    event[5] = virtual_peer_adv_address_type;
+    reverse_bd_addr(virtual_peer_adv_address, &event[6]);
+    event[12] = virtual_peer_adv_data_len;
+    (void) memcpy(&event[13], virtual_peer_adv_data, virtual_peer_adv_data_len);
+    event[13 + virtual_peer_adv_data_len] = (uint8_t) -40;   // RSSI
+    hci_transport_virtual_emit_event(event, 14 + virtual_peer_adv_data_len);
+}
+
+// connections
+
+static virtual_connection_t * hci_transport_virtual_connection_for_handle(hci_con_handle_t handle){
+    int i;
+    for (i=0;i<HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS;i++){
+        if (virtual_connections[i].state == VIRTUAL_CONNECTION_FREE) continue;
+        if (virtual_connections[i].handle != handle) continue;
+        return &virtual_connections[i];
+    }
+    return NULL;
+}
+
+static virtual_connection_t * hci_transport_virtual_connection_for_address(const bd_addr_t address, virtual_connection_state_t state){
+    int i;
+    for (i=0;i<HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS;i++){
+        if (virtual_connections[i].state != state) continue;
+        if (virtual_connections[i].le) continue;
+        if (bd_addr_cmp(virtual_connections[i].address, address) != 0) continue;
+        return &virtual_connections[i];
+    }
+    return NULL;
+}
+
+static virtual_connection_t * hci_transport_virtual_connection_create(uint8_t le, uint8_t address_type, const bd_addr_t address){
+    int i;
+    for (i=0;i<HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS;i++){
+        virtual_connection_t * connection = &virtual_connections[i];
+        if (connection->state != VIRTUAL_CONNECTION_FREE) continue;
+        memset(connection, 0, sizeof(virtual_connection_t));
+        connection->handle = virtual_next_handle;
+        connection->le = le;
+        connection->address_type = address_type;
+        bd_addr_copy(connection->address, address);
+        virtual_next_handle = (virtual_next_handle + 1u) & 0x0eff;
+        if (virtual_next_handle == 0u) {
+            virtual_next_handle = 1;
+        }
+        return connection;
+    }
+    return NULL;
+}
+
+static void hci_transport_virtual_le_own_address(uint8_t own_address_type, uint8_t * address_type, bd_addr_t address){
+    if ((own_address_type & 1u) == 0u){
+        *address_type = BD_ADDR_TYPE_LE_PUBLIC;
+        bd_addr_copy(address, virtual_bd_addr);
+    } else {
+        *address_type = BD_ADDR_TYPE_LE_RANDOM;
+        bd_addr_copy(address, virtual_le_random_address);
+    }
+}
+
+// air interface
+
+static void hci_transport_virtual_air_dummy(const uint8_t * pdu, uint16_t size){
+    UNUSED(pdu);
+    UNUSED(size);
+}
+
+static void hci_transport_virtual_air_send_adv(void){
+    uint8_t pdu[9 + 31];
+    pdu[0] = VIRTUAL_AIR_ADV;
+    bd_addr_t address;
+    hci_transport_virtual_le_own_address(virtual_le_adv_own_address_type, &pdu[1], address);
+    bd_addr_copy(&pdu[2], address);
+    pdu[8] = virtual_le_adv_data_len;
+    (void) memcpy(&pdu[9], virtual_le_adv_data, virtual_le_adv_data_len);
+    (*air_send_pdu)(pdu, 9 + virtual_le_adv_data_len);
+}
+
+static void hci_transport_virtual_air_send_adv_stop(void){
+    uint8_t pdu[1];
+    pdu[0] = VIRTUAL_AIR_ADV_STOP;
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_air_send_le_connect_rsp(hci_con_handle_t initiator_handle, hci_con_handle_t responder_handle){
+    uint8_t pdu[12];
+    pdu[0] = VIRTUAL_AIR_LE_CONNECT_RSP;
+    little_endian_store_16(pdu, 1, initiator_handle);
+    little_endian_store_16(pdu, 3, responder_handle);
+    bd_addr_t address;
+    hci_transport_virtual_le_own_address(virtual_le_adv_own_address_type, &pdu[5], address);
+    bd_addr_copy(&pdu[6], address);
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_air_send_connect_rsp(hci_con_handle_t initiator_handle, hci_con_handle_t responder_handle, uint8_t status){
+    uint8_t pdu[6];
+    pdu[0] = VIRTUAL_AIR_CONNECT_RSP;
+    little_endian_store_16(pdu, 1, initiator_handle);
+    little_endian_store_16(pdu, 3, responder_handle);
+    pdu[5] = status;
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_air_send_disconnect(hci_con_handle_t peer_handle, uint8_t reason){
+    uint8_t pdu[4];
+    pdu[0] = VIRTUAL_AIR_DISCONNECT;
+    little_endian_store_16(pdu, 1, peer_handle);
+    pdu[3] = reason;
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_accept_le_connect(void){
+    virtual_peer_le_connect_pending = 0;
+    virtual_connection_t * connection = hci_transport_virtual_connection_create(1, virtual_peer_le_connect_address_type, virtual_peer_le_connect_address);
+    if (connection == NULL) return;
+    connection->state = VIRTUAL_CONNECTION_OPEN;
+    connection->peer_handle = virtual_peer_le_connect_handle;
+
+    // advertising stops with connection
+    virtual_le_adv_enabled = 0;
+    hci_transport_virtual_air_send_le_connect_rsp(connection->peer_handle, connection->handle);
+    hci_transport_virtual_emit_le_connection_complete(ERROR_CODE_SUCCESS, connection->handle, HCI_ROLE_SLAVE,
+                                                      connection->address_type, connection->address);
+}
+
+static void hci_transport_virtual_receive_acl(const uint8_t * pdu, uint16_t size){
+    if (size < 5u) return;
+    uint16_t handle_and_flags = little_endian_read_16(pdu, 1);
+    hci_con_handle_t handle = handle_and_flags & 0x0fffu;
+    uint16_t acl_len = little_endian_read_16(pdu, 3);
+    if ((5u + acl_len) > size) return;
+    virtual_connection_t * connection = hci_transport_virtual_connection_for_handle(handle);
+    if ((connection == NULL) || (connection->state != VIRTUAL_CONNECTION_OPEN)) return;
+
+    // fragment if peer uses larger ACL packets
+    uint8_t packet[HCI_ACL_HEADER_SIZE + HCI_ACL_PAYLOAD_SIZE];
+    uint16_t pos = 0;
+    uint16_t flags = handle_and_flags & 0xf000u;
+    while (pos < acl_len){
+        uint16_t fragment_len = btstack_min(acl_len - pos, HCI_ACL_PAYLOAD_SIZE);
+        little_endian_store_16(packet, 0, handle | flags);
+        little_endian_store_16(packet, 2, fragment_len);
+        (void) memcpy(&packet[4], &pdu[5 + pos], fragment_len);
+        hci_transport_virtual_host_queue_packet(HCI_ACL_DATA_PACKET, packet, 4 + fragment_len);
+        pos += fragment_len;
+        // continuation fragment
+        flags = (flags & 0xc000u) | 0x1000u;
+    }
+}
+
+void hci_transport_virtual_receive_pdu(const uint8_t * pdu, uint16_t size){
+    if (virtual_open == 0) return;
+    if (size < 1u) return;
+
+    virtual_connection_t * connection;
+    hci_con_handle_t handle;
+    bd_addr_t address;
+    uint8_t address_type;
+
+    switch ((virtual_air_pdu_t) pdu[0]){
+        case VIRTUAL_AIR_ADV:
+            if (size < 9u) break;
+            if (pdu[8] > 31u) break;
+            if (size < (9u + pdu[8])) break;
+            virtual_peer_adv_valid = 1;
+            virtual_peer_adv_address_type = pdu[1];
+            bd_addr_copy(virtual_peer_adv_address, &pdu[2]);
+            virtual_peer_adv_data_len = pdu[8];
+            (void) memcpy(virtual_peer_adv_data, &pdu[9], virtual_peer_adv_data_len);
+            if (virtual_le_scan_enabled){
+                hci_transport_virtual_emit_advertising_report();
+            }
+            break;
+        case VIRTUAL_AIR_ADV_STOP:
+            virtual_peer_adv_valid = 0;
+            break;
+        case VIRTUAL_AIR_LE_CONNECT_REQ:
+            if (size < 16u) break;
+            hci_transport_virtual_le_own_address(virtual_le_adv_own_address_type, &address_type, address);
+            if (bd_addr_cmp(&pdu[10], address) != 0) break;
+            virtual_peer_le_connect_pending = 1;
+            virtual_peer_le_connect_handle = little_endian_read_16(pdu, 1);
+            virtual_peer_le_connect_address_type = pdu[3];
+            bd_addr_copy(virtual_peer_le_connect_address, &pdu[4]);
+            if (virtual_le_adv_enabled){
+                hci_transport_virtual_accept_le_connect();
+            }
+            break;
+        case VIRTUAL_AIR_LE_CONNECT_CANCEL:
+            if (size < 3u) break;
+            if (little_endian_read_16(pdu, 1) != virtual_peer_le_connect_handle) break;
+            virtual_peer_le_connect_pending = 0;
+            break;
+        case VIRTUAL_AIR_LE_CONNECT_RSP:
+            if (size < 12u) break;
+            handle = little_endian_read_16(pdu, 1);
+            connection = hci_transport_virtual_connection_for_handle(handle);
+            if (connection == NULL) break;
+            if (connection->state != VIRTUAL_CONNECTION_W4_CONNECT_RSP) break;
+            virtual_le_connect_handle = HCI_CON_HANDLE_INVALID;
+            connection->state = VIRTUAL_CONNECTION_OPEN;
+            connection->peer_handle = little_endian_read_16(pdu, 3);
+            connection->address_type = pdu[5];
+            bd_addr_copy(connection->address, &pdu[6]);
+            hci_transport_virtual_emit_le_connection_complete(ERROR_CODE_SUCCESS, connection->handle, HCI_ROLE_MASTER,
+                                                              connection->address_type, connection->address);
+            break;
+        case VIRTUAL_AIR_CONNECT_REQ:
+            if (size < 18u) break;
+            handle = little_endian_read_16(pdu, 1);
+            if (((virtual_scan_enable & 2u) == 0u) || (bd_addr_cmp(&pdu[12], virtual_bd_addr) != 0)){
+                hci_transport_virtual_air_send_connect_rsp(handle, HCI_CON_HANDLE_INVALID, ERROR_CODE_PAGE_TIMEOUT);
+                break;
+            }
+            bd_addr_copy(address, &pdu[3]);
+            connection = hci_transport_virtual_connection_create(0, BD_ADDR_TYPE_ACL, address);
+            if (connection == NULL){
+                hci_transport_virtual_air_send_connect_rsp(handle, HCI_CON_HANDLE_INVALID, ERROR_CODE_CONNECTION_REJECTED_DUE_TO_LIMITED_RESOURCES);
+                break;
+            }
+            connection->state = VIRTUAL_CONNECTION_W4_ACCEPT;
+            connection->peer_handle = handle;
+            {
+                uint8_t event[12];
+                event[0] = HCI_EVENT_CONNECTION_REQUEST;
+                event[1] = 10;
+                reverse_bd_addr(address, &event[2]);
+                (void) memcpy(&event[8], &pdu[9], 3);
+                event[11] = 1;  // ACL
+                hci_transport_virtual_emit_event(event, sizeof(event));
+            }
+            break;
+        case VIRTUAL_AIR_CONNECT_RSP:
+            if (size < 6u) break;
+            handle = little_endian_read_16(pdu, 1);
+            connection = hci_transport_virtual_connection_for_handle(handle);
+            if (connection == NULL) break;
+            if (connection->state != VIRTUAL_CONNECTION_W4_CONNECT_RSP) break;
+            hci_transport_virtual_emit_connection_complete(pdu[5], connection->handle, connection->address);
+            if (pdu[5] != ERROR_CODE_SUCCESS){
+                connection->state = VIRTUAL_CONNECTION_FREE;
+                break;
+            }
+            connection->state = VIRTUAL_CONNECTION_OPEN;
+            connection->peer_handle = little_endian_read_16(pdu, 3);
+            break;
+        case VIRTUAL_AIR_ACL:
+            hci_transport_virtual_receive_acl(pdu, size);
+            break;
+        case VIRTUAL_AIR_DISCONNECT:
+            if (size < 4u) break;
+            handle = little_endian_read_16(pdu, 1);
+            connection = hci_transport_virtual_connection_for_handle(handle);
+            if (connection == NULL) break;
+            connection->state = VIRTUAL_CONNECTION_FREE;
+            hci_transport_virtual_emit_disconnection_complete(handle, pdu[3]);
+            break;
+        default:
+            log_error("unknown air pdu 0x%02x", pdu[0]);
+            break;
+    }
+}
+
+// outgoing ACL packets
+
+static void hci_transport_virtual_tx_timer_handler(btstack_timer_source_t * ts);
+
+static void hci_transport_virtual_tx_schedule(void){
+    btstack_run_loop_remove_timer(&virtual_tx_timer);
+    if (virtual_tx_queue_count == 0u) return;
+
+    // next transmission or delivery
+    virtual_tx_packet_t * tx_packet = &virtual_tx_queue[virtual_tx_queue_head];
+    uint32_t next_ms = tx_packet->delivery_ms;
+    if ((virtual_tx_air_count < virtual_tx_queue_count) && (virtual_tx_air_count < HCI_TRANSPORT_VIRTUAL_AIR_PACKETS)){
+        uint16_t index = (virtual_tx_queue_head + virtual_tx_air_count) % HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN;
+        uint32_t tx_done_ms = virtual_tx_queue[index].tx_done_ms;
+        if ((virtual_tx_air_count == 0u) || (hci_transport_virtual_time_delta(tx_done_ms, next_ms) < 0)){
+            next_ms = tx_done_ms;
+        }
+    }
+
+    int32_t timeout_ms = hci_transport_virtual_time_delta(next_ms, btstack_run_loop_get_time_ms());
+    if (timeout_ms < 0){
+        timeout_ms = 0;
+    }
+    btstack_run_loop_set_timer(&virtual_tx_timer, (uint32_t) timeout_ms);
+    btstack_run_loop_add_timer(&virtual_tx_timer);
+}
+
+static void hci_transport_virtual_emit_number_of_completed_packets(void){
+    uint8_t event[3 + 4 * HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS];
+    uint8_t num_handles = 0;
+    int i;
+    for (i=0;i<HCI_TRANSPORT_VIRTUAL_MAX_CONNECTIONS;i++){
+        virtual_connection_t * connection = &virtual_connections[i];
+        if (connection->num_completed_packets == 0u) continue;
+        little_endian_store_16(event, 3 + (4 * num_handles), connection->handle);
+        little_endian_store_16(event, 5 + (4 * num_handles), connection->num_completed_packets);
+        connection->num_completed_packets = 0;
+        num_handles++;
+    }
+    if (num_handles == 0u) return;
+    event[0] = HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS;
+    event[1] = 1 + (4 * num_handles);
+    event[2] = num_handles;
+    hci_transport_virtual_emit_event(event, 3 + (4 * num_handles));
+}
+
+static void hci_transport_virtual_tx_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    uint32_t now = btstack_run_loop_get_time_ms();
+
+    while (virtual_tx_queue_count > 0u){
+        // deliver packets whose latency has passed
+        virtual_tx_packet_t * tx_packet = &virtual_tx_queue[virtual_tx_queue_head];
+        if ((virtual_tx_air_count > 0u) && (hci_transport_virtual_time_delta(now, tx_packet->delivery_ms) >= 0)){
+            virtual_connection_t * connection = hci_transport_virtual_connection_for_handle(tx_packet->handle);
+            if ((connection != NULL) && (connection->state == VIRTUAL_CONNECTION_OPEN)){
+                // replace handle by peer handle
+                uint16_t flags = little_endian_read_16(tx_packet->pdu, 1) & 0xf000u;
+                little_endian_store_16(tx_packet->pdu, 1, connection->peer_handle | flags);
+                (*air_send_pdu)(tx_packet->pdu, 1 + tx_packet->size);
+            }
+            virtual_tx_queue_head = (virtual_tx_queue_head + 1u) % HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN;
+            virtual_tx_queue_count--;
+            virtual_tx_air_count--;
+            continue;
+        }
+
+        // transmit next packet and free Controller buffer if there's space in the air
+        if (virtual_tx_air_count == virtual_tx_queue_count) break;
+        if (virtual_tx_air_count == HCI_TRANSPORT_VIRTUAL_AIR_PACKETS) break;
+        uint16_t index = (virtual_tx_queue_head + virtual_tx_air_count) % HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN;
+        tx_packet = &virtual_tx_queue[index];
+        if (hci_transport_virtual_time_delta(now, tx_packet->tx_done_ms) < 0) break;
+        virtual_tx_air_count++;
+        virtual_connection_t * connection = hci_transport_virtual_connection_for_handle(tx_packet->handle);
+        if (connection != NULL){
+            connection->num_completed_packets++;
+        }
+    }
+
+    hci_transport_virtual_emit_number_of_completed_packets();
+    hci_transport_virtual_tx_schedule();
+}
+
+static int hci_transport_virtual_send_acl_packet(uint8_t * packet, int size){
+    if (size < 4) return -1;
+    if ((size_t) size > (HCI_ACL_HEADER_SIZE + HCI_ACL_PAYLOAD_SIZE)) {
+        log_error("ACL packet too large, size %u", size);
+        return -1;
+    }
+    if ((virtual_tx_queue_count - virtual_tx_air_count) >= HCI_TRANSPORT_VIRTUAL_ACL_PACKETS){
+        log_error("ACL packet exceeds Controller buffers");
+        return -1;
+    }
+    hci_con_handle_t handle = little_endian_read_16(packet, 0) & 0x0fffu;
+    if (hci_transport_virtual_connection_for_handle(handle) == NULL){
+        log_error("ACL packet for unknown handle 0x%04x", handle);
+        return -1;
+    }
+
+    // transmission starts when the link is idle and takes size * 8 bits / link rate
+    uint32_t now = btstack_run_loop_get_time_ms();
+    if (hci_transport_virtual_time_delta(now, virtual_tx_busy_until_ms) > 0){
+        virtual_tx_busy_until_ms = now;
+        virtual_tx_busy_until_us_fraction = 0;
+    }
+    virtual_tx_busy_until_us_fraction += ((uint32_t) size * 8000u) / virtual_link_rate_kbps;
+    virtual_tx_busy_until_ms += virtual_tx_busy_until_us_fraction / 1000u;
+    virtual_tx_busy_until_us_fraction %= 1000u;
+
+    uint16_t index = (virtual_tx_queue_head + virtual_tx_queue_count) % HCI_TRANSPORT_VIRTUAL_TX_QUEUE_LEN;
+    virtual_tx_packet_t * tx_packet = &virtual_tx_queue[index];
+    tx_packet->handle = handle;
+    tx_packet->size = (uint16_t) size;
+    tx_packet->tx_done_ms = virtual_tx_busy_until_ms + ((virtual_tx_busy_until_us_fraction > 0u) ? 1u : 0u);
+    tx_packet->delivery_ms = tx_packet->tx_done_ms + virtual_link_latency_ms;
+    tx_packet->pdu[0] = VIRTUAL_AIR_ACL;
+    (void) memcpy(&tx_packet->pdu[1], packet, size);
+    virtual_tx_queue_count++;
+
+    // timer might need to fire earlier if queue was empty
+    if (virtual_tx_queue_count == 1u){
+        hci_transport_virtual_tx_schedule();
+    }
+    return 0;
+}
+
+// commands
+
+static void hci_transport_virtual_reset(void){
+    memset(virtual_connections, 0, sizeof(virtual_connections));
+    virtual_next_handle = 1;
+    virtual_scan_enable = 0;
+    virtual_class_of_device = 0;
+    memset(virtual_le_random_address, 0, sizeof(bd_addr_t));
+    virtual_le_adv_own_address_type = 0;
+    virtual_le_adv_data_len = 0;
+    virtual_le_adv_enabled = 0;
+    virtual_le_scan_enabled = 0;
+    virtual_le_connect_handle = HCI_CON_HANDLE_INVALID;
+    virtual_peer_adv_valid = 0;
+    virtual_peer_le_connect_pending = 0;
+    virtual_tx_queue_head = 0;
+    virtual_tx_queue_count = 0;
+    virtual_tx_air_count = 0;
+    virtual_tx_busy_until_ms = btstack_run_loop_get_time_ms();
+    virtual_tx_busy_until_us_fraction = 0;
+    btstack_run_loop_remove_timer(&virtual_tx_timer);
+}
+
+static void hci_transport_virtual_handle_le_create_connection(const uint8_t * packet){
+    if (virtual_le_connect_handle != HCI_CON_HANDLE_INVALID){
+        hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_LE_CREATE_CONNECTION, ERROR_CODE_COMMAND_DISALLOWED);
+        return;
+    }
+    bd_addr_t address;
+    reverse_bd_addr(&packet[9], address);
+    virtual_connection_t * connection = hci_transport_virtual_connection_create(1, packet[8], address);
+    if (connection == NULL){
+        hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_LE_CREATE_CONNECTION, ERROR_CODE_CONNECTION_REJECTED_DUE_TO_LIMITED_RESOURCES);
+        return;
+    }
+    connection->state = VIRTUAL_CONNECTION_W4_CONNECT_RSP;
+    virtual_le_connect_handle = connection->handle;
+    hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_LE_CREATE_CONNECTION, ERROR_CODE_SUCCESS);
+
+    uint8_t pdu[16];
+    pdu[0] = VIRTUAL_AIR_LE_CONNECT_REQ;
+    little_endian_store_16(pdu, 1, connection->handle);
+    bd_addr_t own_address;
+    hci_transport_virtual_le_own_address(packet[15], &pdu[3], own_address);
+    bd_addr_copy(&pdu[4], own_address);
+    bd_addr_copy(&pdu[10], address);
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_handle_le_create_connection_cancel(void){
+    virtual_connection_t * connection = hci_transport_virtual_connection_for_handle(virtual_le_connect_handle);
+    if (connection == NULL){
+        hci_transport_virtual_emit_command_complete_status(HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL, ERROR_CODE_COMMAND_DISALLOWED);
+        return;
+    }
+    virtual_le_connect_handle = HCI_CON_HANDLE_INVALID;
+    connection->state = VIRTUAL_CONNECTION_FREE;
+
+    uint8_t pdu[3];
+    pdu[0] = VIRTUAL_AIR_LE_CONNECT_CANCEL;
+    little_endian_store_16(pdu, 1, connection->handle);
+    (*air_send_pdu)(pdu, sizeof(pdu));
+
+    hci_transport_virtual_emit_command_complete_status(HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL, ERROR_CODE_SUCCESS);
+    hci_transport_virtual_emit_le_connection_complete(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, connection->handle, HCI_ROLE_MASTER,
+                                                      connection->address_type, connection->address);
+}
+
+static void hci_transport_virtual_handle_create_connection(const uint8_t * packet){
+    bd_addr_t address;
+    reverse_bd_addr(&packet[3], address);
+    virtual_connection_t * connection = hci_transport_virtual_connection_create(0, BD_ADDR_TYPE_ACL, address);
+    if (connection == NULL){
+        hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_CREATE_CONNECTION, ERROR_CODE_CONNECTION_REJECTED_DUE_TO_LIMITED_RESOURCES);
+        return;
+    }
+    connection->state = VIRTUAL_CONNECTION_W4_CONNECT_RSP;
+    hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_CREATE_CONNECTION, ERROR_CODE_SUCCESS);
+
+    uint8_t pdu[18];
+    pdu[0] = VIRTUAL_AIR_CONNECT_REQ;
+    little_endian_store_16(pdu, 1, connection->handle);
+    bd_addr_copy(&pdu[3], virtual_bd_addr);
+    little_endian_store_24(pdu, 9, virtual_class_of_device);
+    bd_addr_copy(&pdu[12], address);
+    (*air_send_pdu)(pdu, sizeof(pdu));
+}
+
+static void hci_transport_virtual_handle_accept_or_reject(uint16_t opcode, const uint8_t * packet){
+    bd_addr_t address;
+    reverse_bd_addr(&packet[3], address);
+    virtual_connection_t * connection = hci_transport_virtual_connection_for_address(address, VIRTUAL_CONNECTION_W4_ACCEPT);
+    if (connection == NULL){
+        hci_transport_virtual_emit_command_status(opcode, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+        return;
+    }
+    hci_transport_virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+    if (opcode == HCI_OPCODE_HCI_ACCEPT_CONNECTION_REQUEST){
+        connection->state = VIRTUAL_CONNECTION_OPEN;
+        hci_transport_virtual_air_send_connect_rsp(connection->peer_handle, connection->handle, ERROR_CODE_SUCCESS);
+        hci_transport_virtual_emit_connection_complete(ERROR_CODE_SUCCESS, connection->handle, connection->address);
+    } else {
+        connection->state = VIRTUAL_CONNECTION_FREE;
+        hci_transport_virtual_air_send_connect_rsp(connection->peer_handle, HCI_CON_HANDLE_INVALID, packet[9]);
+        hci_transport_virtual_emit_connection_complete(packet[9], connection->handle, connection->address);
+    }
+}
+
+static void hci_transport_virtual_handle_disconnect(const uint8_t * packet){
+    hci_con_handle_t handle = little_endian_read_16(packet, 3);
+    virtual_connection_t * connection = hci_transport_virtual_connection_for_handle(handle);
+    if ((connection == NULL) || (connection->state != VIRTUAL_CONNECTION_OPEN)){
+        hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_DISCONNECT, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+        return;
+    }
+    connection->state = VIRTUAL_CONNECTION_FREE;
+    hci_transport_virtual_emit_command_status(HCI_OPCODE_HCI_DISCONNECT, ERROR_CODE_SUCCESS);
+    hci_transport_virtual_air_send_disconnect(connection->peer_handle, packet[5]);
+    hci_transport_virtual_emit_disconnection_complete(handle, ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
+}
+
+static void hci_transport_virtual_handle_remote_features(uint16_t opcode, const uint8_t * packet){
+    static const uint8_t features[8] = { 0x03, 0, 0, 0, 0x40, 0, 0, 0 };
+    hci_con_handle_t handle = little_endian_read_16(packet, 3);
+    if (hci_transport_virtual_connection_for_handle(handle) == NULL){
+        hci_transport_virtual_emit_command_status(opcode, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+        return;
+    }
+    hci_transport_virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+    uint8_t event[15];
+    uint16_t pos;
+    switch (opcode){
+        case HCI_OPCODE_HCI_LE_READ_REMOTE_USED_FEATURES:
+            event[0] = HCI_EVENT_LE_META;
+            event[2] = HCI_SUBEVENT_LE_READ_REMOTE_USED_FEATURES_COMPLETE;
+            pos = 3;
+            break;
+        case HCI_OPCODE_HCI_READ_REMOTE_EXTENDED_FEATURES_COMMAND:
+            event[0] = HCI_EVENT_READ_REMOTE_EXTENDED_FEATURES_COMPLETE;
+            pos = 2;
+            break;
+        default:
+            event[0] = HCI_EVENT_READ_REMOTE_SUPPORTED_FEATURES_COMPLETE;
+            pos = 2;
+            break;
+    }
+    event[pos++] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, pos, handle);
+    pos += 2;
+    if (opcode == HCI_OPCODE_HCI_READ_REMOTE_EXTENDED_FEATURES_COMMAND){
+        event[pos++] = packet[5];   // page
+        event[pos++] = 0;           // max page
+    }
+    (void) memcpy(&event[pos], features, 8);
+    pos += 8;
+    event[1] = pos - 2;
+    hci_transport_virtual_emit_event(event, pos);
+}
+
+static void hci_transport_virtual_handle_command(const uint8_t * packet, uint16_t size){
+    uint8_t return_params[249];
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    int i;
+
+    // parameters are read up to their max size
+    if (size < 3u) return;
+
+    memset(return_params, 0, sizeof(return_params));
+    switch (opcode){
+        case HCI_OPCODE_HCI_RESET:
+            hci_transport_virtual_reset();
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION:
+            return_params[1] = 0x09;    // Bluetooth 5.0
+            little_endian_store_16(return_params, 2, 0);
+            return_params[4] = 0x09;
+            little_endian_store_16(return_params, 5, BLUETOOTH_COMPANY_ID_BLUEKITCHEN_GMBH);
+            little_endian_store_16(return_params, 7, 0);
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 9);
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_NAME:
+            (void) memcpy(&return_params[1], "BTstack Virtual", 15);
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 249);
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS:
+            return_params[1 + 14] = 0x80;   // Read Buffer Size
+            return_params[1 + 24] = 0x40;   // Write LE Host Supported
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 65);
+            break;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES:
+            return_params[1] = 0x03;        // 3 and 5 slot packets
+            return_params[1 + 4] = 0x40;    // LE Supported (Controller)
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 9);
+            break;
+        case HCI_OPCODE_HCI_READ_BD_ADDR:
+            reverse_bd_addr(virtual_bd_addr, &return_params[1]);
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 7);
+            break;
+        case HCI_OPCODE_HCI_READ_BUFFER_SIZE:
+            little_endian_store_16(return_params, 1, HCI_ACL_PAYLOAD_SIZE);
+            return_params[3] = 0;
+            little_endian_store_16(return_params, 4, HCI_TRANSPORT_VIRTUAL_ACL_PACKETS);
+            little_endian_store_16(return_params, 6, 0);
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 8);
+            break;
+        case HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE:
+            // LE shares ACL buffers
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 4);
+            break;
+        case HCI_OPCODE_HCI_LE_READ_MAXIMUM_DATA_LENGTH:
+            for (i=0;i<2;i++){
+                little_endian_store_16(return_params, 1 + (4 * i), 251);
+                little_endian_store_16(return_params, 3 + (4 * i), 2120);
+            }
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 9);
+            break;
+        case HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE:
+            return_params[1] = 8;
+            hci_transport_virtual_emit_command_complete(opcode, return_params, 2);
+            break;
+        case HCI_OPCODE_HCI_WRITE_SCAN_ENABLE:
+            virtual_scan_enable = packet[3];
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_WRITE_CLASS_OF_DEVICE:
+            virtual_class_of_device = little_endian_read_24(packet, 3);
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_CREATE_CONNECTION:
+            hci_transport_virtual_handle_create_connection(packet);
+            break;
+        case HCI_OPCODE_HCI_ACCEPT_CONNECTION_REQUEST:
+        case HCI_OPCODE_HCI_REJECT_CONNECTION_REQUEST:
+            hci_transport_virtual_handle_accept_or_reject(opcode, packet);
+            break;
+        case HCI_OPCODE_HCI_DISCONNECT:
+            hci_transport_virtual_handle_disconnect(packet);
+            break;
+        case HCI_OPCODE_HCI_READ_REMOTE_SUPPORTED_FEATURES_COMMAND:
+        case HCI_OPCODE_HCI_READ_REMOTE_EXTENDED_FEATURES_COMMAND:
+        case HCI_OPCODE_HCI_LE_READ_REMOTE_USED_FEATURES:
+            hci_transport_virtual_handle_remote_features(opcode, packet);
+            break;
+        case HCI_OPCODE_HCI_LE_SET_RANDOM_ADDRESS:
+            reverse_bd_addr(&packet[3], virtual_le_random_address);
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISING_PARAMETERS:
+            virtual_le_adv_own_address_type = packet[8];
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISING_DATA:
+            virtual_le_adv_data_len = btstack_min(packet[3], sizeof(virtual_le_adv_data));
+            (void) memcpy(virtual_le_adv_data, &packet[4], virtual_le_adv_data_len);
+            if (virtual_le_adv_enabled){
+                hci_transport_virtual_air_send_adv();
+            }
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+        case HCI_OPCODE_HCI_LE_SET_ADVERTISE_ENABLE:
+            virtual_le_adv_enabled = packet[3];
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            if (virtual_le_adv_enabled){
+                hci_transport_virtual_air_send_adv();
+                if (virtual_peer_le_connect_pending){
+                    hci_transport_virtual_accept_le_connect();
+                }
+            } else {
+                hci_transport_virtual_air_send_adv_stop();
+            }
+            break;
+        case HCI_OPCODE_HCI_LE_SET_SCAN_ENABLE:
+            virtual_le_scan_enabled = packet[3];
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            if (virtual_le_scan_enabled && virtual_peer_adv_valid){
+                hci_transport_virtual_emit_advertising_report();
+            }
+            break;
+        case HCI_OPCODE_HCI_LE_CREATE_CONNECTION:
+            hci_transport_virtual_handle_le_create_connection(packet);
+            break;
+        case HCI_OPCODE_HCI_LE_CREATE_CONNECTION_CANCEL:
+            hci_transport_virtual_handle_le_create_connection_cancel();
+            break;
+        case HCI_OPCODE_HCI_LE_CONNECTION_UPDATE:
+            hci_transport_virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+            {
+                uint8_t event[12];
+                event[0] = HCI_EVENT_LE_META;
+                event[1] = 10;
+                event[2] = HCI_SUBEVENT_LE_CONNECTION_UPDATE_COMPLETE;
+                event[3] = ERROR_CODE_SUCCESS;
+                little_endian_store_16(event, 4, little_endian_read_16(packet, 3));
+                little_endian_store_16(event, 6, little_endian_read_16(packet, 7));
+                little_endian_store_16(event, 8, little_endian_read_16(packet, 9));
+                little_endian_store_16(event, 10, little_endian_read_16(packet, 11));
+                hci_transport_virtual_emit_event(event, sizeof(event));
+            }
+            break;
+        default:
+            hci_transport_virtual_emit_command_complete_status(opcode, ERROR_CODE_SUCCESS);
+            break;
+    }
+}
+
+// hci_transport_t implementation
+
+static void hci_transport_virtual_init(const void * transport_config){
+    UNUSED(transport_config);
+    btstack_run_loop_set_timer_handler(&virtual_host_timer, &hci_transport_virtual_host_timer_handler);
+    btstack_run_loop_set_timer_handler(&virtual_tx_timer, &hci_transport_virtual_tx_timer_handler);
+}
+
+static int hci_transport_virtual_open(void){
+    btstack_ring_buffer_init(&virtual_host_ring_buffer, virtual_host_storage, sizeof(virtual_host_storage));
+    hci_transport_virtual_reset();
+    virtual_open = 1;
+    return 0;
+}
+
+static int hci_transport_virtual_close(void){
+    virtual_open = 0;
+    btstack_run_loop_remove_timer(&virtual_host_timer);
+    btstack_run_loop_remove_timer(&virtual_tx_timer);
+    return 0;
+}
+
+static void hci_transport_virtual_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    packet_handler = handler;
+}
+
+static int hci_transport_virtual_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return virtual_open;
+}
+
+static int hci_transport_virtual_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+    if (virtual_open == 0) return -1;
+    // packet has been copied, report it as sent before any response of the Controller
+    hci_transport_virtual_emit_event(packet_sent_event, sizeof(packet_sent_event));
+    switch (packet_type){
+        case HCI_COMMAND_DATA_PACKET:
+            // copy to allow parameters to be read up to max size
+            {
+                uint8_t command[3 + 255];
+                memset(command, 0, sizeof(command));
+                (void) memcpy(command, packet, btstack_min(size, sizeof(command)));
+                hci_transport_virtual_handle_command(command, size);
+            }
+            return 0;
+        case HCI_ACL_DATA_PACKET:
+            return hci_transport_virtual_send_acl_packet(packet, size);
+        default:
+            return -1;
+    }
+}
+
+static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(packet);
+    UNUSED(size);
+}
+
+void hci_transport_virtual_set_bd_addr(const bd_addr_t addr){
+    bd_addr_copy(virtual_bd_addr, addr);
+}
+
+void hci_transport_virtual_set_link_rate(uint32_t bits_per_second){
+    virtual_link_rate_kbps = btstack_max(1, bits_per_second / 1000u);
+}
+
+void hci_transport_virtual_set_link_latency(uint32_t latency_ms){
+    virtual_link_latency_ms = latency_ms;
+}
+
+void hci_transport_virtual_set_air_interface(void (*send_pdu)(const uint8_t * pdu, uint16_t size)){
+    if (send_pdu == NULL){
+        air_send_pdu = &hci_transport_virtual_air_dummy;
+    } else {
+        air_send_pdu = send_pdu;
+    }
+}
+
+// get virtual singleton
+const hci_transport_t * hci_transport_virtual_instance(void) {
+    static const hci_transport_t hci_transport_virtual = {
+            /* const char * name; */                                        "VIRTUAL",
+            /* void   (*init) (const void *transport_config); */            &hci_transport_virtual_init,
+            /* int    (*open)(void); */                                     &hci_transport_virtual_open,
+            /* int    (*close)(void); */                                    &hci_transport_virtual_close,
+            /* void   (*register_packet_handler)(void (*handler)(...); */   &hci_transport_virtual_register_packet_handler,
+            /* int    (*can_send_packet_now)(uint8_t packet_type); */       &hci_transport_virtual_can_send_packet_now,
+            /* int    (*send_packet)(...); */                               &hci_transport_virtual_send_packet,
+            /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+            /* void   (*reset_link)(void); */                               NULL,
+            /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+    };
+    return &hci_transport_virtual;
+}
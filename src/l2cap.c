@@ -125,6 +125,17 @@ typedef enum {
 #define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK 5
 #define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT 5
 
+// nr of SDUs of local MTU size that the peer can send with automatic credits
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+#ifndef L2CAP_LE_AUTOMATIC_CREDITS_BUFFERED_SDUS
+#define L2CAP_LE_AUTOMATIC_CREDITS_BUFFERED_SDUS 2
+#endif
+#endif
+
+#if defined(ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE) && !defined(ENABLE_LE_DATA_CHANNELS)
+#error "ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE requires ENABLE_LE_DATA_CHANNELS"
+#endif
+
 // offsets for L2CAP SIGNALING COMMANDS
 #define L2CAP_SIGNALING_COMMAND_CODE_OFFSET   0
 #define L2CAP_SIGNALING_COMMAND_SIGID_OFFSET  1
@@ -135,6 +146,17 @@ typedef enum {
 #define L2CAP_USES_CHANNELS
 #endif
 
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+// local cids for dynamic channels are allocated from 0x40 .. 0x40 + L2CAP_LOCAL_CID_TABLE_SIZE - 1
+#ifndef L2CAP_LOCAL_CID_TABLE_SIZE
+#define L2CAP_LOCAL_CID_TABLE_SIZE 64
+#endif
+// number of buckets for channels chained per con handle
+#ifndef L2CAP_CON_HANDLE_HASH_SIZE
+#define L2CAP_CON_HANDLE_HASH_SIZE 16
+#endif
+#endif
+
 // prototypes
 static void l2cap_run(void);
 static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
@@ -161,10 +183,25 @@ static void l2cap_le_notify_channel_can_send(l2cap_channel_t *channel);
 static void l2cap_le_finialize_channel_close(l2cap_channel_t *channel);
 static void l2cap_le_send_pdu(l2cap_channel_t *channel);
 static inline l2cap_service_t * l2cap_le_get_service(uint16_t psm);
+static uint16_t l2cap_le_local_mps(l2cap_channel_t * channel);
+static uint16_t l2cap_le_take_initial_credits(l2cap_channel_t * channel);
+static uint16_t l2cap_le_security_check(hci_con_handle_t handle, l2cap_service_t * service);
+#endif
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+static void l2cap_le_automatic_credits_replenish(l2cap_channel_t * channel);
+#endif
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+static bool l2cap_run_ecbfc(void);
+static void l2cap_ecbfc_handle_connection_request(hci_con_handle_t handle, uint8_t sig_id, uint8_t * command, uint16_t len);
+static void l2cap_ecbfc_handle_connection_response(hci_con_handle_t handle, uint8_t sig_id, uint8_t * command, uint16_t len);
+static uint16_t l2cap_ecbfc_handle_reconfigure_request(hci_con_handle_t handle, uint8_t * command, uint16_t len);
 #endif
 #ifdef L2CAP_USES_CHANNELS
 static uint16_t l2cap_next_local_cid(void);
 static l2cap_channel_t * l2cap_get_channel_for_local_cid(uint16_t local_cid);
+static int l2cap_is_dynamic_channel_type(l2cap_channel_type_t channel_type);
+static l2cap_channel_t * l2cap_get_next_channel_for_con_handle(hci_con_handle_t con_handle, l2cap_channel_t * channel);
+static void l2cap_channel_set_con_handle(l2cap_channel_t * channel, hci_con_handle_t con_handle);
 static void l2cap_emit_simple_event_with_cid(l2cap_channel_t * channel, uint8_t event_code);
 static void l2cap_dispatch_to_channel(l2cap_channel_t *channel, uint8_t type, uint8_t * data, uint16_t size);
 static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t packet_handler, l2cap_channel_type_t channel_type, bd_addr_t address, bd_addr_type_t address_type,
@@ -201,10 +238,21 @@ static btstack_linked_list_t l2cap_channels;
 #ifdef L2CAP_USES_CHANNELS
 // next channel id for new connections
 static uint16_t  local_source_cid;
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+// dynamic channels indexed by local cid - 0x40
+static l2cap_channel_t * l2cap_channel_for_local_cid_table[L2CAP_LOCAL_CID_TABLE_SIZE];
+// dynamic channels chained via con_handle_next, bucket selected by con handle
+static l2cap_channel_t * l2cap_channels_for_con_handle[L2CAP_CON_HANDLE_HASH_SIZE];
+#endif
 #endif
 // next signaling sequence number
 static uint8_t   sig_seq_nr;
 
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+// round robin position
+static uint16_t  l2cap_scheduler_last_cid;
+#endif
+
 // used to cache l2cap rejects, echo, and informational requests
 static l2cap_signaling_response_t signaling_responses[NR_PENDING_SIGNALING_RESPONSES];
 static int signaling_responses_pending;
@@ -243,8 +291,39 @@ static const uint16_t crc16_table[256] = {
     0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040, 
 };
 
-static uint16_t crc16_calc(uint8_t * data, uint16_t len){
+#ifdef ENABLE_L2CAP_ERTM_FCS_SLICE_BY_8
+/*
+ * Slice-by-8: crc16_slice_table[i][b] = CRC of byte b followed by i+1 zero bytes, derived from crc16_table in l2cap_init
+ */
+static uint16_t crc16_slice_table[7][256];
+
+static void crc16_init_slice_table(void){
+    int i;
+    int b;
+    for (b = 0; b < 256; b++){
+        uint16_t crc = crc16_table[b];
+        for (i = 0; i < 7; i++){
+            crc = (crc >> 8) ^ crc16_table[crc & 0x00FF];
+            crc16_slice_table[i][b] = crc;
+        }
+    }
+}
+#endif
+
+static uint16_t crc16_calc(const uint8_t * data, uint16_t len){
     uint16_t crc = 0;   // initial value = 0 
+#ifdef ENABLE_L2CAP_ERTM_FCS_SLICE_BY_8
+    // process 8 bytes per iteration
+    while (len >= 8){
+        crc ^= little_endian_read_16(data, 0);
+        crc = crc16_slice_table[6][crc & 0x00FF] ^ crc16_slice_table[5][crc >> 8]
+            ^ crc16_slice_table[4][data[2]]      ^ crc16_slice_table[3][data[3]]
+            ^ crc16_slice_table[2][data[4]]      ^ crc16_slice_table[1][data[5]]
+            ^ crc16_slice_table[0][data[6]]      ^ crc16_table[data[7]];
+        data += 8;
+        len  -= 8;
+    }
+#endif
     while (len--){
         crc = (crc >> 8) ^ crc16_table[ (crc ^ ((uint16_t) *data++)) & 0x00FF ];
     }
@@ -259,8 +338,41 @@ static inline uint16_t l2cap_encanced_control_field_for_supevisor_frame(l2cap_su
     return (req_seq << 8) | (final << 7) | (poll << 4) | (((int) supervisory_function) << 2) | 1; 
 }
 
-static int l2cap_next_ertm_seq_nr(int seq_nr){
-    return (seq_nr + 1) & 0x3f;
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+static inline uint32_t l2cap_extended_control_field_for_information_frame(uint16_t tx_seq, int final, uint16_t req_seq, l2cap_segmentation_and_reassembly_t sar){
+    return (((uint32_t) tx_seq) << 18) | (((uint32_t) sar) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 0;
+}
+
+static inline uint32_t l2cap_extended_control_field_for_supevisor_frame(l2cap_supervisory_function_t supervisory_function, int poll, int final, uint16_t req_seq){
+    return (((uint32_t) poll) << 18) | (((uint32_t) supervisory_function) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 1;
+}
+#endif
+
+// size of Enhanced (2) or Extended (4) Control Field
+static uint16_t l2cap_ertm_control_field_size(l2cap_channel_t * channel){
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    if (channel->extended_control){
+        return 4;
+    }
+#else
+    UNUSED(channel);
+#endif
+    return 2;
+}
+
+static uint16_t l2cap_ertm_seq_nr_mask(l2cap_channel_t * channel){
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    if (channel->extended_control){
+        return 0x3fff;
+    }
+#else
+    UNUSED(channel);
+#endif
+    return 0x3f;
+}
+
+static uint16_t l2cap_next_ertm_seq_nr(l2cap_channel_t * channel, uint16_t seq_nr){
+    return (seq_nr + 1) & l2cap_ertm_seq_nr_mask(channel);
 }
 
 static int l2cap_ertm_can_store_packet_now(l2cap_channel_t * channel){
@@ -374,16 +486,26 @@ static int l2cap_ertm_send_information_frame(l2cap_channel_t * channel, int inde
     l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    uint16_t control = l2cap_encanced_control_field_for_information_frame(tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
-    log_info("I-Frame: control 0x%04x", control);
-    little_endian_store_16(acl_buffer, 8, control);
-    (void)memcpy(&acl_buffer[8 + 2],
+    uint16_t control_size = l2cap_ertm_control_field_size(channel);
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    if (channel->extended_control){
+        uint32_t control = l2cap_extended_control_field_for_information_frame(tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
+        log_info("I-Frame: control 0x%08x", control);
+        little_endian_store_32(acl_buffer, 8, control);
+    } else
+#endif
+    {
+        uint16_t control = l2cap_encanced_control_field_for_information_frame(tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
+        log_info("I-Frame: control 0x%04x", control);
+        little_endian_store_16(acl_buffer, 8, control);
+    }
+    (void)memcpy(&acl_buffer[8 + control_size],
                  &channel->tx_packets_data[index * channel->local_mps],
                  tx_state->len);
     // (re-)start retransmission timer on 
     l2cap_ertm_start_retransmission_timer(channel);
     // send
-    return l2cap_send_prepared(channel->local_cid, 2 + tx_state->len);
+    return l2cap_send_prepared(channel->local_cid, control_size + tx_state->len);
 }
 
 static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentation_and_reassembly_t sar, uint16_t sdu_length, uint8_t * data, uint16_t len){
@@ -407,7 +529,7 @@ static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentat
 
     // update
     channel->num_stored_tx_frames++;
-    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel->next_tx_seq);
+    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel, channel->next_tx_seq);
     l2cap_ertm_next_tx_write_index(channel);
 
     log_info("l2cap_ertm_store_fragment: tx_read_index %u, tx_write_index %u, num stored %u", channel->tx_read_index, channel->tx_write_index, channel->num_stored_tx_frames);
@@ -467,7 +589,7 @@ static uint16_t l2cap_setup_options_ertm_request(l2cap_channel_t * channel, uint
     config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_RETRANSMISSION_AND_FLOW_CONTROL;
     config_options[pos++] = 9;      // length
     config_options[pos++] = (uint8_t) channel->mode;
-    config_options[pos++] = channel->num_rx_buffers;    // == TxWindows size
+    config_options[pos++] = btstack_min(channel->num_rx_buffers, 63);    // == TxWindows size
     config_options[pos++] = channel->local_max_transmit;
     little_endian_store_16( config_options, pos, channel->local_retransmission_timeout_ms);
     pos += 2;
@@ -486,7 +608,23 @@ static uint16_t l2cap_setup_options_ertm_request(l2cap_channel_t * channel, uint
     config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_FRAME_CHECK_SEQUENCE;
     config_options[pos++] = 1;     // length
     config_options[pos++] = channel->fcs_option;
-    return pos; // 11+4+3=18
+
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    // use Extended Window Size option and Extended Control Field for TxWindow > 63 if supported by remote
+    hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+    if ((channel->num_rx_buffers > 63) && (connection != NULL) && ((connection->l2cap_state.extended_feature_mask & 0x100) != 0)){
+        channel->extended_control = 1;
+        config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+        config_options[pos++] = 2;     // length
+        little_endian_store_16(config_options, pos, channel->num_rx_buffers);
+        pos += 2;
+    }
+    // without Extended Control Field, TxWindow and sequence numbers cover only 63 frames
+    if (channel->extended_control == 0){
+        channel->num_rx_buffers = btstack_min(channel->num_rx_buffers, 63);
+    }
+#endif
+    return pos; // 11+4+3(+4)=18(22)
 }
 
 static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uint8_t * config_options){
@@ -495,7 +633,7 @@ static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uin
     config_options[pos++] = 9;      // length
     config_options[pos++] = (uint8_t) channel->mode;
     // less or equal to remote tx window size
-    config_options[pos++] = btstack_min(channel->num_tx_buffers, channel->remote_tx_window_size);
+    config_options[pos++] = btstack_min(btstack_min(channel->num_tx_buffers, channel->remote_tx_window_size), 63);
     // max transmit in response shall be ignored -> use sender values
     config_options[pos++] = channel->remote_max_transmit;
     // A value for the Retransmission time-out shall be sent in a positive Configuration Response
@@ -521,12 +659,29 @@ static uint16_t l2cap_setup_options_ertm_response(l2cap_channel_t * channel, uin
     config_options[pos++] = 1;     // length
     config_options[pos++] = channel->fcs_option;
 #endif
-    return pos; // 11+4=15
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    if (channel->extended_control){
+        config_options[pos++] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+        config_options[pos++] = 2;     // length
+        little_endian_store_16(config_options, pos, btstack_min(channel->num_tx_buffers, channel->remote_tx_window_size));
+        pos += 2;
+    }
+#endif
+    return pos; // 11+4(+4)=15(19)
 }
 
-static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, uint16_t control){
+static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, l2cap_supervisory_function_t supervisory_function, int poll, int final, uint16_t req_seq){
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    if (channel->extended_control){
+        uint32_t control = l2cap_extended_control_field_for_supevisor_frame(supervisory_function, poll, final, req_seq);
+        log_info("S-Frame: control 0x%08x", control);
+        little_endian_store_32(acl_buffer, 8, control);
+        return l2cap_send_prepared(channel->local_cid, 4);
+    }
+#endif
+    uint16_t control = l2cap_encanced_control_field_for_supevisor_frame(supervisory_function, poll, final, req_seq);
     log_info("S-Frame: control 0x%04x", control);
     little_endian_store_16(acl_buffer, 8, control);
     return l2cap_send_prepared(channel->local_cid, 2);
@@ -570,7 +725,13 @@ static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_c
     channel->local_retransmission_timeout_ms = ertm_config->retransmission_timeout_ms;
     channel->local_monitor_timeout_ms = ertm_config->monitor_timeout_ms;
     channel->local_mtu = ertm_config->local_mtu;
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    // limited to 63 when sending config request if Extended Control Field is not used
     channel->num_rx_buffers = ertm_config->num_rx_buffers;
+#else
+    // TxWindow is limited to 63 without Extended Control Field
+    channel->num_rx_buffers = btstack_min(ertm_config->num_rx_buffers, 63);
+#endif
     channel->num_tx_buffers = ertm_config->num_tx_buffers;
 
     // align buffer to 16-byte boundary to assert l2cap_ertm_rx_packet_state_t is aligned
@@ -581,19 +742,22 @@ static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_c
     // setup state buffers - use void cast to avoid -Wcast-align warning
     uint32_t pos = 0;
     channel->rx_packets_state = (l2cap_ertm_rx_packet_state_t *) (void *) &buffer[pos];
-    pos += ertm_config->num_rx_buffers * sizeof(l2cap_ertm_rx_packet_state_t);
+    pos += channel->num_rx_buffers * sizeof(l2cap_ertm_rx_packet_state_t);
     channel->tx_packets_state = (l2cap_ertm_tx_packet_state_t *) (void *) &buffer[pos];
     pos += ertm_config->num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t);
 
+    // buffer may be re-used from a previous channel, reset out-of-order and retransmission state
+    memset(buffer, 0, pos);
+
     // setup reassembly buffer
     channel->reassembly_buffer = &buffer[pos];
     pos += ertm_config->local_mtu;
 
     // divide rest of data equally
-    channel->local_mps = (size - pos) / (ertm_config->num_rx_buffers + ertm_config->num_tx_buffers);
+    channel->local_mps = (size - pos) / (channel->num_rx_buffers + ertm_config->num_tx_buffers);
     log_info("Local MPS: %u", channel->local_mps);
     channel->rx_packets_data = &buffer[pos];
-    pos += ertm_config->num_rx_buffers * channel->local_mps;
+    pos += channel->num_rx_buffers * channel->local_mps;
     channel->tx_packets_data = &buffer[pos];
 
     channel->fcs_option = ertm_config->fcs_option;
@@ -721,7 +885,7 @@ uint8_t l2cap_ertm_set_ready(uint16_t local_cid){
 }
 
 // Process-ReqSeq
-static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t req_seq){
+static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint16_t req_seq){
     int num_buffers_acked = 0;
     l2cap_ertm_tx_packet_state_t * tx_state;
     log_info("l2cap_ertm_process_req_seq: tx_read_index %u, tx_write_index %u, req_seq %u", l2cap_channel->tx_read_index, l2cap_channel->tx_write_index, req_seq);
@@ -736,7 +900,7 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
 
         tx_state = &l2cap_channel->tx_packets_state[l2cap_channel->tx_read_index];
         // calc delta
-        int delta = (req_seq - tx_state->tx_seq) & 0x03f;
+        int delta = (req_seq - tx_state->tx_seq) & l2cap_ertm_seq_nr_mask(l2cap_channel);
         if (delta == 0) break;  // all packets acknowledged
         if (delta > l2cap_channel->remote_tx_window_size) break;   
 
@@ -746,7 +910,7 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
         log_info("RR seq %u => packet with tx_seq %u done", req_seq, tx_state->tx_seq);
 
         l2cap_channel->tx_read_index++;
-        if (l2cap_channel->tx_read_index >= l2cap_channel->num_rx_buffers){
+        if (l2cap_channel->tx_read_index >= l2cap_channel->num_tx_buffers){
             l2cap_channel->tx_read_index = 0;
         }
     }
@@ -756,25 +920,92 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
 }     
 }     
 
-static l2cap_ertm_tx_packet_state_t * l2cap_ertm_get_tx_state(l2cap_channel_t * l2cap_channel, uint8_t tx_seq){
+// stored frames are consecutive from tx_read_index, direct lookup by sequence number
+static l2cap_ertm_tx_packet_state_t * l2cap_ertm_get_tx_state(l2cap_channel_t * l2cap_channel, uint16_t tx_seq){
+    if (l2cap_channel->num_stored_tx_frames == 0) return NULL;
+    uint16_t oldest_tx_seq = l2cap_channel->tx_packets_state[l2cap_channel->tx_read_index].tx_seq;
+    int delta = (tx_seq - oldest_tx_seq) & l2cap_ertm_seq_nr_mask(l2cap_channel);
+    if (delta >= l2cap_channel->num_stored_tx_frames) return NULL;
+    int index = l2cap_channel->tx_read_index + delta;
+    if (index >= l2cap_channel->num_tx_buffers){
+        index -= l2cap_channel->num_tx_buffers;
+    }
+    return &l2cap_channel->tx_packets_state[index];
+}
+
+// @param delta number of frames after expected_tx_seq, 0 <= delta < num_rx_buffers
+static int l2cap_ertm_rx_index_for_delta(l2cap_channel_t * l2cap_channel, int delta){
+    int index = l2cap_channel->rx_store_index + delta;
+    if (index >= l2cap_channel->num_rx_buffers){
+        index -= l2cap_channel->num_rx_buffers;
+    }
+    return index;
+}
+
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+static void l2cap_ertm_srej_set_pending(l2cap_channel_t * l2cap_channel, int index){
+    l2cap_channel->srej_pending[index >> 3] |= 1u << (index & 7);
+}
+
+static void l2cap_ertm_srej_clear_pending(l2cap_channel_t * l2cap_channel, int index){
+    l2cap_channel->srej_pending[index >> 3] &= ~(1u << (index & 7));
+}
+
+static bool l2cap_ertm_srej_is_pending(l2cap_channel_t * l2cap_channel, int index){
+    return (l2cap_channel->srej_pending[index >> 3] & (1u << (index & 7))) != 0;
+}
+
+// request retransmission of all missing frames between the highest received one and tx_seq
+static void l2cap_ertm_srej_request_missing_frames(l2cap_channel_t * l2cap_channel, uint16_t tx_seq){
+    uint16_t mask = l2cap_ertm_seq_nr_mask(l2cap_channel);
+    int delta = (tx_seq - l2cap_channel->expected_tx_seq) & mask;
+    int tail_delta = (l2cap_channel->srej_tail_tx_seq - l2cap_channel->expected_tx_seq) & mask;
+    if (delta < tail_delta) return;
     int i;
-    for (i=0;i<l2cap_channel->num_tx_buffers;i++){
-        l2cap_ertm_tx_packet_state_t * tx_state = &l2cap_channel->tx_packets_state[i];
-        if (tx_state->tx_seq == tx_seq) return tx_state;
+    for (i = tail_delta; i < delta; i++){
+        int index = l2cap_ertm_rx_index_for_delta(l2cap_channel, i);
+        if (l2cap_channel->rx_packets_state[index].valid) continue;
+        l2cap_ertm_srej_set_pending(l2cap_channel, index);
     }
-    return NULL;
+    l2cap_channel->srej_tail_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, tx_seq);
 }
 
-// @param delta number of frames in the future, >= 1
-// @assumption size <= l2cap_channel->local_mps (checked in l2cap_acl_classic_handler)
+// request retransmission of all frames still missing, used after poll. returns number of requested frames
+static int l2cap_ertm_srej_request_all_missing_frames(l2cap_channel_t * l2cap_channel){
+    int tail_delta = (l2cap_channel->srej_tail_tx_seq - l2cap_channel->expected_tx_seq) & l2cap_ertm_seq_nr_mask(l2cap_channel);
+    int num_requested = 0;
+    int i;
+    for (i = 0; i < tail_delta; i++){
+        int index = l2cap_ertm_rx_index_for_delta(l2cap_channel, i);
+        if (l2cap_channel->rx_packets_state[index].valid) continue;
+        l2cap_ertm_srej_set_pending(l2cap_channel, index);
+        num_requested++;
+    }
+    return num_requested;
+}
+#endif
+
+// advance expected_tx_seq and req_seq, keeps SREJ tail within receive window
+static void l2cap_ertm_advance_expected_tx_seq(l2cap_channel_t * l2cap_channel){
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+    if (l2cap_channel->srej_tail_tx_seq == l2cap_channel->expected_tx_seq){
+        l2cap_channel->srej_tail_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->srej_tail_tx_seq);
+    }
+#endif
+    l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->expected_tx_seq);
+    l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+}
+
+// @param delta number of frames in the future, 1 <= delta < num_rx_buffers
 static void l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel_t * l2cap_channel, l2cap_segmentation_and_reassembly_t sar, int delta, const uint8_t * payload, uint16_t size){
     log_info("Store SDU with delta %u", delta);
-    // get rx state for packet to store
-    int index = l2cap_channel->rx_store_index + delta - 1;
-    if (index > l2cap_channel->num_rx_buffers){
-        index -= l2cap_channel->num_rx_buffers;
-    }
+    // rx buffer at rx_store_index is used for tx_seq == expected_tx_seq
+    int index = l2cap_ertm_rx_index_for_delta(l2cap_channel, delta);
     log_info("Index of packet to store %u", index);
+    if (size > l2cap_channel->local_mps){
+        log_error("Packet larger than rx buffer");
+        return;
+    }
     l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
     // check if buffer is free
     if (rx_state->valid){
@@ -784,8 +1015,11 @@ static void l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel_t * l2cap_channe
     rx_state->valid = 1;
     rx_state->sar = sar;
     rx_state->len = size;
-    uint8_t * rx_buffer = &l2cap_channel->rx_packets_data[index];
+    uint8_t * rx_buffer = &l2cap_channel->rx_packets_data[index * l2cap_channel->local_mps];
     (void)memcpy(rx_buffer, payload, size);
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+    l2cap_ertm_srej_clear_pending(l2cap_channel, index);
+#endif
 }
 
 // @assumption size <= l2cap_channel->local_mps (checked in l2cap_acl_classic_handler)
@@ -851,6 +1085,21 @@ static void l2cap_ertm_channel_send_information_frame(l2cap_channel_t * channel)
 
 #ifdef L2CAP_USES_CHANNELS
 static uint16_t l2cap_next_local_cid(void){
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    // stay within table, returns 0 if all local cids are in use
+    uint16_t i;
+    for (i = 0; i < L2CAP_LOCAL_CID_TABLE_SIZE; i++){
+        if (local_source_cid >= (0x40u + L2CAP_LOCAL_CID_TABLE_SIZE - 1u)) {
+            local_source_cid = 0x40;
+        } else {
+            local_source_cid++;
+        }
+        if (l2cap_channel_for_local_cid_table[local_source_cid - 0x40u] == NULL){
+            return local_source_cid;
+        }
+    }
+    return 0;
+#else
     do {
         if (local_source_cid == 0xffffu) {
             local_source_cid = 0x40;
@@ -859,6 +1108,7 @@ static uint16_t l2cap_next_local_cid(void){
         }
     } while (l2cap_get_channel_for_local_cid(local_source_cid) != NULL);
     return local_source_cid;
+#endif
 }
 #endif
 
@@ -875,9 +1125,19 @@ void l2cap_init(void){
     signaling_responses_pending = 0;
 #ifdef L2CAP_USES_CHANNELS
     local_source_cid  = 0x40;
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    memset(l2cap_channel_for_local_cid_table, 0, sizeof(l2cap_channel_for_local_cid_table));
+    memset(l2cap_channels_for_con_handle, 0, sizeof(l2cap_channels_for_con_handle));
+#endif
 #endif
     sig_seq_nr  = 0xff;
     l2cap_channels = NULL;
+#ifdef ENABLE_L2CAP_ERTM_FCS_SLICE_BY_8
+    crc16_init_slice_table();
+#endif
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+    l2cap_scheduler_last_cid = 0;
+#endif
 
 #ifdef ENABLE_CLASSIC
     l2cap_services = NULL;
@@ -1116,6 +1376,28 @@ static void l2cap_handle_channel_closed(l2cap_channel_t * channel){
 #endif
 
 static l2cap_fixed_channel_t * l2cap_channel_item_by_cid(uint16_t cid){
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    switch (cid){
+#ifdef ENABLE_CLASSIC
+        case L2CAP_CID_CONNECTIONLESS_CHANNEL:
+            return &l2cap_fixed_channel_connectionless;
+#endif
+#ifdef ENABLE_BLE
+        case L2CAP_CID_ATTRIBUTE_PROTOCOL:
+            return &l2cap_fixed_channel_att;
+        case L2CAP_CID_SECURITY_MANAGER_PROTOCOL:
+            return &l2cap_fixed_channel_sm;
+#endif
+        default:
+            break;
+    }
+#ifdef L2CAP_USES_CHANNELS
+    if ((cid >= 0x40u) && (cid < (0x40u + L2CAP_LOCAL_CID_TABLE_SIZE))){
+        return (l2cap_fixed_channel_t *) l2cap_channel_for_local_cid_table[cid - 0x40u];
+    }
+#endif
+    return NULL;
+#else
     btstack_linked_list_iterator_t it;    
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -1125,6 +1407,7 @@ static l2cap_fixed_channel_t * l2cap_channel_item_by_cid(uint16_t cid){
         }
     } 
     return NULL;
+#endif
 }
 
 // used for fixed channels in LE (ATT/SM) and Classic (Connectionless Channel). CID < 0x04
@@ -1148,6 +1431,63 @@ static l2cap_channel_t * l2cap_get_channel_for_local_cid_and_handle(uint16_t loc
     return l2cap_channel;
 }
 
+// iterate over dynamic channels for con handle, start with channel = NULL
+// next channel is looked up before the current one is closed, see HCI_EVENT_DISCONNECTION_COMPLETE
+static l2cap_channel_t * l2cap_get_next_channel_for_con_handle(hci_con_handle_t con_handle, l2cap_channel_t * channel){
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    if (channel == NULL){
+        channel = l2cap_channels_for_con_handle[con_handle % L2CAP_CON_HANDLE_HASH_SIZE];
+    } else {
+        channel = channel->con_handle_next;
+    }
+    while (channel != NULL){
+        if (channel->con_handle == con_handle) break;
+        channel = channel->con_handle_next;
+    }
+    return channel;
+#else
+    btstack_linked_item_t * item;
+    if (channel == NULL){
+        item = l2cap_channels;
+    } else {
+        item = channel->item.next;
+    }
+    while (item != NULL){
+        channel = (l2cap_channel_t *) item;
+        if (l2cap_is_dynamic_channel_type(channel->channel_type) && (channel->con_handle == con_handle)) {
+            return channel;
+        }
+        item = item->next;
+    }
+    return NULL;
+#endif
+}
+
+static void l2cap_channel_set_con_handle(l2cap_channel_t * channel, hci_con_handle_t con_handle){
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    if (channel->con_handle == con_handle) return;
+    // unlink from current bucket
+    if (channel->con_handle != HCI_CON_HANDLE_INVALID){
+        l2cap_channel_t ** it = &l2cap_channels_for_con_handle[channel->con_handle % L2CAP_CON_HANDLE_HASH_SIZE];
+        while (*it != NULL){
+            if (*it == channel){
+                *it = channel->con_handle_next;
+                break;
+            }
+            it = &(*it)->con_handle_next;
+        }
+        channel->con_handle_next = NULL;
+    }
+    // add to new bucket
+    if (con_handle != HCI_CON_HANDLE_INVALID){
+        l2cap_channel_t ** head = &l2cap_channels_for_con_handle[con_handle % L2CAP_CON_HANDLE_HASH_SIZE];
+        channel->con_handle_next = *head;
+        *head = channel;
+    }
+#endif
+    channel->con_handle = con_handle;
+}
+
 void l2cap_request_can_send_now_event(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return;
@@ -1158,6 +1498,10 @@ void l2cap_request_can_send_now_event(uint16_t local_cid){
         return;
     }
 #endif        
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+    // HCI shares Controller ACL buffers between connections waiting to send
+    hci_request_can_send_now_event(channel->con_handle);
+#endif
     l2cap_notify_channel_can_send();
 }
 
@@ -1455,6 +1799,10 @@ static uint32_t l2cap_extended_features_mask(void){
     uint32_t features = 0x280;
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     features |= 0x0028;
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    // Extended Window Size
+    features |= 0x0100;
+#endif
 #endif
     return features;
 }
@@ -1466,7 +1814,9 @@ static uint32_t l2cap_extended_features_mask(void){
 // returns true if channel was finalized
 static bool l2cap_run_for_classic_channel(l2cap_channel_t * channel){
 
-#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    uint8_t  config_options[22];
+#elif defined(ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE)
     uint8_t  config_options[18];
 #else
     uint8_t  config_options[10];
@@ -1611,40 +1961,51 @@ static void l2cap_run_for_classic_channel_ertm(l2cap_channel_t * channel){
     if (channel->send_supervisor_frame_receiver_ready){
         channel->send_supervisor_frame_receiver_ready = 0;
         log_info("Send S-Frame: RR %u, final %u", channel->req_seq, channel->set_final_bit_after_packet_with_poll_bit_set);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0,  channel->set_final_bit_after_packet_with_poll_bit_set, channel->req_seq);
+        uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
         channel->set_final_bit_after_packet_with_poll_bit_set = 0;
-        l2cap_ertm_send_supervisor_frame(channel, control);
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0, final, channel->req_seq);
         return;
     }
     if (channel->send_supervisor_frame_receiver_ready_poll){
         channel->send_supervisor_frame_receiver_ready_poll = 0;
         log_info("Send S-Frame: RR %u with poll=1 ", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
-        l2cap_ertm_send_supervisor_frame(channel, control);
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
         return;
     }
     if (channel->send_supervisor_frame_receiver_not_ready){
         channel->send_supervisor_frame_receiver_not_ready = 0;
         log_info("Send S-Frame: RNR %u", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
-        l2cap_ertm_send_supervisor_frame(channel, control);
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
         return;
     }
     if (channel->send_supervisor_frame_reject){
         channel->send_supervisor_frame_reject = 0;
         log_info("Send S-Frame: REJ %u", channel->req_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
-        l2cap_ertm_send_supervisor_frame(channel, control);
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
         return;
     }
     if (channel->send_supervisor_frame_selective_reject){
         channel->send_supervisor_frame_selective_reject = 0;
         log_info("Send S-Frame: SREJ %u", channel->expected_tx_seq);
-        uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, channel->set_final_bit_after_packet_with_poll_bit_set, channel->expected_tx_seq);
+        uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
+        channel->set_final_bit_after_packet_with_poll_bit_set = 0;
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, final, channel->expected_tx_seq);
+        return;
+    }
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+    int delta;
+    for (delta = 0; delta < channel->num_rx_buffers; delta++){
+        int index = l2cap_ertm_rx_index_for_delta(channel, delta);
+        if (!l2cap_ertm_srej_is_pending(channel, index)) continue;
+        l2cap_ertm_srej_clear_pending(channel, index);
+        uint16_t req_seq = (channel->expected_tx_seq + delta) & l2cap_ertm_seq_nr_mask(channel);
+        log_info("Send S-Frame: SREJ %u", req_seq);
+        uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
         channel->set_final_bit_after_packet_with_poll_bit_set = 0;
-        l2cap_ertm_send_supervisor_frame(channel, control);
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, final, req_seq);
         return;
     }
+#endif
 
     if (channel->srej_active){
         int i;
@@ -1686,6 +2047,9 @@ static void l2cap_run_signaling_response(void) {
         uint16_t info_type     = signaling_responses[0].data;  // INFORMATION_REQUEST
         uint16_t source_cid    = signaling_responses[0].cid;   // CONNECTION_REQUEST
 #endif
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+        uint16_t num_channels  = signaling_responses[0].cid;   // CREDIT_BASED_CONNECTION_REQUEST
+#endif
 
         // remove first item before sending (to avoid sending response mutliple times)
         signaling_responses_pending--;
@@ -1744,6 +2108,18 @@ static void l2cap_run_signaling_response(void) {
             case COMMAND_REJECT_LE:
                 l2cap_send_le_signaling_packet(handle, COMMAND_REJECT, sig_id, result, 0, NULL);
                 break;
+#endif
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+            case CREDIT_BASED_CONNECTION_REQUEST: {
+                // all channels refused, one destination cid 0x0000 for each requested channel
+                uint8_t destination_cids[2 * L2CAP_ECBFC_MAX_CHANNELS];
+                memset(destination_cids, 0, sizeof(destination_cids));
+                l2cap_send_le_signaling_packet(handle, CREDIT_BASED_CONNECTION_RESPONSE, sig_id, 0, 0, 0, result, 2u * num_channels, destination_cids);
+                break;
+            }
+            case CREDIT_BASED_RECONFIGURE_REQUEST:
+                l2cap_send_le_signaling_packet(handle, CREDIT_BASED_RECONFIGURE_RESPONSE, sig_id, result);
+                break;
 #endif
             default:
                 // should not happen
@@ -1778,10 +2154,25 @@ static void l2cap_run_le_data_channels(void){
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
         uint16_t mps;
+        uint16_t credits;
         l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
 
         if (channel->channel_type != L2CAP_CHANNEL_TYPE_LE_DATA_CHANNEL) continue;
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+        // connection request and response cover all channels of a request, see l2cap_run_ecbfc
+        if (channel->ecbfc){
+            switch (channel->state){
+                case L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST:
+                case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
+                case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_DECLINE:
+                    continue;
+                default:
+                    break;
+            }
+        }
+#endif
+
         // log_info("l2cap_run: channel %p, state %u, var 0x%02x", channel, channel->state, channel->state_var);
         switch (channel->state){
             case L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST:
@@ -1789,19 +2180,17 @@ static void l2cap_run_le_data_channels(void){
                 channel->state = L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE;
                 // le psm, source cid, mtu, mps, initial credits
                 channel->local_sig_id = l2cap_next_sig_id();
-                channel->credits_incoming =  channel->new_credits_incoming;
-                channel->new_credits_incoming = 0;
-                mps = btstack_min(l2cap_max_le_mtu(), channel->local_mtu);
-                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, mps, channel->credits_incoming);
+                credits = l2cap_le_take_initial_credits(channel);
+                mps = l2cap_le_local_mps(channel);
+                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, mps, credits);
                 break;
             case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
                 // TODO: support larger MPS
                 channel->state = L2CAP_STATE_OPEN;
-                channel->credits_incoming =  channel->new_credits_incoming;
-                channel->new_credits_incoming = 0;
-                mps = btstack_min(l2cap_max_le_mtu(), channel->local_mtu);
-                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, mps, channel->credits_incoming, 0);
+                credits = l2cap_le_take_initial_credits(channel);
+                mps = l2cap_le_local_mps(channel);
+                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, mps, credits, 0);
                 // notify client
                 l2cap_emit_le_channel_opened(channel, 0);
                 break;
@@ -1881,6 +2270,11 @@ static void l2cap_run(void){
     }
 #endif
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+    while (l2cap_run_ecbfc()){
+    }
+#endif
+
 #ifdef ENABLE_LE_DATA_CHANNELS
     l2cap_run_le_data_channels();
 #endif
@@ -1900,6 +2294,7 @@ static void l2cap_run(void){
                 break;
             case CON_PARAMETER_UPDATE_SEND_RESPONSE:
                 connection->le_con_parameter_update_state = CON_PARAMETER_UPDATE_CHANGE_HCI_CON_PARAMETERS;
+                hci_connection_set_dirty(connection);
                 l2cap_send_le_signaling_packet(connection->con_handle, CONNECTION_PARAMETER_UPDATE_RESPONSE, connection->le_con_param_update_identifier, 0);
                 break;
             case CON_PARAMETER_UPDATE_DENY:
@@ -1920,7 +2315,7 @@ static void l2cap_handle_connection_complete(hci_con_handle_t con_handle, l2cap_
     if ((channel->state == L2CAP_STATE_WAIT_CONNECTION_COMPLETE) || (channel->state == L2CAP_STATE_WILL_SEND_CREATE_CONNECTION)) {
         log_info("connection complete con_handle %04x - for channel %p cid 0x%04x", (int) con_handle, channel, channel->local_cid);
         // success, start l2cap handshake
-        channel->con_handle = con_handle;
+        l2cap_channel_set_con_handle(channel, con_handle);
         // check remote SSP feature first
         channel->state = L2CAP_STATE_WAIT_REMOTE_SUPPORTED_FEATURES;
     }
@@ -1961,6 +2356,15 @@ static void l2cap_handle_remote_supported_features_received(l2cap_channel_t * ch
 static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t packet_handler, l2cap_channel_type_t channel_type, bd_addr_t address, bd_addr_type_t address_type, 
     uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level){
 
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    // check for free local cid first
+    uint16_t local_cid = l2cap_next_local_cid();
+    if (local_cid == 0u){
+        log_error("no free local cid");
+        return NULL;
+    }
+#endif
+
     l2cap_channel_t * channel = btstack_memory_l2cap_channel_get();
     if (!channel) {
         return NULL;
@@ -1977,8 +2381,16 @@ static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t pac
     channel->required_security_level = security_level;
 
     // 
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    channel->local_cid = local_cid;
+    l2cap_channel_for_local_cid_table[local_cid - 0x40u] = channel;
+#else
     channel->local_cid = l2cap_next_local_cid();
+#endif
     channel->con_handle = HCI_CON_HANDLE_INVALID;
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    channel->con_handle_next = NULL;
+#endif
 
     // set initial state
     channel->state = L2CAP_STATE_WILL_SEND_CREATE_CONNECTION;
@@ -1999,6 +2411,10 @@ static void l2cap_free_channel_entry(l2cap_channel_t * channel){
     l2cap_ertm_stop_retransmission_timer(channel);
     l2cap_ertm_stop_monitor_timer(channel);
 #endif
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    l2cap_channel_for_local_cid_table[channel->local_cid - 0x40u] = NULL;
+#endif
+    l2cap_channel_set_con_handle(channel, HCI_CON_HANDLE_INVALID);
     // free  memory
     btstack_memory_l2cap_channel_free(channel);
 }
@@ -2141,7 +2557,11 @@ static bool l2cap_channel_ready_to_send(l2cap_channel_t * channel){
             }
 #endif
             if (!channel->waiting_for_can_send_now) return false;
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+            return hci_can_send_acl_packet_now(channel->con_handle) != 0;
+#else
             return (hci_can_send_acl_classic_packet_now() != 0);
+#endif
         case L2CAP_CHANNEL_TYPE_CONNECTIONLESS:
             if (!channel->waiting_for_can_send_now) return false;
             return hci_can_send_acl_classic_packet_now() != 0;
@@ -2153,7 +2573,7 @@ static bool l2cap_channel_ready_to_send(l2cap_channel_t * channel){
 #ifdef ENABLE_LE_DATA_CHANNELS
         case L2CAP_CHANNEL_TYPE_LE_DATA_CHANNEL:
             if (channel->state != L2CAP_STATE_OPEN) return false;
-            if (channel->send_sdu_buffer == NULL) return false;
+            if (channel->send_sdu_segments == NULL) return false;
             if (channel->credits_outgoing == 0u) return false;
             return hci_can_send_acl_le_packet_now() != 0;
 #endif
@@ -2197,7 +2617,67 @@ static void l2cap_channel_trigger_send(l2cap_channel_t * channel){
     }
 }
 
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+// select ready channel with highest priority, channels with same priority are served round robin in list order
+// starting after the last served channel, which is identified by its local cid as it might have been freed since
+static l2cap_channel_t * l2cap_scheduler_select_channel(void){
+    l2cap_channel_t * selected = NULL;
+    bool selected_after_last = false;
+    bool after_last = false;
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) l2cap_channels; it != NULL; it = it->next){
+        l2cap_channel_t * channel = (l2cap_channel_t *) it;
+        if (l2cap_channel_ready_to_send(channel)){
+            channel->scheduler_counters.requests_queued++;
+            bool select;
+            if (selected == NULL){
+                select = true;
+            } else if (channel->scheduler_priority != selected->scheduler_priority){
+                select = channel->scheduler_priority > selected->scheduler_priority;
+            } else {
+                select = after_last && !selected_after_last;
+            }
+            if (select){
+                selected = channel;
+                selected_after_last = after_last;
+            }
+        }
+        if (channel->local_cid == l2cap_scheduler_last_cid){
+            after_last = true;
+        }
+    }
+    if (selected != NULL){
+        selected->scheduler_counters.requests_queued--;
+    }
+    return selected;
+}
+
+uint8_t l2cap_scheduler_set_priority(uint16_t local_cid, uint8_t priority){
+    l2cap_channel_t * channel = (l2cap_channel_t *) l2cap_channel_item_by_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    channel->scheduler_priority = priority;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_scheduler_get_counters(uint16_t local_cid, l2cap_scheduler_counters_t * counters){
+    l2cap_channel_t * channel = (l2cap_channel_t *) l2cap_channel_item_by_cid(local_cid);
+    if (channel == NULL) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    *counters = channel->scheduler_counters;
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+
 static void l2cap_notify_channel_can_send(void){
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+    // serve channels until no channel is ready, e.g. because ACL buffers are used up
+    while (true){
+        l2cap_channel_t * channel = l2cap_scheduler_select_channel();
+        if (channel == NULL) break;
+        l2cap_scheduler_last_cid = channel->local_cid;
+        channel->scheduler_counters.packets_sent++;
+        l2cap_channel_trigger_send(channel);
+    }
+#else
     bool done = false;
     while (!done){
         done = true;
@@ -2220,6 +2700,7 @@ static void l2cap_notify_channel_can_send(void){
             break;
         }
     }
+#endif
 }
 
 #ifdef L2CAP_USES_CHANNELS
@@ -2298,11 +2779,10 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
 #ifdef ENABLE_CLASSIC
     bd_addr_t address;
     hci_connection_t * hci_connection;
-    int hci_con_used;
 #endif
 #ifdef L2CAP_USES_CHANNELS
     hci_con_handle_t handle;
-    btstack_linked_list_iterator_t it;
+    l2cap_channel_t * channel;
 #endif
 
     switch(hci_event_packet_get_type(packet)){
@@ -2310,6 +2790,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
         // Notify channel packet handler if they can send now
         case HCI_EVENT_TRANSPORT_PACKET_SENT:
         case HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS:
+        case HCI_EVENT_ACL_CAN_SEND_NOW:
         case BTSTACK_EVENT_NR_CONNECTIONS_CHANGED:
             l2cap_run();    // try sending signaling packets first
             l2cap_notify_channel_can_send();
@@ -2362,12 +2843,10 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
         case HCI_EVENT_DISCONNECTION_COMPLETE:
             handle = little_endian_read_16(packet, 3);
             // send l2cap open failed or closed events for all channels on this handle and free them
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
-                if (channel->con_handle != handle) continue;
-                btstack_linked_list_iterator_remove(&it);
+            channel = l2cap_get_next_channel_for_con_handle(handle, NULL);
+            while (channel != NULL){
+                l2cap_channel_t * next_channel = l2cap_get_next_channel_for_con_handle(handle, channel);
+                btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
                 switch(channel->channel_type){
 #ifdef ENABLE_CLASSIC
                     case L2CAP_CHANNEL_TYPE_CLASSIC:
@@ -2382,6 +2861,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
                     default:
                         break;
                 }
+                channel = next_channel;
             }
             break;
 #endif
@@ -2393,16 +2873,8 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
             handle = little_endian_read_16(packet, 2);
             if (gap_get_connection_type(handle) != GAP_CONNECTION_ACL) break;
             if (hci_authentication_active_for_handle(handle)) break;
-            hci_con_used = 0;
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
-                if (channel->con_handle != handle) continue;
-                hci_con_used = 1;
-                break;
-            }
-            if (hci_con_used) break;
+            // connection still used by a channel
+            if (l2cap_get_next_channel_for_con_handle(handle, NULL) != NULL) break;
             if (!hci_can_send_command_packet_now()) break;
             hci_send_cmd(&hci_disconnect, handle, 0x13); // remote closed connection             
             break;
@@ -2413,11 +2885,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
             hci_connection = hci_connection_for_handle(handle);
             if (hci_connection == NULL) break;
             if ((hci_connection->bonding_flags & BONDING_RECEIVED_REMOTE_FEATURES) == 0) break;
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
-                if (channel->con_handle != handle) continue;
+            for (channel = l2cap_get_next_channel_for_con_handle(handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(handle, channel)){
                 log_info("remote supported features, channel %p, cid %04x - state %u", channel, channel->local_cid, channel->state);
                 l2cap_handle_remote_supported_features_received(channel);
             }
@@ -2426,11 +2894,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
         case GAP_EVENT_SECURITY_LEVEL:
             handle = little_endian_read_16(packet, 2);
             log_info("l2cap - security level update for handle 0x%04x", handle);
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
-                if (channel->con_handle != handle) continue;
+            for (channel = l2cap_get_next_channel_for_con_handle(handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(handle, channel)){
 
                 gap_security_level_t actual_level = (gap_security_level_t) packet[4];
                 gap_security_level_t required_level = channel->required_security_level;
@@ -2527,7 +2991,7 @@ static void l2cap_handle_connection_request(hci_con_handle_t handle, uint8_t sig
         return;
     }
 
-    channel->con_handle = handle;
+    l2cap_channel_set_con_handle(channel, handle);
     channel->remote_cid = source_cid;
     channel->remote_sig_id = sig_id; 
 
@@ -2584,6 +3048,9 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     uint8_t use_fcs = 1;
 #endif
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    uint16_t extended_window_size = 0;
+#endif
 
     channel->remote_sig_id = command[L2CAP_SIGNALING_COMMAND_SIGID_OFFSET];
 
@@ -2666,6 +3133,12 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
             use_fcs = command[pos];
         }        
 #endif        
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+        // Extended Window Size { type(8): 7, len(8): 2, Max Window Size(16) }
+        if ((option_type == L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE) && (length == 2)){
+            extended_window_size = little_endian_read_16(command, pos) & 0x3fff;
+        }
+#endif
         // check for unknown options
         if ((option_hint == 0) && ((option_type < L2CAP_CONFIG_OPTION_TYPE_MAX_TRANSMISSION_UNIT) || (option_type > L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE))){
             log_info("l2cap cid %u, unknown options", channel->local_cid);
@@ -2684,6 +3157,14 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
             channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
         }
 #endif
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+        // Extended Window Size option replaces TxWindow of Retransmission and Flow Control option, both sides use Extended Control Field
+        if ((extended_window_size > 0) && (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION)){
+            log_info("Extended window size %u", extended_window_size);
+            channel->remote_tx_window_size = extended_window_size;
+            channel->extended_control = 1;
+        }
+#endif
 }
 
 // @pre command len is valid, see check in l2cap_signaling_handler_channel
@@ -2918,7 +3399,9 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
 // @pre command len is valid, see check in l2cap_acl_classic_handler
 static void l2cap_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t * command){
     
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     btstack_linked_list_iterator_t it;    
+#endif
 
     // get code, signalind identifier and command len
     uint8_t code     = command[L2CAP_SIGNALING_COMMAND_CODE_OFFSET];
@@ -3029,24 +3512,20 @@ static void l2cap_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t *
     uint16_t dest_cid = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET);
     
     // Find channel for this sig_id and connection handle
-    btstack_linked_list_iterator_init(&it, &l2cap_channels);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-        if (!l2cap_is_dynamic_channel_type(channel->channel_type)) continue;
-        if (channel->con_handle != handle) continue;
-        if (code & 1) {
-            // match odd commands (responses) by previous signaling identifier 
-            if (channel->local_sig_id == sig_id) {
-                l2cap_signaling_handler_channel(channel, command);
-                break;
-            }
-        } else {
-            // match even commands (requests) by local channel id
-            if (channel->local_cid == dest_cid) {
-                l2cap_signaling_handler_channel(channel, command);
-                break;
-            }
+    l2cap_channel_t * channel;
+    if (code & 1) {
+        // match odd commands (responses) by previous signaling identifier 
+        channel = l2cap_get_next_channel_for_con_handle(handle, NULL);
+        while (channel != NULL){
+            if (channel->local_sig_id == sig_id) break;
+            channel = l2cap_get_next_channel_for_con_handle(handle, channel);
         }
+    } else {
+        // match even commands (requests) by local channel id
+        channel = l2cap_get_channel_for_local_cid_and_handle(dest_cid, handle);
+    }
+    if (channel != NULL){
+        l2cap_signaling_handler_channel(channel, command);
     }
 }
 #endif
@@ -3071,7 +3550,6 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
     uint8_t  event[12];
 
 #ifdef ENABLE_LE_DATA_CHANNELS
-    btstack_linked_list_iterator_t it;    
     l2cap_channel_t * channel;
     uint16_t local_cid;
     uint16_t le_psm;
@@ -3137,29 +3615,22 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
 #ifdef ENABLE_LE_DATA_CHANNELS
 
         case COMMAND_REJECT:
-            // Find channel for this sig_id and connection handle
-            channel = NULL;
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * a_channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(a_channel->channel_type)) continue;
-                if (a_channel->con_handle   != handle) continue;
-                if (a_channel->local_sig_id != sig_id) continue;
-                channel = a_channel;
-                break; 
-            }
-            if (!channel) break;
-
-            // if received while waiting for le connection response, assume legacy device
-            if (channel->state == L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE){
-                channel->state = L2CAP_STATE_CLOSED;
-                // no official value for this, use: Connection refused – LE_PSM not supported - 0x0002
-                l2cap_emit_le_channel_opened(channel, 0x0002);
-                                
-                // discard channel
-                btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
-                l2cap_free_channel_entry(channel);
-                break;
+            // Find channels for this sig_id and connection handle, a credit based connection request covers multiple channels
+            channel = l2cap_get_next_channel_for_con_handle(handle, NULL);
+            while (channel != NULL){
+                l2cap_channel_t * next_channel = l2cap_get_next_channel_for_con_handle(handle, channel);
+
+                // if received while waiting for le connection response, assume legacy device
+                if ((channel->local_sig_id == sig_id) && (channel->state == L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE)){
+                    channel->state = L2CAP_STATE_CLOSED;
+                    // no official value for this, use: Connection refused – LE_PSM not supported - 0x0002
+                    l2cap_emit_le_channel_opened(channel, 0x0002);
+
+                    // discard channel
+                    btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                    l2cap_free_channel_entry(channel);
+                }
+                channel = next_channel;
             }
             break;
 
@@ -3184,48 +3655,18 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
                 }
 
                 // go through list of channels for this ACL connection and check if we get a match
-                btstack_linked_list_iterator_init(&it, &l2cap_channels);
-                while (btstack_linked_list_iterator_has_next(&it)){
-                    l2cap_channel_t * a_channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                    if (!l2cap_is_dynamic_channel_type(a_channel->channel_type)) continue;
-                    if (a_channel->con_handle != handle) continue;
-                    if (a_channel->remote_cid != source_cid) continue;
+                for (channel = l2cap_get_next_channel_for_con_handle(handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(handle, channel)){
+                    if (channel->remote_cid != source_cid) continue;
                     // 0x000a Connection refused - Source CID already allocated
                     l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x000a);
                     return 1;
                 }                    
 
-                // security: check encryption
-                if (service->required_security_level >= LEVEL_2){
-                    if (gap_encryption_key_size(handle) == 0){
-                        // 0x0008 Connection refused - insufficient encryption 
-                        l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x0008);
-                        return 1;
-                    }
-                    // anything less than 16 byte key size is insufficient
-                    if (gap_encryption_key_size(handle) < 16){
-                        // 0x0007 Connection refused – insufficient encryption key size
-                        l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x0007);
-                        return 1;
-                    }
-                }
-
-                // security: check authencation
-                if (service->required_security_level >= LEVEL_3){
-                    if (!gap_authenticated(handle)){
-                        // 0x0005 Connection refused – insufficient authentication
-                        l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x0005);
-                        return 1;
-                    }
-                }
-
-                // security: check authorization
-                if (service->required_security_level >= LEVEL_4){
-                    if (gap_authorization_state(handle) != AUTHORIZATION_GRANTED){
-                        // 0x0006 Connection refused – insufficient authorization
-                        l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x0006);
-                        return 1;
-                    }
+                // security: check encryption, authentication and authorization
+                result = l2cap_le_security_check(handle, service);
+                if (result != 0u){
+                    l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, result);
+                    return 1;
                 }
 
                 // allocate channel
@@ -3237,7 +3678,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
                     return 1;
                 }
 
-                channel->con_handle = handle;
+                l2cap_channel_set_con_handle(channel, handle);
                 channel->remote_cid = source_cid;
                 channel->remote_sig_id = sig_id; 
                 channel->remote_mtu = little_endian_read_16(command, 8);
@@ -3246,7 +3687,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
 
                 // set initial state
                 channel->state      = L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT;
-                channel->state_var |= L2CAP_CHANNEL_STATE_VAR_INCOMING;
+                channel->state_var = (L2CAP_CHANNEL_STATE_VAR) (channel->state_var | L2CAP_CHANNEL_STATE_VAR_INCOMING);
 
                 // add to connections list
                 btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
@@ -3265,15 +3706,10 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
             if (len < 10u) return 0u;
 
             // Find channel for this sig_id and connection handle
-            channel = NULL;
-            btstack_linked_list_iterator_init(&it, &l2cap_channels);
-            while (btstack_linked_list_iterator_has_next(&it)){
-                l2cap_channel_t * a_channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-                if (!l2cap_is_dynamic_channel_type(a_channel->channel_type)) continue;
-                if (a_channel->con_handle   != handle) continue;
-                if (a_channel->local_sig_id != sig_id) continue;
-                channel = a_channel;
-                break; 
+            channel = l2cap_get_next_channel_for_con_handle(handle, NULL);
+            while (channel != NULL){
+                if (channel->local_sig_id == sig_id) break;
+                channel = l2cap_get_next_channel_for_con_handle(handle, channel);
             }
             if (!channel) break;
 
@@ -3322,6 +3758,31 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
             log_info("l2cap: %u credits for 0x%02x, now %u", new_credits, local_cid, channel->credits_outgoing);
             break;
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+        case CREDIT_BASED_CONNECTION_REQUEST:
+            // check size: spsm, mtu, mps, initial credits, at least one source cid
+            if (len < 10u) return 0u;
+            l2cap_ecbfc_handle_connection_request(handle, sig_id, command, len);
+            break;
+
+        case CREDIT_BASED_CONNECTION_RESPONSE:
+            // check size: mtu, mps, initial credits, result
+            if (len < 8u) return 0u;
+            l2cap_ecbfc_handle_connection_response(handle, sig_id, command, len);
+            break;
+
+        case CREDIT_BASED_RECONFIGURE_REQUEST:
+            // check size: mtu, mps, at least one destination cid
+            if (len < 6u) return 0u;
+            result = l2cap_ecbfc_handle_reconfigure_request(handle, command, len);
+            l2cap_register_signaling_response(handle, CREDIT_BASED_RECONFIGURE_REQUEST, sig_id, 0, result);
+            break;
+
+        case CREDIT_BASED_RECONFIGURE_RESPONSE:
+            // we don't send reconfigure requests
+            break;
+#endif
+
         case DISCONNECTION_REQUEST:
 
             // check size
@@ -3361,9 +3822,10 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
     if (l2cap_channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
 
         int fcs_size = l2cap_channel->fcs_option ? 2 : 0;
+        uint16_t control_size = l2cap_ertm_control_field_size(l2cap_channel);
 
         // assert control + FCS fields are inside
-        if (size < COMPLETE_L2CAP_HEADER+2+fcs_size) return;
+        if (size < COMPLETE_L2CAP_HEADER+control_size+fcs_size) return;
 
         if (l2cap_channel->fcs_option){
             // verify FCS (required if one side requested it)
@@ -3390,13 +3852,35 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
         }
 
         // switch on packet type
-        uint16_t control = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
-        uint8_t  req_seq = (control >> 8) & 0x3f;
-        int final = (control >> 7) & 0x01;
+        uint32_t control;
+        uint16_t req_seq;
+        int final;
+        int poll;
+        uint16_t tx_seq;
+        l2cap_segmentation_and_reassembly_t sar;
+        l2cap_supervisory_function_t s;
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+        if (l2cap_channel->extended_control){
+            control = little_endian_read_32(packet, COMPLETE_L2CAP_HEADER);
+            req_seq = (control >> 2) & 0x3fff;
+            final   = (control >> 1) & 0x01;
+            poll    = (control >> 18) & 0x01;
+            tx_seq  = (control >> 18) & 0x3fff;
+            sar     = (l2cap_segmentation_and_reassembly_t) ((control >> 16) & 0x03);
+            s       = (l2cap_supervisory_function_t) ((control >> 16) & 0x03);
+        } else
+#endif
+        {
+            control = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
+            req_seq = (control >> 8) & 0x3f;
+            final   = (control >> 7) & 0x01;
+            poll    = (control >> 4) & 0x01;
+            tx_seq  = (control >> 1) & 0x3f;
+            sar     = (l2cap_segmentation_and_reassembly_t) ((control >> 14) & 0x03);
+            s       = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
+        }
         if (control & 1){
             // S-Frame
-            int poll  = (control >> 4) & 0x01;
-            l2cap_supervisory_function_t s = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
             log_info("Control: 0x%04x => Supervisory function %u, ReqSeq %02u", control, (int) s, req_seq);
             l2cap_ertm_tx_packet_state_t * tx_state;
             switch (s){
@@ -3409,6 +3893,12 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
                         break;
                     }
                     if (poll){
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+                        // request all frames that are still missing, RR otherwise
+                        if (l2cap_ertm_srej_request_all_missing_frames(l2cap_channel) == 0){
+                            l2cap_channel->send_supervisor_frame_receiver_ready = 1;
+                        }
+#else
                         // check if we did request selective retransmission before <==> we have stored SDU segments
                         int i;
                         int num_stored_out_of_order_packets = 0;
@@ -3426,6 +3916,7 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
                         } else {
                             l2cap_channel->send_supervisor_frame_receiver_ready   = 1;
                         }
+#endif
                         l2cap_channel->set_final_bit_after_packet_with_poll_bit_set = 1;
                     }
                     if (final){
@@ -3467,9 +3958,6 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             }
         } else {
             // I-Frame
-            // get control
-            l2cap_segmentation_and_reassembly_t sar = (l2cap_segmentation_and_reassembly_t) (control >> 14);
-            uint8_t tx_seq = (control >> 1) & 0x3f;
             log_info("Control: 0x%04x => SAR %u, ReqSeq %02u, R?, TxSeq %02u", control, (int) sar, req_seq, tx_seq);
             log_info("SAR: pos %u", l2cap_channel->reassembly_pos);
             log_info("State: expected_tx_seq %02u, req_seq %02u", l2cap_channel->expected_tx_seq, l2cap_channel->req_seq);
@@ -3480,8 +3968,8 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             }
 
             // get SDU
-            const uint8_t * payload_data = &packet[COMPLETE_L2CAP_HEADER+2];
-            uint16_t        payload_len  = size-(COMPLETE_L2CAP_HEADER+2+fcs_size);
+            const uint8_t * payload_data = &packet[COMPLETE_L2CAP_HEADER+control_size];
+            uint16_t        payload_len  = size-(COMPLETE_L2CAP_HEADER+control_size+fcs_size);
 
             // assert SDU size is smaller or equal to our buffers
             uint16_t max_payload_size = 0;
@@ -3507,8 +3995,11 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
             // check ordering
             if (l2cap_channel->expected_tx_seq == tx_seq){
                 log_info("Received expected frame with TxSeq == ExpectedTxSeq == %02u", tx_seq);
-                l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
-                l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+                l2cap_ertm_advance_expected_tx_seq(l2cap_channel);
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+                l2cap_ertm_srej_clear_pending(l2cap_channel, l2cap_channel->rx_store_index);
+#endif
+                l2cap_channel->rx_store_index = l2cap_ertm_rx_index_for_delta(l2cap_channel, 1);
 
                 // process SDU
                 l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, sar, payload_data, payload_len);
@@ -3520,25 +4011,34 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
                     if (!rx_state->valid) break;
 
                     log_info("Processing stored frame with TxSeq == ExpectedTxSeq == %02u", l2cap_channel->expected_tx_seq);
-                    l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
-                    l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+                    l2cap_ertm_advance_expected_tx_seq(l2cap_channel);
 
                     rx_state->valid = 0;
-                    l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, &l2cap_channel->rx_packets_data[index], rx_state->len);
+                    l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, &l2cap_channel->rx_packets_data[index * l2cap_channel->local_mps], rx_state->len);
 
                     // update rx store index
-                    index++;
-                    if (index >= l2cap_channel->num_rx_buffers){
-                        index = 0;
-                    }
-                    l2cap_channel->rx_store_index = index;
+                    l2cap_channel->rx_store_index = l2cap_ertm_rx_index_for_delta(l2cap_channel, 1);
                 }
 
                 //
                 l2cap_channel->send_supervisor_frame_receiver_ready = 1;
 
             } else {
-                int delta = (tx_seq - l2cap_channel->expected_tx_seq) & 0x3f;
+                uint16_t mask = l2cap_ertm_seq_nr_mask(l2cap_channel);
+                int delta = (tx_seq - l2cap_channel->expected_tx_seq) & mask;
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+                if (delta < l2cap_channel->num_rx_buffers){
+                    // store segment and request missing frames
+                    l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, payload_data, payload_len);
+                    l2cap_ertm_srej_request_missing_frames(l2cap_channel, tx_seq);
+                    log_info("Received unexpected frame TxSeq %u but expected %u -> send S-SREJ", tx_seq, l2cap_channel->expected_tx_seq);
+                } else if (((l2cap_channel->expected_tx_seq - tx_seq) & mask) <= l2cap_channel->num_rx_buffers){
+                    log_info("Received duplicate frame TxSeq %u -> ignore", tx_seq);
+                } else {
+                    log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
+                    l2cap_channel->send_supervisor_frame_reject = 1;
+                }
+#else
                 if (delta < 2){
                     // store segment
                     l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, payload_data, payload_len);
@@ -3549,6 +4049,7 @@ static void l2cap_acl_classic_handler_for_channel(l2cap_channel_t * l2cap_channe
                     log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
                     l2cap_channel->send_supervisor_frame_reject = 1;
                 }
+#endif
             }
         }
         return;
@@ -3664,9 +4165,15 @@ static void l2cap_acl_le_handler(hci_con_handle_t handle, uint8_t *packet, uint1
                 l2cap_channel->credits_incoming--;
 
                 // automatic credits
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+                if (l2cap_channel->automatic_credits){
+                    l2cap_le_automatic_credits_replenish(l2cap_channel);
+                }
+#else
                 if ((l2cap_channel->credits_incoming < L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK) && l2cap_channel->automatic_credits){
                     l2cap_channel->new_credits_incoming = L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT;
                 }
+#endif
 
                 // first fragment
                 uint16_t pos = 0;
@@ -3819,7 +4326,7 @@ uint8_t l2cap_unregister_service(uint16_t psm){
 
 static void l2cap_le_notify_channel_can_send(l2cap_channel_t *channel){
     if (!channel->waiting_for_can_send_now) return;
-    if (channel->send_sdu_buffer) return;
+    if (channel->send_sdu_segments != NULL) return;
     channel->waiting_for_can_send_now = 0;
     log_debug("L2CAP_EVENT_CHANNEL_LE_CAN_SEND_NOW local_cid 0x%x", channel->local_cid);
     l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_CAN_SEND_NOW);
@@ -3876,7 +4383,7 @@ static void l2cap_emit_le_channel_closed(l2cap_channel_t * channel){
 
 static void l2cap_le_send_pdu(l2cap_channel_t *channel){
     btstack_assert(channel != NULL);
-    btstack_assert(channel->send_sdu_buffer != NULL);
+    btstack_assert(channel->send_sdu_segments != NULL);
     btstack_assert(channel->credits_outgoing > 0);
 
     // send part of SDU
@@ -3892,11 +4399,21 @@ static void l2cap_le_send_pdu(l2cap_channel_t *channel){
     }
     uint16_t payload_size = btstack_min(channel->send_sdu_len + 2u - channel->send_sdu_pos, channel->remote_mps - pos);
     log_info("len %u, pos %u => payload %u, credits %u", channel->send_sdu_len, channel->send_sdu_pos, payload_size, channel->credits_outgoing);
-    (void)memcpy(&l2cap_payload[pos],
-                 &channel->send_sdu_buffer[channel->send_sdu_pos - 2u],
-                 payload_size); // -2 for virtual SDU len
-    pos += payload_size;
     channel->send_sdu_pos += payload_size;
+    // gather payload from SDU segments
+    while (payload_size > 0u){
+        btstack_assert(channel->send_sdu_segment_index < channel->send_sdu_num_segments);
+        const l2cap_le_sdu_segment_t * segment = &channel->send_sdu_segments[channel->send_sdu_segment_index];
+        uint16_t bytes_to_copy = btstack_min(payload_size, segment->len - channel->send_sdu_segment_pos);
+        (void)memcpy(&l2cap_payload[pos], &segment->data[channel->send_sdu_segment_pos], bytes_to_copy);
+        pos += bytes_to_copy;
+        payload_size -= bytes_to_copy;
+        channel->send_sdu_segment_pos += bytes_to_copy;
+        if (channel->send_sdu_segment_pos == segment->len){
+            channel->send_sdu_segment_index++;
+            channel->send_sdu_segment_pos = 0;
+        }
+    }
     l2cap_setup_header(acl_buffer, channel->con_handle, 0, channel->remote_cid, pos);
 
     channel->credits_outgoing--;
@@ -3904,7 +4421,7 @@ static void l2cap_le_send_pdu(l2cap_channel_t *channel){
     hci_send_acl_packet_buffer(8u + pos);
 
     if (channel->send_sdu_pos >= (channel->send_sdu_len + 2u)){
-        channel->send_sdu_buffer = NULL;
+        channel->send_sdu_segments = NULL;
         // send done event
         l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_PACKET_SENT);
         // inform about can send now
@@ -3925,6 +4442,422 @@ static inline l2cap_service_t * l2cap_le_get_service(uint16_t le_psm){
     return l2cap_get_service_internal(&l2cap_le_services, le_psm);
 }
 
+// MPS for incoming K-frames
+static uint16_t l2cap_le_local_mps(l2cap_channel_t * channel){
+    return btstack_min(l2cap_max_le_mtu(), channel->local_mtu);
+}
+
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+// nr of K-frames needed to receive L2CAP_LE_AUTOMATIC_CREDITS_BUFFERED_SDUS SDUs of local MTU size
+static uint16_t l2cap_le_automatic_credits_window(l2cap_channel_t * channel){
+    uint16_t local_mps = l2cap_le_local_mps(channel);
+    uint32_t k_frames_per_sdu = (channel->local_mtu + 2u + local_mps - 1u) / local_mps;
+    return (uint16_t) btstack_min(k_frames_per_sdu * L2CAP_LE_AUTOMATIC_CREDITS_BUFFERED_SDUS, 0xffffu);
+}
+
+// K-frames are consumed when received, return them once half of the window has been used.
+// This replaces one LE Flow Control Credit packet per K-frame by one per half window
+static void l2cap_le_automatic_credits_replenish(l2cap_channel_t * channel){
+    uint16_t window = l2cap_le_automatic_credits_window(channel);
+    uint32_t outstanding = channel->credits_incoming + channel->new_credits_incoming;
+    if (outstanding > (window / 2u)) return;
+    channel->new_credits_incoming += window - (uint16_t) outstanding;
+}
+#endif
+
+// move credits provided by application into credits_incoming for LE Credit Based Connection Request/Response
+static uint16_t l2cap_le_take_initial_credits(l2cap_channel_t * channel){
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+    if (channel->automatic_credits){
+        channel->new_credits_incoming = l2cap_le_automatic_credits_window(channel);
+    }
+#endif
+    channel->credits_incoming = channel->new_credits_incoming;
+    channel->new_credits_incoming = 0;
+    return channel->credits_incoming;
+}
+
+// returns result code for LE Credit Based Connection Response, or 0 if security requirements of service are met
+static uint16_t l2cap_le_security_check(hci_con_handle_t handle, l2cap_service_t * service){
+    // security: check encryption
+    if (service->required_security_level >= LEVEL_2){
+        if (gap_encryption_key_size(handle) == 0){
+            // 0x0008 Connection refused - insufficient encryption
+            return 0x0008;
+        }
+        // anything less than 16 byte key size is insufficient
+        if (gap_encryption_key_size(handle) < 16){
+            // 0x0007 Connection refused – insufficient encryption key size
+            return 0x0007;
+        }
+    }
+
+    // security: check authencation
+    if (service->required_security_level >= LEVEL_3){
+        if (!gap_authenticated(handle)){
+            // 0x0005 Connection refused – insufficient authentication
+            return 0x0005;
+        }
+    }
+
+    // security: check authorization
+    if (service->required_security_level >= LEVEL_4){
+        if (gap_authorization_state(handle) != AUTHORIZATION_GRANTED){
+            // 0x0006 Connection refused – insufficient authorization
+            return 0x0006;
+        }
+    }
+    return 0;
+}
+
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+
+// channels of a request share con handle and direction, outgoing ones use our sig id, incoming ones the remote sig id
+static bool l2cap_ecbfc_channel_in_request(l2cap_channel_t * channel, bool incoming, uint8_t sig_id){
+    if (!channel->ecbfc) return false;
+    if (incoming){
+        if ((channel->state_var & L2CAP_CHANNEL_STATE_VAR_INCOMING) == 0u) return false;
+        return channel->remote_sig_id == sig_id;
+    } else {
+        if ((channel->state_var & L2CAP_CHANNEL_STATE_VAR_INCOMING) != 0u) return false;
+        return channel->local_sig_id == sig_id;
+    }
+}
+
+// returns false if channels of the request are still waiting for the security level update
+static bool l2cap_ecbfc_send_connection_request(l2cap_channel_t * first_channel){
+    hci_con_handle_t con_handle = first_channel->con_handle;
+    uint8_t  sig_id = first_channel->local_sig_id;
+    uint8_t  source_cids[2 * L2CAP_ECBFC_MAX_CHANNELS];
+    uint8_t  num_channels = 0;
+    uint8_t  index;
+    uint16_t credits = 0;
+    l2cap_channel_t * channel;
+
+    for (channel = l2cap_get_next_channel_for_con_handle(con_handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(con_handle, channel)){
+        if (!l2cap_ecbfc_channel_in_request(channel, false, sig_id)) continue;
+        if (channel->state == L2CAP_STATE_WAIT_OUTGOING_SECURITY_LEVEL_UPDATE) return false;
+    }
+
+    // list source cids in the order the channels were created, skip channels that have been discarded
+    for (index = 0; index < first_channel->ecbfc_num_channels; index++){
+        for (channel = l2cap_get_next_channel_for_con_handle(con_handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(con_handle, channel)){
+            if (!l2cap_ecbfc_channel_in_request(channel, false, sig_id)) continue;
+            if (channel->state != L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST) continue;
+            if (channel->ecbfc_index != index) continue;
+            channel->state = L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE;
+            channel->ecbfc_index = num_channels;
+            credits = l2cap_le_take_initial_credits(channel);
+            little_endian_store_16(source_cids, 2u * num_channels, channel->local_cid);
+            num_channels++;
+            break;
+        }
+    }
+
+    // spsm, mtu, mps, initial credits, source cids
+    l2cap_send_le_signaling_packet(con_handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, first_channel->psm, first_channel->local_mtu,
+                                   l2cap_le_local_mps(first_channel), credits, 2u * num_channels, source_cids);
+    return true;
+}
+
+// returns false if application did not accept or decline all channels of the request yet
+static bool l2cap_ecbfc_send_connection_response(l2cap_channel_t * first_channel){
+    hci_con_handle_t con_handle = first_channel->con_handle;
+    uint8_t  sig_id       = first_channel->remote_sig_id;
+    uint8_t  num_channels = first_channel->ecbfc_num_channels;
+    uint8_t  destination_cids[2 * L2CAP_ECBFC_MAX_CHANNELS];
+    l2cap_channel_t * opened_channels[L2CAP_ECBFC_MAX_CHANNELS];
+    uint8_t  num_opened = 0;
+    uint16_t mtu = 0xffff;
+    uint16_t mps = 0;
+    uint16_t credits = 0xffff;
+    uint16_t result = 0;
+    l2cap_channel_t * channel;
+    l2cap_channel_t * next_channel;
+    uint8_t i;
+
+    // common MTU and result, channels refused with the request have their result in reason
+    for (channel = l2cap_get_next_channel_for_con_handle(con_handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(con_handle, channel)){
+        if (!l2cap_ecbfc_channel_in_request(channel, true, sig_id)) continue;
+        switch (channel->state){
+            case L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT:
+                return false;
+            case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
+                mtu = btstack_min(mtu, channel->local_mtu);
+                if (channel->reason != 0u){
+                    result = channel->reason;
+                }
+                break;
+            case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_DECLINE:
+                // 0x0004 Some connections refused – insufficient resources available
+                result = channel->reason;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // common initial credits, remaining credits are provided with LE Flow Control Credit afterwards
+    for (channel = l2cap_get_next_channel_for_con_handle(con_handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(con_handle, channel)){
+        if (!l2cap_ecbfc_channel_in_request(channel, true, sig_id)) continue;
+        if (channel->state != L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT) continue;
+        channel->local_mtu = mtu;
+        mps = l2cap_le_local_mps(channel);
+        credits = btstack_min(credits, l2cap_le_take_initial_credits(channel));
+    }
+
+    // open accepted channels, discard declined ones
+    memset(destination_cids, 0, sizeof(destination_cids));
+    channel = l2cap_get_next_channel_for_con_handle(con_handle, NULL);
+    while (channel != NULL){
+        next_channel = l2cap_get_next_channel_for_con_handle(con_handle, channel);
+        if (l2cap_ecbfc_channel_in_request(channel, true, sig_id)){
+            switch (channel->state){
+                case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
+                    channel->state = L2CAP_STATE_OPEN;
+                    channel->new_credits_incoming = channel->credits_incoming - credits;
+                    channel->credits_incoming = credits;
+                    little_endian_store_16(destination_cids, 2u * channel->ecbfc_index, channel->local_cid);
+                    opened_channels[num_opened++] = channel;
+                    break;
+                case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_DECLINE:
+                    // discard channel - l2cap_finialize_channel_close without sending l2cap close event
+                    channel->state = L2CAP_STATE_INVALID;
+                    btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                    l2cap_free_channel_entry(channel);
+                    break;
+                default:
+                    break;
+            }
+        }
+        channel = next_channel;
+    }
+
+    // mtu, mps and initial credits shall be ignored if all connections were refused
+    if (num_opened == 0u){
+        mtu = 0;
+        credits = 0;
+    }
+
+    // mtu, mps, initial credits, result, destination cids
+    l2cap_send_le_signaling_packet(con_handle, CREDIT_BASED_CONNECTION_RESPONSE, sig_id, mtu, mps, credits, result,
+                                   2u * num_channels, destination_cids);
+
+    // notify client
+    for (i = 0; i < num_opened; i++){
+        l2cap_emit_le_channel_opened(opened_channels[i], 0);
+    }
+    return true;
+}
+
+// send pending credit based connection request or response, returns true if a packet was sent
+static bool l2cap_run_ecbfc(void){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &l2cap_channels);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+        if (channel->channel_type != L2CAP_CHANNEL_TYPE_LE_DATA_CHANNEL) continue;
+        if (!channel->ecbfc) continue;
+        switch (channel->state){
+            case L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST:
+                if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
+                // list of channels has changed
+                if (l2cap_ecbfc_send_connection_request(channel)) return true;
+                break;
+            case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
+            case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_DECLINE:
+                if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
+                // list of channels has changed
+                if (l2cap_ecbfc_send_connection_response(channel)) return true;
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+static void l2cap_ecbfc_handle_connection_request(hci_con_handle_t handle, uint8_t sig_id, uint8_t * command, uint16_t len){
+    uint16_t le_psm       = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 0);
+    uint16_t remote_mtu   = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 2);
+    uint16_t remote_mps   = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 4);
+    uint16_t credits      = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 6);
+    uint16_t num_channels = (len - 8u) / 2u;
+    l2cap_channel_t * channels[L2CAP_ECBFC_MAX_CHANNELS];
+    uint8_t  num_created = 0;
+    uint16_t result;
+    uint16_t index;
+    uint8_t  i;
+
+    // get hci connection, bail if not found (must not happen)
+    hci_connection_t * connection = hci_connection_for_handle(handle);
+    if (!connection) return;
+
+    if ((num_channels > L2CAP_ECBFC_MAX_CHANNELS) || ((len & 1u) != 0u)){
+        // 0x000c All connections refused – invalid parameters
+        l2cap_register_signaling_response(handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, btstack_min(num_channels, L2CAP_ECBFC_MAX_CHANNELS), 0x000c);
+        return;
+    }
+
+    // check if service registered
+    l2cap_service_t * service = l2cap_le_get_service(le_psm);
+    if (!service){
+        // 0x0002 All connections refused – SPSM not supported
+        l2cap_register_signaling_response(handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, num_channels, 0x0002);
+        return;
+    }
+
+    // security: check encryption, authentication and authorization
+    result = l2cap_le_security_check(handle, service);
+    if (result != 0u){
+        l2cap_register_signaling_response(handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, num_channels, result);
+        return;
+    }
+
+    if ((remote_mtu < L2CAP_ECBFC_MIN_MTU) || (remote_mps < L2CAP_ECBFC_MIN_MTU)){
+        // 0x000b All connections refused – unacceptable parameters
+        l2cap_register_signaling_response(handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, num_channels, 0x000b);
+        return;
+    }
+
+    // allocate channel for each valid source cid, others get destination cid 0x0000 in the response
+    for (index = 0; index < num_channels; index++){
+        uint16_t source_cid = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 8u + (2u * index));
+        l2cap_channel_t * channel;
+
+        if (source_cid < 0x40u){
+            // 0x0009 Some connections refused – invalid Source CID
+            result = 0x0009;
+            continue;
+        }
+
+        // go through list of channels for this ACL connection and check if we get a match
+        for (channel = l2cap_get_next_channel_for_con_handle(handle, NULL); channel != NULL; channel = l2cap_get_next_channel_for_con_handle(handle, channel)){
+            if (channel->remote_cid == source_cid) break;
+        }
+        if (channel != NULL){
+            // 0x000a Some connections refused – Source CID already allocated
+            result = 0x000a;
+            continue;
+        }
+
+        channel = l2cap_create_channel_entry(service->packet_handler, L2CAP_CHANNEL_TYPE_LE_DATA_CHANNEL, connection->address,
+            BD_ADDR_TYPE_LE_RANDOM, le_psm, service->mtu, service->required_security_level);
+        if (!channel){
+            // 0x0004 Some connections refused – insufficient resources available
+            result = 0x0004;
+            continue;
+        }
+
+        l2cap_channel_set_con_handle(channel, handle);
+        channel->remote_cid = source_cid;
+        channel->remote_sig_id = sig_id;
+        channel->remote_mtu = remote_mtu;
+        channel->remote_mps = remote_mps;
+        channel->credits_outgoing = credits;
+        channel->ecbfc = true;
+        channel->ecbfc_index = (uint8_t) index;
+        channel->ecbfc_num_channels = (uint8_t) num_channels;
+
+        // set initial state
+        channel->state      = L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT;
+        channel->state_var = (L2CAP_CHANNEL_STATE_VAR) (channel->state_var | L2CAP_CHANNEL_STATE_VAR_INCOMING);
+
+        // add to connections list
+        btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
+        channels[num_created++] = channel;
+    }
+
+    if (num_created == 0u){
+        l2cap_register_signaling_response(handle, CREDIT_BASED_CONNECTION_REQUEST, sig_id, num_channels, result);
+        return;
+    }
+
+    // post connection request events after all channels have been created, as the response is sent for all of them
+    for (i = 0; i < num_created; i++){
+        channels[i]->reason = (uint8_t) result;
+    }
+    for (i = 0; i < num_created; i++){
+        l2cap_emit_le_incoming_connection(channels[i]);
+    }
+}
+
+static void l2cap_ecbfc_handle_connection_response(hci_con_handle_t handle, uint8_t sig_id, uint8_t * command, uint16_t len){
+    uint16_t remote_mtu = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 0);
+    uint16_t remote_mps = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 2);
+    uint16_t credits    = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 4);
+    uint16_t result     = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 6);
+    uint16_t num_destination_cids = (len - 8u) / 2u;
+
+    l2cap_channel_t * channel = l2cap_get_next_channel_for_con_handle(handle, NULL);
+    while (channel != NULL){
+        l2cap_channel_t * next_channel = l2cap_get_next_channel_for_con_handle(handle, channel);
+        if (l2cap_ecbfc_channel_in_request(channel, false, sig_id) && (channel->state == L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE)){
+            uint16_t destination_cid = 0;
+            if (channel->ecbfc_index < num_destination_cids){
+                destination_cid = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 8u + (2u * channel->ecbfc_index));
+            }
+            if (destination_cid < 0x40u){
+                channel->state = L2CAP_STATE_CLOSED;
+                // use 0x0004 insufficient resources if peer refused channel without result
+                l2cap_emit_le_channel_opened(channel, (result != 0u) ? (uint8_t) result : 0x0004);
+
+                // discard channel
+                btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                l2cap_free_channel_entry(channel);
+            } else {
+                channel->remote_cid = destination_cid;
+                channel->remote_mtu = remote_mtu;
+                channel->remote_mps = remote_mps;
+                channel->credits_outgoing = credits;
+                channel->state = L2CAP_STATE_OPEN;
+                l2cap_emit_le_channel_opened(channel, 0);
+            }
+        }
+        channel = next_channel;
+    }
+}
+
+// returns result for credit based reconfigure response, MTU and MPS are updated for all channels or none
+static uint16_t l2cap_ecbfc_handle_reconfigure_request(hci_con_handle_t handle, uint8_t * command, uint16_t len){
+    uint16_t remote_mtu = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 0);
+    uint16_t remote_mps = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 2);
+    uint16_t num_destination_cids = (len - 4u) / 2u;
+    l2cap_channel_t * channel;
+    uint16_t i;
+
+    if ((remote_mtu < L2CAP_ECBFC_MIN_MTU) || (remote_mps < L2CAP_ECBFC_MIN_MTU)){
+        // 0x0004 Reconfiguration failed - other unacceptable parameters
+        return 0x0004;
+    }
+
+    for (i = 0; i < num_destination_cids; i++){
+        uint16_t local_cid = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 4u + (2u * i));
+        channel = l2cap_get_channel_for_local_cid_and_handle(local_cid, handle);
+        if ((channel == NULL) || !channel->ecbfc){
+            // 0x0003 Reconfiguration failed - one or more Destination CIDs invalid
+            return 0x0003;
+        }
+        if (remote_mtu < channel->remote_mtu){
+            // 0x0001 Reconfiguration failed - reduction in size of MTU not allowed
+            return 0x0001;
+        }
+        if ((num_destination_cids > 1u) && (remote_mps < channel->remote_mps)){
+            // 0x0002 Reconfiguration failed - reduction in size of MPS not allowed for more than one channel at a time
+            return 0x0002;
+        }
+    }
+
+    for (i = 0; i < num_destination_cids; i++){
+        uint16_t local_cid = little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_DATA_OFFSET + 4u + (2u * i));
+        channel = l2cap_get_channel_for_local_cid_and_handle(local_cid, handle);
+        channel->remote_mtu = remote_mtu;
+        channel->remote_mps = remote_mps;
+    }
+    return 0;
+}
+#endif
+
 uint8_t l2cap_le_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, gap_security_level_t security_level){
     
     log_info("L2CAP_LE_REGISTER_SERVICE psm 0x%x", psm);
@@ -4053,13 +4986,24 @@ static void l2cap_sm_packet_handler(uint8_t packet_type, uint16_t channel_nr, ui
     }
 }
 
+static void l2cap_le_request_pairing(hci_con_handle_t con_handle){
+    static btstack_packet_callback_registration_t sm_event_callback_registration;
+    static bool sm_callback_registered = false;
+
+    if (!sm_callback_registered){
+        sm_callback_registered = true;
+        // lazy registration for SM events
+        sm_event_callback_registration.callback = &l2cap_sm_packet_handler;
+        sm_add_event_handler(&sm_event_callback_registration);
+    }
+
+    sm_request_pairing(con_handle);
+}
+
 uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con_handle_t con_handle,
     uint16_t psm, uint8_t * receive_sdu_buffer, uint16_t mtu, uint16_t initial_credits, gap_security_level_t security_level,
     uint16_t * out_local_cid) {
 
-    static btstack_packet_callback_registration_t sm_event_callback_registration;
-    static bool sm_callback_registered = false;
-
     log_info("L2CAP_LE_CREATE_CHANNEL handle 0x%04x psm 0x%x mtu %u", con_handle, psm, mtu);
 
     hci_connection_t * connection = hci_connection_for_handle(con_handle);
@@ -4080,7 +5024,7 @@ uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con
     }
 
     // setup channel entry
-    channel->con_handle = con_handle;
+    l2cap_channel_set_con_handle(channel, con_handle);
     channel->receive_sdu_buffer = receive_sdu_buffer;
     channel->new_credits_incoming = initial_credits;
     channel->automatic_credits    = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
@@ -4090,16 +5034,9 @@ uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con
 
     // check security level
     if (l2cap_le_security_level_for_connection(con_handle) < channel->required_security_level){
-        if (!sm_callback_registered){
-            sm_callback_registered = true;
-            // lazy registration for SM events
-            sm_event_callback_registration.callback = &l2cap_sm_packet_handler;
-            sm_add_event_handler(&sm_event_callback_registration);
-        }
-
         // start pairing
         channel->state = L2CAP_STATE_WAIT_OUTGOING_SECURITY_LEVEL_UPDATE;
-        sm_request_pairing(con_handle);
+        l2cap_le_request_pairing(con_handle);
     } else {
         // send conn request right away
         channel->state = L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST;
@@ -4159,7 +5096,7 @@ int l2cap_le_can_send_now(uint16_t local_cid){
     if (channel->state != L2CAP_STATE_OPEN) return 0;
 
     // check queue
-    if (channel->send_sdu_buffer) return 0;    
+    if (channel->send_sdu_segments != NULL) return 0;
 
     // fine, go ahead
     return 1;
@@ -4202,12 +5139,17 @@ uint8_t l2cap_le_send_data(uint16_t local_cid, uint8_t * data, uint16_t len){
         return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
     }
 
-    if (channel->send_sdu_buffer){
+    if (channel->send_sdu_segments != NULL){
         log_info("l2cap_send cid 0x%02x, cannot send", local_cid);
         return BTSTACK_ACL_BUFFERS_FULL;
     }
 
-    channel->send_sdu_buffer = data;
+    channel->send_sdu_segment.data = data;
+    channel->send_sdu_segment.len  = len;
+    channel->send_sdu_segments     = &channel->send_sdu_segment;
+    channel->send_sdu_num_segments = 1;
+    channel->send_sdu_segment_index = 0;
+    channel->send_sdu_segment_pos  = 0;
     channel->send_sdu_len    = len;
     channel->send_sdu_pos    = 0;
 
@@ -4215,6 +5157,42 @@ uint8_t l2cap_le_send_data(uint16_t local_cid, uint8_t * data, uint16_t len){
     return ERROR_CODE_SUCCESS;
 }
 
+uint8_t l2cap_le_send_data_chain(uint16_t local_cid, const l2cap_le_sdu_segment_t * segments, uint8_t num_segments){
+
+    l2cap_channel_t * channel = l2cap_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_send no channel for cid 0x%02x", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+
+    uint32_t len = 0;
+    uint8_t i;
+    for (i = 0; i < num_segments; i++){
+        len += segments[i].len;
+    }
+
+    if (len > channel->remote_mtu){
+        log_error("l2cap_send cid 0x%02x, data length exceeds remote MTU.", local_cid);
+        return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
+    }
+
+    if (channel->send_sdu_segments != NULL){
+        log_info("l2cap_send cid 0x%02x, cannot send", local_cid);
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+
+    // SDU is gathered from segments in l2cap_le_send_pdu
+    channel->send_sdu_segments     = segments;
+    channel->send_sdu_num_segments = num_segments;
+    channel->send_sdu_segment_index = 0;
+    channel->send_sdu_segment_pos  = 0;
+    channel->send_sdu_len    = (uint16_t) len;
+    channel->send_sdu_pos    = 0;
+
+    l2cap_notify_channel_can_send();
+    return ERROR_CODE_SUCCESS;
+}
+
 /**
  * @brief Disconnect from LE Data Channel
  * @param local_cid             L2CAP LE Data Channel Identifier
@@ -4232,4 +5210,71 @@ uint8_t l2cap_le_disconnect(uint16_t local_cid)
     return ERROR_CODE_SUCCESS;
 }
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+uint8_t l2cap_ecbfc_create_channels(btstack_packet_handler_t packet_handler, hci_con_handle_t con_handle, uint16_t psm,
+    uint8_t num_channels, uint8_t ** receive_sdu_buffers, uint16_t mtu, uint16_t initial_credits, gap_security_level_t security_level,
+    uint16_t * out_local_cids){
+
+    l2cap_channel_t * channels[L2CAP_ECBFC_MAX_CHANNELS];
+    uint8_t i;
+
+    log_info("L2CAP_ECBFC_CREATE_CHANNELS handle 0x%04x psm 0x%x mtu %u, num channels %u", con_handle, psm, mtu, num_channels);
+
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) {
+        log_error("no hci_connection for handle 0x%04x", con_handle);
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+
+    if ((num_channels == 0u) || (num_channels > L2CAP_ECBFC_MAX_CHANNELS) || (mtu < L2CAP_ECBFC_MIN_MTU)){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+
+    // allocate all channels first
+    for (i = 0; i < num_channels; i++){
+        channels[i] = l2cap_create_channel_entry(packet_handler, L2CAP_CHANNEL_TYPE_LE_DATA_CHANNEL, connection->address, connection->address_type, psm, mtu, security_level);
+        if (channels[i] == NULL){
+            while (i > 0u){
+                i--;
+                l2cap_free_channel_entry(channels[i]);
+            }
+            return BTSTACK_MEMORY_ALLOC_FAILED;
+        }
+    }
+
+    // all channels share the signaling identifier of the request
+    uint8_t sig_id = l2cap_next_sig_id();
+    bool security_level_sufficient = l2cap_le_security_level_for_connection(con_handle) >= security_level;
+
+    for (i = 0; i < num_channels; i++){
+        l2cap_channel_t * channel = channels[i];
+        out_local_cids[i] = channel->local_cid;
+
+        // setup channel entry
+        l2cap_channel_set_con_handle(channel, con_handle);
+        channel->receive_sdu_buffer = receive_sdu_buffers[i];
+        channel->new_credits_incoming = initial_credits;
+        channel->automatic_credits    = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
+        channel->local_sig_id = sig_id;
+        channel->ecbfc = true;
+        channel->ecbfc_index = i;
+        channel->ecbfc_num_channels = num_channels;
+        channel->state = security_level_sufficient ? L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST : L2CAP_STATE_WAIT_OUTGOING_SECURITY_LEVEL_UPDATE;
+
+        // add to connections list
+        btstack_linked_list_add_tail(&l2cap_channels, (btstack_linked_item_t *) channel);
+    }
+
+    if (security_level_sufficient){
+        // send conn request right away
+        l2cap_run();
+    } else {
+        // start pairing, request is sent for all channels after pairing complete
+        l2cap_le_request_pairing(con_handle);
+    }
+
+    return ERROR_CODE_SUCCESS;
+}
+#endif
+
 #endif
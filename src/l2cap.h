@@ -69,6 +69,12 @@ extern "C" {
 
 #define L2CAP_LE_AUTOMATIC_CREDITS 0xffff
 
+// max number of channels created by a single L2CAP Credit Based Connection Request
+#define L2CAP_ECBFC_MAX_CHANNELS 5
+
+// min MTU and MPS for L2CAP Enhanced Credit Based Flow Control Mode
+#define L2CAP_ECBFC_MIN_MTU 64
+
 // private structs
 typedef enum {
     L2CAP_STATE_CLOSED = 1,           // no baseband
@@ -144,7 +150,7 @@ typedef struct {
 typedef struct {
     l2cap_segmentation_and_reassembly_t sar;
     uint16_t len;
-    uint8_t tx_seq;
+    uint16_t tx_seq;
     uint8_t retry_count;
     uint8_t retransmission_requested;
 } l2cap_ertm_tx_packet_state_t;
@@ -169,6 +175,7 @@ typedef struct {
     uint8_t num_tx_buffers;
 
     // Number of packets that can be received out of order (-> our tx_window size)
+    // values > 63 require ENABLE_L2CAP_ERTM_EXTENDED_WINDOW and remote support for Extended Window Size, limited to 63 otherwise
     uint8_t num_rx_buffers;
 
     // Frame Check Sequence (FCS) Option
@@ -176,6 +183,21 @@ typedef struct {
 
 } l2cap_ertm_config_t;
 
+// segment of an outgoing SDU, see l2cap_le_send_data_chain
+typedef struct {
+    const uint8_t * data;
+    uint16_t        len;
+} l2cap_le_sdu_segment_t;
+
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+typedef struct {
+    // channel was served: can send now event emitted, LE Data Channel PDU or ERTM I-Frame sent
+    uint32_t packets_sent;
+    // channel was ready to send, but queued behind a channel with higher priority or earlier in round
+    uint32_t requests_queued;
+} l2cap_scheduler_counters_t;
+#endif
+
 // info regarding an actual channel
 // note: l2cap_fixed_channel and l2cap_channel_t share commmon fields
 
@@ -195,11 +217,17 @@ typedef struct l2cap_fixed_channel {
     // send request
     uint8_t waiting_for_can_send_now;
 
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+    // channels with higher priority are served first
+    uint8_t scheduler_priority;
+    l2cap_scheduler_counters_t scheduler_counters;
+#endif
+
     // -- end of shared prefix
 
 } l2cap_fixed_channel_t;
 
-typedef struct {
+typedef struct l2cap_channel {
     // linked list - assert: first field
     btstack_linked_item_t    item;
     
@@ -215,6 +243,12 @@ typedef struct {
     // send request
     uint8_t   waiting_for_can_send_now;
 
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+    // channels with higher priority are served first
+    uint8_t   scheduler_priority;
+    l2cap_scheduler_counters_t scheduler_counters;
+#endif
+
     // -- end of shared prefix
 
     // timer
@@ -226,6 +260,11 @@ typedef struct {
     // info
     hci_con_handle_t con_handle;
 
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+    // next channel on same connection, see l2cap_channel_set_con_handle
+    struct l2cap_channel * con_handle_next;
+#endif
+
     bd_addr_t address;
     bd_addr_type_t address_type;
     
@@ -252,11 +291,17 @@ typedef struct {
     uint16_t  receive_sdu_len;
     uint16_t  receive_sdu_pos;
 
-    // outgoing SDU
-    uint8_t  * send_sdu_buffer;
+    // outgoing SDU, gathered from chain of segments - send_sdu_pos includes 2 bytes SDU length
+    const l2cap_le_sdu_segment_t * send_sdu_segments;
+    uint8_t    send_sdu_num_segments;
+    uint8_t    send_sdu_segment_index;
+    uint16_t   send_sdu_segment_pos;
     uint16_t   send_sdu_len;
     uint16_t   send_sdu_pos;
 
+    // single segment used by l2cap_le_send_data
+    l2cap_le_sdu_segment_t send_sdu_segment;
+
     // max PDU size
     uint16_t  remote_mps;
 
@@ -272,6 +317,15 @@ typedef struct {
     // automatic credits incoming
     uint16_t automatic_credits;
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+    // channel is part of a L2CAP Credit Based Connection Request with up to L2CAP_ECBFC_MAX_CHANNELS channels,
+    // identified by con handle and local (outgoing) or remote (incoming) sig id
+    bool     ecbfc;
+    // position of the channel in the request and number of channels requested
+    uint8_t  ecbfc_index;
+    uint8_t  ecbfc_num_channels;
+#endif
+
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 
     // l2cap channel mode: basic or enhanced retransmission mode
@@ -293,7 +347,7 @@ typedef struct {
     uint16_t remote_retransmission_timeout_ms;
     uint16_t remote_monitor_timeout_ms;
 
-    uint8_t remote_tx_window_size;
+    uint16_t remote_tx_window_size;
 
     uint8_t local_max_transmit;
     uint8_t remote_max_transmit;
@@ -304,6 +358,11 @@ typedef struct {
     // Frame Chech Sequence (crc16) is present in both directions
     uint8_t fcs_option;
 
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+    // Extended Control Field with 14-bit sequence numbers is used in both directions
+    uint8_t extended_control;
+#endif
+
     // sender: max num of stored outgoing frames
     uint8_t num_tx_buffers;
 
@@ -323,7 +382,7 @@ typedef struct {
     uint8_t tx_send_index;
 
     // sender: next seq nr used for sending
-    uint8_t next_tx_seq;
+    uint16_t next_tx_seq;
 
     // sender: selective retransmission requested
     uint8_t srej_active;
@@ -332,14 +391,22 @@ typedef struct {
     // receiver: max num out-of-order packets // tx_window
     uint8_t num_rx_buffers;
 
-    // receiver: buffer index of to store packet with delta = 1
+    // receiver: buffer index for packet with tx_seq == expected_tx_seq
     uint8_t rx_store_index;
 
     // receiver: value of tx_seq in next expected i-frame
-    uint8_t expected_tx_seq;
+    uint16_t expected_tx_seq;
 
     // receiver: request transmission with tx_seq = req_seq and ack up to and including req_seq
-    uint8_t req_seq;
+    uint16_t req_seq;
+
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+    // receiver: tx_seq following the highest tx_seq received so far
+    uint16_t srej_tail_tx_seq;
+
+    // receiver: send SREJ for rx buffer index - bitmap, num_rx_buffers <= 255
+    uint8_t srej_pending[32];
+#endif
 
     // receiver: local busy condition
     uint8_t local_busy;
@@ -659,12 +726,43 @@ uint8_t l2cap_le_request_can_send_now_event(uint16_t cid);
  */
 uint8_t l2cap_le_send_data(uint16_t cid, uint8_t * data, uint16_t size);
 
+/**
+ * @brief Send SDU gathered from a chain of segments via LE Data Channel
+ * @note Segments are copied directly into the outgoing HCI buffer one PDU at a time, segments and their data need to stay valid until L2CAP_EVENT_LE_PACKET_SENT
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param segments              array of segments, SDU is the concatenation of all segments
+ * @param num_segments          number of segments
+ */
+uint8_t l2cap_le_send_data_chain(uint16_t local_cid, const l2cap_le_sdu_segment_t * segments, uint8_t num_segments);
+
 /**
  * @brief Disconnect from LE Data Channel
  * @param local_cid             L2CAP LE Data Channel Identifier
  */
 uint8_t l2cap_le_disconnect(uint16_t cid);
 
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+/**
+ * @brief Create up to L2CAP_ECBFC_MAX_CHANNELS channels in L2CAP Enhanced Credit Based Flow Control Mode with a single request
+ * @note requires ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE. Each channel is reported by L2CAP_EVENT_LE_CHANNEL_OPENED
+ *       and used with the l2cap_le_* functions. Incoming requests are reported as L2CAP_EVENT_LE_INCOMING_CONNECTION per channel
+ *       for services registered with l2cap_le_register_service.
+ * @param packet_handler        Packet handler for these channels
+ * @param con_handle            ACL-LE HCI Connction Handle
+ * @param psm                   Service PSM to connect to
+ * @param num_channels          Number of channels
+ * @param receive_sdu_buffers   Receive buffer of MTU bytes for each channel
+ * @param mtu                   MTU for all channels, at least L2CAP_ECBFC_MIN_MTU
+ * @param initial_credits       Number of initial credits provided to peer or L2CAP_LE_AUTOMATIC_CREDITS to enable automatic credits
+ * @param security_level        Minimum required security level
+ * @param out_local_cids        L2CAP LE Channel Identifiers are stored here
+ * @return status
+ */
+uint8_t l2cap_ecbfc_create_channels(btstack_packet_handler_t packet_handler, hci_con_handle_t con_handle, uint16_t psm,
+    uint8_t num_channels, uint8_t ** receive_sdu_buffers, uint16_t mtu, uint16_t initial_credits, gap_security_level_t security_level,
+    uint16_t * out_local_cids);
+#endif
+
 /**
  * @brief ERTM Set channel as busy.
  * @note Can be cleared by l2cap_ertm_set_ready
@@ -679,6 +777,27 @@ uint8_t l2cap_ertm_set_busy(uint16_t local_cid);
  */
 uint8_t l2cap_ertm_set_ready(uint16_t local_cid);
 
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+/**
+ * @brief Set priority of a channel. If ACL buffers are scarce, channels with higher priority are served first,
+ *        channels with same priority are served round robin
+ * @note requires ENABLE_L2CAP_CHANNEL_SCHEDULER, default 0. Also works for fixed channels, e.g. L2CAP_CID_ATTRIBUTE_PROTOCOL
+ * @param local_cid
+ * @param priority
+ * @return status
+ */
+uint8_t l2cap_scheduler_set_priority(uint16_t local_cid, uint8_t priority);
+
+/**
+ * @brief Get scheduler counters for a channel
+ * @note requires ENABLE_L2CAP_CHANNEL_SCHEDULER
+ * @param local_cid
+ * @param counters
+ * @return status
+ */
+uint8_t l2cap_scheduler_get_counters(uint16_t local_cid, l2cap_scheduler_counters_t * counters);
+#endif
+
 /**
  * @brief De-Init L2CAP
  */
@@ -76,6 +76,12 @@ static uint16_t l2cap_create_signaling_internal(uint8_t * acl_buffer, hci_con_ha
             "22222", // 0X14 le credit based connection request: le psm, source cid, mtu, mps, initial credits
             "22222", // 0x15 le credit based connection respone: dest cid, mtu, mps, initial credits, result
             "22",    // 0x16 le flow control credit: source cid, credits
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+            "2222D", // 0x17 credit based connection request: spsm, mtu, mps, initial credits, source cids
+            "2222D", // 0x18 credit based connection response: mtu, mps, initial credits, result, destination cids
+            "22D",   // 0x19 credit based reconfigure request: mtu, mps, destination cids
+            "2",     // 0x1a credit based reconfigure response: result
+#endif
 #endif
     };
     static const unsigned int num_l2cap_commands = sizeof(l2cap_signaling_commands_format) / sizeof(const char *);
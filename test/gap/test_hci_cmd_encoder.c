@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_util.h"
+#include "hci_cmd.h"
+#include "hci_cmd_encoder.h"
+
+static uint8_t  template_buffer[300];
+static uint8_t  encoder_buffer[300];
+
+static uint16_t create_from_template(const hci_cmd_t * cmd, ...){
+    va_list argptr;
+    va_start(argptr, cmd);
+    uint16_t size = hci_cmd_create_from_template(template_buffer, cmd, argptr);
+    va_end(argptr);
+    return size;
+}
+
+static void check_buffers_equal(uint16_t template_size, uint16_t encoder_size){
+    CHECK_EQUAL(template_size, encoder_size);
+    MEMCMP_EQUAL(template_buffer, encoder_buffer, template_size);
+}
+
+TEST_GROUP(HCI_CmdEncoder){
+    bd_addr_t addr;
+    uint8_t   key[16];
+    uint8_t   data[31];
+    void setup(void){
+        int i;
+        for (i = 0; i < 6; i++){
+            addr[i] = 0x11 * (i + 1);
+        }
+        for (i = 0; i < 16; i++){
+            key[i] = i;
+        }
+        for (i = 0; i < 31; i++){
+            data[i] = 0x80 + i;
+        }
+        memset(template_buffer, 0x55, sizeof(template_buffer));
+        memset(encoder_buffer,  0xaa, sizeof(encoder_buffer));
+    }
+};
+
+TEST(HCI_CmdEncoder, NoParameters){
+    check_buffers_equal(create_from_template(&hci_le_rand), hci_cmd_create_le_rand(encoder_buffer));
+}
+
+TEST(HCI_CmdEncoder, Integers){
+    check_buffers_equal(create_from_template(&hci_inquiry, 0x9e8b33, 0x30, 0x00),
+                        hci_cmd_create_inquiry(encoder_buffer, 0x9e8b33, 0x30, 0x00));
+    check_buffers_equal(create_from_template(&hci_le_connection_update, 0x0040, 0x0006, 0x000c, 0x0000, 0x01f4, 0x0000, 0xffff),
+                        hci_cmd_create_le_connection_update(encoder_buffer, 0x0040, 0x0006, 0x000c, 0x0000, 0x01f4, 0x0000, 0xffff));
+}
+
+TEST(HCI_CmdEncoder, Address){
+    check_buffers_equal(create_from_template(&hci_create_connection, addr, 0xcc18, 0x01, 0x00, 0x1234, 0x01),
+                        hci_cmd_create_create_connection(encoder_buffer, addr, 0xcc18, 0x01, 0x00, 0x1234, 0x01));
+    check_buffers_equal(create_from_template(&hci_le_add_device_to_white_list, 0x01, addr),
+                        hci_cmd_create_le_add_device_to_white_list(encoder_buffer, 0x01, addr));
+}
+
+TEST(HCI_CmdEncoder, DataBlocks){
+    check_buffers_equal(create_from_template(&hci_le_encrypt, key, key),
+                        hci_cmd_create_le_encrypt(encoder_buffer, key, key));
+    check_buffers_equal(create_from_template(&hci_le_start_encryption, 0x0040, 0x01020304, 0x05060708, 0x1234, key),
+                        hci_cmd_create_le_start_encryption(encoder_buffer, 0x0040, 0x01020304, 0x05060708, 0x1234, key));
+    check_buffers_equal(create_from_template(&hci_le_set_advertising_data, 31, data),
+                        hci_cmd_create_le_set_advertising_data(encoder_buffer, 31, data));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,421 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_memory.h"
+#include "hci.h"
+#include "hci_dump.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_run_loop_posix.h"
+
+static void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static uint8_t  sent_acl_packets[4][40];
+static uint16_t sent_acl_packet_sizes[4];
+static int      sent_acl_packet_count;
+static uint16_t sent_command_opcode;
+static int      transport_ready;
+
+static int hci_transport_test_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return transport_ready;
+}
+
+static int hci_transport_test_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    // asynchronous transport is busy until packet sent event
+    transport_ready = 0;
+    if (packet_type == HCI_COMMAND_DATA_PACKET){
+        sent_command_opcode = little_endian_read_16(packet, 0);
+    }
+    if (packet_type != HCI_ACL_DATA_PACKET) return 0;
+    if (sent_acl_packet_count < 4){
+        memcpy(sent_acl_packets[sent_acl_packet_count], packet, size);
+        sent_acl_packet_sizes[sent_acl_packet_count] = size;
+    }
+    sent_acl_packet_count++;
+    return 0;
+}
+
+static void hci_transport_test_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    packet_handler = handler;
+}
+
+static const hci_transport_t hci_transport_test_async = {
+        /* const char * name; */                                        "TEST",
+        /* void   (*init) (const void *transport_config); */            NULL,
+        /* int    (*open)(void); */                                     NULL,
+        /* int    (*close)(void); */                                    NULL,
+        /* void   (*register_packet_handler)(void (*handler)(...); */   &hci_transport_test_register_packet_handler,
+        /* int    (*can_send_packet_now)(uint8_t packet_type); */       &hci_transport_test_can_send_packet_now,
+        /* int    (*send_packet)(...); */                               &hci_transport_test_send_packet,
+        /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+        /* void   (*reset_link)(void); */                               NULL,
+        /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+};
+
+static const hci_transport_t hci_transport_test = {
+        /* const char * name; */                                        "TEST",
+        /* void   (*init) (const void *transport_config); */            NULL,
+        /* int    (*open)(void); */                                     NULL,
+        /* int    (*close)(void); */                                    NULL,
+        /* void   (*register_packet_handler)(void (*handler)(...); */   &hci_transport_test_register_packet_handler,
+        /* int    (*can_send_packet_now)(uint8_t packet_type); */       NULL,
+        /* int    (*send_packet)(...); */                               &hci_transport_test_send_packet,
+        /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+        /* void   (*reset_link)(void); */                               NULL,
+        /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+};
+
+// matches addresses used by hci_setup_test_connections_fuzz
+static bd_addr_t test_addr = { 0x66, 0x55, 0x44, 0x33, 0x00, 0x00};
+
+static uint8_t  acl_packet[100];
+static uint16_t acl_packet_size;
+static int      acl_packet_count;
+
+static void acl_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    memcpy(acl_packet, packet, size);
+    acl_packet_size = size;
+    acl_packet_count++;
+}
+
+TEST_GROUP(HCI_Connections){
+    void setup(void){
+        btstack_memory_init();
+        hci_init(&hci_transport_test, NULL);
+        hci_setup_test_connections_fuzz();
+        hci_register_acl_packet_handler(&acl_packet_handler);
+        acl_packet_count = 0;
+        sent_acl_packet_count = 0;
+    }
+    void teardown(void){
+        hci_free_connections_fuzz();
+    }
+};
+
+TEST(HCI_Connections, LookupByHandle){
+    hci_con_handle_t con_handle;
+    for (con_handle = 1; con_handle <= 5; con_handle++){
+        hci_connection_t * conn = hci_connection_for_handle(con_handle);
+        CHECK(conn != NULL);
+        CHECK_EQUAL(con_handle, conn->con_handle);
+    }
+    POINTERS_EQUAL(NULL, hci_connection_for_handle(0));
+    POINTERS_EQUAL(NULL, hci_connection_for_handle(6));
+    POINTERS_EQUAL(NULL, hci_connection_for_handle(HCI_CON_HANDLE_INVALID));
+}
+
+TEST(HCI_Connections, LookupByAddressAndType){
+    test_addr[5] = 0x01;
+    hci_connection_t * conn = hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_ACL);
+    CHECK(conn != NULL);
+    CHECK_EQUAL(0x01, conn->con_handle);
+    test_addr[5] = 0x02;
+    conn = hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_SCO);
+    CHECK(conn != NULL);
+    CHECK_EQUAL(0x02, conn->con_handle);
+    test_addr[5] = 0x05;
+    conn = hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_LE_PUBLIC);
+    CHECK(conn != NULL);
+    CHECK_EQUAL(0x05, conn->con_handle);
+    // same address, different type
+    POINTERS_EQUAL(NULL, hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_LE_RANDOM));
+    test_addr[5] = 0x06;
+    POINTERS_EQUAL(NULL, hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_LE_PUBLIC));
+}
+
+TEST(HCI_Connections, Free){
+    hci_free_connections_fuzz();
+    POINTERS_EQUAL(NULL, hci_connection_for_handle(1));
+    test_addr[5] = 0x01;
+    POINTERS_EQUAL(NULL, hci_connection_for_bd_addr_and_type(test_addr, BD_ADDR_TYPE_ACL));
+}
+
+TEST(HCI_Connections, AclRecombination){
+    // L2CAP packet with 6 bytes payload for handle 0x0005, split into 2 fragments
+    uint8_t first_fragment[]        = { 0x05, 0x20, 0x06, 0x00, 0x06, 0x00, 0x04, 0x00, 0x01, 0x02 };
+    uint8_t continuation_fragment[] = { 0x05, 0x10, 0x04, 0x00, 0x03, 0x04, 0x05, 0x06 };
+    uint8_t expected[]              = { 0x05, 0x20, 0x0a, 0x00, 0x06, 0x00, 0x04, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+    packet_handler(HCI_ACL_DATA_PACKET, first_fragment, sizeof(first_fragment));
+    CHECK_EQUAL(0, acl_packet_count);
+    packet_handler(HCI_ACL_DATA_PACKET, continuation_fragment, sizeof(continuation_fragment));
+    CHECK_EQUAL(1, acl_packet_count);
+    CHECK_EQUAL(sizeof(expected), acl_packet_size);
+    MEMCMP_EQUAL(expected, acl_packet, sizeof(expected));
+    // stray continuation fragment is dropped
+    packet_handler(HCI_ACL_DATA_PACKET, continuation_fragment, sizeof(continuation_fragment));
+    CHECK_EQUAL(1, acl_packet_count);
+}
+
+TEST(HCI_Connections, AclRecombinationDisconnect){
+    uint8_t first_fragment[] = { 0x05, 0x20, 0x06, 0x00, 0x06, 0x00, 0x04, 0x00, 0x01, 0x02 };
+    packet_handler(HCI_ACL_DATA_PACKET, first_fragment, sizeof(first_fragment));
+    // partially received packet is released with connection
+    hci_free_connections_fuzz();
+    CHECK_EQUAL(0, acl_packet_count);
+}
+
+#if defined(ENABLE_HCI_OUTGOING_PACKET_POOL) || defined(ENABLE_HCI_ACL_SCHEDULER)
+static void send_empty_l2cap_packet(hci_con_handle_t con_handle){
+    hci_reserve_packet_buffer();
+    uint8_t * packet = hci_get_outgoing_packet_buffer();
+    little_endian_store_16(packet, 0, con_handle);
+    little_endian_store_16(packet, 2, 4);
+    little_endian_store_16(packet, 4, 0);
+    little_endian_store_16(packet, 6, 0x0004);
+    hci_send_acl_packet_buffer(8);
+}
+#endif
+
+#ifdef ENABLE_HCI_OUTGOING_PACKET_POOL
+TEST(HCI_Connections, OutgoingPacketPool){
+    // LE controller buffers: 27 bytes, 1 packet
+    uint8_t le_read_buffer_size_complete[] = { HCI_EVENT_COMMAND_COMPLETE, 0x07, 0x01, 0x02, 0x20, 0x00, 27, 0x00, 0x01 };
+    packet_handler(HCI_EVENT_PACKET, le_read_buffer_size_complete, sizeof(le_read_buffer_size_complete));
+    hci_simulate_working_fuzz();
+
+    // L2CAP packet with 36 bytes payload for LE handle 0x0005 needs two fragments
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0005));
+    hci_reserve_packet_buffer();
+    uint8_t * packet = hci_get_outgoing_packet_buffer();
+    little_endian_store_16(packet, 0, 0x0005);
+    little_endian_store_16(packet, 2, 40);
+    little_endian_store_16(packet, 4, 36);
+    little_endian_store_16(packet, 6, 0x0004);
+    int i;
+    for (i = 0; i < 36; i++){
+        packet[8 + i] = (uint8_t) i;
+    }
+    hci_send_acl_packet_buffer(44);
+    CHECK_EQUAL(1, sent_acl_packet_count);
+    CHECK_EQUAL(31, sent_acl_packet_sizes[0]);
+
+    // second fragment is parked, packet buffer available for other connections but not for LE handle
+    CHECK_FALSE(hci_is_packet_buffer_reserved());
+    CHECK_FALSE(hci_can_send_acl_packet_now(0x0005));
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0003));
+
+    // controller buffer becomes available
+    uint8_t number_of_completed_packets[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 0x05, 0x01, 0x05, 0x00, 0x01, 0x00 };
+    packet_handler(HCI_EVENT_PACKET, number_of_completed_packets, sizeof(number_of_completed_packets));
+    CHECK_EQUAL(2, sent_acl_packet_count);
+    CHECK_EQUAL(4 + 13, sent_acl_packet_sizes[1]);
+    CHECK_EQUAL(0x1005, little_endian_read_16(sent_acl_packets[1], 0));
+    BYTES_EQUAL(23, sent_acl_packets[1][4]);
+    CHECK_FALSE(hci_is_packet_buffer_reserved());
+}
+
+TEST(HCI_Connections, OutgoingPacketPoolPrepareWhileSending){
+    hci_free_connections_fuzz();
+    hci_init(&hci_transport_test_async, NULL);
+    hci_setup_test_connections_fuzz();
+    transport_ready = 1;
+    // LE controller buffers: 27 bytes, 2 packets
+    uint8_t le_read_buffer_size_complete[] = { HCI_EVENT_COMMAND_COMPLETE, 0x07, 0x01, 0x02, 0x20, 0x00, 27, 0x00, 0x02 };
+    packet_handler(HCI_EVENT_PACKET, le_read_buffer_size_complete, sizeof(le_read_buffer_size_complete));
+    hci_simulate_working_fuzz();
+
+    // transport sends packet for LE handle 0x0005
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0005));
+    send_empty_l2cap_packet(0x0005);
+    CHECK_EQUAL(1, sent_acl_packet_count);
+
+    // Classic handle 0x0003 prepares packet as Controller has buffers, it waits for transport
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0003));
+    send_empty_l2cap_packet(0x0003);
+    CHECK_EQUAL(1, sent_acl_packet_count);
+    CHECK_FALSE(hci_can_send_acl_packet_now(0x0003));
+
+    // transport done, prepared packet is sent
+    uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0x00 };
+    transport_ready = 1;
+    packet_handler(HCI_EVENT_PACKET, packet_sent_event, sizeof(packet_sent_event));
+    CHECK_EQUAL(2, sent_acl_packet_count);
+    CHECK_EQUAL(0x0003, little_endian_read_16(sent_acl_packets[1], 0));
+    transport_ready = 1;
+    packet_handler(HCI_EVENT_PACKET, packet_sent_event, sizeof(packet_sent_event));
+    CHECK_FALSE(hci_is_packet_buffer_reserved());
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0003));
+}
+#endif
+
+#ifdef ENABLE_HCI_ACL_SCHEDULER
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static bool acl_scheduler_senders_active;
+
+// senders always have another packet
+static void acl_scheduler_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_ACL_CAN_SEND_NOW) return;
+    hci_con_handle_t con_handle = hci_event_acl_can_send_now_get_handle(packet);
+    send_empty_l2cap_packet(con_handle);
+    if (acl_scheduler_senders_active){
+        hci_request_can_send_now_event(con_handle);
+    }
+}
+
+TEST(HCI_Connections, AclSchedulerWeights){
+    // LE controller buffers: 27 bytes, 2 packets
+    uint8_t le_read_buffer_size_complete[] = { HCI_EVENT_COMMAND_COMPLETE, 0x07, 0x01, 0x02, 0x20, 0x00, 27, 0x00, 0x02 };
+    packet_handler(HCI_EVENT_PACKET, le_read_buffer_size_complete, sizeof(le_read_buffer_size_complete));
+    hci_simulate_working_fuzz();
+
+    // second LE connection with handle 0x0006 as peripheral
+    uint8_t le_connection_complete[] = { HCI_EVENT_LE_META, 19, HCI_SUBEVENT_LE_CONNECTION_COMPLETE, 0x00, 0x06, 0x00, HCI_ROLE_SLAVE, 0x00,
+                                         0x06, 0x00, 0x33, 0x44, 0x55, 0x66, 0x28, 0x00, 0x00, 0x00, 0xc8, 0x00, 0x00 };
+    packet_handler(HCI_EVENT_PACKET, le_connection_complete, sizeof(le_connection_complete));
+    CHECK(hci_connection_for_handle(0x0006) != NULL);
+
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hci_acl_scheduler_set_weight(0x0005, 3));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, hci_acl_scheduler_set_weight(0x0005, 0));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, hci_acl_scheduler_set_weight(0x0007, 1));
+
+    hci_event_callback_registration.callback = &acl_scheduler_event_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+
+    // both connections always want to send, Controller completes all packets after each pass
+    acl_scheduler_senders_active = true;
+    hci_request_can_send_now_event(0x0005);
+    hci_request_can_send_now_event(0x0006);
+    int pass;
+    for (pass = 0; pass < 100; pass++){
+        if (pass == 99){
+            acl_scheduler_senders_active = false;
+        }
+        uint8_t number_of_completed_packets[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 0x09, 0x02, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00 };
+        little_endian_store_16(number_of_completed_packets, 5, hci_connection_for_handle(0x0005)->num_packets_sent);
+        little_endian_store_16(number_of_completed_packets, 9, hci_connection_for_handle(0x0006)->num_packets_sent);
+        packet_handler(HCI_EVENT_PACKET, number_of_completed_packets, sizeof(number_of_completed_packets));
+    }
+
+    hci_acl_scheduler_counters_t counters_5;
+    hci_acl_scheduler_counters_t counters_6;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hci_acl_scheduler_get_counters(0x0005, &counters_5));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hci_acl_scheduler_get_counters(0x0006, &counters_6));
+    CHECK_EQUAL(202, counters_5.packets_sent + counters_6.packets_sent);
+    CHECK_EQUAL(counters_5.packets_sent, counters_5.fragments_sent);
+    CHECK(counters_5.packets_sent >= 145);
+    CHECK(counters_5.packets_sent <= 157);
+    CHECK(counters_6.requests_denied > 0);
+}
+
+TEST(HCI_Connections, AclSchedulerPriority){
+    hci_simulate_working_fuzz();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hci_acl_scheduler_set_priority(0x0003, 1));
+    // check doesn't change scheduler state
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0001));
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0001));
+    // 0x0003 with higher priority waits for can send now, 0x0001 has to wait
+    hci_connection_for_handle(0x0003)->acl_waiting_for_can_send_now = 1;
+    CHECK_FALSE(hci_can_send_acl_packet_now(0x0001));
+    CHECK_TRUE(hci_can_send_acl_packet_now(0x0003));
+    hci_acl_scheduler_counters_t counters;
+    hci_acl_scheduler_get_counters(0x0001, &counters);
+    CHECK_EQUAL(0, counters.requests_denied);
+    hci_request_can_send_now_event(0x0001);
+    hci_acl_scheduler_get_counters(0x0001, &counters);
+    CHECK_EQUAL(1, counters.requests_denied);
+}
+#endif
+
+#if defined(ENABLE_HCI_COMMAND_PIPELINING) || defined(ENABLE_HCI_RUN_DIRTY_FLAGS)
+static void command_complete(uint16_t opcode, uint8_t num_hci_command_packets){
+    uint8_t command_complete_event[] = { HCI_EVENT_COMMAND_COMPLETE, 0x04, 0x00, 0x00, 0x00, 0x00 };
+    command_complete_event[2] = num_hci_command_packets;
+    little_endian_store_16(command_complete_event, 3, opcode);
+    packet_handler(HCI_EVENT_PACKET, command_complete_event, sizeof(command_complete_event));
+}
+#endif
+
+#ifdef ENABLE_HCI_COMMAND_PIPELINING
+TEST(HCI_Connections, CommandPipelining){
+    hci_simulate_working_fuzz();
+    test_addr[5] = 0x07;
+    // independent commands are pipelined
+    CHECK_EQUAL(0, hci_send_cmd(&hci_le_rand));
+    CHECK_TRUE(hci_can_send_command_packet_now());
+    CHECK_EQUAL(0, hci_send_cmd(&hci_le_add_device_to_white_list, BD_ADDR_TYPE_LE_PUBLIC, test_addr));
+    CHECK_TRUE(hci_can_send_command_packet_now());
+    // others wait until they are complete
+    CHECK_EQUAL(0, hci_send_cmd(&hci_le_set_scan_enable, 0, 0));
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_RAND, 1);
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_SET_SCAN_ENABLE, 2);
+    CHECK_TRUE(hci_can_send_command_packet_now());
+    // Controller credits limit commands in flight
+    CHECK_EQUAL(0, hci_send_cmd(&hci_le_rand));
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_ADD_DEVICE_TO_WHITE_LIST, 4);
+    CHECK_TRUE(hci_can_send_command_packet_now());
+    // and pipeline size
+    int i;
+    for (i = 0; i < (HCI_COMMAND_PIPELINE_MAX - 1); i++){
+        CHECK_TRUE(hci_can_send_command_packet_now());
+        CHECK_EQUAL(0, hci_send_cmd(&hci_le_rand));
+    }
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    // NOP doesn't complete a command
+    command_complete(0x0000, 4);
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_RAND, 4);
+    CHECK_TRUE(hci_can_send_command_packet_now());
+    // credits from late Command Complete don't include commands still outstanding
+    CHECK_EQUAL(0, hci_send_cmd(&hci_le_rand));
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_RAND, 1);
+    CHECK_FALSE(hci_can_send_command_packet_now());
+    command_complete(HCI_OPCODE_HCI_LE_RAND, 3);
+    CHECK_TRUE(hci_can_send_command_packet_now());
+}
+#endif
+
+#ifdef ENABLE_HCI_RUN_DIRTY_FLAGS
+static void read_rssi_complete(hci_con_handle_t con_handle){
+    uint8_t read_rssi_complete_event[] = { HCI_EVENT_COMMAND_COMPLETE, 0x07, 0x01, 0x05, 0x14, 0x00, 0x00, 0x00, 0xd0 };
+    little_endian_store_16(read_rssi_complete_event, 6, con_handle);
+    packet_handler(HCI_EVENT_PACKET, read_rssi_complete_event, sizeof(read_rssi_complete_event));
+}
+
+TEST(HCI_Connections, RunDirtyFlags){
+    hci_simulate_working_fuzz();
+    // pending connection requests have been handled
+    hci_con_handle_t con_handle;
+    for (con_handle = 1; con_handle <= 5; con_handle++){
+        CHECK_FALSE(hci_connection_for_handle(con_handle)->dirty);
+    }
+    command_complete(HCI_OPCODE_HCI_ACCEPT_CONNECTION_REQUEST, 1);
+    command_complete(HCI_OPCODE_HCI_ACCEPT_SYNCHRONOUS_CONNECTION, 1);
+    // new work marks connection and is processed by hci_run
+    sent_command_opcode = 0;
+    CHECK_EQUAL(1, gap_read_rssi(0x0003));
+    CHECK_EQUAL(HCI_OPCODE_HCI_READ_RSSI, sent_command_opcode);
+    // cleared by next hci_run that finds nothing to do
+    read_rssi_complete(0x0003);
+    CHECK_FALSE(hci_connection_for_handle(0x0003)->dirty);
+    // connection stays dirty while command cannot be sent
+    command_complete(0x0000, 0);
+    sent_command_opcode = 0;
+    CHECK_EQUAL(1, gap_read_rssi(0x0004));
+    CHECK_EQUAL(0, sent_command_opcode);
+    CHECK_TRUE(hci_connection_for_handle(0x0004)->dirty);
+    command_complete(0x0000, 1);
+    CHECK_EQUAL(HCI_OPCODE_HCI_READ_RSSI, sent_command_opcode);
+    read_rssi_complete(0x0004);
+    CHECK_FALSE(hci_connection_for_handle(0x0004)->dirty);
+}
+#endif
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
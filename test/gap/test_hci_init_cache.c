@@ -0,0 +1,297 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "bluetooth_company_id.h"
+#include "btstack_chipset.h"
+#include "btstack_memory.h"
+#include "btstack_tlv.h"
+#include "btstack_util.h"
+#include "gap.h"
+#include "hci.h"
+#include "hci_dump.h"
+#include "btstack_debug.h"
+#include "btstack_run_loop_posix.h"
+
+static void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static const uint8_t packet_sent_event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+
+// Controller model
+static uint16_t controller_manufacturer;
+static const bd_addr_t controller_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static uint16_t sent_opcodes[50];
+static int      sent_opcodes_count;
+
+static int sent_opcode_count(uint16_t opcode){
+    int count = 0;
+    int i;
+    for (i = 0; i < sent_opcodes_count; i++){
+        if (sent_opcodes[i] == opcode){
+            count++;
+        }
+    }
+    return count;
+}
+
+static uint8_t controller_return_parameters(uint16_t opcode, uint8_t * params){
+    switch (opcode){
+        case HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION:
+            params[1] = 0x09;
+            little_endian_store_16(params, 2, 0x1234);
+            params[4] = 0x09;
+            little_endian_store_16(params, 5, controller_manufacturer);
+            little_endian_store_16(params, 7, 0x5678);
+            return 9;
+        case HCI_OPCODE_HCI_READ_LOCAL_NAME:
+            strcpy((char *) &params[1], "Controller");
+            return 249;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS:
+            // Read Buffer Size, Write LE Host Supported
+            params[1 + 14] = 0x80;
+            params[1 + 24] = 0x40;
+            return 65;
+        case HCI_OPCODE_HCI_READ_BD_ADDR:
+            reverse_bd_addr(controller_addr, &params[1]);
+            return 7;
+        case HCI_OPCODE_HCI_READ_BUFFER_SIZE:
+            little_endian_store_16(params, 1, 1021);
+            params[3] = 64;
+            little_endian_store_16(params, 4, 8);
+            little_endian_store_16(params, 6, 8);
+            return 8;
+        case HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_FEATURES:
+            // LE Supported (Controller)
+            params[1 + 4] = 1 << 6;
+            return 9;
+        case HCI_OPCODE_HCI_LE_READ_BUFFER_SIZE:
+            little_endian_store_16(params, 1, 251);
+            params[3] = 4;
+            return 4;
+        case HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE:
+            params[1] = 8;
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static int hci_transport_test_can_send_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return 1;
+}
+
+// Controller responds after packet was sent
+static uint8_t  response_event[HCI_EVENT_BUFFER_SIZE];
+static uint16_t response_event_size;
+
+static int hci_transport_test_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    UNUSED(size);
+    btstack_assert(packet_type == HCI_COMMAND_DATA_PACKET);
+    btstack_assert(response_event_size == 0);
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    btstack_assert(sent_opcodes_count < 50);
+    sent_opcodes[sent_opcodes_count++] = opcode;
+    memset(response_event, 0, sizeof(response_event));
+    uint8_t params_len = controller_return_parameters(opcode, &response_event[5]);
+    response_event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    response_event[1] = 3 + params_len;
+    response_event[2] = 1;
+    little_endian_store_16(response_event, 3, opcode);
+    response_event_size = 5 + params_len;
+    return 0;
+}
+
+static void controller_process(void){
+    uint8_t event[HCI_EVENT_BUFFER_SIZE];
+    while (response_event_size > 0){
+        uint16_t size = response_event_size;
+        memcpy(event, response_event, size);
+        response_event_size = 0;
+        packet_handler(HCI_EVENT_PACKET, (uint8_t *) &packet_sent_event[0], sizeof(packet_sent_event));
+        packet_handler(HCI_EVENT_PACKET, event, size);
+    }
+}
+
+static void hci_transport_test_init(const void * transport_config){
+    UNUSED(transport_config);
+}
+
+static int hci_transport_test_open(void){
+    return 0;
+}
+
+static int hci_transport_test_close(void){
+    return 0;
+}
+
+static void hci_transport_test_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    packet_handler = handler;
+}
+
+// chipset driver uploads patch with version
+static uint8_t patch_version;
+static bool    patch_sent;
+
+static void chipset_test_init(const void * transport_config){
+    UNUSED(transport_config);
+    patch_sent = false;
+}
+
+static btstack_chipset_result_t chipset_test_next_command(uint8_t * hci_cmd_buffer){
+    if (patch_sent) return BTSTACK_CHIPSET_DONE;
+    patch_sent = true;
+    little_endian_store_16(hci_cmd_buffer, 0, 0xfc00);
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = patch_version;
+    return BTSTACK_CHIPSET_VALID_COMMAND;
+}
+
+static const btstack_chipset_t chipset_test = {
+    "TEST",
+    &chipset_test_init,
+    &chipset_test_next_command,
+    NULL,
+    NULL,
+};
+
+static const btstack_chipset_t * controller_chipset;
+
+static const hci_transport_t hci_transport_test = {
+        /* const char * name; */                                        "TEST",
+        /* void   (*init) (const void *transport_config); */            &hci_transport_test_init,
+        /* int    (*open)(void); */                                     &hci_transport_test_open,
+        /* int    (*close)(void); */                                    &hci_transport_test_close,
+        /* void   (*register_packet_handler)(void (*handler)(...); */   &hci_transport_test_register_packet_handler,
+        /* int    (*can_send_packet_now)(uint8_t packet_type); */       &hci_transport_test_can_send_now,
+        /* int    (*send_packet)(...); */                               &hci_transport_test_send_packet,
+        /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+        /* void   (*reset_link)(void); */                               NULL,
+        /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+};
+
+// TLV with single entry
+static uint32_t tlv_tag;
+static uint8_t  tlv_value[300];
+static int      tlv_value_len;
+
+static int tlv_test_get_tag(void * context, uint32_t tag, uint8_t * buffer, uint32_t buffer_size){
+    UNUSED(context);
+    if ((tlv_value_len == 0) || (tag != tlv_tag)) return 0;
+    int len = btstack_min(tlv_value_len, buffer_size);
+    memcpy(buffer, tlv_value, len);
+    return len;
+}
+
+static int tlv_test_store_tag(void * context, uint32_t tag, const uint8_t * data, uint32_t data_size){
+    UNUSED(context);
+    btstack_assert(data_size <= sizeof(tlv_value));
+    tlv_tag = tag;
+    memcpy(tlv_value, data, data_size);
+    tlv_value_len = data_size;
+    return 0;
+}
+
+static void tlv_test_delete_tag(void * context, uint32_t tag){
+    UNUSED(context);
+    UNUSED(tag);
+    tlv_value_len = 0;
+}
+
+static const btstack_tlv_t tlv_test = {
+    &tlv_test_get_tag,
+    &tlv_test_store_tag,
+    &tlv_test_delete_tag,
+};
+
+static void power_on(void){
+    btstack_memory_init();
+    hci_init(&hci_transport_test, NULL);
+    if (controller_chipset != NULL){
+        hci_set_chipset(controller_chipset);
+    }
+    sent_opcodes_count = 0;
+    hci_power_control(HCI_POWER_ON);
+    controller_process();
+    CHECK_EQUAL(HCI_STATE_WORKING, hci_get_state());
+}
+
+TEST_GROUP(HCI_InitCache){
+    void setup(void){
+        controller_manufacturer = BLUETOOTH_COMPANY_ID_BLUEKITCHEN_GMBH;
+        controller_chipset = NULL;
+        patch_version = 1;
+        tlv_value_len = 0;
+        btstack_tlv_set_instance(&tlv_test, NULL);
+    }
+};
+
+TEST(HCI_InitCache, WarmBoot){
+    power_on();
+    int cold_boot_commands = sent_opcodes_count;
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+    CHECK(tlv_value_len > 0);
+    // cold boot responses are stored without trailing zeros
+    CHECK(tlv_value_len < 128);
+
+    power_on();
+    CHECK_EQUAL(cold_boot_commands - 6, sent_opcodes_count);
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_RESET));
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_READ_LOCAL_VERSION_INFORMATION));
+    // read before chipset driver uploads patches
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_READ_LOCAL_NAME));
+    CHECK_EQUAL(0, sent_opcode_count(HCI_OPCODE_HCI_READ_LOCAL_SUPPORTED_COMMANDS));
+    CHECK_EQUAL(0, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+    CHECK_EQUAL(0, sent_opcode_count(HCI_OPCODE_HCI_LE_READ_WHITE_LIST_SIZE));
+    // write commands are still sent
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_WRITE_LE_HOST_SUPPORTED));
+
+    // replayed responses have been applied
+    CHECK_EQUAL(1021, hci_max_acl_data_packet_length());
+    bd_addr_t addr;
+    gap_local_bd_addr(addr);
+    MEMCMP_EQUAL(controller_addr, addr, 6);
+}
+
+TEST(HCI_InitCache, ControllerChanged){
+    power_on();
+    int cold_boot_commands = sent_opcodes_count;
+    controller_manufacturer = BLUETOOTH_COMPANY_ID_CYPRESS_SEMICONDUCTOR;
+    power_on();
+    CHECK_EQUAL(cold_boot_commands, sent_opcodes_count);
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+    // cache updated for new Controller
+    power_on();
+    CHECK_EQUAL(0, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+}
+
+TEST(HCI_InitCache, FirmwareChanged){
+    controller_chipset = &chipset_test;
+    power_on();
+    CHECK_EQUAL(1, sent_opcode_count(0xfc00));
+    int cold_boot_commands = sent_opcodes_count;
+    patch_version = 2;
+    power_on();
+    CHECK_EQUAL(cold_boot_commands, sent_opcodes_count);
+    CHECK_EQUAL(1, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+    // cache updated for new patch
+    power_on();
+    CHECK_EQUAL(0, sent_opcode_count(HCI_OPCODE_HCI_READ_BUFFER_SIZE));
+}
+
+TEST(HCI_InitCache, NoTLV){
+    btstack_tlv_set_instance(NULL, NULL);
+    power_on();
+    int cold_boot_commands = sent_opcodes_count;
+    power_on();
+    CHECK_EQUAL(cold_boot_commands, sent_opcodes_count);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -15,6 +15,7 @@
 #include "btstack_event.h"
 #include "hci_dump.h"
 #include "btstack_debug.h"
+#include "btstack_run_loop_posix.h"
 
 typedef struct {
     uint8_t type;
@@ -131,7 +132,161 @@ TEST(GAP_LE, ScanStartParam){
     CHECK_HCI_COMMAND(&hci_le_set_scan_enable);
 }
 
+#ifdef ENABLE_LE_ADVERTISING_REPORT_PIPELINE
+// advertising report pipeline
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static int     gap_reports_count;
+static int     gap_batches_count;
+static uint8_t gap_batch_num_reports;
+
+static void gap_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    switch (hci_event_packet_get_type(packet)){
+        case GAP_EVENT_ADVERTISING_REPORT:
+            gap_reports_count++;
+            break;
+        case GAP_EVENT_ADVERTISING_REPORT_BATCH:
+            gap_batches_count++;
+            gap_batch_num_reports = gap_event_advertising_report_batch_get_num_reports(packet);
+            CHECK_EQUAL(size, 4 + gap_event_advertising_report_batch_get_reports_length(packet));
+            CHECK_EQUAL(GAP_EVENT_ADVERTISING_REPORT, gap_event_advertising_report_batch_get_reports(packet)[0]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void simulate_advertising_report(const bd_addr_t address, int8_t rssi, const uint8_t * data, uint8_t data_len){
+    uint8_t event[2 + 11 + 31 + 1];
+    uint16_t pos = 0;
+    event[pos++] = HCI_EVENT_LE_META;
+    event[pos++] = 11 + data_len + 1;
+    event[pos++] = HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+    event[pos++] = 1;
+    event[pos++] = 0;   // ADV_IND
+    event[pos++] = 0;   // public address
+    reverse_bd_addr(address, &event[pos]);
+    pos += 6;
+    event[pos++] = data_len;
+    memcpy(&event[pos], data, data_len);
+    pos += data_len;
+    event[pos++] = (uint8_t) rssi;
+    packet_handler(HCI_EVENT_PACKET, event, pos);
+}
+
+static const bd_addr_t adv_address_1 = { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 };
+static const bd_addr_t adv_address_2 = { 0x22, 0x22, 0x22, 0x22, 0x22, 0x22 };
+// flags, UUID16 0x180f, Manufacturer Specific Data for company 0x048f
+static const uint8_t adv_data_battery[]      = { 2, 0x01, 0x06, 3, 0x03, 0x0f, 0x18 };
+static const uint8_t adv_data_manufacturer[] = { 2, 0x01, 0x06, 4, 0xff, 0x8f, 0x04, 0x42 };
+
+TEST_GROUP(GAP_LE_AdvertisingReports){
+        void setup(void){
+            transport_count_packets = 0;
+            gap_reports_count = 0;
+            gap_batches_count = 0;
+            gap_batch_num_reports = 0;
+            hci_init(&hci_transport_test, NULL);
+            hci_simulate_working_fuzz();
+            hci_event_callback_registration.callback = &gap_event_handler;
+            hci_add_event_handler(&hci_event_callback_registration);
+            gap_start_scan();
+        }
+        void teardown(void){
+            hci_deinit();
+        }
+};
+
+TEST(GAP_LE_AdvertisingReports, Forward){
+    simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(2, gap_reports_count);
+    gap_advertising_report_counters_t counters;
+    gap_get_advertising_report_counters(&counters);
+    CHECK_EQUAL(2, counters.forwarded);
+}
+
+TEST(GAP_LE_AdvertisingReports, Dedup){
+    gap_set_advertising_report_cache_ttl(10000);
+    simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_1, -60, adv_data_battery, sizeof(adv_data_battery));
+    // changed data or other address are new
+    simulate_advertising_report(adv_address_1, -50, adv_data_manufacturer, sizeof(adv_data_manufacturer));
+    simulate_advertising_report(adv_address_2, -50, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_2, -50, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(3, gap_reports_count);
+    gap_advertising_report_counters_t counters;
+    gap_get_advertising_report_counters(&counters);
+    CHECK_EQUAL(3, counters.forwarded);
+    CHECK_EQUAL(2, counters.dropped_duplicates);
+    // cache cleared on scan start
+    gap_stop_scan();
+    gap_start_scan();
+    simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(4, gap_reports_count);
+}
+
+TEST(GAP_LE_AdvertisingReports, Filter){
+    static const bd_addr_t addresses[] = { { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11 } };
+    gap_advertising_report_filter_t filter;
+    filter.rssi_min = -70;
+    filter.num_addresses = 0;
+    filter.addresses = NULL;
+    filter.uuid16 = 0;
+    filter.company_id = 0xffff;
+    gap_set_advertising_report_filter(&filter);
+    simulate_advertising_report(adv_address_1, -80, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_1, -60, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(1, gap_reports_count);
+
+    filter.num_addresses = 1;
+    filter.addresses = addresses;
+    simulate_advertising_report(adv_address_2, -60, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_1, -60, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(2, gap_reports_count);
+
+    filter.uuid16 = 0x180f;
+    simulate_advertising_report(adv_address_1, -60, adv_data_manufacturer, sizeof(adv_data_manufacturer));
+    simulate_advertising_report(adv_address_1, -60, adv_data_battery, sizeof(adv_data_battery));
+    CHECK_EQUAL(3, gap_reports_count);
+
+    filter.uuid16 = 0;
+    filter.company_id = 0x048f;
+    simulate_advertising_report(adv_address_1, -60, adv_data_battery, sizeof(adv_data_battery));
+    simulate_advertising_report(adv_address_1, -60, adv_data_manufacturer, sizeof(adv_data_manufacturer));
+    CHECK_EQUAL(4, gap_reports_count);
+
+    gap_advertising_report_counters_t counters;
+    gap_get_advertising_report_counters(&counters);
+    CHECK_EQUAL(4, counters.forwarded);
+    CHECK_EQUAL(4, counters.dropped_by_filter);
+}
+
+TEST(GAP_LE_AdvertisingReports, Batch){
+    gap_set_advertising_report_batch_timeout(100);
+    int i;
+    for (i=0;i<4;i++){
+        simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    }
+    CHECK_EQUAL(0, gap_reports_count);
+    CHECK_EQUAL(0, gap_batches_count);
+    gap_stop_scan();
+    CHECK_EQUAL(1, gap_batches_count);
+    CHECK_EQUAL(4, gap_batch_num_reports);
+
+    // full batch is emitted, 12 + 7 bytes per report
+    gap_start_scan();
+    for (i=0;i<20;i++){
+        simulate_advertising_report(adv_address_1, -50, adv_data_battery, sizeof(adv_data_battery));
+    }
+    CHECK_EQUAL(2, gap_batches_count);
+    CHECK_EQUAL(13, gap_batch_num_reports);
+    CHECK_EQUAL(0, gap_reports_count);
+}
+#endif
+
 int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
     const char * log_path = "/tmp/test_scan.pklg";
     printf("Log: %s\n", log_path);
     hci_dump_open(log_path, HCI_DUMP_PACKETLOGGER);
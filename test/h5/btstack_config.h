@@ -0,0 +1,13 @@
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+#define ENABLE_H5_SLIDING_WINDOW
+#define ENABLE_H5_CRC16_TABLE_256
+#define ENABLE_H5_BULK_READ
+#define ENABLE_PRINTF_HEXDUMP
+
+#define HCI_ACL_PAYLOAD_SIZE 1021
+#define HCI_TRANSPORT_H5_WINDOW_SIZE 4
+#define HCI_TRANSPORT_H5_SLIP_TX_CHUNK_LEN 512
+
+#endif
@@ -0,0 +1,492 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_slip.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_transport.h"
+
+// Simulated UART link between H5 transport (host) and H5 peer (controller) with virtual time in us
+
+#define BAUDRATE              921600
+#define PEER_ACK_DELAY_US     1000
+#define ACL_PACKET_SIZE       (HCI_ACL_HEADER_SIZE + 251)
+#define RX_FIFO_SIZE          4096
+#define MAX_PEER_FRAMES       32
+
+static uint32_t sim_time_us;
+
+static uint32_t sim_bytes_time_us(uint32_t num_bytes){
+    // 8N1
+    return (uint32_t) ((uint64_t) num_bytes * 10u * 1000000u / BAUDRATE);
+}
+
+// run loop with virtual time
+
+static void sim_run_loop_init(void){
+    btstack_run_loop_base_init();
+}
+
+static uint32_t sim_run_loop_get_time_ms(void){
+    return sim_time_us / 1000u;
+}
+
+static void sim_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = sim_run_loop_get_time_ms() + timeout_in_ms;
+}
+
+static const btstack_run_loop_t sim_run_loop = {
+    &sim_run_loop_init,
+    &btstack_run_loop_base_add_data_source,
+    &btstack_run_loop_base_remove_data_source,
+    &btstack_run_loop_base_enable_data_source_callbacks,
+    &btstack_run_loop_base_disable_data_source_callbacks,
+    &sim_run_loop_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    NULL,
+    &btstack_run_loop_base_dump_timer,
+    &sim_run_loop_get_time_ms,
+};
+
+// peer: minimal H5 controller that acknowledges every reliable packet
+
+static uint8_t  peer_config_field;
+static uint8_t  peer_expected_seq_nr;
+static uint32_t peer_packets_received;
+static uint32_t peer_packets_dropped;
+static int      peer_drop_seq_nr;
+static uint8_t  peer_slip_frame[2 * (HCI_ACL_BUFFER_SIZE + 6)];
+static uint16_t peer_slip_frame_len;
+static bool     peer_slip_escape;
+static bool     peer_slip_active;
+
+typedef struct {
+    uint32_t arrival_us;
+    uint16_t len;
+    uint8_t  data[16];
+} peer_frame_t;
+
+static peer_frame_t peer_frames[MAX_PEER_FRAMES];
+static int      peer_frames_count;
+static uint32_t peer_line_free_us;
+
+static uint16_t peer_crc16_ccitt(const uint8_t * data, uint16_t len){
+    // bitwise reference, reflected polynomial 0x8408, init 0xffff
+    uint16_t crc = 0xffff;
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        crc ^= data[i];
+        int bit;
+        for (bit = 0; bit < 8; bit++){
+            crc = (crc & 1u) ? ((crc >> 1) ^ 0x8408u) : (crc >> 1);
+        }
+    }
+    // H5 transmits DIC MSB first with bit order reversed
+    uint16_t reversed = 0;
+    int bit;
+    for (bit = 0; bit < 16; bit++){
+        reversed = (reversed << 1) | ((crc >> bit) & 1u);
+    }
+    return reversed;
+}
+
+static void peer_send_frame(uint8_t ack_nr, uint8_t packet_type, const uint8_t * payload, uint16_t payload_len){
+    uint8_t frame[8];
+    frame[0] = ack_nr << 3;
+    frame[1] = packet_type | ((payload_len & 0x0fu) << 4);
+    frame[2] = payload_len >> 4;
+    frame[3] = 0xffu - (frame[0] + frame[1] + frame[2]);
+    memcpy(&frame[4], payload, payload_len);
+
+    btstack_assert(peer_frames_count < MAX_PEER_FRAMES);
+    peer_frame_t * out = &peer_frames[peer_frames_count++];
+    uint16_t pos = 0;
+    out->data[pos++] = BTSTACK_SLIP_SOF;
+    uint16_t i;
+    for (i = 0; i < (4 + payload_len); i++){
+        switch (frame[i]){
+            case BTSTACK_SLIP_SOF:
+                out->data[pos++] = 0xdb;
+                out->data[pos++] = 0xdc;
+                break;
+            case 0xdb:
+                out->data[pos++] = 0xdb;
+                out->data[pos++] = 0xdd;
+                break;
+            default:
+                out->data[pos++] = frame[i];
+                break;
+        }
+    }
+    out->data[pos++] = BTSTACK_SLIP_SOF;
+    out->len = pos;
+    // responses are sent after processing delay, one after the other
+    uint32_t start = btstack_max(sim_time_us + PEER_ACK_DELAY_US, peer_line_free_us);
+    out->arrival_us = start + sim_bytes_time_us(pos);
+    peer_line_free_us = out->arrival_us;
+}
+
+static void peer_process_frame(const uint8_t * frame, uint16_t len){
+    CHECK(len >= 4);
+    CHECK_EQUAL(0xff, (uint8_t) (frame[0] + frame[1] + frame[2] + frame[3]));
+    uint8_t  seq_nr      = frame[0] & 0x07u;
+    bool     dic_present = (frame[0] & 0x40u) != 0u;
+    bool     reliable    = (frame[0] & 0x80u) != 0u;
+    uint8_t  packet_type = frame[1] & 0x0fu;
+    uint16_t payload_len = (frame[1] >> 4) | (frame[2] << 4);
+    const uint8_t * payload = &frame[4];
+    CHECK_EQUAL(len, 4 + payload_len + (dic_present ? 2 : 0));
+    if (dic_present){
+        CHECK_EQUAL(peer_crc16_ccitt(frame, 4 + payload_len), big_endian_read_16(frame, 4 + payload_len));
+    }
+
+    if (packet_type == 0x0f){
+        static const uint8_t sync[]            = { 0x01, 0x7e };
+        static const uint8_t sync_response[]   = { 0x02, 0x7d };
+        static const uint8_t config[]          = { 0x03, 0xfc };
+        if (memcmp(payload, sync, 2) == 0){
+            peer_send_frame(0, 0x0f, sync_response, sizeof(sync_response));
+        }
+        if (memcmp(payload, config, 2) == 0){
+            uint8_t config_response[] = { 0x04, 0x7b, peer_config_field };
+            peer_send_frame(0, 0x0f, config_response, sizeof(config_response));
+        }
+        return;
+    }
+
+    if (!reliable) return;
+    if ((seq_nr == peer_expected_seq_nr) && (seq_nr == peer_drop_seq_nr)){
+        // simulate lost packet once
+        peer_drop_seq_nr = -1;
+        peer_packets_dropped++;
+        return;
+    }
+    if (seq_nr == peer_expected_seq_nr){
+        CHECK_EQUAL(HCI_ACL_DATA_PACKET, packet_type);
+        CHECK_EQUAL(ACL_PACKET_SIZE, payload_len);
+        // packets carry running counter
+        CHECK_EQUAL(peer_packets_received & 0xffu, payload[HCI_ACL_HEADER_SIZE]);
+        peer_packets_received++;
+        peer_expected_seq_nr = (peer_expected_seq_nr + 1u) & 0x07u;
+    }
+    peer_send_frame(peer_expected_seq_nr, 0x00, NULL, 0);
+}
+
+static void peer_receive(const uint8_t * data, uint16_t len){
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        uint8_t byte = data[i];
+        if (byte == BTSTACK_SLIP_SOF){
+            if (peer_slip_active && (peer_slip_frame_len > 0u)){
+                peer_process_frame(peer_slip_frame, peer_slip_frame_len);
+            }
+            peer_slip_active = true;
+            peer_slip_frame_len = 0;
+            peer_slip_escape = false;
+            continue;
+        }
+        if (!peer_slip_active) continue;
+        if (peer_slip_escape){
+            byte = (byte == 0xdc) ? BTSTACK_SLIP_SOF : 0xdb;
+            peer_slip_escape = false;
+        } else if (byte == 0xdb){
+            peer_slip_escape = true;
+            continue;
+        }
+        btstack_assert(peer_slip_frame_len < sizeof(peer_slip_frame));
+        peer_slip_frame[peer_slip_frame_len++] = byte;
+    }
+}
+
+// UART driver connected to peer
+
+static void (*uart_block_sent)(void);
+static void (*uart_block_received)(void);
+static void (*uart_data_received)(uint16_t size);
+
+static const uint8_t * uart_tx_data;
+static uint16_t        uart_tx_len;
+static uint32_t        uart_tx_done_us;
+static uint32_t        uart_tx_bytes;
+
+static uint8_t * uart_rx_buffer;
+static uint16_t  uart_rx_len;
+static bool      uart_rx_partial;
+
+static uint8_t  uart_rx_fifo[RX_FIFO_SIZE];
+static uint16_t uart_rx_fifo_len;
+
+static int uart_init(const btstack_uart_config_t * config){
+    UNUSED(config);
+    return 0;
+}
+
+static int uart_open(void){
+    return 0;
+}
+
+static int uart_close(void){
+    return 0;
+}
+
+static void uart_set_block_received(void (*handler)(void)){
+    uart_block_received = handler;
+}
+
+static void uart_set_block_sent(void (*handler)(void)){
+    uart_block_sent = handler;
+}
+
+static void uart_set_data_received(void (*handler)(uint16_t size)){
+    uart_data_received = handler;
+}
+
+static int uart_set_baudrate(uint32_t baudrate){
+    UNUSED(baudrate);
+    return 0;
+}
+
+static int uart_set_parity(int parity){
+    UNUSED(parity);
+    return 0;
+}
+
+static void uart_receive_block(uint8_t * buffer, uint16_t len){
+    uart_rx_buffer  = buffer;
+    uart_rx_len     = len;
+    uart_rx_partial = false;
+}
+
+static void uart_receive_available(uint8_t * buffer, uint16_t len){
+    uart_rx_buffer  = buffer;
+    uart_rx_len     = len;
+    uart_rx_partial = true;
+}
+
+static void uart_send_block(const uint8_t * data, uint16_t len){
+    btstack_assert(uart_tx_data == NULL);
+    uart_tx_data = data;
+    uart_tx_len  = len;
+    uart_tx_done_us = sim_time_us + sim_bytes_time_us(len);
+    uart_tx_bytes += len;
+}
+
+static const btstack_uart_block_t uart_bulk = {
+    &uart_init, &uart_open, &uart_close, &uart_set_block_received, &uart_set_block_sent, &uart_set_baudrate,
+    &uart_set_parity, NULL, &uart_receive_block, &uart_send_block, NULL, NULL, NULL,
+    &uart_set_data_received, &uart_receive_available,
+};
+
+static const btstack_uart_block_t uart_bytewise = {
+    &uart_init, &uart_open, &uart_close, &uart_set_block_received, &uart_set_block_sent, &uart_set_baudrate,
+    &uart_set_parity, NULL, &uart_receive_block, &uart_send_block, NULL, NULL, NULL,
+    NULL, NULL,
+};
+
+static void uart_deliver_rx(void){
+    while ((uart_rx_fifo_len > 0u) && (uart_rx_len > 0u)){
+        uint16_t len = uart_rx_partial ? btstack_min(uart_rx_len, uart_rx_fifo_len) : uart_rx_len;
+        if (len > uart_rx_fifo_len) return;
+        memcpy(uart_rx_buffer, uart_rx_fifo, len);
+        memmove(uart_rx_fifo, &uart_rx_fifo[len], uart_rx_fifo_len - len);
+        uart_rx_fifo_len -= len;
+        uart_rx_len = 0;
+        if (uart_rx_partial){
+            uart_data_received(len);
+        } else {
+            uart_block_received();
+        }
+    }
+}
+
+// host
+
+static const hci_transport_t * transport;
+static uint32_t host_packets_to_send;
+static uint32_t host_packets_sent;
+static uint8_t  host_acl_packet[ACL_PACKET_SIZE];
+static bool     host_link_active;
+
+static void host_send_next(void){
+    if (host_packets_sent >= host_packets_to_send) return;
+    if (!transport->can_send_packet_now(HCI_ACL_DATA_PACKET)) return;
+    host_acl_packet[HCI_ACL_HEADER_SIZE] = host_packets_sent & 0xffu;
+    CHECK_EQUAL(0, transport->send_packet(HCI_ACL_DATA_PACKET, host_acl_packet, sizeof(host_acl_packet)));
+    host_packets_sent++;
+}
+
+static void host_packet_handler(uint8_t packet_type, uint8_t * packet, uint16_t size){
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (packet[0] != HCI_EVENT_TRANSPORT_PACKET_SENT) return;
+    host_link_active = true;
+    host_send_next();
+}
+
+// simulation
+
+static void sim_step(void){
+    // find next event
+    uint32_t next_us = UINT32_MAX;
+    if (uart_tx_data != NULL){
+        next_us = uart_tx_done_us;
+    }
+    if (peer_frames_count > 0){
+        next_us = btstack_min(next_us, peer_frames[0].arrival_us);
+    }
+    int32_t timeout_ms = btstack_run_loop_base_get_time_until_timeout(sim_run_loop_get_time_ms());
+    if (timeout_ms >= 0){
+        next_us = btstack_min(next_us, (sim_run_loop_get_time_ms() + timeout_ms) * 1000u);
+    }
+    btstack_assert(next_us != UINT32_MAX);
+    sim_time_us = btstack_max(sim_time_us, next_us);
+
+    if ((uart_tx_data != NULL) && (uart_tx_done_us <= sim_time_us)){
+        const uint8_t * data = uart_tx_data;
+        uint16_t len = uart_tx_len;
+        uart_tx_data = NULL;
+        peer_receive(data, len);
+        uart_block_sent();
+    }
+    while ((peer_frames_count > 0) && (peer_frames[0].arrival_us <= sim_time_us)){
+        btstack_assert(uart_rx_fifo_len + peer_frames[0].len <= RX_FIFO_SIZE);
+        memcpy(&uart_rx_fifo[uart_rx_fifo_len], peer_frames[0].data, peer_frames[0].len);
+        uart_rx_fifo_len += peer_frames[0].len;
+        peer_frames_count--;
+        memmove(&peer_frames[0], &peer_frames[1], peer_frames_count * sizeof(peer_frame_t));
+    }
+    uart_deliver_rx();
+    btstack_run_loop_base_process_timers(sim_run_loop_get_time_ms());
+}
+
+static void sim_open(const btstack_uart_block_t * uart, uint8_t peer_window_size){
+    static hci_transport_config_uart_t config = {
+        HCI_TRANSPORT_CONFIG_UART, BAUDRATE, 0, 0, NULL
+    };
+    sim_time_us = 0;
+    btstack_run_loop_base_init();
+    peer_config_field = peer_window_size | 0x10;
+    peer_expected_seq_nr = 0;
+    peer_packets_received = 0;
+    peer_packets_dropped = 0;
+    peer_drop_seq_nr = -1;
+    peer_slip_active = false;
+    peer_frames_count = 0;
+    peer_line_free_us = 0;
+    uart_tx_data = NULL;
+    uart_tx_bytes = 0;
+    uart_rx_len = 0;
+    uart_rx_fifo_len = 0;
+    host_packets_sent = 0;
+    host_packets_to_send = 0;
+    host_link_active = false;
+
+    transport = hci_transport_h5_instance(uart);
+    transport->init(&config);
+    transport->register_packet_handler(&host_packet_handler);
+    CHECK_EQUAL(0, transport->open());
+    while (!host_link_active){
+        sim_step();
+    }
+}
+
+// achieved payload throughput in bytes per second
+static uint32_t sim_throughput;
+
+static void sim_send_packets(uint32_t num_packets){
+    uint32_t start_us = sim_time_us;
+    host_packets_to_send = num_packets;
+    host_send_next();
+    while ((peer_packets_received < num_packets) || !transport->can_send_packet_now(HCI_ACL_DATA_PACKET)){
+        sim_step();
+        CHECK(sim_time_us - start_us < 60000000u);
+    }
+    uint32_t duration_us = sim_time_us - start_us;
+    sim_throughput = (uint32_t) ((uint64_t) num_packets * ACL_PACKET_SIZE * 1000000u / duration_us);
+}
+
+static uint32_t sim_benchmark(uint8_t peer_window_size){
+    sim_open(&uart_bulk, peer_window_size);
+    sim_send_packets(200);
+    transport->close();
+    uint32_t throughput = sim_throughput;
+    uint32_t line_rate = BAUDRATE / 10;
+    printf("H5 window %u: %u bytes/s of %u bytes/s line rate (%u%%)\n", peer_window_size,
+           throughput, line_rate, throughput * 100u / line_rate);
+    return throughput;
+}
+
+TEST_GROUP(SLIP){
+};
+
+TEST(SLIP, EncodeDecodeSpans){
+    uint8_t data[300];
+    uint16_t i;
+    for (i = 0; i < sizeof(data); i++){
+        data[i] = (uint8_t) (i * 7u);
+    }
+    data[10] = BTSTACK_SLIP_SOF;
+    data[11] = 0xdb;
+
+    // reference encoding byte by byte
+    uint8_t expected[2 * sizeof(data)];
+    uint16_t expected_len = 0;
+    btstack_slip_encoder_start(data, sizeof(data));
+    while (btstack_slip_encoder_has_data()){
+        expected[expected_len++] = btstack_slip_encoder_get_byte();
+    }
+
+    // encode in chunks that split escape sequences
+    uint8_t encoded[2 * sizeof(data) + 2];
+    uint16_t encoded_len = 1;
+    encoded[0] = BTSTACK_SLIP_SOF;
+    btstack_slip_encoder_start(data, sizeof(data));
+    while (btstack_slip_encoder_has_data()){
+        encoded_len += btstack_slip_encoder_get_bytes(&encoded[encoded_len], 11);
+    }
+    CHECK_EQUAL(expected_len, encoded_len - 1);
+    MEMCMP_EQUAL(expected, &encoded[1], expected_len);
+    encoded[encoded_len++] = BTSTACK_SLIP_SOF;
+
+    // decode in chunks
+    uint8_t decoded[sizeof(data)];
+    btstack_slip_decoder_init(decoded, sizeof(decoded));
+    uint16_t pos = 0;
+    while (pos < encoded_len){
+        pos += btstack_slip_decoder_process_data(&encoded[pos], btstack_min(13, encoded_len - pos));
+    }
+    CHECK_EQUAL(sizeof(data), btstack_slip_decoder_frame_size());
+    MEMCMP_EQUAL(data, decoded, sizeof(data));
+}
+
+TEST_GROUP(H5){
+};
+
+TEST(H5, SlidingWindowThroughput){
+    uint32_t throughput_window_1 = sim_benchmark(1);
+    uint32_t throughput_window_4 = sim_benchmark(4);
+    // window hides ack round trip
+    CHECK(throughput_window_4 > throughput_window_1);
+    CHECK(throughput_window_4 * 100u > (BAUDRATE / 10) * 90u);
+}
+
+TEST(H5, ResendLostPacket){
+    sim_open(&uart_bytewise, 4);
+    peer_drop_seq_nr = 3;
+    sim_send_packets(20);
+    CHECK_EQUAL(1, peer_packets_dropped);
+    CHECK_EQUAL(20, peer_packets_received);
+    transport->close();
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(&sim_run_loop);
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
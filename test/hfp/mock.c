@@ -216,6 +216,20 @@ int hci_send_cmd(const hci_cmd_t *cmd, ...){
 	return 0;
 }
 
+static uint8_t hci_cmd_packet_buffer[HCI_CMD_HEADER_SIZE + 255];
+
+uint8_t * hci_reserve_cmd_packet_buffer(void){
+    return hci_cmd_packet_buffer;
+}
+
+int hci_send_cmd_packet_buffer(uint16_t size){
+    UNUSED(size);
+    if (little_endian_read_16(hci_cmd_packet_buffer, 0) == 0x428){
+        hci_event_sco_complete();
+    }
+    return 0;
+}
+
 int hci_can_send_command_packet_now(void){
     return 1;
 }
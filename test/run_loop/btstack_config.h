@@ -0,0 +1,6 @@
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+#define ENABLE_RUN_LOOP_TIMER_HEAP
+
+#endif
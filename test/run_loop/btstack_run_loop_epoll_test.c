@@ -0,0 +1,188 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <setjmp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_epoll.h"
+#include "btstack_util.h"
+
+// run loop does not return, timer or data source handler leave it via longjmp
+static jmp_buf run_loop_exit;
+static btstack_timer_source_t exit_timer;
+static btstack_timer_source_t timeout_timer;
+static bool timed_out;
+
+static void exit_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    longjmp(run_loop_exit, 1);
+}
+
+static void timeout_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    timed_out = true;
+    longjmp(run_loop_exit, 1);
+}
+
+static void run_loop_exit_after(uint32_t timeout_ms){
+    btstack_run_loop_set_timer_handler(&exit_timer, &exit_timer_handler);
+    btstack_run_loop_set_timer(&exit_timer, timeout_ms);
+    btstack_run_loop_add_timer(&exit_timer);
+}
+
+static void run_loop_execute(void){
+    btstack_run_loop_set_timer_handler(&timeout_timer, &timeout_timer_handler);
+    btstack_run_loop_set_timer(&timeout_timer, 1000);
+    btstack_run_loop_add_timer(&timeout_timer);
+    if (setjmp(run_loop_exit) == 0){
+        btstack_run_loop_execute();
+    }
+    btstack_run_loop_remove_timer(&timeout_timer);
+    btstack_run_loop_remove_timer(&exit_timer);
+}
+
+#define NUM_PIPES 3
+
+static int pipe_fds[NUM_PIPES][2];
+static btstack_data_source_t data_sources[NUM_PIPES];
+static int num_calls[NUM_PIPES];
+
+static int data_source_index(btstack_data_source_t * ds){
+    return (int) (ds - &data_sources[0]);
+}
+
+static void make_readable(int index){
+    uint8_t data = 0;
+    CHECK_EQUAL(1, write(pipe_fds[index][1], &data, 1));
+}
+
+static void add_read_data_source(int index, void (*process)(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type)){
+    btstack_run_loop_set_data_source_fd(&data_sources[index], pipe_fds[index][0]);
+    btstack_run_loop_set_data_source_handler(&data_sources[index], process);
+    btstack_run_loop_enable_data_source_callbacks(&data_sources[index], DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_add_data_source(&data_sources[index]);
+}
+
+static void read_handler(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    CHECK_EQUAL(DATA_SOURCE_CALLBACK_READ, callback_type);
+    int index = data_source_index(ds);
+    num_calls[index]++;
+    uint8_t data;
+    CHECK_EQUAL(1, read(ds->source.fd, &data, 1));
+    longjmp(run_loop_exit, 1);
+}
+
+// first of pipe 0 and 1 removes both and adds pipe 2, which removes itself
+static void add_remove_handler(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(callback_type);
+    num_calls[data_source_index(ds)]++;
+    if (ds == &data_sources[2]){
+        CHECK_TRUE(btstack_run_loop_remove_data_source(&data_sources[2]));
+        run_loop_exit_after(20);
+        return;
+    }
+    CHECK_TRUE(btstack_run_loop_remove_data_source(&data_sources[0]));
+    CHECK_TRUE(btstack_run_loop_remove_data_source(&data_sources[1]));
+    add_read_data_source(2, &add_remove_handler);
+    make_readable(2);
+}
+
+TEST_GROUP(RunLoopEpoll){
+    void setup(void){
+        btstack_run_loop_init(btstack_run_loop_epoll_get_instance());
+        memset(data_sources, 0, sizeof(data_sources));
+        memset(num_calls, 0, sizeof(num_calls));
+        memset(&exit_timer, 0, sizeof(exit_timer));
+        memset(&timeout_timer, 0, sizeof(timeout_timer));
+        timed_out = false;
+        int i;
+        for (i = 0; i < NUM_PIPES; i++){
+            CHECK_EQUAL(0, pipe(pipe_fds[i]));
+        }
+    }
+    void teardown(void){
+        int i;
+        for (i = 0; i < NUM_PIPES; i++){
+            btstack_run_loop_remove_data_source(&data_sources[i]);
+            close(pipe_fds[i][0]);
+            close(pipe_fds[i][1]);
+        }
+    }
+};
+
+TEST(RunLoopEpoll, Timer){
+    run_loop_exit_after(10);
+    uint32_t start_ms = btstack_run_loop_get_time_ms();
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_TRUE(btstack_run_loop_get_time_ms() - start_ms >= 10);
+}
+
+TEST(RunLoopEpoll, Read){
+    add_read_data_source(0, &read_handler);
+    make_readable(0);
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(1, num_calls[0]);
+}
+
+TEST(RunLoopEpoll, DisabledCallback){
+    add_read_data_source(0, &read_handler);
+    btstack_run_loop_disable_data_source_callbacks(&data_sources[0], DATA_SOURCE_CALLBACK_READ);
+    make_readable(0);
+    run_loop_exit_after(20);
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(0, num_calls[0]);
+}
+
+TEST(RunLoopEpoll, AddRemoveFromCallback){
+    add_read_data_source(0, &add_remove_handler);
+    add_read_data_source(1, &add_remove_handler);
+    make_readable(0);
+    make_readable(1);
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    // events of both pipes are reported by the same epoll_wait, only one of them is processed
+    CHECK_EQUAL(1, num_calls[0] + num_calls[1]);
+    CHECK_EQUAL(1, num_calls[2]);
+}
+
+// write-only data source needs to get hang-up
+static int socket_fds[2];
+static int num_write_calls;
+
+static void write_hangup_handler(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    CHECK_EQUAL(DATA_SOURCE_CALLBACK_WRITE, callback_type);
+    num_write_calls++;
+    uint8_t data = 0;
+    if (send(ds->source.fd, &data, 1, MSG_NOSIGNAL) < 0){
+        btstack_run_loop_remove_data_source(ds);
+        run_loop_exit_after(20);
+    }
+}
+
+TEST(RunLoopEpoll, WriteHangup){
+    CHECK_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, socket_fds));
+    // fill socket buffer and shut socket down: hang-up without writable event
+    uint8_t data[256];
+    memset(data, 0, sizeof(data));
+    while (send(socket_fds[0], data, sizeof(data), MSG_NOSIGNAL) > 0);
+    shutdown(socket_fds[0], SHUT_RDWR);
+    num_write_calls = 0;
+    btstack_run_loop_set_data_source_fd(&data_sources[0], socket_fds[0]);
+    btstack_run_loop_set_data_source_handler(&data_sources[0], &write_hangup_handler);
+    btstack_run_loop_enable_data_source_callbacks(&data_sources[0], DATA_SOURCE_CALLBACK_WRITE);
+    btstack_run_loop_add_data_source(&data_sources[0]);
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(1, num_write_calls);
+    close(socket_fds[0]);
+    close(socket_fds[1]);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
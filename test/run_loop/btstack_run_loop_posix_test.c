@@ -0,0 +1,136 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "btstack_util.h"
+
+// run loop does not return, timer or function call leave it via longjmp
+static jmp_buf run_loop_exit;
+static btstack_timer_source_t timeout_timer;
+static bool timed_out;
+
+static void timeout_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    timed_out = true;
+    longjmp(run_loop_exit, 1);
+}
+
+static void run_loop_execute(void){
+    btstack_run_loop_set_timer_handler(&timeout_timer, &timeout_timer_handler);
+    btstack_run_loop_set_timer(&timeout_timer, 5000);
+    btstack_run_loop_add_timer(&timeout_timer);
+    if (setjmp(run_loop_exit) == 0){
+        btstack_run_loop_execute();
+    }
+    btstack_run_loop_remove_timer(&timeout_timer);
+}
+
+#define NUM_PRODUCERS 4
+#define NUM_CALLS_PER_PRODUCER 5000
+
+static pthread_t producers[NUM_PRODUCERS];
+static uint32_t producer_ids[NUM_PRODUCERS];
+static uint32_t next_call[NUM_PRODUCERS];
+static uint32_t num_calls;
+static uint32_t num_calls_expected;
+static bool calls_in_order;
+
+// arg encodes producer in upper and call number in lower 16 bits
+static void function_call(void * arg){
+    uint32_t value = (uint32_t) (uintptr_t) arg;
+    uint32_t producer = value >> 16;
+    uint32_t call = value & 0xffffu;
+    // calls from one producer are executed in order
+    if (next_call[producer] != call){
+        calls_in_order = false;
+    }
+    next_call[producer] = call + 1;
+    num_calls++;
+    if (num_calls == num_calls_expected){
+        longjmp(run_loop_exit, 1);
+    }
+}
+
+static void * producer_thread(void * context){
+    uint32_t producer = *(uint32_t *) context;
+    uint32_t call;
+    for (call = 0; call < NUM_CALLS_PER_PRODUCER; call++){
+        void * arg = (void *) (uintptr_t) ((producer << 16) | call);
+        // queue full, wait for run loop
+        while (!btstack_run_loop_posix_execute_code_on_main_thread(&function_call, arg)){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void direct_call(void * arg){
+    (*(int *) arg)++;
+}
+
+static int num_direct_calls;
+
+static void direct_call_timer_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    // called on run loop thread, executed right away
+    CHECK_TRUE(btstack_run_loop_posix_execute_code_on_main_thread(&direct_call, &num_direct_calls));
+    CHECK_EQUAL(1, num_direct_calls);
+    longjmp(run_loop_exit, 1);
+}
+
+TEST_GROUP(RunLoopPosix){
+    void setup(void){
+        btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+        memset(&timeout_timer, 0, sizeof(timeout_timer));
+        memset(next_call, 0, sizeof(next_call));
+        timed_out = false;
+        num_calls = 0;
+        num_calls_expected = 0;
+        calls_in_order = true;
+    }
+};
+
+TEST(RunLoopPosix, CallPostedBeforeExecute){
+    num_calls_expected = 1;
+    CHECK_TRUE(btstack_run_loop_posix_execute_code_on_main_thread(&function_call, NULL));
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(1, num_calls);
+}
+
+TEST(RunLoopPosix, CallOnRunLoopThread){
+    btstack_timer_source_t timer;
+    memset(&timer, 0, sizeof(timer));
+    num_direct_calls = 0;
+    btstack_run_loop_set_timer_handler(&timer, &direct_call_timer_handler);
+    btstack_run_loop_set_timer(&timer, 0);
+    btstack_run_loop_add_timer(&timer);
+    run_loop_execute();
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(1, num_direct_calls);
+}
+
+TEST(RunLoopPosix, MultipleProducers){
+    num_calls_expected = NUM_PRODUCERS * NUM_CALLS_PER_PRODUCER;
+    int i;
+    for (i = 0; i < NUM_PRODUCERS; i++){
+        producer_ids[i] = i;
+        CHECK_EQUAL(0, pthread_create(&producers[i], NULL, &producer_thread, &producer_ids[i]));
+    }
+    run_loop_execute();
+    for (i = 0; i < NUM_PRODUCERS; i++){
+        pthread_join(producers[i], NULL);
+    }
+    CHECK_FALSE(timed_out);
+    CHECK_EQUAL(num_calls_expected, num_calls);
+    CHECK_TRUE(calls_in_order);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,171 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdlib.h>
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_util.h"
+
+#define NUM_TIMERS 200
+
+static btstack_timer_source_t timers[NUM_TIMERS];
+static int timer_ids[NUM_TIMERS];
+static int fired[NUM_TIMERS];
+static int num_fired;
+
+static void timer_handler(btstack_timer_source_t * ts){
+    fired[num_fired++] = *(int *) ts->context;
+}
+
+// returns index of next timer to fire in reference model, -1 if none
+static int reference_next(const bool * active, uint32_t now){
+    int i;
+    int next = -1;
+    for (i = 0; i < NUM_TIMERS; i++){
+        if (!active[i]) continue;
+        if (btstack_time_delta(timers[i].timeout, now) > 0) continue;
+        if (next < 0){
+            next = i;
+            continue;
+        }
+        if (btstack_time_delta(timers[i].timeout, timers[next].timeout) < 0){
+            next = i;
+        }
+    }
+    return next;
+}
+
+TEST_GROUP(RunLoopBaseTimer){
+    void setup(void){
+        btstack_run_loop_base_init();
+        memset(timers, 0, sizeof(timers));
+        int i;
+        for (i = 0; i < NUM_TIMERS; i++){
+            timer_ids[i] = i;
+            timers[i].process = &timer_handler;
+            timers[i].context = &timer_ids[i];
+        }
+        num_fired = 0;
+    }
+};
+
+TEST(RunLoopBaseTimer, Empty){
+    CHECK_EQUAL(-1, btstack_run_loop_base_get_time_until_timeout(0));
+    CHECK_FALSE(btstack_run_loop_base_remove_timer(&timers[0]));
+    btstack_run_loop_base_process_timers(1000);
+    CHECK_EQUAL(0, num_fired);
+}
+
+TEST(RunLoopBaseTimer, AddRemove){
+    timers[0].timeout = 100;
+    btstack_run_loop_base_add_timer(&timers[0]);
+    // add twice keeps single entry
+    btstack_run_loop_base_add_timer(&timers[0]);
+    CHECK_EQUAL(50, btstack_run_loop_base_get_time_until_timeout(50));
+    CHECK_EQUAL(0, btstack_run_loop_base_get_time_until_timeout(150));
+    CHECK_TRUE(btstack_run_loop_base_remove_timer(&timers[0]));
+    CHECK_FALSE(btstack_run_loop_base_remove_timer(&timers[0]));
+    CHECK_EQUAL(-1, btstack_run_loop_base_get_time_until_timeout(0));
+}
+
+TEST(RunLoopBaseTimer, NeverAddedTimer){
+    // zero-initialized timer, e.g. static or from btstack_memory
+    btstack_timer_source_t timer;
+    memset(&timer, 0, sizeof(timer));
+    btstack_run_loop_set_timer_handler(&timer, &timer_handler);
+    timer.context = &timer_ids[0];
+    timer.timeout = 10;
+    timers[1].timeout = 20;
+    btstack_run_loop_base_add_timer(&timers[1]);
+    CHECK_FALSE(btstack_run_loop_base_remove_timer(&timer));
+    btstack_run_loop_base_add_timer(&timer);
+    btstack_run_loop_base_process_timers(20);
+    CHECK_EQUAL(2, num_fired);
+    CHECK_EQUAL(0, fired[0]);
+    CHECK_EQUAL(1, fired[1]);
+}
+
+TEST(RunLoopBaseTimer, ReAddQueuedTimer){
+    int i;
+    for (i = 0; i < 3; i++){
+        timers[i].timeout = 10 * (i + 1);
+        btstack_run_loop_base_add_timer(&timers[i]);
+    }
+    // re-arm queued timer without removing it first, as done e.g. for periodic timers
+    btstack_run_loop_set_timer_handler(&timers[1], &timer_handler);
+    timers[1].timeout = 40;
+    btstack_run_loop_base_add_timer(&timers[1]);
+    btstack_run_loop_base_process_timers(100);
+    CHECK_EQUAL(3, num_fired);
+    CHECK_EQUAL(0, fired[0]);
+    CHECK_EQUAL(2, fired[1]);
+    CHECK_EQUAL(1, fired[2]);
+    CHECK_EQUAL(-1, btstack_run_loop_base_get_time_until_timeout(100));
+}
+
+TEST(RunLoopBaseTimer, SameTimeoutInsertionOrder){
+    int i;
+    for (i = 0; i < 10; i++){
+        timers[i].timeout = 10;
+        btstack_run_loop_base_add_timer(&timers[i]);
+    }
+    btstack_run_loop_base_process_timers(10);
+    CHECK_EQUAL(10, num_fired);
+    for (i = 0; i < 10; i++){
+        CHECK_EQUAL(i, fired[i]);
+    }
+}
+
+TEST(RunLoopBaseTimer, Wraparound){
+    timers[0].timeout = 0xfffffff0u;
+    timers[1].timeout = 0x00000010u;
+    btstack_run_loop_base_add_timer(&timers[1]);
+    btstack_run_loop_base_add_timer(&timers[0]);
+    CHECK_EQUAL(0x10, btstack_run_loop_base_get_time_until_timeout(0xffffffe0u));
+    btstack_run_loop_base_process_timers(0x00000020u);
+    CHECK_EQUAL(2, num_fired);
+    CHECK_EQUAL(0, fired[0]);
+    CHECK_EQUAL(1, fired[1]);
+}
+
+TEST(RunLoopBaseTimer, RandomAddRemove){
+    bool active[NUM_TIMERS];
+    memset(active, 0, sizeof(active));
+    srand(1234);
+    int round;
+    uint32_t now = 0;
+    for (round = 0; round < 2000; round++){
+        int i = rand() % NUM_TIMERS;
+        if (active[i]){
+            CHECK_TRUE(btstack_run_loop_base_remove_timer(&timers[i]));
+            active[i] = false;
+        } else {
+            timers[i].timeout = now + (rand() % 1000);
+            btstack_run_loop_base_add_timer(&timers[i]);
+            active[i] = true;
+        }
+        if ((round % 10) != 0) continue;
+        // fire expired timers and compare with reference
+        now += 50;
+        int expected[NUM_TIMERS];
+        int num_expected = 0;
+        while (true){
+            int next = reference_next(active, now);
+            if (next < 0) break;
+            active[next] = false;
+            expected[num_expected++] = next;
+        }
+        num_fired = 0;
+        btstack_run_loop_base_process_timers(now);
+        CHECK_EQUAL(num_expected, num_fired);
+        int j;
+        for (j = 0; j < num_fired; j++){
+            CHECK_EQUAL(timers[expected[j]].timeout, timers[fired[j]].timeout);
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
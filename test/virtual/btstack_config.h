@@ -0,0 +1,39 @@
+//
+// btstack_config.h for virtual HCI Transport test
+//
+
+#ifndef BTSTACK_CONFIG_H
+#define BTSTACK_CONFIG_H
+
+// Port related features
+#define HAVE_ASSERT
+#define HAVE_MALLOC
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_CLASSIC
+#define ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+#define ENABLE_L2CAP_CHANNEL_SCHEDULER
+#define ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+#define ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#define ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+#define ENABLE_L2CAP_ERTM_FCS_SLICE_BY_8
+#define ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+#define ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+#define ENABLE_LE_CENTRAL
+#define ENABLE_LE_DATA_CHANNELS
+#define ENABLE_LE_PERIPHERAL
+#define ENABLE_LOG_ERROR
+#define ENABLE_LOG_INFO
+#define ENABLE_PRINTF_HEXDUMP
+#define ENABLE_RFCOMM_CHANNEL_LOOKUP_TABLES
+#define ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 300
+#define HCI_INCOMING_PRE_BUFFER_SIZE 6
+#define L2CAP_LOCAL_CID_TABLE_SIZE 16
+#define NVM_NUM_DEVICE_DB_ENTRIES 4
+#define NVM_NUM_LINK_KEYS 2
+
+#endif
@@ -0,0 +1,301 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_transport.h"
+
+// BTstack with virtual Controller, the peer Controller is simulated on the air interface
+
+#define LINK_RATE        1000000
+#define LINK_LATENCY_MS  20
+#define ACL_PAYLOAD_LEN  251
+#define MAX_AIR_PDUS     200
+#define PEER_HANDLE      0x0040
+
+static const bd_addr_t local_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static const bd_addr_t peer_addr  = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 };
+
+static uint32_t sim_time_ms;
+
+// run loop with virtual time
+
+static void sim_run_loop_init(void){
+    btstack_run_loop_base_init();
+}
+
+static uint32_t sim_run_loop_get_time_ms(void){
+    return sim_time_ms;
+}
+
+static void sim_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = sim_time_ms + timeout_in_ms;
+}
+
+static const btstack_run_loop_t sim_run_loop = {
+    &sim_run_loop_init,
+    &btstack_run_loop_base_add_data_source,
+    &btstack_run_loop_base_remove_data_source,
+    &btstack_run_loop_base_enable_data_source_callbacks,
+    &btstack_run_loop_base_disable_data_source_callbacks,
+    &sim_run_loop_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    NULL,
+    &btstack_run_loop_base_dump_timer,
+    &sim_run_loop_get_time_ms,
+};
+
+// air interface
+
+typedef struct {
+    uint32_t time_ms;
+    uint16_t size;
+    uint8_t  data[1 + HCI_ACL_HEADER_SIZE + ACL_PAYLOAD_LEN];
+} air_pdu_t;
+
+static air_pdu_t air_pdus[MAX_AIR_PDUS];
+static int       air_pdus_count;
+
+static void air_send_pdu(const uint8_t * pdu, uint16_t size){
+    btstack_assert(air_pdus_count < MAX_AIR_PDUS);
+    btstack_assert(size <= sizeof(air_pdus[0].data));
+    air_pdu_t * air_pdu = &air_pdus[air_pdus_count++];
+    air_pdu->time_ms = sim_time_ms;
+    air_pdu->size = size;
+    memcpy(air_pdu->data, pdu, size);
+}
+
+static const air_pdu_t * air_find_pdu(uint8_t type){
+    int i;
+    for (i=0;i<air_pdus_count;i++){
+        if (air_pdus[i].data[0] == type) return &air_pdus[i];
+    }
+    return NULL;
+}
+
+// host
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static hci_con_handle_t con_handle;
+static uint8_t  connection_complete_status;
+static uint8_t  disconnection_reason;
+static uint16_t acl_bytes_received;
+static uint16_t acl_packets_received;
+static uint16_t acl_packets_to_send;
+static uint16_t acl_packets_sent;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case HCI_EVENT_LE_META:
+            if (hci_event_le_meta_get_subevent_code(packet) != HCI_SUBEVENT_LE_CONNECTION_COMPLETE) break;
+            connection_complete_status = hci_subevent_le_connection_complete_get_status(packet);
+            con_handle = hci_subevent_le_connection_complete_get_connection_handle(packet);
+            break;
+        case HCI_EVENT_CONNECTION_COMPLETE:
+            connection_complete_status = hci_event_connection_complete_get_status(packet);
+            con_handle = hci_event_connection_complete_get_connection_handle(packet);
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            disconnection_reason = hci_event_disconnection_complete_get_reason(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    CHECK_EQUAL(con_handle, little_endian_read_16(packet, 0) & 0x0fff);
+    acl_packets_received++;
+    acl_bytes_received += size - HCI_ACL_HEADER_SIZE;
+}
+
+static void host_send_acl_packets(void){
+    while (acl_packets_sent < acl_packets_to_send){
+        if (!hci_can_send_acl_packet_now(con_handle)) return;
+        hci_reserve_packet_buffer();
+        uint8_t * buffer = hci_get_outgoing_packet_buffer();
+        little_endian_store_16(buffer, 0, con_handle | 0x2000);
+        little_endian_store_16(buffer, 2, ACL_PAYLOAD_LEN);
+        memset(&buffer[4], acl_packets_sent, ACL_PAYLOAD_LEN);
+        hci_send_acl_packet_buffer(HCI_ACL_HEADER_SIZE + ACL_PAYLOAD_LEN);
+        acl_packets_sent++;
+    }
+}
+
+// simulation
+
+static void sim_run(uint32_t duration_ms){
+    uint32_t end_ms = sim_time_ms + duration_ms;
+    while (true){
+        btstack_run_loop_base_process_timers(sim_time_ms);
+        host_send_acl_packets();
+        int32_t timeout_ms = btstack_run_loop_base_get_time_until_timeout(sim_time_ms);
+        if (timeout_ms < 0) break;
+        if ((sim_time_ms + timeout_ms) > end_ms) break;
+        sim_time_ms += timeout_ms;
+    }
+    sim_time_ms = end_ms;
+}
+
+static void sim_power_on(void){
+    sim_time_ms = 0;
+    air_pdus_count = 0;
+    con_handle = HCI_CON_HANDLE_INVALID;
+    connection_complete_status = 0xff;
+    disconnection_reason = 0;
+    acl_bytes_received = 0;
+    acl_packets_received = 0;
+    acl_packets_to_send = 0;
+    acl_packets_sent = 0;
+
+    btstack_run_loop_init(&sim_run_loop);
+    btstack_memory_init();
+    hci_transport_virtual_set_bd_addr(local_addr);
+    hci_transport_virtual_set_link_rate(LINK_RATE);
+    hci_transport_virtual_set_link_latency(LINK_LATENCY_MS);
+    hci_transport_virtual_set_air_interface(&air_send_pdu);
+    hci_init(hci_transport_virtual_instance(), NULL);
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+    hci_register_acl_packet_handler(&acl_handler);
+    hci_power_control(HCI_POWER_ON);
+    sim_run(100);
+}
+
+static void sim_le_connect(void){
+    gap_connect(peer_addr, BD_ADDR_TYPE_LE_PUBLIC);
+    sim_run(10);
+    const air_pdu_t * connect_req = air_find_pdu(3);
+    CHECK(connect_req != NULL);
+    CHECK_EQUAL(16, connect_req->size);
+    MEMCMP_EQUAL(local_addr, &connect_req->data[4], 6);
+    MEMCMP_EQUAL(peer_addr, &connect_req->data[10], 6);
+
+    uint8_t connect_rsp[12];
+    connect_rsp[0] = 5;
+    little_endian_store_16(connect_rsp, 1, little_endian_read_16(connect_req->data, 1));
+    little_endian_store_16(connect_rsp, 3, PEER_HANDLE);
+    connect_rsp[5] = BD_ADDR_TYPE_LE_PUBLIC;
+    memcpy(&connect_rsp[6], peer_addr, 6);
+    hci_transport_virtual_receive_pdu(connect_rsp, sizeof(connect_rsp));
+    sim_run(10);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connection_complete_status);
+}
+
+static void sim_close(void){
+    hci_power_control(HCI_POWER_OFF);
+    sim_run(100);
+    hci_deinit();
+    btstack_run_loop_deinit();
+}
+
+TEST_GROUP(Virtual){
+    void setup(void){
+        sim_power_on();
+    }
+    void teardown(void){
+        sim_close();
+    }
+};
+
+TEST(Virtual, PowerOn){
+    CHECK_EQUAL(HCI_STATE_WORKING, hci_get_state());
+    bd_addr_t addr;
+    gap_local_bd_addr(addr);
+    MEMCMP_EQUAL(local_addr, addr, 6);
+}
+
+TEST(Virtual, LinkRateAndLatency){
+    sim_le_connect();
+
+    uint32_t start_ms = sim_time_ms;
+    air_pdus_count = 0;
+    acl_packets_to_send = 100;
+    sim_run(1000);
+    CHECK_EQUAL(100, acl_packets_sent);
+    CHECK_EQUAL(100, air_pdus_count);
+
+    // peer handle used on air
+    CHECK_EQUAL(8, air_pdus[0].data[0]);
+    CHECK_EQUAL(PEER_HANDLE, little_endian_read_16(air_pdus[0].data, 1) & 0x0fff);
+    CHECK_EQUAL(ACL_PAYLOAD_LEN, little_endian_read_16(air_pdus[0].data, 3));
+
+    // first packet arrives after transmission and latency, then one every 2.04 ms
+    uint32_t packet_time_us = (HCI_ACL_HEADER_SIZE + ACL_PAYLOAD_LEN) * 8 * 1000000u / LINK_RATE;
+    uint32_t first_ms = air_pdus[0].time_ms - start_ms;
+    uint32_t last_ms  = air_pdus[99].time_ms - start_ms;
+    CHECK(first_ms >= LINK_LATENCY_MS);
+    CHECK(first_ms <= (LINK_LATENCY_MS + 3));
+    uint32_t expected_last_ms = LINK_LATENCY_MS + (100 * packet_time_us / 1000u);
+    CHECK(last_ms >= (expected_last_ms - 1));
+    CHECK(last_ms <= (expected_last_ms + 1));
+}
+
+TEST(Virtual, ReceiveAndDisconnect){
+    sim_le_connect();
+
+    // L2CAP PDU from peer uses local handle
+    uint8_t acl_pdu[5 + 100];
+    acl_pdu[0] = 8;
+    little_endian_store_16(acl_pdu, 1, PEER_HANDLE | 0x2000);
+    little_endian_store_16(acl_pdu, 3, 100);
+    little_endian_store_16(acl_pdu, 5, 96);
+    little_endian_store_16(acl_pdu, 7, 0x0040);
+    memset(&acl_pdu[9], 0x55, 96);
+    hci_transport_virtual_receive_pdu(acl_pdu, sizeof(acl_pdu));
+    sim_run(10);
+    CHECK_EQUAL(0, acl_packets_received);
+    little_endian_store_16(acl_pdu, 1, con_handle | 0x2000);
+    hci_transport_virtual_receive_pdu(acl_pdu, sizeof(acl_pdu));
+    sim_run(10);
+    CHECK_EQUAL(1, acl_packets_received);
+    CHECK_EQUAL(100, acl_bytes_received);
+
+    uint8_t disconnect[4];
+    disconnect[0] = 9;
+    little_endian_store_16(disconnect, 1, con_handle);
+    disconnect[3] = ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION;
+    hci_transport_virtual_receive_pdu(disconnect, sizeof(disconnect));
+    sim_run(10);
+    CHECK_EQUAL(ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION, disconnection_reason);
+}
+
+TEST(Virtual, AcceptClassicConnection){
+    gap_connectable_control(1);
+    sim_run(10);
+    air_pdus_count = 0;
+
+    uint8_t connect_req[18];
+    connect_req[0] = 6;
+    little_endian_store_16(connect_req, 1, PEER_HANDLE);
+    memcpy(&connect_req[3], peer_addr, 6);
+    little_endian_store_24(connect_req, 9, 0x200404);
+    memcpy(&connect_req[12], local_addr, 6);
+    hci_transport_virtual_receive_pdu(connect_req, sizeof(connect_req));
+    sim_run(10);
+
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connection_complete_status);
+    const air_pdu_t * connect_rsp = air_find_pdu(7);
+    CHECK(connect_rsp != NULL);
+    CHECK_EQUAL(PEER_HANDLE, little_endian_read_16(connect_rsp->data, 1));
+    CHECK_EQUAL(con_handle, little_endian_read_16(connect_rsp->data, 3));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connect_rsp->data[5]);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,1189 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+
+// L2CAP LE Data Channels over virtual Controller, the peer L2CAP layer is simulated on the air interface
+
+#define LINK_RATE        1000000
+#define LINK_LATENCY_MS  5
+#define ACL_PAYLOAD_LEN  251
+#define MAX_AIR_PDUS     200
+#define PEER_HANDLE      0x0040
+#define PEER_CID_BASE    0x0080
+#define TEST_PSM         0x0080
+#define TEST_MTU         64
+#define PEER_MTU         400
+#define PEER_MPS         23
+#define PEER_CREDITS     50
+#define NUM_CHANNELS     8
+#define PEER_MAX_PAYLOAD 256
+
+static const bd_addr_t local_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static const bd_addr_t peer_addr  = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 };
+
+static uint32_t sim_time_ms;
+
+// run loop with virtual time
+
+static void sim_run_loop_init(void){
+    btstack_run_loop_base_init();
+}
+
+static uint32_t sim_run_loop_get_time_ms(void){
+    return sim_time_ms;
+}
+
+static void sim_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = sim_time_ms + timeout_in_ms;
+}
+
+static const btstack_run_loop_t sim_run_loop = {
+    &sim_run_loop_init,
+    &btstack_run_loop_base_add_data_source,
+    &btstack_run_loop_base_remove_data_source,
+    &btstack_run_loop_base_enable_data_source_callbacks,
+    &btstack_run_loop_base_disable_data_source_callbacks,
+    &sim_run_loop_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    NULL,
+    &btstack_run_loop_base_dump_timer,
+    &sim_run_loop_get_time_ms,
+};
+
+// SM is not used with security level 0
+extern "C" void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+extern "C" void sm_request_pairing(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+}
+
+// air interface
+
+typedef struct {
+    uint16_t size;
+    uint8_t  data[1 + HCI_ACL_HEADER_SIZE + ACL_PAYLOAD_LEN];
+} air_pdu_t;
+
+static air_pdu_t air_pdus[MAX_AIR_PDUS];
+static int       air_pdus_count;
+
+static void air_send_pdu(const uint8_t * pdu, uint16_t size){
+    btstack_assert(air_pdus_count < MAX_AIR_PDUS);
+    btstack_assert(size <= sizeof(air_pdus[0].data));
+    air_pdu_t * air_pdu = &air_pdus[air_pdus_count++];
+    air_pdu->size = size;
+    memcpy(air_pdu->data, pdu, size);
+}
+
+// host
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static hci_con_handle_t con_handle;
+static uint8_t  connection_complete_status;
+static uint16_t local_cids[NUM_CHANNELS];
+static uint8_t  receive_buffers[NUM_CHANNELS][TEST_MTU];
+static uint16_t channels_opened;
+static uint16_t channels_failed;
+static uint16_t channels_closed;
+static uint16_t sdus_received;
+static uint16_t last_sdu_cid;
+static uint8_t  last_sdu[TEST_MTU];
+static uint16_t packets_sent;
+static uint16_t incoming_connections;
+static uint16_t incoming_connections_to_accept;
+
+static void hci_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) == HCI_EVENT_CONNECTION_COMPLETE){
+        connection_complete_status = hci_event_connection_complete_get_status(packet);
+        con_handle = hci_event_connection_complete_get_connection_handle(packet);
+        return;
+    }
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_LE_META) return;
+    if (hci_event_le_meta_get_subevent_code(packet) != HCI_SUBEVENT_LE_CONNECTION_COMPLETE) return;
+    connection_complete_status = hci_subevent_le_connection_complete_get_status(packet);
+    con_handle = hci_subevent_le_connection_complete_get_connection_handle(packet);
+}
+
+static void l2cap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    switch (packet_type){
+        case L2CAP_DATA_PACKET:
+            sdus_received++;
+            last_sdu_cid = channel;
+            memcpy(last_sdu, packet, btstack_min(size, sizeof(last_sdu)));
+            break;
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case L2CAP_EVENT_LE_CHANNEL_OPENED:
+                    if (l2cap_event_le_channel_opened_get_status(packet) == ERROR_CODE_SUCCESS){
+                        channels_opened++;
+                    } else {
+                        channels_failed++;
+                    }
+                    break;
+                case L2CAP_EVENT_LE_CHANNEL_CLOSED:
+                    channels_closed++;
+                    break;
+                case L2CAP_EVENT_LE_PACKET_SENT:
+                    packets_sent++;
+                    break;
+                case L2CAP_EVENT_LE_INCOMING_CONNECTION:
+                    // accept first incoming_connections_to_accept connections, local cids are stored in local_cids
+                    local_cids[incoming_connections] = l2cap_event_le_incoming_connection_get_local_cid(packet);
+                    if (incoming_connections < incoming_connections_to_accept){
+                        l2cap_le_accept_connection(local_cids[incoming_connections], receive_buffers[incoming_connections], TEST_MTU, 5);
+                    } else {
+                        l2cap_le_decline_connection(local_cids[incoming_connections]);
+                    }
+                    incoming_connections++;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// peer
+
+static void peer_send_l2cap_pdu(uint16_t cid, const uint8_t * payload, uint16_t len){
+    uint8_t acl_pdu[1 + HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE + PEER_MAX_PAYLOAD];
+    btstack_assert(len <= PEER_MAX_PAYLOAD);
+    acl_pdu[0] = 8;
+    little_endian_store_16(acl_pdu, 1, con_handle | 0x2000);
+    little_endian_store_16(acl_pdu, 3, L2CAP_HEADER_SIZE + len);
+    little_endian_store_16(acl_pdu, 5, len);
+    little_endian_store_16(acl_pdu, 7, cid);
+    memcpy(&acl_pdu[9], payload, len);
+    hci_transport_virtual_receive_pdu(acl_pdu, 9 + len);
+}
+
+// accept all LE Credit Based Connection Requests found on air, peer cid = PEER_CID_BASE + local cid
+static int peer_accept_le_connections(void){
+    int num_accepted = 0;
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != L2CAP_CID_SIGNALING_LE) continue;
+        if (pdu[9] != LE_CREDIT_BASED_CONNECTION_REQUEST) continue;
+        uint8_t  sig_id    = pdu[10];
+        uint16_t local_cid = little_endian_read_16(pdu, 15);
+        uint8_t response[14];
+        response[0] = LE_CREDIT_BASED_CONNECTION_RESPONSE;
+        response[1] = sig_id;
+        little_endian_store_16(response, 2, 10);
+        little_endian_store_16(response, 4, PEER_CID_BASE + local_cid);
+        little_endian_store_16(response, 6, PEER_MTU);
+        little_endian_store_16(response, 8, PEER_MPS);
+        little_endian_store_16(response, 10, PEER_CREDITS);
+        little_endian_store_16(response, 12, 0);
+        peer_send_l2cap_pdu(L2CAP_CID_SIGNALING_LE, response, sizeof(response));
+        num_accepted++;
+    }
+    air_pdus_count = 0;
+    return num_accepted;
+}
+
+static void peer_send_sdu(uint16_t local_cid, uint8_t value){
+    uint8_t k_frame[2 + 10];
+    little_endian_store_16(k_frame, 0, 10);
+    memset(&k_frame[2], value, 10);
+    peer_send_l2cap_pdu(local_cid, k_frame, sizeof(k_frame));
+}
+
+static void peer_disconnect(void){
+    uint8_t disconnect[4];
+    disconnect[0] = 9;
+    little_endian_store_16(disconnect, 1, con_handle);
+    disconnect[3] = ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION;
+    hci_transport_virtual_receive_pdu(disconnect, sizeof(disconnect));
+}
+
+// simulation
+
+static void sim_run(uint32_t duration_ms){
+    uint32_t end_ms = sim_time_ms + duration_ms;
+    while (true){
+        btstack_run_loop_base_process_timers(sim_time_ms);
+        int32_t timeout_ms = btstack_run_loop_base_get_time_until_timeout(sim_time_ms);
+        if (timeout_ms < 0) break;
+        if ((sim_time_ms + timeout_ms) > end_ms) break;
+        sim_time_ms += timeout_ms;
+    }
+    sim_time_ms = end_ms;
+}
+
+static void sim_power_on(void){
+    sim_time_ms = 0;
+    air_pdus_count = 0;
+    con_handle = HCI_CON_HANDLE_INVALID;
+    connection_complete_status = 0xff;
+    channels_opened = 0;
+    channels_failed = 0;
+    channels_closed = 0;
+    sdus_received = 0;
+    last_sdu_cid = 0;
+    packets_sent = 0;
+    incoming_connections = 0;
+    incoming_connections_to_accept = 0;
+
+    btstack_run_loop_init(&sim_run_loop);
+    btstack_memory_init();
+    hci_transport_virtual_set_bd_addr(local_addr);
+    hci_transport_virtual_set_link_rate(LINK_RATE);
+    hci_transport_virtual_set_link_latency(LINK_LATENCY_MS);
+    hci_transport_virtual_set_air_interface(&air_send_pdu);
+    hci_init(hci_transport_virtual_instance(), NULL);
+    l2cap_init();
+    hci_event_callback_registration.callback = &hci_packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+    hci_power_control(HCI_POWER_ON);
+    sim_run(100);
+}
+
+static void sim_le_connect(void){
+    gap_connect(peer_addr, BD_ADDR_TYPE_LE_PUBLIC);
+    sim_run(10);
+    const air_pdu_t * connect_req = NULL;
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        if (air_pdus[i].data[0] == 3) connect_req = &air_pdus[i];
+    }
+    CHECK(connect_req != NULL);
+    uint8_t connect_rsp[12];
+    connect_rsp[0] = 5;
+    little_endian_store_16(connect_rsp, 1, little_endian_read_16(connect_req->data, 1));
+    little_endian_store_16(connect_rsp, 3, PEER_HANDLE);
+    connect_rsp[5] = BD_ADDR_TYPE_LE_PUBLIC;
+    memcpy(&connect_rsp[6], peer_addr, 6);
+    hci_transport_virtual_receive_pdu(connect_rsp, sizeof(connect_rsp));
+    sim_run(10);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connection_complete_status);
+    air_pdus_count = 0;
+}
+
+static uint8_t sim_create_channel(int index){
+    return l2cap_le_create_channel(&l2cap_packet_handler, con_handle, TEST_PSM, receive_buffers[index], TEST_MTU, 5, LEVEL_0, &local_cids[index]);
+}
+
+static void sim_open_channels(int num_channels){
+    int i;
+    for (i = 0; i < num_channels; i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, sim_create_channel(i));
+    }
+    sim_run(20);
+    CHECK_EQUAL(num_channels, peer_accept_le_connections());
+    sim_run(20);
+    CHECK_EQUAL(num_channels, channels_opened);
+}
+
+static void sim_close(void){
+    hci_power_control(HCI_POWER_OFF);
+    sim_run(100);
+    l2cap_deinit();
+    hci_deinit();
+    btstack_run_loop_deinit();
+}
+
+TEST_GROUP(L2CAP_Virtual){
+    void setup(void){
+        sim_power_on();
+        sim_le_connect();
+    }
+    void teardown(void){
+        sim_close();
+    }
+};
+
+TEST(L2CAP_Virtual, DeliverSduByLocalCid){
+    sim_open_channels(NUM_CHANNELS);
+
+    int i;
+    for (i = NUM_CHANNELS - 1; i >= 0; i--){
+        peer_send_sdu(local_cids[i], (uint8_t) i);
+        sim_run(10);
+        CHECK_EQUAL(NUM_CHANNELS - i, sdus_received);
+        CHECK_EQUAL(local_cids[i], last_sdu_cid);
+        CHECK_EQUAL(i, last_sdu[0]);
+    }
+
+    // unknown local cid is dropped
+    peer_send_sdu(local_cids[NUM_CHANNELS - 1] + 1, 0xff);
+    sim_run(10);
+    CHECK_EQUAL(NUM_CHANNELS, sdus_received);
+}
+
+TEST(L2CAP_Virtual, DisconnectClosesAllChannels){
+    sim_open_channels(NUM_CHANNELS);
+
+    peer_disconnect();
+    sim_run(10);
+    CHECK_EQUAL(NUM_CHANNELS, channels_closed);
+
+    // channels are gone
+    int i;
+    for (i = 0; i < NUM_CHANNELS; i++){
+        CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_le_disconnect(local_cids[i]));
+    }
+}
+
+#ifdef ENABLE_L2CAP_CHANNEL_SCHEDULER
+static uint8_t send_sdu[PEER_MTU];
+
+// number of PDUs for SDU of PEER_MTU bytes incl. SDU length
+#define PDUS_PER_SDU ((PEER_MTU + 2 + PEER_MPS - 1) / PEER_MPS)
+
+// get local cids of LE Data Channel PDUs on air, returns number of PDUs
+static int air_get_pdu_cids(uint16_t * cids, int max_cids){
+    int num_cids = 0;
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        if (air_pdus[i].data[0] != 8) continue;
+        uint16_t cid = little_endian_read_16(air_pdus[i].data, 7);
+        if (cid < PEER_CID_BASE) continue;
+        if (num_cids == max_cids) break;
+        cids[num_cids++] = cid - PEER_CID_BASE;
+    }
+    return num_cids;
+}
+
+TEST(L2CAP_Virtual, SchedulerRoundRobin){
+    sim_open_channels(2);
+
+    // first channel takes all free ACL buffers before second one starts
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[0], send_sdu, sizeof(send_sdu)));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[1], send_sdu, sizeof(send_sdu)));
+    sim_run(1000);
+
+    uint16_t cids[2 * PDUS_PER_SDU];
+    CHECK_EQUAL(2 * PDUS_PER_SDU, air_get_pdu_cids(cids, 2 * PDUS_PER_SDU));
+
+    // channels alternate as soon as both are waiting
+    int first_pdu_for_second_channel = 0;
+    while (cids[first_pdu_for_second_channel] == local_cids[0]){
+        first_pdu_for_second_channel++;
+    }
+    CHECK(first_pdu_for_second_channel < PDUS_PER_SDU);
+    int i;
+    for (i = first_pdu_for_second_channel; i < (2 * (PDUS_PER_SDU - first_pdu_for_second_channel)); i++){
+        CHECK(cids[i] != cids[i+1]);
+    }
+
+    l2cap_scheduler_counters_t counters;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_scheduler_get_counters(local_cids[0], &counters));
+    CHECK_EQUAL(PDUS_PER_SDU, counters.packets_sent);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_scheduler_get_counters(local_cids[1], &counters));
+    CHECK_EQUAL(PDUS_PER_SDU, counters.packets_sent);
+    CHECK(counters.requests_queued > 0);
+}
+
+TEST(L2CAP_Virtual, SchedulerPriority){
+    sim_open_channels(2);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_scheduler_set_priority(local_cids[1], 1));
+
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[0], send_sdu, sizeof(send_sdu)));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[1], send_sdu, sizeof(send_sdu)));
+    sim_run(1000);
+
+    uint16_t cids[2 * PDUS_PER_SDU];
+    CHECK_EQUAL(2 * PDUS_PER_SDU, air_get_pdu_cids(cids, 2 * PDUS_PER_SDU));
+
+    // once waiting, channel with higher priority sends all its PDUs first
+    int first_pdu_for_second_channel = 0;
+    while (cids[first_pdu_for_second_channel] == local_cids[0]){
+        first_pdu_for_second_channel++;
+    }
+    int i;
+    for (i = first_pdu_for_second_channel; i < (first_pdu_for_second_channel + PDUS_PER_SDU); i++){
+        CHECK_EQUAL(local_cids[1], cids[i]);
+    }
+
+    l2cap_scheduler_counters_t counters;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_scheduler_get_counters(local_cids[1], &counters));
+    CHECK_EQUAL(0, counters.requests_queued);
+    CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_scheduler_set_priority(0x0100, 1));
+}
+#endif
+
+#ifdef ENABLE_L2CAP_CHANNEL_LOOKUP_TABLES
+TEST(L2CAP_Virtual, LocalCidsFromTable){
+    uint16_t first_cid;
+    int i;
+    for (i = 0; i < L2CAP_LOCAL_CID_TABLE_SIZE; i++){
+        CHECK_EQUAL(ERROR_CODE_SUCCESS, sim_create_channel(0));
+        CHECK(local_cids[0] >= 0x40);
+        CHECK(local_cids[0] < (0x40 + L2CAP_LOCAL_CID_TABLE_SIZE));
+        if (i == 0){
+            first_cid = local_cids[0];
+        }
+    }
+    CHECK_EQUAL(BTSTACK_MEMORY_ALLOC_FAILED, sim_create_channel(0));
+
+    // local cids become available after the channels failed to open
+    peer_disconnect();
+    sim_run(10);
+    CHECK_EQUAL(L2CAP_LOCAL_CID_TABLE_SIZE, channels_failed);
+    sim_le_connect();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, sim_create_channel(0));
+    CHECK_EQUAL(first_cid, local_cids[0]);
+}
+#endif
+
+// get LE signaling PDU with given code on air, returns number of matching PDUs
+static int air_get_le_signaling_pdu(uint8_t code, const uint8_t ** out_pdu){
+    int num_pdus = 0;
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != L2CAP_CID_SIGNALING_LE) continue;
+        if (pdu[9] != code) continue;
+        *out_pdu = pdu;
+        num_pdus++;
+    }
+    return num_pdus;
+}
+
+static uint8_t chain_sdu[PEER_MTU + 100];
+
+TEST(L2CAP_Virtual, SendDataChain){
+    sim_open_channels(1);
+
+    int i;
+    for (i = 0; i < (int) sizeof(chain_sdu); i++){
+        chain_sdu[i] = (uint8_t) i;
+    }
+    // header, empty segment, payload and trailer
+    l2cap_le_sdu_segment_t segments[4];
+    segments[0].data = &chain_sdu[0];
+    segments[0].len  = 10;
+    segments[1].data = &chain_sdu[10];
+    segments[1].len  = 0;
+    segments[2].data = &chain_sdu[10];
+    segments[2].len  = 100;
+    segments[3].data = &chain_sdu[110];
+    segments[3].len  = 5;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data_chain(local_cids[0], segments, 4));
+    CHECK_EQUAL(BTSTACK_ACL_BUFFERS_FULL, l2cap_le_send_data_chain(local_cids[0], segments, 4));
+    sim_run(100);
+    CHECK_EQUAL(1, packets_sent);
+
+    // reassemble K-frames
+    uint8_t  sdu[PEER_MTU];
+    uint16_t sdu_len = 0;
+    uint16_t sdu_pos = 0;
+    int num_k_frames = 0;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != (PEER_CID_BASE + local_cids[0])) continue;
+        uint16_t len = little_endian_read_16(pdu, 5);
+        const uint8_t * payload = &pdu[9];
+        CHECK(len <= PEER_MPS);
+        if (num_k_frames == 0){
+            sdu_len = little_endian_read_16(payload, 0);
+            payload += 2;
+            len -= 2;
+        }
+        CHECK((sdu_pos + len) <= sdu_len);
+        memcpy(&sdu[sdu_pos], payload, len);
+        sdu_pos += len;
+        num_k_frames++;
+    }
+    CHECK_EQUAL(115, sdu_len);
+    CHECK_EQUAL(115, sdu_pos);
+    CHECK_EQUAL((115 + 2 + PEER_MPS - 1) / PEER_MPS, num_k_frames);
+    MEMCMP_EQUAL(chain_sdu, sdu, sdu_len);
+
+    // SDU exceeds remote MTU
+    segments[0].len = PEER_MTU;
+    CHECK_EQUAL(L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU, l2cap_le_send_data_chain(local_cids[0], segments, 4));
+}
+
+#ifdef ENABLE_L2CAP_LE_AUTOMATIC_CREDITS_HYSTERESIS
+TEST(L2CAP_Virtual, AutomaticCreditsHysteresis){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_create_channel(&l2cap_packet_handler, con_handle, TEST_PSM, receive_buffers[0], TEST_MTU,
+                                                            L2CAP_LE_AUTOMATIC_CREDITS, LEVEL_0, &local_cids[0]));
+    sim_run(20);
+
+    // initial credits are enough for two SDUs of TEST_MTU
+    const uint8_t * request = NULL;
+    CHECK_EQUAL(1, air_get_le_signaling_pdu(LE_CREDIT_BASED_CONNECTION_REQUEST, &request));
+    uint16_t mps    = little_endian_read_16(request, 19);
+    uint16_t window = little_endian_read_16(request, 21);
+    CHECK_EQUAL(2 * ((TEST_MTU + 2 + mps - 1) / mps), window);
+    CHECK_EQUAL(1, peer_accept_le_connections());
+    sim_run(20);
+
+    // peer sends as long as it has credits
+    uint16_t peer_credits = window;
+    int credit_packets = 0;
+    int i;
+    for (i = 0; i < 100; i++){
+        CHECK(peer_credits > 0);
+        peer_send_sdu(local_cids[0], (uint8_t) i);
+        peer_credits--;
+        sim_run(10);
+        int j;
+        for (j = 0; j < air_pdus_count; j++){
+            const uint8_t * pdu = air_pdus[j].data;
+            if (pdu[0] != 8) continue;
+            if (little_endian_read_16(pdu, 7) != L2CAP_CID_SIGNALING_LE) continue;
+            if (pdu[9] != LE_FLOW_CONTROL_CREDIT) continue;
+            CHECK_EQUAL(PEER_CID_BASE + local_cids[0], little_endian_read_16(pdu, 13));
+            peer_credits += little_endian_read_16(pdu, 15);
+            credit_packets++;
+        }
+        air_pdus_count = 0;
+        CHECK(peer_credits <= window);
+    }
+    CHECK_EQUAL(100, sdus_received);
+
+    // one credit packet per half window
+    CHECK_EQUAL(100 / (window / 2), credit_packets);
+}
+#endif
+
+#ifdef ENABLE_L2CAP_ENHANCED_CREDIT_BASED_FLOW_CONTROL_MODE
+#define ECBFC_PEER_MPS 64
+
+TEST(L2CAP_Virtual, EnhancedCreditBasedCreateChannels){
+    uint8_t * buffers[3] = { receive_buffers[0], receive_buffers[1], receive_buffers[2] };
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_ecbfc_create_channels(&l2cap_packet_handler, con_handle, TEST_PSM, 3, buffers, TEST_MTU, 5, LEVEL_0, local_cids));
+    sim_run(20);
+
+    // single request for all channels: spsm, mtu, mps, initial credits, source cids
+    const uint8_t * request = NULL;
+    CHECK_EQUAL(1, air_get_le_signaling_pdu(CREDIT_BASED_CONNECTION_REQUEST, &request));
+    CHECK_EQUAL(8 + 6, little_endian_read_16(request, 11));
+    CHECK_EQUAL(TEST_PSM, little_endian_read_16(request, 13));
+    CHECK_EQUAL(TEST_MTU, little_endian_read_16(request, 15));
+    CHECK_EQUAL(5, little_endian_read_16(request, 19));
+    int i;
+    for (i = 0; i < 3; i++){
+        CHECK_EQUAL(local_cids[i], little_endian_read_16(request, 21 + (2 * i)));
+    }
+
+    // peer accepts first and last channel
+    uint8_t response[4 + 8 + 6];
+    response[0] = CREDIT_BASED_CONNECTION_RESPONSE;
+    response[1] = request[10];
+    little_endian_store_16(response, 2, 8 + 6);
+    little_endian_store_16(response, 4, PEER_MTU);
+    little_endian_store_16(response, 6, ECBFC_PEER_MPS);
+    little_endian_store_16(response, 8, PEER_CREDITS);
+    little_endian_store_16(response, 10, 0x0004);
+    little_endian_store_16(response, 12, PEER_CID_BASE + local_cids[0]);
+    little_endian_store_16(response, 14, 0);
+    little_endian_store_16(response, 16, PEER_CID_BASE + local_cids[2]);
+    air_pdus_count = 0;
+    peer_send_l2cap_pdu(L2CAP_CID_SIGNALING_LE, response, sizeof(response));
+    sim_run(20);
+    CHECK_EQUAL(2, channels_opened);
+    CHECK_EQUAL(1, channels_failed);
+    CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_le_disconnect(local_cids[1]));
+
+    // opened channels are LE Data Channels
+    peer_send_sdu(local_cids[2], 0x22);
+    sim_run(10);
+    CHECK_EQUAL(1, sdus_received);
+    CHECK_EQUAL(local_cids[2], last_sdu_cid);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[0], chain_sdu, PEER_MTU));
+    sim_run(100);
+    CHECK_EQUAL(1, packets_sent);
+
+    // invalid parameters
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS,
+                l2cap_ecbfc_create_channels(&l2cap_packet_handler, con_handle, TEST_PSM, L2CAP_ECBFC_MAX_CHANNELS + 1, buffers, TEST_MTU, 5, LEVEL_0, local_cids));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS,
+                l2cap_ecbfc_create_channels(&l2cap_packet_handler, con_handle, TEST_PSM, 1, buffers, L2CAP_ECBFC_MIN_MTU - 1, 5, LEVEL_0, local_cids));
+}
+
+static void peer_send_ecbfc_connection_request(uint8_t sig_id, uint16_t psm, const uint16_t * source_cids, int num_channels){
+    uint8_t request[4 + 8 + (2 * L2CAP_ECBFC_MAX_CHANNELS)];
+    request[0] = CREDIT_BASED_CONNECTION_REQUEST;
+    request[1] = sig_id;
+    little_endian_store_16(request, 2, 8 + (2 * num_channels));
+    little_endian_store_16(request, 4, psm);
+    little_endian_store_16(request, 6, PEER_MTU);
+    little_endian_store_16(request, 8, ECBFC_PEER_MPS);
+    little_endian_store_16(request, 10, PEER_CREDITS);
+    int i;
+    for (i = 0; i < num_channels; i++){
+        little_endian_store_16(request, 12 + (2 * i), source_cids[i]);
+    }
+    peer_send_l2cap_pdu(L2CAP_CID_SIGNALING_LE, request, 12 + (2 * num_channels));
+}
+
+// returns result of credit based reconfigure response, or 0xffff if no response was sent
+static uint16_t peer_reconfigure(uint8_t sig_id, uint16_t mtu, const uint16_t * destination_cids, int num_channels){
+    uint8_t request[4 + 4 + (2 * L2CAP_ECBFC_MAX_CHANNELS)];
+    request[0] = CREDIT_BASED_RECONFIGURE_REQUEST;
+    request[1] = sig_id;
+    little_endian_store_16(request, 2, 4 + (2 * num_channels));
+    little_endian_store_16(request, 4, mtu);
+    little_endian_store_16(request, 6, ECBFC_PEER_MPS);
+    int i;
+    for (i = 0; i < num_channels; i++){
+        little_endian_store_16(request, 8 + (2 * i), destination_cids[i]);
+    }
+    air_pdus_count = 0;
+    peer_send_l2cap_pdu(L2CAP_CID_SIGNALING_LE, request, 8 + (2 * num_channels));
+    sim_run(20);
+    const uint8_t * response = NULL;
+    if (air_get_le_signaling_pdu(CREDIT_BASED_RECONFIGURE_RESPONSE, &response) != 1) return 0xffff;
+    if (response[10] != sig_id) return 0xffff;
+    return little_endian_read_16(response, 13);
+}
+
+TEST(L2CAP_Virtual, EnhancedCreditBasedIncomingChannels){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_register_service(&l2cap_packet_handler, TEST_PSM, LEVEL_0));
+    incoming_connections_to_accept = 2;
+
+    // second source cid is invalid, fourth channel gets declined
+    const uint16_t source_cids[] = { PEER_CID_BASE, 0x0010, PEER_CID_BASE + 1, PEER_CID_BASE + 2 };
+    peer_send_ecbfc_connection_request(0x42, TEST_PSM, source_cids, 4);
+    sim_run(20);
+    CHECK_EQUAL(3, incoming_connections);
+    CHECK_EQUAL(2, channels_opened);
+
+    // single response for all channels: mtu, mps, initial credits, result, destination cids
+    const uint8_t * response = NULL;
+    CHECK_EQUAL(1, air_get_le_signaling_pdu(CREDIT_BASED_CONNECTION_RESPONSE, &response));
+    CHECK_EQUAL(0x42, response[10]);
+    CHECK_EQUAL(8 + 8, little_endian_read_16(response, 11));
+    CHECK_EQUAL(TEST_MTU, little_endian_read_16(response, 13));
+    CHECK_EQUAL(5, little_endian_read_16(response, 17));
+    CHECK(little_endian_read_16(response, 19) != 0);
+    CHECK_EQUAL(local_cids[0], little_endian_read_16(response, 21));
+    CHECK_EQUAL(0, little_endian_read_16(response, 23));
+    CHECK_EQUAL(local_cids[1], little_endian_read_16(response, 25));
+    CHECK_EQUAL(0, little_endian_read_16(response, 27));
+    CHECK_EQUAL(L2CAP_LOCAL_CID_DOES_NOT_EXIST, l2cap_le_disconnect(local_cids[2]));
+
+    peer_send_sdu(local_cids[1], 0x11);
+    sim_run(10);
+    CHECK_EQUAL(1, sdus_received);
+    CHECK_EQUAL(local_cids[1], last_sdu_cid);
+
+    // MTU can only grow, for valid destination cids
+    const uint16_t destination_cids[] = { local_cids[0], local_cids[1], 0x0100 };
+    CHECK_EQUAL(L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU, l2cap_le_send_data(local_cids[0], chain_sdu, PEER_MTU + 100));
+    CHECK_EQUAL(0x0000, peer_reconfigure(0x43, PEER_MTU + 100, destination_cids, 2));
+    CHECK_EQUAL(0x0001, peer_reconfigure(0x44, PEER_MTU, destination_cids, 2));
+    CHECK_EQUAL(0x0003, peer_reconfigure(0x45, PEER_MTU + 100, destination_cids, 3));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_le_send_data(local_cids[0], chain_sdu, PEER_MTU + 100));
+
+    // all channels refused for unknown SPSM
+    air_pdus_count = 0;
+    peer_send_ecbfc_connection_request(0x46, TEST_PSM + 1, source_cids, 2);
+    sim_run(20);
+    CHECK_EQUAL(3, incoming_connections);
+    CHECK_EQUAL(1, air_get_le_signaling_pdu(CREDIT_BASED_CONNECTION_RESPONSE, &response));
+    CHECK_EQUAL(8 + 4, little_endian_read_16(response, 11));
+    CHECK_EQUAL(0x0002, little_endian_read_16(response, 19));
+}
+#endif
+
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+
+// ERTM over Classic connection, the peer sends numbered SDUs as I-Frames with injected loss and handles our S-Frames
+
+#define ERTM_PSM            0x1001
+#define ERTM_PEER_CID       0x0070
+#define ERTM_SDU_LEN        100
+#define ERTM_NUM_SDUS       1000
+#define ERTM_ROUND_MS       5
+#define ERTM_FRAMES_PER_ROUND 8
+#define ERTM_POLL_ROUNDS    10
+#define ERTM_MAX_ROUNDS     20000
+
+static uint8_t  ertm_buffer[20000];
+static uint16_t ertm_local_cid;
+static uint16_t ertm_sdus_received;
+static uint16_t ertm_sdus_out_of_order;
+
+// peer state, sequence numbers are SDU numbers, tx_seq = sdu number & mask
+static int      ertm_extended_control;
+static uint16_t ertm_window;
+static uint16_t ertm_loss_permille;
+static uint32_t ertm_random;
+static int      ertm_acked;
+static int      ertm_next;
+static int      ertm_highest_sent;
+static int      ertm_i_frames_sent;
+static int      ertm_i_frames_lost;
+
+static void ertm_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case L2CAP_DATA_PACKET:
+            if ((size != ERTM_SDU_LEN) || (little_endian_read_16(packet, 0) != ertm_sdus_received)){
+                ertm_sdus_out_of_order++;
+            }
+            ertm_sdus_received++;
+            break;
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) != L2CAP_EVENT_CHANNEL_OPENED) break;
+            if (l2cap_event_channel_opened_get_status(packet) == ERROR_CODE_SUCCESS){
+                channels_opened++;
+            } else {
+                channels_failed++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// reference implementation: bitwise CRC-16 with polynom D^16 + D^15 + D^2 + 1
+static uint16_t ertm_fcs(const uint8_t * data, uint16_t len){
+    uint16_t crc = 0;
+    while (len--){
+        crc ^= *data++;
+        int i;
+        for (i = 0; i < 8; i++){
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t ertm_seq_nr_mask(void){
+    return ertm_extended_control ? 0x3fff : 0x3f;
+}
+
+static bool ertm_lose_frame(void){
+    ertm_random = ertm_random * 1103515245u + 12345u;
+    return ((ertm_random >> 16) % 1000u) < ertm_loss_permille;
+}
+
+// send L2CAP PDU with control field and FCS on ERTM channel
+static void peer_send_ertm_frame(uint32_t control, const uint8_t * payload, uint16_t len){
+    uint8_t frame[L2CAP_HEADER_SIZE + 4 + ERTM_SDU_LEN + 2];
+    uint16_t control_size = ertm_extended_control ? 4 : 2;
+    uint16_t pdu_len = control_size + len + 2;
+    little_endian_store_16(frame, 0, pdu_len);
+    little_endian_store_16(frame, 2, ertm_local_cid);
+    if (ertm_extended_control){
+        little_endian_store_32(frame, 4, control);
+    } else {
+        little_endian_store_16(frame, 4, (uint16_t) control);
+    }
+    memcpy(&frame[4 + control_size], payload, len);
+    little_endian_store_16(frame, 4 + control_size + len, ertm_fcs(frame, 4 + control_size + len));
+    // peer_send_l2cap_pdu adds the L2CAP header
+    peer_send_l2cap_pdu(ertm_local_cid, &frame[4], pdu_len);
+}
+
+static void peer_send_i_frame(int sdu_number){
+    uint8_t sdu[ERTM_SDU_LEN];
+    memset(sdu, (uint8_t) sdu_number, sizeof(sdu));
+    little_endian_store_16(sdu, 0, (uint16_t) sdu_number);
+    uint16_t tx_seq = sdu_number & ertm_seq_nr_mask();
+    uint32_t control = ertm_extended_control ? (((uint32_t) tx_seq) << 18) : (tx_seq << 1);
+    ertm_i_frames_sent++;
+    if (sdu_number > ertm_highest_sent){
+        ertm_highest_sent = sdu_number;
+    }
+    if (ertm_lose_frame()){
+        ertm_i_frames_lost++;
+        return;
+    }
+    peer_send_ertm_frame(control, sdu, sizeof(sdu));
+}
+
+static void peer_send_rr_poll(void){
+    uint32_t control = ertm_extended_control ? ((1u << 18) | 1u) : ((1u << 4) | 1u);
+    peer_send_ertm_frame(control, NULL, 0);
+}
+
+static void peer_send_rr(uint16_t req_seq){
+    uint32_t control = ertm_extended_control ? ((((uint32_t) req_seq) << 2) | 1u) : ((((uint32_t) req_seq) << 8) | 1u);
+    peer_send_ertm_frame(control, NULL, 0);
+}
+
+static void peer_send_signaling(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t command[4 + 24];
+    btstack_assert(len <= 24);
+    command[0] = code;
+    command[1] = sig_id;
+    little_endian_store_16(command, 2, len);
+    memcpy(&command[4], data, len);
+    peer_send_l2cap_pdu(L2CAP_CID_SIGNALING, command, 4 + len);
+}
+
+static void peer_accept_classic_connection(void){
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        if (air_pdus[i].data[0] != 6) continue;
+        uint8_t connect_rsp[6];
+        connect_rsp[0] = 7;
+        little_endian_store_16(connect_rsp, 1, little_endian_read_16(air_pdus[i].data, 1));
+        little_endian_store_16(connect_rsp, 3, PEER_HANDLE);
+        connect_rsp[5] = ERROR_CODE_SUCCESS;
+        hci_transport_virtual_receive_pdu(connect_rsp, sizeof(connect_rsp));
+    }
+    air_pdus_count = 0;
+}
+
+// answer information, connection and configuration requests, request ERTM with extended window if enabled
+static void peer_handle_classic_signaling(void){
+    uint8_t data[24];
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != L2CAP_CID_SIGNALING) continue;
+        uint8_t sig_id = pdu[10];
+        const uint8_t * command_data = &pdu[13];
+        switch (pdu[9]){
+            case INFORMATION_REQUEST:
+                little_endian_store_16(data, 0, little_endian_read_16(command_data, 0));
+                little_endian_store_16(data, 2, 0);
+                if (little_endian_read_16(command_data, 0) == 2){
+                    // extended features: ERTM, FCS option, Extended Window Size
+                    little_endian_store_32(data, 4, 0x0128);
+                    peer_send_signaling(INFORMATION_RESPONSE, sig_id, data, 8);
+                } else {
+                    // fixed channels: signaling
+                    memset(&data[4], 0, 8);
+                    data[4] = 0x02;
+                    peer_send_signaling(INFORMATION_RESPONSE, sig_id, data, 12);
+                }
+                break;
+            case CONNECTION_REQUEST:
+                little_endian_store_16(data, 0, ERTM_PEER_CID);
+                little_endian_store_16(data, 2, little_endian_read_16(command_data, 2));
+                little_endian_store_16(data, 4, 0);
+                little_endian_store_16(data, 6, 0);
+                peer_send_signaling(CONNECTION_RESPONSE, sig_id, data, 8);
+                // peer configuration: ERTM, TxWindow 63, max transmit 3, timeouts 2000/12000 ms, MPS
+                little_endian_store_16(data, 0, ertm_local_cid);
+                little_endian_store_16(data, 2, 0);
+                data[4] = 4;
+                data[5] = 9;
+                data[6] = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+                data[7] = 63;
+                data[8] = 3;
+                little_endian_store_16(data,  9, 2000);
+                little_endian_store_16(data, 11, 12000);
+                little_endian_store_16(data, 13, ERTM_SDU_LEN);
+                if (ertm_extended_control){
+                    data[15] = 7;
+                    data[16] = 2;
+                    little_endian_store_16(data, 17, 200);
+                    peer_send_signaling(CONFIGURE_REQUEST, 0x80, data, 19);
+                } else {
+                    peer_send_signaling(CONFIGURE_REQUEST, 0x80, data, 15);
+                }
+                break;
+            case CONFIGURE_REQUEST:
+                little_endian_store_16(data, 0, ertm_local_cid);
+                little_endian_store_16(data, 2, 0);
+                little_endian_store_16(data, 4, 0);
+                peer_send_signaling(CONFIGURE_RESPONSE, sig_id, data, 6);
+                break;
+            default:
+                break;
+        }
+    }
+    air_pdus_count = 0;
+}
+
+// process S-Frames from us, returns number of S-Frames
+static int peer_handle_s_frames(void){
+    int num_s_frames = 0;
+    uint16_t mask = ertm_seq_nr_mask();
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != ERTM_PEER_CID) continue;
+        uint32_t control;
+        uint16_t req_seq;
+        int      final;
+        int      function;
+        if (ertm_extended_control){
+            control  = little_endian_read_32(pdu, 9);
+            req_seq  = (control >> 2) & 0x3fff;
+            final    = (control >> 1) & 1;
+            function = (control >> 16) & 3;
+        } else {
+            control  = little_endian_read_16(pdu, 9);
+            req_seq  = (control >> 8) & 0x3f;
+            final    = (control >> 7) & 1;
+            function = (control >> 2) & 3;
+        }
+        if ((control & 1) == 0) continue;
+        num_s_frames++;
+        int sdu_number = ertm_acked + ((req_seq - ertm_acked) & mask);
+        switch (function){
+            case 0: // RR
+            case 2: // REJ
+                if (sdu_number > ertm_acked){
+                    ertm_acked = sdu_number;
+                }
+                if (ertm_next < ertm_acked){
+                    ertm_next = ertm_acked;
+                }
+                // REJ or RR as response to poll: retransmit all unacknowledged frames
+                if ((function == 2) || final){
+                    ertm_next = ertm_acked;
+                }
+                break;
+            case 3: // SREJ
+                if (sdu_number <= ertm_highest_sent){
+                    peer_send_i_frame(sdu_number);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    air_pdus_count = 0;
+    return num_s_frames;
+}
+
+// receive I-Frames from us in sequence and acknowledge them with RR, returns number of I-Frames
+static int peer_handle_i_frames(void){
+    int num_i_frames = 0;
+    uint16_t mask = ertm_seq_nr_mask();
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        if (little_endian_read_16(pdu, 7) != ERTM_PEER_CID) continue;
+        uint32_t control;
+        uint16_t tx_seq;
+        uint16_t control_size;
+        if (ertm_extended_control){
+            control      = little_endian_read_32(pdu, 9);
+            tx_seq       = (control >> 18) & 0x3fff;
+            control_size = 4;
+        } else {
+            control      = little_endian_read_16(pdu, 9);
+            tx_seq       = (control >> 1) & 0x3f;
+            control_size = 2;
+        }
+        if ((control & 1) != 0) continue;
+        num_i_frames++;
+        // ignore retransmissions
+        if (tx_seq != (ertm_sdus_received & mask)) continue;
+        if (little_endian_read_16(pdu, 9 + control_size) != ertm_sdus_received){
+            ertm_sdus_out_of_order++;
+        }
+        ertm_sdus_received++;
+    }
+    air_pdus_count = 0;
+    if (num_i_frames > 0){
+        peer_send_rr(ertm_sdus_received & mask);
+    }
+    return num_i_frames;
+}
+
+static void sim_ertm_open_channel(uint8_t num_rx_buffers){
+    l2cap_ertm_config_t ertm_config;
+    ertm_config.ertm_mandatory = 1;
+    ertm_config.max_transmit = 3;
+    ertm_config.retransmission_timeout_ms = 2000;
+    ertm_config.monitor_timeout_ms = 12000;
+    ertm_config.local_mtu = ERTM_SDU_LEN;
+    ertm_config.num_tx_buffers = 2;
+    ertm_config.num_rx_buffers = num_rx_buffers;
+    ertm_config.fcs_option = 1;
+    // rx and tx buffers with at least ERTM_SDU_LEN bytes each
+    uint32_t size = 16 + ERTM_SDU_LEN + (num_rx_buffers + 2) * (32 + ERTM_SDU_LEN);
+    btstack_assert(size <= sizeof(ertm_buffer));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_create_ertm_channel(&ertm_packet_handler, (uint8_t *) peer_addr, ERTM_PSM,
+                                                              &ertm_config, ertm_buffer, size, &ertm_local_cid));
+    sim_run(10);
+    peer_accept_classic_connection();
+    sim_run(100);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connection_complete_status);
+    int i;
+    for (i = 0; i < 5; i++){
+        peer_handle_classic_signaling();
+        sim_run(20);
+    }
+    CHECK_EQUAL(1, channels_opened);
+}
+
+// send ERTM_NUM_SDUS from peer with given loss rate, returns number of rounds
+static int sim_ertm_transfer(void){
+    ertm_random = 1;
+    ertm_acked = 0;
+    ertm_next = 0;
+    ertm_highest_sent = -1;
+    ertm_i_frames_sent = 0;
+    ertm_i_frames_lost = 0;
+    ertm_sdus_received = 0;
+    ertm_sdus_out_of_order = 0;
+    int idle_rounds = 0;
+    int round;
+    for (round = 0; round < ERTM_MAX_ROUNDS; round++){
+        if (ertm_acked >= ERTM_NUM_SDUS) break;
+        // fill window, limited by link rate
+        int num_frames = 0;
+        while ((ertm_next < ERTM_NUM_SDUS) && (ertm_next < (ertm_acked + ertm_window)) && (num_frames < ERTM_FRAMES_PER_ROUND)){
+            peer_send_i_frame(ertm_next++);
+            num_frames++;
+        }
+        sim_run(ERTM_ROUND_MS);
+        if (peer_handle_s_frames() > 0){
+            idle_rounds = 0;
+            continue;
+        }
+        // retransmission timeout
+        if (++idle_rounds >= ERTM_POLL_ROUNDS){
+            idle_rounds = 0;
+            peer_send_rr_poll();
+        }
+    }
+    return round;
+}
+
+static void sim_ertm_report(const char * name, int rounds){
+    printf("%-8s window %3u, loss %4.1f%%: %4u SDUs in %5u ms, %5u I-Frames sent, %4u lost, goodput %5.1f%%\n",
+           name, ertm_window, ertm_loss_permille / 10.0, ertm_sdus_received, rounds * ERTM_ROUND_MS,
+           ertm_i_frames_sent, ertm_i_frames_lost, 100.0 * ertm_sdus_received / ertm_i_frames_sent);
+}
+
+TEST_GROUP(L2CAP_ERTM){
+    void setup(void){
+        sim_power_on();
+        ertm_extended_control = 0;
+        ertm_loss_permille = 0;
+    }
+    void teardown(void){
+        sim_close();
+    }
+};
+
+// loss-injection benchmark, goodput = SDUs delivered / I-Frames sent by peer
+static void ertm_goodput_versus_loss(uint8_t num_rx_buffers, int extended_control){
+    static const uint16_t loss_rates_permille[] = { 0, 10, 50, 100, 200 };
+    unsigned int i;
+    for (i = 0; i < sizeof(loss_rates_permille) / sizeof(uint16_t); i++){
+        if (i > 0){
+            sim_close();
+            sim_power_on();
+            channels_opened = 0;
+        }
+        ertm_extended_control = extended_control;
+        ertm_window = num_rx_buffers;
+        ertm_loss_permille = loss_rates_permille[i];
+        sim_ertm_open_channel(num_rx_buffers);
+        int rounds = sim_ertm_transfer();
+        sim_ertm_report(extended_control ? "extended" : "enhanced", rounds);
+        CHECK_EQUAL(ERTM_NUM_SDUS, ertm_sdus_received);
+        CHECK_EQUAL(0, ertm_sdus_out_of_order);
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+        // only lost frames are retransmitted, unless retransmissions are lost as well
+        CHECK(ertm_i_frames_sent <= (ERTM_NUM_SDUS + 2 * ertm_i_frames_lost));
+#endif
+    }
+}
+
+TEST(L2CAP_ERTM, GoodputVersusLoss){
+    ertm_goodput_versus_loss(16, 0);
+}
+
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+TEST(L2CAP_ERTM, GoodputVersusLossExtendedWindow){
+    ertm_goodput_versus_loss(100, 1);
+}
+#endif
+
+#ifdef ENABLE_L2CAP_ERTM_SELECTIVE_REJECT
+// send I-Frames for SDUs first..last except lost one, then let peer handle S-Frames until idle
+static void sim_ertm_send_sdus(int first, int last, int lost){
+    int sdu_number;
+    for (sdu_number = first; sdu_number <= last; sdu_number++){
+        if (sdu_number == lost) continue;
+        peer_send_i_frame(sdu_number);
+    }
+    int idle_rounds = 0;
+    while (idle_rounds < ERTM_POLL_ROUNDS){
+        sim_run(ERTM_ROUND_MS);
+        if (peer_handle_s_frames() > 0){
+            idle_rounds = 0;
+        } else {
+            idle_rounds++;
+        }
+    }
+}
+
+TEST(L2CAP_ERTM, SelectiveRejectAfterWraparound){
+    sim_ertm_open_channel(16);
+    ertm_acked = 0;
+    ertm_highest_sent = -1;
+    ertm_sdus_received = 0;
+    ertm_sdus_out_of_order = 0;
+    // SDU 1 lost, requested by SREJ
+    sim_ertm_send_sdus(0, 2, 1);
+    CHECK_EQUAL(3, ertm_sdus_received);
+    // TxSeq wraps around
+    int sdu_number;
+    for (sdu_number = 3; sdu_number < 64; sdu_number += 8){
+        sim_ertm_send_sdus(sdu_number, btstack_min(sdu_number + 7, 63), -1);
+    }
+    CHECK_EQUAL(64, ertm_sdus_received);
+    // SDU 64 with TxSeq 0 lost, has to be requested although TxSeq 1 was requested before
+    sim_ertm_send_sdus(64, 65, 64);
+    CHECK_EQUAL(66, ertm_sdus_received);
+    CHECK_EQUAL(0, ertm_sdus_out_of_order);
+}
+#endif
+
+#ifdef ENABLE_L2CAP_ERTM_EXTENDED_WINDOW
+#define ERTM_NUM_SDUS_SENT  300
+
+TEST(L2CAP_ERTM, SendExtendedControlAfterTxSeq255){
+    ertm_extended_control = 1;
+    sim_ertm_open_channel(100);
+    ertm_sdus_received = 0;
+    ertm_sdus_out_of_order = 0;
+    // ReqSeq of RR from peer exceeds 8 bit after 256 SDUs
+    uint8_t sdu[ERTM_SDU_LEN];
+    int sdus_sent = 0;
+    int round;
+    for (round = 0; (round < ERTM_MAX_ROUNDS) && (ertm_sdus_received < ERTM_NUM_SDUS_SENT); round++){
+        while ((sdus_sent < ERTM_NUM_SDUS_SENT) && l2cap_can_send_packet_now(ertm_local_cid)){
+            memset(sdu, (uint8_t) sdus_sent, sizeof(sdu));
+            little_endian_store_16(sdu, 0, (uint16_t) sdus_sent);
+            CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_send(ertm_local_cid, sdu, sizeof(sdu)));
+            sdus_sent++;
+        }
+        sim_run(ERTM_ROUND_MS);
+        peer_handle_i_frames();
+    }
+    CHECK_EQUAL(ERTM_NUM_SDUS_SENT, ertm_sdus_received);
+    CHECK_EQUAL(0, ertm_sdus_out_of_order);
+}
+#endif
+#endif
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
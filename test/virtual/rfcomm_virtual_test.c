@@ -0,0 +1,524 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_base.h"
+#include "btstack_util.h"
+#include "classic/rfcomm.h"
+#include "gap.h"
+#include "hci.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+
+// SPP streaming over virtual Controller, the peer RFCOMM layer is simulated on the air interface
+
+#define LINK_RATE           1000000
+#define ACL_PAYLOAD_LEN     HCI_ACL_PAYLOAD_SIZE
+#define MAX_AIR_PDUS        200
+#define PEER_HANDLE         0x0040
+#define PEER_L2CAP_CID      0x0050
+#define PEER_L2CAP_MTU      1000
+#define SERVER_CHANNEL      1
+#define ROUND_MS            5
+#define STREAM_MS           2000
+
+// RFCOMM frame types and multiplexer commands
+#define RFCOMM_SABM         0x3F
+#define RFCOMM_UA           0x73
+#define RFCOMM_UIH          0xEF
+#define RFCOMM_UIH_PF       0xFF
+#define RFCOMM_PN_CMD       0x83
+#define RFCOMM_PN_RSP       0x81
+#define RFCOMM_MSC_CMD      0xE3
+#define RFCOMM_MSC_RSP      0xE1
+
+static const bd_addr_t local_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static const bd_addr_t peer_addr  = { 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 };
+
+static uint32_t sim_time_ms;
+
+// run loop with virtual time
+
+static void sim_run_loop_init(void){
+    btstack_run_loop_base_init();
+}
+
+static uint32_t sim_run_loop_get_time_ms(void){
+    return sim_time_ms;
+}
+
+static void sim_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = sim_time_ms + timeout_in_ms;
+}
+
+static const btstack_run_loop_t sim_run_loop = {
+    &sim_run_loop_init,
+    &btstack_run_loop_base_add_data_source,
+    &btstack_run_loop_base_remove_data_source,
+    &btstack_run_loop_base_enable_data_source_callbacks,
+    &btstack_run_loop_base_disable_data_source_callbacks,
+    &sim_run_loop_set_timer,
+    &btstack_run_loop_base_add_timer,
+    &btstack_run_loop_base_remove_timer,
+    NULL,
+    &btstack_run_loop_base_dump_timer,
+    &sim_run_loop_get_time_ms,
+};
+
+// SM is not used with security level 0
+extern "C" void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    UNUSED(callback_handler);
+}
+extern "C" void sm_request_pairing(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+}
+
+// air interface
+
+typedef struct {
+    uint16_t size;
+    uint8_t  data[1 + HCI_ACL_HEADER_SIZE + ACL_PAYLOAD_LEN];
+} air_pdu_t;
+
+static air_pdu_t air_pdus[MAX_AIR_PDUS];
+static int       air_pdus_count;
+
+static void air_send_pdu(const uint8_t * pdu, uint16_t size){
+    btstack_assert(air_pdus_count < MAX_AIR_PDUS);
+    btstack_assert(size <= sizeof(air_pdus[0].data));
+    air_pdu_t * air_pdu = &air_pdus[air_pdus_count++];
+    air_pdu->size = size;
+    memcpy(air_pdu->data, pdu, size);
+}
+
+// host, streams like spp_streamer and counts received data
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+static hci_con_handle_t con_handle;
+static uint8_t  connection_complete_status;
+static uint16_t rfcomm_cid;
+static uint16_t rfcomm_mtu;
+static uint16_t channels_opened;
+static int      local_streaming;
+static uint32_t local_bytes_received;
+static uint8_t  test_data[ACL_PAYLOAD_LEN];
+
+static void hci_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_CONNECTION_COMPLETE) return;
+    connection_complete_status = hci_event_connection_complete_get_status(packet);
+    con_handle = hci_event_connection_complete_get_connection_handle(packet);
+}
+
+static void rfcomm_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case RFCOMM_DATA_PACKET:
+            local_bytes_received += size;
+            break;
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)){
+                case RFCOMM_EVENT_CHANNEL_OPENED:
+                    if (rfcomm_event_channel_opened_get_status(packet) != ERROR_CODE_SUCCESS) break;
+                    rfcomm_mtu = rfcomm_event_channel_opened_get_max_frame_size(packet);
+                    channels_opened++;
+                    break;
+                case RFCOMM_EVENT_CAN_SEND_NOW:
+                    if (!local_streaming) break;
+                    rfcomm_send(rfcomm_cid, test_data, rfcomm_mtu);
+                    rfcomm_request_can_send_now_event(rfcomm_cid);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// peer L2CAP
+
+static uint16_t peer_local_l2cap_cid;
+
+static void peer_send_l2cap_pdu(uint16_t cid, const uint8_t * payload, uint16_t len){
+    uint8_t acl_pdu[1 + HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE + PEER_L2CAP_MTU];
+    btstack_assert(len <= PEER_L2CAP_MTU);
+    acl_pdu[0] = 8;
+    little_endian_store_16(acl_pdu, 1, con_handle | 0x2000);
+    little_endian_store_16(acl_pdu, 3, L2CAP_HEADER_SIZE + len);
+    little_endian_store_16(acl_pdu, 5, len);
+    little_endian_store_16(acl_pdu, 7, cid);
+    memcpy(&acl_pdu[9], payload, len);
+    hci_transport_virtual_receive_pdu(acl_pdu, 9 + len);
+}
+
+static void peer_send_signaling(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t command[4 + 12];
+    btstack_assert(len <= 12);
+    command[0] = code;
+    command[1] = sig_id;
+    little_endian_store_16(command, 2, len);
+    memcpy(&command[4], data, len);
+    peer_send_l2cap_pdu(L2CAP_CID_SIGNALING, command, 4 + len);
+}
+
+static void peer_accept_classic_connection(void){
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        if (air_pdus[i].data[0] != 6) continue;
+        uint8_t connect_rsp[6];
+        connect_rsp[0] = 7;
+        little_endian_store_16(connect_rsp, 1, little_endian_read_16(air_pdus[i].data, 1));
+        little_endian_store_16(connect_rsp, 3, PEER_HANDLE);
+        connect_rsp[5] = ERROR_CODE_SUCCESS;
+        hci_transport_virtual_receive_pdu(connect_rsp, sizeof(connect_rsp));
+    }
+    air_pdus_count = 0;
+}
+
+// answer information, connection and configuration requests for basic mode channel
+static void peer_handle_l2cap_signaling(const uint8_t * pdu){
+    uint8_t data[12];
+    uint8_t sig_id = pdu[10];
+    const uint8_t * command_data = &pdu[13];
+    switch (pdu[9]){
+        case INFORMATION_REQUEST:
+            little_endian_store_16(data, 0, little_endian_read_16(command_data, 0));
+            little_endian_store_16(data, 2, 0);
+            if (little_endian_read_16(command_data, 0) == 2){
+                // extended features: none
+                little_endian_store_32(data, 4, 0);
+                peer_send_signaling(INFORMATION_RESPONSE, sig_id, data, 8);
+            } else {
+                // fixed channels: signaling
+                memset(&data[4], 0, 8);
+                data[4] = 0x02;
+                peer_send_signaling(INFORMATION_RESPONSE, sig_id, data, 12);
+            }
+            break;
+        case CONNECTION_REQUEST:
+            peer_local_l2cap_cid = little_endian_read_16(command_data, 2);
+            little_endian_store_16(data, 0, PEER_L2CAP_CID);
+            little_endian_store_16(data, 2, peer_local_l2cap_cid);
+            little_endian_store_16(data, 4, 0);
+            little_endian_store_16(data, 6, 0);
+            peer_send_signaling(CONNECTION_RESPONSE, sig_id, data, 8);
+            // peer configuration: MTU
+            little_endian_store_16(data, 0, peer_local_l2cap_cid);
+            little_endian_store_16(data, 2, 0);
+            data[4] = 1;
+            data[5] = 2;
+            little_endian_store_16(data, 6, PEER_L2CAP_MTU);
+            peer_send_signaling(CONFIGURE_REQUEST, 0x80, data, 8);
+            break;
+        case CONFIGURE_REQUEST:
+            little_endian_store_16(data, 0, peer_local_l2cap_cid);
+            little_endian_store_16(data, 2, 0);
+            little_endian_store_16(data, 4, 0);
+            peer_send_signaling(CONFIGURE_RESPONSE, sig_id, data, 6);
+            break;
+        default:
+            break;
+    }
+}
+
+// peer RFCOMM, responder for multiplexer and DLCI
+
+static uint8_t  peer_dlci;
+static uint16_t peer_max_frame_size;
+static uint16_t peer_credits;           // credits granted by us
+static uint16_t peer_credits_window;    // credits the peer grants to us
+static uint16_t peer_frames_to_grant;
+static uint32_t peer_bytes_received;
+static uint32_t peer_frames_received;
+
+static void peer_send_rfcomm_frame(uint8_t address, uint8_t control, uint8_t credits, const uint8_t * data, uint16_t len){
+    uint8_t frame[6 + PEER_L2CAP_MTU];
+    uint16_t pos = 0;
+    frame[pos++] = address;
+    frame[pos++] = control;
+    if (len < 128){
+        frame[pos++] = (len << 1) | 1;
+    } else {
+        frame[pos++] = (len & 0x7f) << 1;
+        frame[pos++] = len >> 7;
+    }
+    uint16_t fcs_len = (control == RFCOMM_UIH) || (control == RFCOMM_UIH_PF) ? 2 : pos;
+    if (control == RFCOMM_UIH_PF){
+        frame[pos++] = credits;
+    }
+    memcpy(&frame[pos], data, len);
+    pos += len;
+    frame[pos] = btstack_crc8_calc(frame, fcs_len);
+    pos++;
+    peer_send_l2cap_pdu(peer_local_l2cap_cid, frame, pos);
+}
+
+// responder sends responses with C/R = 1 and UIH frames with C/R = 0
+static void peer_send_ua(uint8_t dlci){
+    peer_send_rfcomm_frame((dlci << 2) | 3, RFCOMM_UA, 0, NULL, 0);
+}
+
+static void peer_send_multiplexer_command(const uint8_t * command, uint16_t len){
+    peer_send_rfcomm_frame(1, RFCOMM_UIH, 0, command, len);
+}
+
+static void peer_grant_credits(uint8_t credits){
+    peer_send_rfcomm_frame((peer_dlci << 2) | 1, RFCOMM_UIH_PF, credits, NULL, 0);
+}
+
+static void peer_send_data(uint16_t len){
+    btstack_assert(peer_credits > 0);
+    peer_credits--;
+    peer_send_rfcomm_frame((peer_dlci << 2) | 1, RFCOMM_UIH, 0, test_data, len);
+}
+
+static void peer_handle_multiplexer_command(const uint8_t * command){
+    uint8_t response[10];
+    switch (command[0]){
+        case RFCOMM_PN_CMD:
+            // accept credit based flow control and grant initial credits
+            peer_max_frame_size = btstack_min(little_endian_read_16(command, 6), PEER_L2CAP_MTU - 6);
+            memcpy(response, command, 10);
+            response[0] = RFCOMM_PN_RSP;
+            response[3] = 0xe0;
+            little_endian_store_16(response, 6, peer_max_frame_size);
+            response[9] = (uint8_t) peer_credits_window;
+            peer_send_multiplexer_command(response, 10);
+            break;
+        case RFCOMM_MSC_CMD:
+            memcpy(response, command, 4);
+            response[0] = RFCOMM_MSC_RSP;
+            peer_send_multiplexer_command(response, 4);
+            response[0] = RFCOMM_MSC_CMD;
+            response[3] = 0x8d;
+            peer_send_multiplexer_command(response, 4);
+            break;
+        default:
+            break;
+    }
+}
+
+static void peer_handle_rfcomm_frame(const uint8_t * frame, uint16_t size){
+    uint8_t dlci = frame[0] >> 2;
+    uint8_t control = frame[1];
+    uint16_t len = frame[2] >> 1;
+    uint16_t pos = 3;
+    if ((frame[2] & 1) == 0){
+        len |= frame[3] << 7;
+        pos++;
+    }
+    switch (control){
+        case RFCOMM_SABM:
+            if (dlci != 0){
+                peer_dlci = dlci;
+            }
+            peer_send_ua(dlci);
+            break;
+        case RFCOMM_UIH_PF:
+            peer_credits += frame[pos++];
+            /* fall through */
+        case RFCOMM_UIH:
+            btstack_assert((pos + len + 1u) == size);
+            if (dlci == 0){
+                peer_handle_multiplexer_command(&frame[pos]);
+                break;
+            }
+            if (len == 0) break;
+            peer_bytes_received += len;
+            peer_frames_received++;
+            peer_frames_to_grant++;
+            break;
+        default:
+            break;
+    }
+}
+
+// process all PDUs from us
+static void peer_process_air_pdus(void){
+    int i;
+    for (i = 0; i < air_pdus_count; i++){
+        const uint8_t * pdu = air_pdus[i].data;
+        if (pdu[0] != 8) continue;
+        uint16_t l2cap_len = little_endian_read_16(pdu, 5);
+        switch (little_endian_read_16(pdu, 7)){
+            case L2CAP_CID_SIGNALING:
+                peer_handle_l2cap_signaling(pdu);
+                break;
+            case PEER_L2CAP_CID:
+                peer_handle_rfcomm_frame(&pdu[9], l2cap_len);
+                break;
+            default:
+                break;
+        }
+    }
+    air_pdus_count = 0;
+    // return credits once half of the window has been used
+    if ((peer_dlci != 0) && (peer_frames_to_grant >= (peer_credits_window / 2))){
+        peer_grant_credits((uint8_t) peer_frames_to_grant);
+        peer_frames_to_grant = 0;
+    }
+}
+
+// simulation
+
+static void sim_run(uint32_t duration_ms){
+    uint32_t end_ms = sim_time_ms + duration_ms;
+    while (true){
+        btstack_run_loop_base_process_timers(sim_time_ms);
+        int32_t timeout_ms = btstack_run_loop_base_get_time_until_timeout(sim_time_ms);
+        if (timeout_ms < 0) break;
+        if ((sim_time_ms + timeout_ms) > end_ms) break;
+        sim_time_ms += timeout_ms;
+    }
+    sim_time_ms = end_ms;
+}
+
+static void sim_power_on(uint32_t link_latency_ms){
+    sim_time_ms = 0;
+    air_pdus_count = 0;
+    con_handle = HCI_CON_HANDLE_INVALID;
+    connection_complete_status = 0xff;
+    rfcomm_cid = 0;
+    rfcomm_mtu = 0;
+    channels_opened = 0;
+    local_streaming = 0;
+    local_bytes_received = 0;
+    peer_local_l2cap_cid = 0;
+    peer_dlci = 0;
+    peer_max_frame_size = 0;
+    peer_credits = 0;
+    peer_credits_window = 40;
+    peer_frames_to_grant = 0;
+    peer_bytes_received = 0;
+    peer_frames_received = 0;
+    memset(test_data, 0x55, sizeof(test_data));
+
+    btstack_run_loop_init(&sim_run_loop);
+    btstack_memory_init();
+    hci_transport_virtual_set_bd_addr(local_addr);
+    hci_transport_virtual_set_link_rate(LINK_RATE);
+    hci_transport_virtual_set_link_latency(link_latency_ms);
+    hci_transport_virtual_set_air_interface(&air_send_pdu);
+    hci_init(hci_transport_virtual_instance(), NULL);
+    gap_set_security_level(LEVEL_0);
+    l2cap_init();
+    rfcomm_init();
+    hci_event_callback_registration.callback = &hci_packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+    hci_power_control(HCI_POWER_ON);
+    sim_run(100);
+}
+
+static void sim_open_channel(void){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, rfcomm_create_channel(&rfcomm_packet_handler, (uint8_t *) peer_addr, SERVER_CHANNEL, &rfcomm_cid));
+    sim_run(10);
+    peer_accept_classic_connection();
+    sim_run(10);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, connection_complete_status);
+    int i;
+    for (i = 0; i < 100; i++){
+        peer_process_air_pdus();
+        sim_run(ROUND_MS);
+        if (channels_opened > 0) break;
+    }
+    CHECK_EQUAL(1, channels_opened);
+    CHECK_EQUAL(SERVER_CHANNEL << 1, peer_dlci);
+    sim_run(100);
+    peer_process_air_pdus();
+}
+
+static void sim_close(void){
+    hci_power_control(HCI_POWER_OFF);
+    sim_run(100);
+    rfcomm_deinit();
+    l2cap_deinit();
+    hci_deinit();
+    btstack_run_loop_deinit();
+}
+
+static void sim_report(const char * name, uint32_t bytes, uint16_t frame_size){
+    uint32_t kbps = (bytes * 8u) / STREAM_MS;
+    printf("%-8s frame size %3u: %6u bytes in %u ms, goodput %4u kbit/s, %4.1f%% of link rate\n",
+           name, frame_size, bytes, STREAM_MS, kbps, 100.0 * kbps * 1000 / LINK_RATE);
+}
+
+TEST_GROUP(RFCOMM_Virtual){
+    void setup(void){
+    }
+    void teardown(void){
+        sim_close();
+    }
+};
+
+TEST(RFCOMM_Virtual, LookupByCid){
+    sim_power_on(5);
+    sim_open_channel();
+    CHECK(rfcomm_get_max_frame_size(rfcomm_cid) > 0);
+    CHECK_EQUAL(0, rfcomm_get_max_frame_size(rfcomm_cid + 1));
+
+    // second channel to same server channel is rejected, other server channel uses open multiplexer
+    uint16_t cid;
+    CHECK_EQUAL(RFCOMM_CHANNEL_ALREADY_REGISTERED, rfcomm_create_channel(&rfcomm_packet_handler, (uint8_t *) peer_addr, SERVER_CHANNEL, &cid));
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, rfcomm_create_channel(&rfcomm_packet_handler, (uint8_t *) peer_addr, SERVER_CHANNEL + 1, &cid));
+    CHECK(cid != rfcomm_cid);
+}
+
+// local device streams with max frame size like spp_streamer, peer grants credits per half window
+TEST(RFCOMM_Virtual, SppStreamerGoodput){
+    sim_power_on(5);
+    sim_open_channel();
+    local_streaming = 1;
+    rfcomm_request_can_send_now_event(rfcomm_cid);
+    int round;
+    for (round = 0; round < (STREAM_MS / ROUND_MS); round++){
+        sim_run(ROUND_MS);
+        peer_process_air_pdus();
+    }
+    local_streaming = 0;
+    sim_report("send", peer_bytes_received, rfcomm_mtu);
+    CHECK(peer_frames_received > 0);
+    CHECK_EQUAL(peer_frames_received * rfcomm_mtu, peer_bytes_received);
+    // RFCOMM, L2CAP and ACL headers use less than 5% of ACL payload
+    CHECK(((peer_bytes_received * 8u) / STREAM_MS) >= ((LINK_RATE / 1000u) * 90u / 100u));
+}
+
+// peer streams as fast as the link and our credits allow, credit round trip time is dominated by link latency
+TEST(RFCOMM_Virtual, SppReceiveGoodput){
+    sim_power_on(20);
+    sim_open_channel();
+    const uint16_t frame_size = 100;
+    // frame on air: ACL, L2CAP, RFCOMM header and FCS
+    const uint32_t frames_per_round = ((LINK_RATE / 8u) * ROUND_MS / 1000u) / (4u + 4u + 4u + frame_size + 1u);
+    uint32_t frames_sent = 0;
+    int round;
+    for (round = 0; round < (STREAM_MS / ROUND_MS); round++){
+        uint32_t i;
+        for (i = 0; (i < frames_per_round) && (peer_credits > 0); i++){
+            peer_send_data(frame_size);
+            frames_sent++;
+        }
+        sim_run(ROUND_MS);
+        peer_process_air_pdus();
+    }
+    sim_report("receive", local_bytes_received, frame_size);
+    CHECK_EQUAL(frames_sent * frame_size, local_bytes_received);
+#ifdef ENABLE_RFCOMM_CREDIT_AUTO_TUNING
+    // credits cover round trip time after ramp up
+    CHECK(frames_sent >= (frames_per_round * (STREAM_MS / ROUND_MS) * 90u / 100u));
+#endif
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
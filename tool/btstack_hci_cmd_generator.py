@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+
+import re
+import sys
+import os
+
+program_info = '''
+BTstack HCI Command Encoder Generator for BTstack
+Copyright 2016, BlueKitchen GmbH
+'''
+
+copyright = """/*
+ * Copyright (C) 2016 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+"""
+
+hfile_header_begin = """
+
+/*
+ *  hci_cmd_encoder.h
+ *
+ *  @brief HCI Command encoders, type-safe alternative to hci_cmd_create_from_template
+ *  @note  Don't edit - generated by tool/btstack_hci_cmd_generator.py
+ *
+ */
+
+#ifndef HCI_CMD_ENCODER_H
+#define HCI_CMD_ENCODER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include "btstack_util.h"
+#include "hci_cmd.h"
+#include <stdint.h>
+#include <string.h>
+
+/* API_START */
+
+"""
+
+hfile_header_end = """
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // HCI_CMD_ENCODER_H
+"""
+
+c_prototype = '''/**
+ * @brief Create HCI Command {command_name} in hci_cmd_buffer
+ * @param hci_cmd_buffer{param_docs}
+ * @return size of HCI Command
+ * @note: btstack_type {format}
+ */
+static inline uint16_t {fn_name}(uint8_t * hci_cmd_buffer{params}){{
+    little_endian_store_16(hci_cmd_buffer, 0, {opcode});
+    hci_cmd_buffer[2] = {param_len};
+{code}    return {size};
+}}
+'''
+
+c_prototype_name = '''    uint16_t {name}_len = (uint16_t) strlen({name});
+    if ({name}_len > 248u) {{
+        {name}_len = 248;
+    }}
+    (void)memcpy(&hci_cmd_buffer[{offset}], {name}, {name}_len);
+    memset(&hci_cmd_buffer[{offset} + {name}_len], 0u, 248u - {name}_len);
+'''
+
+param_types = {
+    '1' : 'uint8_t',
+    '2' : 'uint16_t',
+    '3' : 'uint32_t',
+    '4' : 'uint32_t',
+    'H' : 'hci_con_handle_t',
+    'B' : 'const bd_addr_t',
+    'D' : 'const uint8_t *',
+    'E' : 'const uint8_t *',
+    'N' : 'const char *',
+    'P' : 'const uint8_t *',
+    'A' : 'const uint8_t *',
+    'Q' : 'const uint8_t *',
+}
+
+param_sizes = { '1' : 1, '2' : 2, '3' : 3, '4' : 4, 'H' : 2, 'B' : 6, 'D' : 8, 'E' : 240, 'N' : 248, 'P' : 16, 'A' : 31, 'Q' : 32 }
+
+param_write = {
+    '1' : '    hci_cmd_buffer[{offset}] = {name};\n',
+    '2' : '    little_endian_store_16(hci_cmd_buffer, {offset}, {name});\n',
+    '3' : '    little_endian_store_24(hci_cmd_buffer, {offset}, {name});\n',
+    '4' : '    little_endian_store_32(hci_cmd_buffer, {offset}, {name});\n',
+    'H' : '    little_endian_store_16(hci_cmd_buffer, {offset}, {name});\n',
+    'B' : '    reverse_bd_addr({name}, &hci_cmd_buffer[{offset}]);\n',
+    'D' : '    (void)memcpy(&hci_cmd_buffer[{offset}], {name}, 8);\n',
+    'E' : '    (void)memcpy(&hci_cmd_buffer[{offset}], {name}, 240);\n',
+    'N' : c_prototype_name,
+    'P' : '    (void)memcpy(&hci_cmd_buffer[{offset}], {name}, 16);\n',
+    'A' : '    (void)memcpy(&hci_cmd_buffer[{offset}], {name}, 31);\n',
+    'Q' : '    reverse_bytes({name}, &hci_cmd_buffer[{offset}], 32);\n',
+}
+
+def parse_commands(path):
+    # returns list of (command_name, opcode, format, params, preprocessor conditions)
+    commands = []
+    conditions = []
+    params = []
+    command_name = None
+    with open (path, 'rt') as fin:
+        for line in fin:
+            # track preprocessor conditions
+            parts = re.match('\s*#\s*if(n?def)?\s+(.*)', line)
+            if parts:
+                conditions.append(line.strip())
+                continue
+            if re.match('\s*#\s*endif', line):
+                conditions.pop()
+                continue
+
+            parts = re.match('.*@param\s*(\w*)\s*', line)
+            if parts and len(parts.groups()) == 1:
+                params.append(parts.groups()[0].lower())
+                continue
+
+            declaration = re.match('const\s+hci_cmd_t\s+(\w+)[\s=]+', line)
+            if declaration:
+                command_name = declaration.groups()[0]
+                continue
+
+            definition = re.match('\s*(HCI_OPCODE_\w+|0x[0-9a-fA-F]+)\s*,\s*\\"(\w*)\\".*', line)
+            if definition:
+                (opcode, format) = definition.groups()
+                if '#if 0' not in conditions:
+                    if len(params) != len(format):
+                        params = ['arg%u' % (i+1) for i in range(len(format))]
+                    commands.append((command_name, opcode, format, params, list(conditions)))
+                params = []
+                continue
+    return commands
+
+def create_encoder(command_name, opcode, format, params):
+    # hci_le_rand -> hci_cmd_create_le_rand
+    base_name = command_name[4:] if command_name.startswith('hci_') else command_name
+    fn_name = 'hci_cmd_create_' + base_name
+    param_docs = ''
+    param_list = ''
+    code = ''
+    offset = 3
+    for field_type, name in zip(format, params):
+        param_docs += '\n * @param %s' % name
+        param_list += ', %s %s' % (param_types[field_type], name)
+        code += param_write[field_type].format(offset=offset, name=name)
+        offset += param_sizes[field_type]
+    return c_prototype.format(command_name=command_name.upper(), param_docs=param_docs, fn_name=fn_name, params=param_list,
+                              opcode=opcode, param_len=offset-3, code=code, size=offset, format=format)
+
+def create_encoders(commands):
+    global gen_path
+    with open(gen_path, 'wt') as fout:
+        fout.write(copyright)
+        fout.write(hfile_header_begin)
+        active_conditions = []
+        for command_name, opcode, format, params, conditions in commands:
+            # close and open preprocessor conditions as needed
+            if conditions != active_conditions:
+                for _ in active_conditions:
+                    fout.write('#endif\n\n')
+                for condition in conditions:
+                    fout.write(condition + '\n')
+                active_conditions = conditions
+            fout.write(create_encoder(command_name, opcode, format, params))
+            fout.write('\n')
+        for _ in active_conditions:
+            fout.write('#endif\n')
+        fout.write(hfile_header_end)
+
+btstack_root = os.path.abspath(os.path.dirname(sys.argv[0]) + '/..')
+gen_path = btstack_root + '/src/hci_cmd_encoder.h'
+
+print(program_info)
+
+# parse commands
+commands = parse_commands(btstack_root + '/src/hci_cmd.c')
+
+# create encoder for each command
+create_encoders(commands)
+
+# done
+print('Done!')
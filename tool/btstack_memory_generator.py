@@ -142,7 +142,10 @@ static btstack_memory_buffer_t * btstack_memory_malloc_buffers;
 
 static void btstack_memory_tracking_add(btstack_memory_buffer_t * buffer){
     btstack_assert(buffer != NULL);
-    btstack_memory_malloc_buffers = buffer;
+    if (btstack_memory_malloc_buffers != NULL) {
+        // let current first item prev point to new first item
+        btstack_memory_malloc_buffers->prev = buffer;
+    }
     buffer->prev = NULL;
     buffer->next = btstack_memory_malloc_buffers;
     btstack_memory_malloc_buffers = buffer;
@@ -248,10 +251,18 @@ def replacePlaceholder(template, struct_name):
         pool_count = "MAX_NR_" + struct_name.upper() + "S"
     pool_count_old_no = pool_count.replace("MAX_NR_", "MAX_NO_")
     snippet = template.replace("STRUCT_TYPE", struct_type).replace("STRUCT_NAME", struct_name).replace("POOL_COUNT_OLD_NO", pool_count_old_no).replace("POOL_COUNT", pool_count)
+    if struct_name in list_of_uncleared_structs:
+        snippet = snippet.replace("    if (buffer){\n        memset(buffer, 0, sizeof(%s));\n    }\n" % struct_type, "")
+        snippet = snippet.replace("        memset(buffer, 0, sizeof(%s));\n" % struct_type, "")
     return snippet
+
+# data buffers are not cleared on allocation, their users initialize the relevant fields
+list_of_uncleared_structs = [
+    "hci_acl_recombination_buffer",
+]
     
 list_of_structs = [
-    ["hci_connection"],
+    ["hci_connection", "hci_acl_recombination_buffer"],
     ["l2cap_service", "l2cap_channel"],
 ]
 list_of_classic_structs = [